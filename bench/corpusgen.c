@@ -0,0 +1,765 @@
+/* -------------------------------------------------------------------------- */
+/* corpusgen                                                                  */
+/* writes a synthetic corpus of image files with exif data for benchmarks.    */
+/*                                                                            */
+/*    usage: corpusgen <dir> [count] [seed]                                   */
+/*                                                                            */
+/* the files cycle through intel and motorola byte order, ifd0 sizes from 4   */
+/* to 200 extra tags, large maker notes, app1 placed after app0 and app2      */
+/* segments and an xmp packet after app1, and gps-heavy files. every seventh  */
+/* file is a plain tiff file.                                                 */
+/* of the others, every eleventh is a heif file, every thirteenth a png file  */
+/* and every seventeenth a webp file, all with the exif data after the image. */
+/* the variant is part of the file name, e.g. moto_ifd064_mn_late_gps.jpg.    */
+/* -------------------------------------------------------------------------- */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define CORPUS_DEFAULT_COUNT 1000
+#define CORPUS_MAX_ENTRIES 256
+#define CORPUS_MAKERNOTE_SIZE 56000
+#define CORPUS_ICC_SIZE 3144
+#define CORPUS_XMP_HEADER "http://ns.adobe.com/xap/1.0/"
+#define CORPUS_XMP                                                          \
+    "<x:xmpmeta xmlns:x=\"adobe:ns:meta/\"><rdf:RDF><rdf:Description "      \
+    "xmp:Rating=\"3\" xmp:CreatorTool=\"corpusgen\"><dc:subject>"           \
+    "<rdf:Bag><rdf:li>bench</rdf:li><rdf:li>corpus</rdf:li></rdf:Bag>"      \
+    "</dc:subject></rdf:Description></rdf:RDF></x:xmpmeta>"
+
+#define TYPE_BYTE 1
+#define TYPE_ASCII 2
+#define TYPE_SHORT 3
+#define TYPE_LONG 4
+#define TYPE_RATIONAL 5
+#define TYPE_UNDEFINED 7
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct buffer {
+    unsigned char *data;
+    long int length;
+    long int capacity;
+    int moto;
+};
+
+struct entry {
+    int tag;
+    int type;
+    long int count;
+    unsigned char *data;
+    long int dataLength;
+    long int valuePos;
+};
+
+struct ifd {
+    struct entry entries[CORPUS_MAX_ENTRIES];
+    int entryCount;
+};
+
+struct variant {
+    int moto;
+    int fillerTags;
+    int makerNote;
+    int app1Late;
+    int gps;
+    int gpsHeavy;
+    int tiff;
+    int heif;
+    int png;
+    int webp;
+};
+
+/* -------------------------------------------------------------------------- */
+/* functions                                                                  */
+/* -------------------------------------------------------------------------- */
+
+static void putBytes(struct buffer *buf, void *bytes, long int length);
+static void put16(struct buffer *buf, long int value);
+static void put32(struct buffer *buf, long int value);
+static void patch32(struct buffer *buf, long int pos, long int value);
+static void encode16(unsigned char *bytes, long int value, int moto);
+static void encode32(unsigned char *bytes, long int value, int moto);
+
+static struct entry *addEntry(struct ifd *ifd, int tag, int type,
+                              long int count, long int dataLength);
+static void addAscii(struct ifd *ifd, int tag, char *value);
+static void addShort(struct ifd *ifd, int tag, long int value, int moto);
+static void addLong(struct ifd *ifd, int tag, long int value, int moto);
+static void addRationals(struct ifd *ifd, int tag, long int *values,
+                         long int count, int moto);
+static void addBytes(struct ifd *ifd, int tag, int type, unsigned char *bytes,
+                     long int count);
+static long int writeIfd(struct buffer *buf, struct ifd *ifd);
+static void freeIfd(struct ifd *ifd);
+
+static void buildTiff(struct buffer *tiff, struct variant *v, long int n);
+static void writeFile(char *dir, struct variant *v, long int n);
+static void writeHeif(struct buffer *file, struct buffer *tiff);
+static void writePng(struct buffer *file, struct buffer *tiff);
+static void putPngChunk(struct buffer *file, char *type, void *data,
+                        long int length);
+static void writeWebp(struct buffer *file, struct buffer *tiff);
+static unsigned long int crc32(unsigned char *bytes, long int length);
+static unsigned long int nextRandom(void);
+
+/* -------------------------------------------------------------------------- */
+
+static unsigned long int randomState = 1;
+
+/* -------------------------------------------------------------------------- */
+/* main                                                                       */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char *argv[]) {
+    long int i = 0;
+    long int count = CORPUS_DEFAULT_COUNT;
+    static int fillerTags[4] = {4, 16, 64, 200};
+
+    struct variant v;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: corpusgen <dir> [count] [seed]\n");
+        return 1;
+    }
+
+    if (argc > 2) count = atol(argv[2]);
+    if (argc > 3) randomState = strtoul(argv[3], NULL, 10);
+    if (randomState == 0) randomState = 1;
+
+    if (mkdir(argv[1], 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "corpusgen: can not create '%s'\n", argv[1]);
+        return 1;
+    }
+
+    for (i = 0; i < count; i++) {
+        v.moto = i % 2;
+        v.fillerTags = fillerTags[(i / 2) % 4];
+        v.makerNote = i % 5 == 0;
+        v.app1Late = i % 3 == 0;
+        v.gps = i % 4 != 3;
+        v.gpsHeavy = i % 4 == 1;
+        v.tiff = i % 7 == 6;
+        v.heif = i % 11 == 10 && !v.tiff;
+        v.png = i % 13 == 12 && !v.tiff && !v.heif;
+        v.webp = i % 17 == 16 && !v.tiff && !v.heif && !v.png;
+
+        writeFile(argv[1], &v, i);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeFile                                                                  */
+/* writes file number "n" of variant "v" to "dir". jpg files get an app1      */
+/* block with the tiff structure and a random payload after the start of      */
+/* scan.                                                                      */
+/* -------------------------------------------------------------------------- */
+
+static void writeFile(char *dir, struct variant *v, long int n) {
+    long int i = 0;
+    long int payloadLength = 0;
+    char fileName[4096];
+    unsigned char byte = 0;
+
+    struct buffer tiff = {NULL, 0, 0, (*v).moto};
+    struct buffer file = {NULL, 0, 0, 1};
+
+    FILE *fp = NULL;
+
+    snprintf(fileName, sizeof(fileName), "%s/%s_ifd%03d%s%s%s_%06ld.%s", dir,
+             (*v).moto ? "moto" : "intel", (*v).fillerTags,
+             (*v).makerNote ? "_mn" : "", (*v).app1Late ? "_late" : "",
+             (*v).gpsHeavy ? "_gpsheavy" : ((*v).gps ? "_gps" : ""), n,
+             (*v).tiff   ? "tif"
+             : (*v).heif ? "heic"
+             : (*v).png  ? "png"
+             : (*v).webp ? "webp"
+                         : "jpg");
+
+    buildTiff(&tiff, v, n);
+
+    /* a tiff file is the tiff structure followed by some image data */
+
+    if ((*v).tiff) {
+        putBytes(&file, tiff.data, tiff.length);
+        for (i = 0; i < 4096; i++) {
+            byte = nextRandom() & 0xFF;
+            putBytes(&file, &byte, 1);
+        }
+    }
+
+    /* a heif file puts it into an exif item */
+
+    else if ((*v).heif)
+        writeHeif(&file, &tiff);
+
+    /* png and webp put it into a chunk */
+
+    else if ((*v).png)
+        writePng(&file, &tiff);
+
+    else if ((*v).webp)
+        writeWebp(&file, &tiff);
+
+    /* a jpg file wraps it into app1 */
+
+    else {
+        put16(&file, 0xFFD8);
+
+        if ((*v).app1Late) {
+            put16(&file, 0xFFE0);
+            put16(&file, 16);
+            putBytes(&file, "JFIF\0\1\1\0\0\1\0\1\0\0", 14);
+
+            put16(&file, 0xFFE2);
+            put16(&file, CORPUS_ICC_SIZE + 2);
+            putBytes(&file, "ICC_PROFILE\0\1\1", 14);
+            for (i = 14; i < CORPUS_ICC_SIZE; i++) {
+                byte = nextRandom() & 0xFF;
+                putBytes(&file, &byte, 1);
+            }
+        }
+
+        put16(&file, 0xFFE1);
+        put16(&file, tiff.length + 8);
+        putBytes(&file, "Exif\0\0", 6);
+        putBytes(&file, tiff.data, tiff.length);
+
+        if ((*v).app1Late) {
+            put16(&file, 0xFFE1);
+            put16(&file, sizeof(CORPUS_XMP_HEADER) + sizeof(CORPUS_XMP) + 1);
+            putBytes(&file, CORPUS_XMP_HEADER, sizeof(CORPUS_XMP_HEADER));
+            putBytes(&file, CORPUS_XMP, sizeof(CORPUS_XMP) - 1);
+        }
+
+        put16(&file, 0xFFDA);
+        put16(&file, 8);
+        putBytes(&file, "\1\1\0\0\77\0", 6);
+
+        payloadLength = 4096 + nextRandom() % 61440;
+        for (i = 0; i < payloadLength; i++) {
+            byte = nextRandom() & 0xFF;
+            if (byte == 0xFF) byte = 0xFE;  // keep markers out of the payload
+            putBytes(&file, &byte, 1);
+        }
+
+        put16(&file, 0xFFD9);
+    }
+
+    if ((fp = fopen(fileName, "w")) == NULL ||
+        fwrite(file.data, 1, file.length, fp) != file.length) {
+        fprintf(stderr, "corpusgen: can not write '%s'\n", fileName);
+        exit(1);
+    }
+
+    fclose(fp);
+    free(tiff.data);
+    free(file.data);
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeHeif                                                                  */
+/* writes a heif file with an image item and an exif item holding "tiff" to   */
+/* "file". the meta box comes first, the mdat box holds some image data       */
+/* followed by the exif item.                                                 */
+/* -------------------------------------------------------------------------- */
+
+static void writeHeif(struct buffer *file, struct buffer *tiff) {
+    long int i = 0;
+    long int imagePos = 0;
+    long int exifPos = 0;
+    unsigned char byte = 0;
+
+    long int ftypLength = 24;
+    long int hdlrLength = 33;
+    long int infeLength = 21;
+    long int iinfLength = 14 + 2 * infeLength;
+    long int ilocLength = 16 + 2 * 14;
+    long int metaLength = 12 + hdlrLength + iinfLength + ilocLength;
+
+    imagePos = ftypLength + metaLength + 8;
+    exifPos = imagePos + 4096;
+
+    put32(file, ftypLength);
+    putBytes(file, "ftypheic\0\0\0\0mif1heic", 20);
+
+    put32(file, metaLength);
+    putBytes(file, "meta\0\0\0\0", 8);
+
+    put32(file, hdlrLength);
+    putBytes(file, "hdlr\0\0\0\0\0\0\0\0pict\0\0\0\0\0\0\0\0\0\0\0\0\0", 29);
+
+    /* item 1 is the image, item 2 the exif data */
+
+    put32(file, iinfLength);
+    putBytes(file, "iinf\0\0\0\0", 8);
+    put16(file, 2);
+
+    put32(file, infeLength);
+    putBytes(file, "infe\2\0\0\0\0\1\0\0hvc1\0", 17);
+    put32(file, infeLength);
+    putBytes(file, "infe\2\0\0\0\0\2\0\0Exif\0", 17);
+
+    /* version 0, 4 byte offsets and lengths, no base offset */
+
+    put32(file, ilocLength);
+    putBytes(file, "iloc\0\0\0\0\x44\0", 10);
+    put16(file, 2);
+
+    put16(file, 1);
+    put16(file, 0);
+    put16(file, 1);
+    put32(file, imagePos);
+    put32(file, 4096);
+
+    put16(file, 2);
+    put16(file, 0);
+    put16(file, 1);
+    put32(file, exifPos);
+    put32(file, 10 + (*tiff).length);
+
+    /* image data, then the exif item with the offset of the tiff header */
+
+    put32(file, 8 + 4096 + 10 + (*tiff).length);
+    putBytes(file, "mdat", 4);
+
+    for (i = 0; i < 4096; i++) {
+        byte = nextRandom() & 0xFF;
+        putBytes(file, &byte, 1);
+    }
+
+    put32(file, 6);
+    putBytes(file, "Exif\0\0", 6);
+    putBytes(file, (*tiff).data, (*tiff).length);
+}
+
+/* -------------------------------------------------------------------------- */
+/* writePng                                                                   */
+/* writes a png file with an ihdr chunk, some image data and an exif chunk    */
+/* holding "tiff" to "file".                                                  */
+/* -------------------------------------------------------------------------- */
+
+static void writePng(struct buffer *file, struct buffer *tiff) {
+    long int i = 0;
+    unsigned char image[4096];
+
+    putBytes(file, "\211PNG\r\n\32\n", 8);
+    putPngChunk(file, "IHDR", "\0\0\0\100\0\0\0\100\10\2\0\0\0", 13);
+
+    for (i = 0; i < 4096; i++) image[i] = nextRandom() & 0xFF;
+
+    putPngChunk(file, "IDAT", image, 4096);
+    putPngChunk(file, "eXIf", (*tiff).data, (*tiff).length);
+    putPngChunk(file, "IEND", "", 0);
+}
+
+static void putPngChunk(struct buffer *file, char *type, void *data,
+                        long int length) {
+    long int start = 0;
+
+    put32(file, length);
+
+    start = (*file).length;
+
+    putBytes(file, type, 4);
+    putBytes(file, data, length);
+    put32(file, crc32((*file).data + start, length + 4));
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeWebp                                                                  */
+/* writes an extended webp file with a vp8x chunk, some image data and an     */
+/* exif chunk holding "tiff" to "file". riff sizes are little endian.         */
+/* -------------------------------------------------------------------------- */
+
+static void writeWebp(struct buffer *file, struct buffer *tiff) {
+    long int i = 0;
+    long int exifLength = (*tiff).length + ((*tiff).length & 1);
+    unsigned char byte = 0;
+
+    (*file).moto = 0;
+
+    putBytes(file, "RIFF", 4);
+    put32(file, 4 + 18 + 8 + 4096 + 8 + exifLength);
+    putBytes(file, "WEBP", 4);
+
+    /* the exif flag is set in vp8x */
+
+    putBytes(file, "VP8X", 4);
+    put32(file, 10);
+    putBytes(file, "\10\0\0\0\77\0\0\77\0\0", 10);
+
+    putBytes(file, "VP8 ", 4);
+    put32(file, 4096);
+
+    for (i = 0; i < 4096; i++) {
+        byte = nextRandom() & 0xFF;
+        putBytes(file, &byte, 1);
+    }
+
+    putBytes(file, "EXIF", 4);
+    put32(file, (*tiff).length);
+    putBytes(file, (*tiff).data, (*tiff).length);
+
+    byte = 0;
+    if ((*tiff).length & 1) putBytes(file, &byte, 1);
+
+    (*file).moto = 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* crc32                                                                      */
+/* returns the crc of png chunks over the "length" bytes at "bytes".          */
+/* -------------------------------------------------------------------------- */
+
+static unsigned long int crc32(unsigned char *bytes, long int length) {
+    long int i = 0;
+    long int j = 0;
+    unsigned long int crc = 0xFFFFFFFF;
+
+    for (i = 0; i < length; i++) {
+        crc = crc ^ bytes[i];
+        for (j = 0; j < 8; j++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+/* -------------------------------------------------------------------------- */
+/* buildTiff                                                                  */
+/* writes the tiff header, ifd0, the exif ifd and the gps ifd of file number  */
+/* "n" of variant "v" to "tiff". offsets are relative to the tiff header.     */
+/* -------------------------------------------------------------------------- */
+
+static void buildTiff(struct buffer *tiff, struct variant *v, long int n) {
+    long int i = 0;
+    long int exifPointerPos = 0;
+    long int gpsPointerPos = 0;
+    long int rationals[6];
+    char text[64];
+    unsigned char *makerNote = NULL;
+    static char *makes[4] = {"NIKON", "Canon", "SONY", "FUJIFILM"};
+    static char *models[4] = {"D850", "EOS R5", "ILCE-7M4", "X-T5"};
+
+    struct ifd *ifd0 = calloc(1, sizeof(struct ifd));
+    struct ifd *exif = calloc(1, sizeof(struct ifd));
+    struct ifd *gps = calloc(1, sizeof(struct ifd));
+
+    int moto = (*v).moto;
+
+    /* ifd0 */
+
+    addAscii(ifd0, 0x010f, makes[n % 4]);
+    addAscii(ifd0, 0x0110, models[n % 4]);
+    addShort(ifd0, 0x0112, 1 + n % 8, moto);
+    rationals[0] = 300;
+    rationals[1] = 1;
+    addRationals(ifd0, 0x011a, rationals, 1, moto);
+    addRationals(ifd0, 0x011b, rationals, 1, moto);
+    snprintf(text, sizeof(text), "20%02ld:%02ld:%02ld 12:%02ld:%02ld",
+             10 + n % 14, 1 + n % 12, 1 + n % 28, n % 60, (n / 60) % 60);
+    addAscii(ifd0, 0x0132, text);
+    addAscii(ifd0, 0x013b, "corpusgen");
+    addLong(ifd0, 0x8769, 0, moto);
+    if ((*v).gps) addLong(ifd0, 0x8825, 0, moto);
+
+    for (i = 0; i < (*v).fillerTags; i++) {
+        if (i % 2)
+            addShort(ifd0, 0xc000 + i, i, moto);
+        else {
+            snprintf(text, sizeof(text), "filler value %ld", i);
+            addAscii(ifd0, 0xc000 + i, text);
+        }
+    }
+
+    /* exif ifd */
+
+    snprintf(text, sizeof(text), "20%02ld:%02ld:%02ld 12:%02ld:%02ld",
+             10 + n % 14, 1 + n % 12, 1 + n % 28, n % 60, (n / 60) % 60);
+    addAscii(exif, 0x9003, text);
+    addAscii(exif, 0x9004, text);
+    rationals[0] = 1;
+    rationals[1] = 250;
+    addRationals(exif, 0x829a, rationals, 1, moto);
+    rationals[0] = 28;
+    rationals[1] = 10;
+    addRationals(exif, 0x829d, rationals, 1, moto);
+    addShort(exif, 0x8827, 100 << (n % 6), moto);
+    rationals[0] = 24 + n % 176;
+    rationals[1] = 1;
+    addRationals(exif, 0x920a, rationals, 1, moto);
+    snprintf(text, sizeof(text), "%032lx", n * 2654435761UL);
+    addAscii(exif, 0xa420, text);
+    snprintf(text, sizeof(text), "%08ld", 3000000 + n % 7);
+    addAscii(exif, 0xa431, text);
+
+    if ((*v).makerNote) {
+        makerNote = malloc(CORPUS_MAKERNOTE_SIZE);
+        for (i = 0; i < CORPUS_MAKERNOTE_SIZE; i++)
+            makerNote[i] = nextRandom() & 0xFF;
+        memcpy(makerNote, "Nikon\0\2\0\0\0", 10);
+        addBytes(exif, 0x927c, TYPE_UNDEFINED, makerNote,
+                 CORPUS_MAKERNOTE_SIZE);
+        free(makerNote);
+    }
+
+    /* gps ifd */
+
+    if ((*v).gps) {
+        addBytes(gps, 0x0000, TYPE_BYTE, (unsigned char *)"\2\3\0\0", 4);
+        addAscii(gps, 0x0001, n % 2 ? "N" : "S");
+        rationals[0] = n % 90;
+        rationals[1] = 1;
+        rationals[2] = n % 60;
+        rationals[3] = 1;
+        rationals[4] = 1234;
+        rationals[5] = 100;
+        addRationals(gps, 0x0002, rationals, 3, moto);
+        addAscii(gps, 0x0003, n % 3 ? "E" : "W");
+        rationals[0] = n % 180;
+        addRationals(gps, 0x0004, rationals, 3, moto);
+        addBytes(gps, 0x0005, TYPE_BYTE, (unsigned char *)"\0", 1);
+        rationals[0] = 520;
+        rationals[1] = 1;
+        addRationals(gps, 0x0006, rationals, 1, moto);
+        rationals[0] = 12;
+        rationals[2] = n % 60;
+        rationals[4] = 0;
+        rationals[5] = 1;
+        addRationals(gps, 0x0007, rationals, 3, moto);
+        snprintf(text, sizeof(text), "20%02ld:%02ld:%02ld", 10 + n % 14,
+                 1 + n % 12, 1 + n % 28);
+        addAscii(gps, 0x001d, text);
+
+        if ((*v).gpsHeavy) {
+            addAscii(gps, 0x0008, "05 07 12 15 19 24 26 29");
+            addAscii(gps, 0x0009, "A");
+            addAscii(gps, 0x000a, "3");
+            rationals[0] = 12;
+            rationals[1] = 10;
+            addRationals(gps, 0x000b, rationals, 1, moto);
+            addAscii(gps, 0x000c, "K");
+            addRationals(gps, 0x000d, rationals, 1, moto);
+            addAscii(gps, 0x000e, "T");
+            addRationals(gps, 0x000f, rationals, 1, moto);
+            addAscii(gps, 0x0010, "M");
+            addRationals(gps, 0x0011, rationals, 1, moto);
+            addAscii(gps, 0x0012, "WGS-84");
+            addAscii(gps, 0x0013, "N");
+            rationals[0] = 48;
+            rationals[2] = 8;
+            rationals[4] = 3000;
+            rationals[5] = 100;
+            addRationals(gps, 0x0014, rationals, 3, moto);
+            addAscii(gps, 0x0015, "E");
+            addRationals(gps, 0x0016, rationals, 3, moto);
+            addAscii(gps, 0x001b, "ASCII\0\0\0GPS");
+            addShort(gps, 0x001e, 0, moto);
+        }
+    }
+
+    /* header, then ifd0, exif and gps ifd */
+
+    put16(tiff, moto ? 0x4D4D : 0x4949);
+    put16(tiff, 42);
+    put32(tiff, 8);
+
+    writeIfd(tiff, ifd0);
+
+    for (i = 0; i < (*ifd0).entryCount; i++) {
+        if ((*ifd0).entries[i].tag == 0x8769)
+            exifPointerPos = (*ifd0).entries[i].valuePos;
+        if ((*ifd0).entries[i].tag == 0x8825)
+            gpsPointerPos = (*ifd0).entries[i].valuePos;
+    }
+
+    patch32(tiff, exifPointerPos, writeIfd(tiff, exif));
+    if ((*v).gps) patch32(tiff, gpsPointerPos, writeIfd(tiff, gps));
+
+    freeIfd(ifd0);
+    freeIfd(exif);
+    freeIfd(gps);
+    free(ifd0);
+    free(exif);
+    free(gps);
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeIfd                                                                   */
+/* appends "ifd" and the values that do not fit into the entries to "buf".    */
+/* returns the position of the ifd.                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int writeIfd(struct buffer *buf, struct ifd *ifd) {
+    long int i = 0;
+    long int ifdPos = 0;
+    unsigned char zero[4] = {0, 0, 0, 0};
+
+    struct entry *entry = NULL;
+
+    if ((*buf).length % 2) putBytes(buf, zero, 1);
+
+    ifdPos = (*buf).length;
+
+    put16(buf, (*ifd).entryCount);
+
+    for (i = 0; i < (*ifd).entryCount; i++) {
+        entry = &(*ifd).entries[i];
+
+        put16(buf, (*entry).tag);
+        put16(buf, (*entry).type);
+        put32(buf, (*entry).count);
+
+        (*entry).valuePos = (*buf).length;
+
+        if ((*entry).dataLength <= 4) {
+            putBytes(buf, (*entry).data, (*entry).dataLength);
+            putBytes(buf, zero, 4 - (*entry).dataLength);
+        } else
+            put32(buf, 0);
+    }
+
+    put32(buf, 0);
+
+    /* values that do not fit into the entries */
+
+    for (i = 0; i < (*ifd).entryCount; i++) {
+        entry = &(*ifd).entries[i];
+
+        if ((*entry).dataLength <= 4) continue;
+
+        if ((*buf).length % 2) putBytes(buf, zero, 1);
+
+        patch32(buf, (*entry).valuePos, (*buf).length);
+        putBytes(buf, (*entry).data, (*entry).dataLength);
+    }
+
+    return ifdPos;
+}
+
+/* -------------------------------------------------------------------------- */
+/* entry helpers                                                              */
+/* -------------------------------------------------------------------------- */
+
+static struct entry *addEntry(struct ifd *ifd, int tag, int type,
+                              long int count, long int dataLength) {
+    struct entry *entry = &(*ifd).entries[(*ifd).entryCount];
+
+    (*ifd).entryCount = (*ifd).entryCount + 1;
+
+    (*entry).tag = tag;
+    (*entry).type = type;
+    (*entry).count = count;
+    (*entry).dataLength = dataLength;
+    (*entry).data = calloc(1, dataLength > 4 ? dataLength : 4);
+
+    return entry;
+}
+
+static void addAscii(struct ifd *ifd, int tag, char *value) {
+    long int length = strlen(value) + 1;
+
+    memcpy((*addEntry(ifd, tag, TYPE_ASCII, length, length)).data, value,
+           length);
+}
+
+static void addShort(struct ifd *ifd, int tag, long int value, int moto) {
+    encode16((*addEntry(ifd, tag, TYPE_SHORT, 1, 2)).data, value, moto);
+}
+
+static void addLong(struct ifd *ifd, int tag, long int value, int moto) {
+    encode32((*addEntry(ifd, tag, TYPE_LONG, 1, 4)).data, value, moto);
+}
+
+static void addRationals(struct ifd *ifd, int tag, long int *values,
+                         long int count, int moto) {
+    long int i = 0;
+    struct entry *entry = addEntry(ifd, tag, TYPE_RATIONAL, count, count * 8);
+
+    for (i = 0; i < count * 2; i++)
+        encode32((*entry).data + i * 4, values[i], moto);
+}
+
+static void addBytes(struct ifd *ifd, int tag, int type, unsigned char *bytes,
+                     long int count) {
+    memcpy((*addEntry(ifd, tag, type, count, count)).data, bytes, count);
+}
+
+static void freeIfd(struct ifd *ifd) {
+    long int i = 0;
+
+    for (i = 0; i < (*ifd).entryCount; i++) free((*ifd).entries[i].data);
+}
+
+/* -------------------------------------------------------------------------- */
+/* buffer helpers                                                             */
+/* -------------------------------------------------------------------------- */
+
+static void putBytes(struct buffer *buf, void *bytes, long int length) {
+    if ((*buf).length + length > (*buf).capacity) {
+        (*buf).capacity = ((*buf).length + length) * 2;
+        if (((*buf).data = realloc((*buf).data, (*buf).capacity)) == NULL) {
+            fprintf(stderr, "corpusgen: out of memory\n");
+            exit(1);
+        }
+    }
+
+    memcpy((*buf).data + (*buf).length, bytes, length);
+    (*buf).length = (*buf).length + length;
+}
+
+static void put16(struct buffer *buf, long int value) {
+    unsigned char bytes[2];
+
+    encode16(bytes, value, (*buf).moto);
+    putBytes(buf, bytes, 2);
+}
+
+static void put32(struct buffer *buf, long int value) {
+    unsigned char bytes[4];
+
+    encode32(bytes, value, (*buf).moto);
+    putBytes(buf, bytes, 4);
+}
+
+static void patch32(struct buffer *buf, long int pos, long int value) {
+    encode32((*buf).data + pos, value, (*buf).moto);
+}
+
+static void encode16(unsigned char *bytes, long int value, int moto) {
+    bytes[moto ? 0 : 1] = (value >> 8) & 0xFF;
+    bytes[moto ? 1 : 0] = value & 0xFF;
+}
+
+static void encode32(unsigned char *bytes, long int value, int moto) {
+    encode16(bytes + (moto ? 0 : 2), (value >> 16) & 0xFFFF, moto);
+    encode16(bytes + (moto ? 2 : 0), value & 0xFFFF, moto);
+}
+
+/* -------------------------------------------------------------------------- */
+/* nextRandom                                                                 */
+/* returns the next value of a xorshift generator, so a seed always gives     */
+/* the same corpus.                                                           */
+/* -------------------------------------------------------------------------- */
+
+static unsigned long int nextRandom(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+
+    return randomState;
+}
+
+/* -------------------------------------------------------------------------- */
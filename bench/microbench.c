@@ -0,0 +1,301 @@
+/* -------------------------------------------------------------------------- */
+/* microbench                                                                 */
+/* runs microbenchmarks of exiflib over the jpg files of a corpus directory.  */
+/*                                                                            */
+/*    usage: microbench <dir>                                                 */
+/*                                                                            */
+/* every benchmark repeats its operation over the whole corpus until at       */
+/* least BENCH_MIN_TIME has passed and reports ns/op and allocations/op.      */
+/* allocations are counted by wrapping malloc, calloc and realloc at link     */
+/* time, see the bench target of the makefile.                                */
+/* -------------------------------------------------------------------------- */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/exifextras.h"
+#include "../src/exiflib.h"
+#include "../src/exifparser.h"
+
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define BENCH_MIN_TIME 0.5
+#define BENCH_PATTERN "[Make]_[DateTimeOriginal;1:4]_[OldFileName]"
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct corpus {
+    char **fileNames;
+    long int fileCount;
+    struct exifItem **tables;
+    long int *tableItemCounts;
+};
+
+typedef long int (*benchFunction)(struct corpus *corpus);
+
+/* -------------------------------------------------------------------------- */
+/* functions                                                                  */
+/* -------------------------------------------------------------------------- */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+static long int loadCorpus(char *dir, struct corpus *corpus);
+static void runBench(char *name, benchFunction bench, struct corpus *corpus);
+static double now(void);
+
+static long int benchExtractExifInfo(struct corpus *corpus);
+static long int benchVisitExifInfo(struct corpus *corpus);
+static long int countTag(struct exifItem *item, void *arg);
+static long int benchParseTagData(struct corpus *corpus);
+static long int benchFindTagByName(struct corpus *corpus);
+static long int benchFileNameFromPattern(struct corpus *corpus);
+
+/* -------------------------------------------------------------------------- */
+/* variables                                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int allocCount = 0;
+
+static char *lookupNames[4] = {"Make", "DateTimeOriginal", "GPSLatitude",
+                               "Copyright"};
+
+/* -------------------------------------------------------------------------- */
+/* main                                                                       */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char *argv[]) {
+    struct corpus corpus;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: microbench <dir>\n");
+        return 1;
+    }
+
+    if (loadCorpus(argv[1], &corpus) <= 0) {
+        fprintf(stderr, "microbench: no jpg files in '%s'\n", argv[1]);
+        return 1;
+    }
+
+    printf("%ld files\n\n", corpus.fileCount);
+    printf("%-24s %12s %12s %14s\n", "benchmark", "ops", "ns/op",
+           "allocs/op");
+
+    runBench("extractExifInfo", benchExtractExifInfo, &corpus);
+    runBench("visitExifInfo", benchVisitExifInfo, &corpus);
+    runBench("parseTagData", benchParseTagData, &corpus);
+    runBench("findTagByName", benchFindTagByName, &corpus);
+    runBench("fileNameFromPattern", benchFileNameFromPattern, &corpus);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* loadCorpus                                                                 */
+/* reads the names of the jpg files in "dir" and extracts their exif tables   */
+/* once for the benchmarks that work on tables. returns the number of files.  */
+/* -------------------------------------------------------------------------- */
+
+static long int loadCorpus(char *dir, struct corpus *corpus) {
+    long int n = 0;
+    long int length = 0;
+
+    DIR *dp = NULL;
+    struct dirent *ep = NULL;
+
+    memset(corpus, 0, sizeof(struct corpus));
+
+    if ((dp = opendir(dir)) == NULL) return 0;
+
+    while ((ep = readdir(dp)) != NULL) {
+        length = strlen((*ep).d_name);
+
+        if (length < 4 || strcmp((*ep).d_name + length - 4, ".jpg") != 0)
+            continue;
+
+        n = (*corpus).fileCount;
+
+        (*corpus).fileNames =
+            realloc((*corpus).fileNames, sizeof(char *) * (n + 1));
+        (*corpus).tables =
+            realloc((*corpus).tables, sizeof(struct exifItem *) * (n + 1));
+        (*corpus).tableItemCounts =
+            realloc((*corpus).tableItemCounts, sizeof(long int) * (n + 1));
+
+        (*corpus).fileNames[n] = malloc(strlen(dir) + length + 2);
+        sprintf((*corpus).fileNames[n], "%s/%s", dir, (*ep).d_name);
+
+        (*corpus).tables[n] = NULL;
+        if (((*corpus).tableItemCounts[n] = extractExifInfo(
+                 (*corpus).fileNames[n], &(*corpus).tables[n])) < 0)
+            (*corpus).tableItemCounts[n] = 0;
+
+        (*corpus).fileCount = n + 1;
+    }
+
+    closedir(dp);
+
+    return (*corpus).fileCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* runBench                                                                   */
+/* repeats "bench" until BENCH_MIN_TIME has passed and prints the results.    */
+/* -------------------------------------------------------------------------- */
+
+static void runBench(char *name, benchFunction bench, struct corpus *corpus) {
+    long int ops = 0;
+    long int allocs = 0;
+    double start = 0;
+    double elapsed = 0;
+
+    /* warm up the page cache and the allocator */
+
+    bench(corpus);
+
+    allocCount = 0;
+    start = now();
+
+    do {
+        ops = ops + bench(corpus);
+        elapsed = now() - start;
+    } while (elapsed < BENCH_MIN_TIME);
+
+    allocs = allocCount;
+
+    printf("%-24s %12ld %12.1f %14.2f\n", name, ops, elapsed * 1e9 / ops,
+           (double)allocs / ops);
+}
+
+/* -------------------------------------------------------------------------- */
+/* benchmarks                                                                 */
+/* every benchmark returns the number of operations it ran.                   */
+/* -------------------------------------------------------------------------- */
+
+static long int benchExtractExifInfo(struct corpus *corpus) {
+    long int i = 0;
+    long int n = 0;
+    struct exifItem *exifTable = NULL;
+
+    for (i = 0; i < (*corpus).fileCount; i++) {
+        exifTable = NULL;
+        if ((n = extractExifInfo((*corpus).fileNames[i], &exifTable)) < 0)
+            n = 0;
+        freeExifTable(exifTable, n);
+    }
+
+    return (*corpus).fileCount;
+}
+
+static long int benchVisitExifInfo(struct corpus *corpus) {
+    long int i = 0;
+    long int tagCount = 0;
+    struct exifSource source;
+
+    for (i = 0; i < (*corpus).fileCount; i++) {
+        if (openExifSource(&exifDefaultContext, (*corpus).fileNames[i],
+                           &source) == 0)
+            visitExifInfo(&exifDefaultContext, &source, countTag, &tagCount);
+        closeExifSource(&source);
+    }
+
+    return (*corpus).fileCount;
+}
+
+static long int countTag(struct exifItem *item, void *arg) {
+    *(long int *)arg = *(long int *)arg + 1;
+    return 0;
+}
+
+static long int benchParseTagData(struct corpus *corpus) {
+    long int i = 0;
+    long int j = 0;
+    long int ops = 0;
+
+    for (i = 0; i < (*corpus).fileCount; i++) {
+        for (j = 0; j < (*corpus).tableItemCounts[i]; j++) {
+            free(parseTagData(&(*corpus).tables[i][j]));
+            ops++;
+        }
+    }
+
+    return ops;
+}
+
+static long int benchFindTagByName(struct corpus *corpus) {
+    long int i = 0;
+    long int j = 0;
+    long int ops = 0;
+    volatile struct exifItem *tag = NULL;
+
+    for (i = 0; i < (*corpus).fileCount; i++) {
+        for (j = 0; j < 4; j++) {
+            tag = findTagByName((*corpus).tables[i],
+                                (*corpus).tableItemCounts[i], lookupNames[j]);
+            ops++;
+        }
+    }
+
+    return ops;
+}
+
+static long int benchFileNameFromPattern(struct corpus *corpus) {
+    long int i = 0;
+    char *fileName = NULL;
+
+    for (i = 0; i < (*corpus).fileCount; i++) {
+        fileName = NULL;
+        fileNameFromPattern(&fileName, BENCH_PATTERN, (*corpus).fileNames[i],
+                            (*corpus).tables[i], (*corpus).tableItemCounts[i]);
+        free(fileName);
+    }
+
+    return (*corpus).fileCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* now                                                                        */
+/* returns a monotonic time in seconds.                                       */
+/* -------------------------------------------------------------------------- */
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* -------------------------------------------------------------------------- */
+/* allocation counters                                                        */
+/* -------------------------------------------------------------------------- */
+
+void *__wrap_malloc(size_t size) {
+    allocCount++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocCount++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocCount++;
+    return __real_realloc(ptr, size);
+}
+
+/* -------------------------------------------------------------------------- */
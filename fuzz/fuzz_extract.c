@@ -0,0 +1,133 @@
+/* -------------------------------------------------------------------------- */
+/* fuzz_extract                                                               */
+/* fuzz harness for extractExifInfo, parseTagData and visitExifInfo.          */
+/*                                                                            */
+/*    libFuzzer: make fuzz && fuzz/fuzz_extract bench/corpus                  */
+/*    afl:       afl-clang-fast fuzz/fuzz_extract.c src/exif*.c ... &&        */
+/*               afl-fuzz -i bench/corpus -o out -- ./fuzz_extract @@         */
+/*    replay:    fuzz_extract file...                                         */
+/*                                                                            */
+/* extractExifInfo reads from a file name, so every input is written to an    */
+/* in-memory file and read back through /proc/self/fd. without                */
+/* FUZZ_LIBFUZZER a main is built that runs every file given on the command   */
+/* line, which serves afl and the replay of crashes. every extracted item is  */
+/* formatted by parseTagData like print does. the input is also visited in    */
+/* place, where every byte of tag data is read, so the sanitizers see views   */
+/* that leave the input.                                                      */
+/* -------------------------------------------------------------------------- */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../src/exiflib.h"
+#include "../src/exifparser.h"
+
+/* -------------------------------------------------------------------------- */
+/* functions                                                                  */
+/* -------------------------------------------------------------------------- */
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static long int touchTagData(struct exifItem *item, void *arg);
+
+/* -------------------------------------------------------------------------- */
+/* variables                                                                  */
+/* -------------------------------------------------------------------------- */
+
+static int memFd = -1;
+static char memFileName[32] = "";
+
+/* -------------------------------------------------------------------------- */
+/* LLVMFuzzerTestOneInput                                                     */
+/* runs extractExifInfo on "size" bytes of "data". always returns 0.          */
+/* -------------------------------------------------------------------------- */
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    long int i = 0;
+    long int n = 0;
+    long int sum = 0;
+    struct exifItem *exifTable = NULL;
+    struct exifSource source;
+
+    if (memFd < 0) {
+        if ((memFd = memfd_create("fuzz_extract", 0)) < 0) abort();
+        snprintf(memFileName, sizeof(memFileName), "/proc/self/fd/%d", memFd);
+    }
+
+    if (ftruncate(memFd, 0) != 0) abort();
+    if (pwrite(memFd, data, size, 0) != (ssize_t)size) abort();
+
+    if ((n = extractExifInfo(memFileName, &exifTable)) < 0) n = 0;
+
+    for (i = 0; i < n; i++) free(parseTagData(&exifTable[i]));
+
+    freeExifTable(exifTable, n);
+
+    openExifMemory(&source, (unsigned char *)data, size);
+    visitExifInfo(&exifDefaultContext, &source, touchTagData, &sum);
+    closeExifSource(&source);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* touchTagData                                                               */
+/* visitor that adds every byte of the tag data of "item" to the sum "arg".   */
+/* -------------------------------------------------------------------------- */
+
+static long int touchTagData(struct exifItem *item, void *arg) {
+    long int i = 0;
+
+    for (i = 0; i < (*item).tagTypeSize * (*item).tagCount; i++)
+        *(volatile long int *)arg += (*item).tagData[i];
+
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+/* -------------------------------------------------------------------------- */
+/* main                                                                       */
+/* runs every file given on the command line through the harness.             */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char *argv[]) {
+    int i = 0;
+    long int size = 0;
+    unsigned char *data = NULL;
+    FILE *fp = NULL;
+
+    for (i = 1; i < argc; i++) {
+        if ((fp = fopen(argv[i], "rb")) == NULL) {
+            fprintf(stderr, "fuzz_extract: can't open '%s'\n", argv[i]);
+            return 1;
+        }
+
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+
+        if ((data = malloc(size + 1)) == NULL ||
+            fread(data, 1, size, fp) != (size_t)size) {
+            fprintf(stderr, "fuzz_extract: can't read '%s'\n", argv[i]);
+            return 1;
+        }
+
+        fclose(fp);
+
+        LLVMFuzzerTestOneInput(data, size);
+
+        free(data);
+    }
+
+    return 0;
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,411 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifagg.h"
+
+/* -------------------------------------------------------------------------- */
+/* parseAggSpec                                                               */
+/* parses the comma separated list of tags "by" to "specTable". every tag may */
+/* be followed by ";from:to" to use only these letters. returns the number of */
+/* tags if successful or a negative value otherwise.                          */
+/* -------------------------------------------------------------------------- */
+
+long int parseAggSpec(char *by, struct aggSpec **specTable) {
+    long int rc = 0;
+    long int specTableItemCount = 0;
+    long int length = 0;
+
+    char *pos = by;
+    char *end = NULL;
+    char *semicolPos = NULL;
+    struct aggSpec *spec = NULL;
+    struct aggSpec *table = NULL;
+
+    *specTable = NULL;
+
+    while (rc == 0 && *pos != '\0') {
+        if ((end = strchr(pos, ',')) == NULL) end = pos + strlen(pos);
+
+        if ((table = (struct aggSpec *)realloc(
+                 *specTable,
+                 sizeof(struct aggSpec) * (specTableItemCount + 1))) == NULL) {
+            rc = AGG_ERR_MALLOC;
+            break;
+        }
+
+        *specTable = table;
+
+        spec = &(*specTable)[specTableItemCount];
+        (*spec).fromPos = 0;
+        (*spec).toPos = 0;
+
+        /* tag name and optional from and to positions */
+
+        if ((semicolPos = memchr(pos, ';', end - pos)) != NULL) {
+            length = semicolPos - pos;
+
+            if (sscanf(semicolPos + 1, "%ld:%ld", &(*spec).fromPos,
+                       &(*spec).toPos) != 2) {
+                rc = AGG_ERR_SPEC;
+                break;
+            }
+        } else
+            length = end - pos;
+
+        if (((*spec).tagName = (char *)malloc(length + 1)) == NULL) {
+            rc = AGG_ERR_MALLOC;
+            break;
+        }
+
+        memcpy((*spec).tagName, pos, length);
+        (*spec).tagName[length] = '\0';
+
+        specTableItemCount++;
+
+        if (findTagIDByName((*spec).tagName) < 0) rc = AGG_ERR_SPEC;
+
+        pos = *end == ',' ? end + 1 : end;
+    }
+
+    if (rc == 0 && specTableItemCount == 0) rc = AGG_ERR_SPEC;
+
+    if (rc < 0) {
+        freeAggSpec(*specTable, specTableItemCount);
+        *specTable = NULL;
+        return rc;
+    }
+
+    return specTableItemCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* freeAggSpec                                                                */
+/* frees "specTable" of length "specTableItemCount" and its tag names.        */
+/* -------------------------------------------------------------------------- */
+
+void freeAggSpec(struct aggSpec *specTable, long int specTableItemCount) {
+    long int i = 0;
+
+    for (i = 0; i < specTableItemCount; i++) free(specTable[i].tagName);
+
+    free(specTable);
+}
+
+/* -------------------------------------------------------------------------- */
+/* makeAggKey                                                                 */
+/* writes the group key of the file with "exifTable" to "key", which has to   */
+/* be freed by the caller. missing tags are written as "n/a". returns 0 if    */
+/* successful or a negative value otherwise.                                  */
+/* -------------------------------------------------------------------------- */
+
+long int makeAggKey(char **key, struct aggSpec *specTable,
+                    long int specTableItemCount, struct exifItem *exifTable,
+                    long int exifTableItemCount) {
+    long int i = 0;
+    long int rc = 0;
+    long int keyLength = 0;
+    long int valueLength = 0;
+    long int fromPos = 0;
+    long int toPos = 0;
+
+    char *value = NULL;
+    char *buffer = NULL;
+    struct exifItem *tag = NULL;
+
+    *key = NULL;
+
+    for (i = 0; i < specTableItemCount; i++) {
+        buffer = NULL;
+
+        if ((tag = findTagByName(exifTable, exifTableItemCount,
+                                 specTable[i].tagName)) == NULL)
+            value = "n/a";
+        else if ((*tag).tagType == 2)
+            value = (char *)(*tag).tagData;
+        else if ((value = buffer = parseTagData(tag)) == NULL)
+            value = "n/a";
+
+        /* ascii tags are not always null-terminated */
+
+        if (tag != NULL && (*tag).tagType == 2)
+            valueLength = strnlen(value, (*tag).tagCount);
+        else
+            valueLength = strlen(value);
+
+        /* cut to the letters from:to */
+
+        fromPos = specTable[i].fromPos < 1 ? 1 : specTable[i].fromPos;
+        toPos = specTable[i].toPos;
+
+        if (toPos < 1 || toPos > valueLength) toPos = valueLength;
+
+        if (fromPos > toPos)
+            valueLength = 0;
+        else {
+            value = value + fromPos - 1;
+            valueLength = toPos - fromPos + 1;
+        }
+
+        if (i > 0 && (rc = appendAggField(key, &keyLength, ",", -1)) < 0) {
+            free(buffer);
+            return rc;
+        }
+
+        rc = appendAggField(key, &keyLength, value, valueLength);
+
+        free(buffer);
+
+        if (rc < 0) return rc;
+    }
+
+    if (*key == NULL) return appendAggField(key, &keyLength, "", 0);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* addAggEntry                                                                */
+/* adds "count" to the entry with "key" and "bin" in "table", creating the    */
+/* entry if needed. "bin" is only used if "binType" is AGG_BIN_VALUE.         */
+/* returns 0 if successful or a negative value otherwise.                     */
+/* -------------------------------------------------------------------------- */
+
+long int addAggEntry(struct aggTable *table, char *key, int binType,
+                     double bin, long int count) {
+    long int i = 0;
+    long int rc = 0;
+    long int keyLength = 0;
+
+    uint64_t hash = 0;
+    struct aggEntry *entry = NULL;
+
+    if (binType != AGG_BIN_VALUE) bin = 0;
+
+    if (((*table).entryCount + 1) * 10 > (*table).capacity * 7 &&
+        (rc = growAggTable(table)) < 0)
+        return rc;
+
+    hash = hashAggKey(key, binType, bin);
+
+    /* linear probing */
+
+    for (i = hash & ((*table).capacity - 1);;
+         i = (i + 1) & ((*table).capacity - 1)) {
+        entry = &(*table).entries[i];
+
+        if ((*entry).key == NULL) break;
+
+        if ((*entry).hash == hash && (*entry).binType == binType &&
+            (*entry).bin == bin && strcmp((*entry).key, key) == 0) {
+            (*entry).count = (*entry).count + count;
+            return 0;
+        }
+    }
+
+    keyLength = strlen(key);
+
+    if (((*entry).key = (char *)malloc(keyLength + 1)) == NULL)
+        return AGG_ERR_MALLOC;
+
+    memcpy((*entry).key, key, keyLength + 1);
+
+    (*entry).hash = hash;
+    (*entry).binType = binType;
+    (*entry).bin = bin;
+    (*entry).count = count;
+
+    (*table).entryCount = (*table).entryCount + 1;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* mergeAggTable                                                              */
+/* adds all entries of "other" to "table". returns 0 if successful or a       */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+long int mergeAggTable(struct aggTable *table, struct aggTable *other) {
+    long int i = 0;
+    long int rc = 0;
+
+    struct aggEntry *entry = NULL;
+
+    for (i = 0; i < (*other).capacity; i++) {
+        entry = &(*other).entries[i];
+
+        if ((*entry).key == NULL) continue;
+
+        if ((rc = addAggEntry(table, (*entry).key, (*entry).binType,
+                              (*entry).bin, (*entry).count)) < 0)
+            return rc;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* sortAggTable                                                               */
+/* writes pointers to the entries of "table" sorted by key and bin to         */
+/* "sorted", which has to be freed by the caller. returns the number of       */
+/* entries if successful or a negative value otherwise.                       */
+/* -------------------------------------------------------------------------- */
+
+long int sortAggTable(struct aggTable *table, struct aggEntry ***sorted) {
+    long int i = 0;
+    long int n = 0;
+
+    if ((*sorted = (struct aggEntry **)malloc(
+             sizeof(struct aggEntry *) * ((*table).entryCount + 1))) == NULL)
+        return AGG_ERR_MALLOC;
+
+    for (i = 0; i < (*table).capacity; i++)
+        if ((*table).entries[i].key != NULL)
+            (*sorted)[n++] = &(*table).entries[i];
+
+    qsort(*sorted, n, sizeof(struct aggEntry *), compareAggEntries);
+
+    return n;
+}
+
+/* -------------------------------------------------------------------------- */
+/* freeAggTable                                                               */
+/* releases the entries of "table" and leaves it empty.                       */
+/* -------------------------------------------------------------------------- */
+
+void freeAggTable(struct aggTable *table) {
+    long int i = 0;
+
+    for (i = 0; i < (*table).capacity; i++) free((*table).entries[i].key);
+
+    free((*table).entries);
+
+    (*table).entries = NULL;
+    (*table).capacity = 0;
+    (*table).entryCount = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* hashAggKey                                                                 */
+/* returns the fnv-1a hash of "key" and "bin".                                */
+/* -------------------------------------------------------------------------- */
+
+static uint64_t hashAggKey(char *key, int binType, double bin) {
+    uint64_t hash = AGG_FNV_OFFSET;
+    unsigned char bytes[sizeof(double)];
+    size_t i = 0;
+
+    for (; *key != '\0'; key++)
+        hash = (hash ^ (unsigned char)*key) * AGG_FNV_PRIME;
+
+    hash = (hash ^ (unsigned char)binType) * AGG_FNV_PRIME;
+
+    if (binType != AGG_BIN_VALUE) return hash;
+
+    if (bin == 0) bin = 0;  // -0.0 and 0.0 are the same bin
+
+    memcpy(bytes, &bin, sizeof(double));
+
+    for (i = 0; i < sizeof(double); i++)
+        hash = (hash ^ bytes[i]) * AGG_FNV_PRIME;
+
+    return hash;
+}
+
+/* -------------------------------------------------------------------------- */
+/* growAggTable                                                               */
+/* doubles the capacity of "table" and rehashes its entries. returns 0 if     */
+/* successful or a negative value otherwise.                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int growAggTable(struct aggTable *table) {
+    long int i = 0;
+    long int j = 0;
+    long int capacity = 0;
+
+    struct aggEntry *entries = NULL;
+
+    capacity = (*table).capacity == 0 ? AGG_TABLE_MIN_CAPACITY
+                                      : (*table).capacity * 2;
+
+    if ((entries = (struct aggEntry *)calloc(capacity,
+                                             sizeof(struct aggEntry))) == NULL)
+        return AGG_ERR_MALLOC;
+
+    for (i = 0; i < (*table).capacity; i++) {
+        if ((*table).entries[i].key == NULL) continue;
+
+        for (j = (*table).entries[i].hash & (capacity - 1);
+             entries[j].key != NULL; j = (j + 1) & (capacity - 1))
+            ;
+
+        entries[j] = (*table).entries[i];
+    }
+
+    free((*table).entries);
+
+    (*table).entries = entries;
+    (*table).capacity = capacity;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* appendAggField                                                             */
+/* appends "valueLength" chars of "value" to "key" of length "keyLength" as a */
+/* csv field, quoting it if needed. a negative "valueLength" appends "value"  */
+/* unquoted. returns 0 if successful or a negative value otherwise.           */
+/* -------------------------------------------------------------------------- */
+
+static long int appendAggField(char **key, long int *keyLength, char *value,
+                               long int valueLength) {
+    long int i = 0;
+    long int n = *keyLength;
+    int quote = 0;
+
+    if (valueLength < 0)
+        valueLength = strlen(value);
+    else
+        for (i = 0; i < valueLength; i++)
+            if (value[i] == ',' || value[i] == '"' || value[i] == '\n')
+                quote = 1;
+
+    /* worst case every char is a quote */
+
+    if ((*key = (char *)realloc(*key, n + valueLength * 2 + 3)) == NULL)
+        return AGG_ERR_MALLOC;
+
+    if (quote) (*key)[n++] = '"';
+
+    for (i = 0; i < valueLength; i++) {
+        if (quote && value[i] == '"') (*key)[n++] = '"';
+        (*key)[n++] = value[i];
+    }
+
+    if (quote) (*key)[n++] = '"';
+
+    (*key)[n] = '\0';
+    *keyLength = n;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* compareAggEntries                                                          */
+/* qsort callback ordering entries by key, then totals, bins and missing      */
+/* values, then by bin.                                                       */
+/* -------------------------------------------------------------------------- */
+
+static int compareAggEntries(const void *a, const void *b) {
+    struct aggEntry *entryA = *(struct aggEntry **)a;
+    struct aggEntry *entryB = *(struct aggEntry **)b;
+    int cmp = 0;
+
+    if ((cmp = strcmp((*entryA).key, (*entryB).key)) != 0) return cmp;
+
+    if ((*entryA).binType != (*entryB).binType)
+        return (*entryA).binType - (*entryB).binType;
+
+    return ((*entryA).bin > (*entryB).bin) - ((*entryA).bin < (*entryB).bin);
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,103 @@
+#ifndef EXIFAGG_H_INCLUDED
+#define EXIFAGG_H_INCLUDED
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exiflib.h"
+#include "exifparser.h"
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    aggregation:                                                            */
+/*                                                                            */
+/*       --by=Model,DateTimeOriginal;1:4 --hist=FocalLength --bin=10          */
+/*                                                                            */
+/*    every file adds one to the entry of its group. the group key is the     */
+/*    csv row of the "by" tags, optionally cut to the letters from:to like    */
+/*    in rename patterns. with a histogram tag, the value of the tag rounded  */
+/*    down to a multiple of the bin width is part of the key. entries live    */
+/*    in an open addressing hash table per worker and are merged at the end.  */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define AGG_TABLE_MIN_CAPACITY 64
+#define AGG_FNV_OFFSET 14695981039346656037ULL
+#define AGG_FNV_PRIME 1099511628211ULL
+
+#define AGG_BIN_NONE 0
+#define AGG_BIN_VALUE 1
+#define AGG_BIN_MISSING 2
+
+#define AGG_ERR_MALLOC -841
+#define AGG_ERR_SPEC -842
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct aggSpec {
+    char *tagName;
+    long int fromPos;
+    long int toPos;
+};
+
+struct aggEntry {
+    uint64_t hash;
+    char *key;
+    int binType;
+    double bin;
+    long int count;
+};
+
+struct aggTable {
+    struct aggEntry *entries;
+    long int capacity;
+    long int entryCount;
+};
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int parseAggSpec(char *by, struct aggSpec **specTable);
+
+void freeAggSpec(struct aggSpec *specTable, long int specTableItemCount);
+
+long int makeAggKey(char **key, struct aggSpec *specTable,
+                    long int specTableItemCount, struct exifItem *exifTable,
+                    long int exifTableItemCount);
+
+long int addAggEntry(struct aggTable *table, char *key, int binType,
+                     double bin, long int count);
+
+long int mergeAggTable(struct aggTable *table, struct aggTable *other);
+
+long int sortAggTable(struct aggTable *table, struct aggEntry ***sorted);
+
+void freeAggTable(struct aggTable *table);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static uint64_t hashAggKey(char *key, int binType, double bin);
+
+static long int growAggTable(struct aggTable *table);
+
+static long int appendAggField(char **key, long int *keyLength, char *value,
+                               long int valueLength);
+
+static int compareAggEntries(const void *a, const void *b);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
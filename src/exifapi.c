@@ -0,0 +1,332 @@
+#include "exifapi.h"
+
+#include "exiflib.h"
+#include "exifparser.h"
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int visitApiItem(struct exifItem *item, void *arg);
+
+/* -------------------------------------------------------------------------- */
+/* exifNewContext                                                             */
+/* returns a context with the default limits, the libc allocator and no       */
+/* logger, or NULL if it could not be allocated.                              */
+/* -------------------------------------------------------------------------- */
+
+struct exifContext *exifNewContext(void) {
+    struct exifContext *context = NULL;
+
+    if ((context = (struct exifContext *)malloc(sizeof(struct exifContext))) ==
+        NULL)
+        return NULL;
+
+    (*context).limits.maxIfds = EXIF_DEFAULT_MAX_IFDS;
+    (*context).limits.maxTags = EXIF_DEFAULT_MAX_TAGS;
+    (*context).limits.maxTagBytes = EXIF_DEFAULT_MAX_TAG_BYTES;
+    (*context).alloc = NULL;
+    (*context).allocArg = NULL;
+    (*context).log = NULL;
+    (*context).logArg = NULL;
+    (*context).logLevel = 0;
+    (*context).makerNotes = 0;
+    (*context).readFiles = 0;
+
+    return context;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifFreeContext                                                            */
+/* frees "context". results read with it must be freed before.                */
+/* -------------------------------------------------------------------------- */
+
+void exifFreeContext(struct exifContext *context) { free(context); }
+
+/* -------------------------------------------------------------------------- */
+/* exifSetLimits                                                              */
+/* sets the limits a hostile file can not exceed. a tag with more than        */
+/* "maxTagBytes" bytes is skipped. values below one keep the current limit.   */
+/* -------------------------------------------------------------------------- */
+
+void exifSetLimits(struct exifContext *context, long int maxIfds,
+                   long int maxTags, long int maxTagBytes) {
+    if (maxIfds > 0) (*context).limits.maxIfds = maxIfds;
+    if (maxTags > 0) (*context).limits.maxTags = maxTags;
+    if (maxTagBytes > 0) (*context).limits.maxTagBytes = maxTagBytes;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifSetAllocator                                                           */
+/* sets the allocator for the tables of a result, NULL restores the libc      */
+/* allocator.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+void exifSetAllocator(struct exifContext *context, exifAllocFunction alloc,
+                      void *allocArg) {
+    (*context).alloc = alloc;
+    (*context).allocArg = allocArg;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifSetLogger                                                              */
+/* passes debug messages up to "logLevel" to "log", NULL prints them to       */
+/* stderr.                                                                    */
+/* -------------------------------------------------------------------------- */
+
+void exifSetLogger(struct exifContext *context, exifLogFunction log,
+                   void *logArg, int logLevel) {
+    (*context).log = log;
+    (*context).logArg = logArg;
+    (*context).logLevel = logLevel;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifSetMakerNotes                                                          */
+/* turns the decoding of the vendor tags in maker notes on or off. it is off  */
+/* by default, the maker note is then skipped as a whole.                     */
+/* -------------------------------------------------------------------------- */
+
+void exifSetMakerNotes(struct exifContext *context, int makerNotes) {
+    (*context).makerNotes = makerNotes;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifSetReadFiles                                                           */
+/* reads files with pread instead of mapping them. files that can not be      */
+/* mapped are always read.                                                    */
+/* -------------------------------------------------------------------------- */
+
+void exifSetReadFiles(struct exifContext *context, int readFiles) {
+    (*context).readFiles = readFiles;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifReadFile                                                               */
+/* reads the tags of "fileName" into "result". returns the number of tags or  */
+/* a negative error code, "result" is only set on success.                    */
+/* -------------------------------------------------------------------------- */
+
+long int exifReadFile(struct exifContext *context, const char *fileName,
+                      struct exifResult **result) {
+    long int rc = 0;
+    struct exifItem *exifTable = NULL;
+
+    if ((rc = extractExifInfoContext(context, (char *)fileName, &exifTable,
+                                     NULL, NULL)) < 0)
+        return rc;
+
+    if ((*result = (struct exifResult *)exifAllocate(
+             context, NULL, sizeof(struct exifResult))) == NULL) {
+        freeExifTableContext(context, exifTable, rc);
+        return EXIF_ERR_MALLOC;
+    }
+
+    (**result).context = context;
+    (**result).exifTable = exifTable;
+    (**result).exifTableItemCount = rc;
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifVisitFile                                                              */
+/* calls "visit" with "visitArg" for every tag of "fileName" without building */
+/* a result. returns the number of tags visited or a negative value.          */
+/* -------------------------------------------------------------------------- */
+
+long int exifVisitFile(struct exifContext *context, const char *fileName,
+                       exifVisitFunction visit, void *visitArg) {
+    long int rc = 0;
+
+    struct exifSource source;
+    struct apiVisit apiVisit = {visit, visitArg};
+
+    if ((rc = openExifSource(context, (char *)fileName, &source)) == 0)
+        rc = visitExifInfo(context, &source, visitApiItem, &apiVisit);
+
+    closeExifSource(&source);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifVisitMemory                                                            */
+/* same as exifVisitFile for the "size" bytes of a file at "data".            */
+/* -------------------------------------------------------------------------- */
+
+long int exifVisitMemory(struct exifContext *context, const unsigned char *data,
+                         long int size, exifVisitFunction visit,
+                         void *visitArg) {
+    long int rc = 0;
+
+    struct exifSource source;
+    struct apiVisit apiVisit = {visit, visitArg};
+
+    openExifMemory(&source, (unsigned char *)data, size);
+
+    rc = visitExifInfo(context, &source, visitApiItem, &apiVisit);
+
+    closeExifSource(&source);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifGetItemCount                                                           */
+/* returns the number of tags in "result".                                    */
+/* -------------------------------------------------------------------------- */
+
+long int exifGetItemCount(struct exifResult *result) {
+    return (*result).exifTableItemCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifGetTagID                                                               */
+/* returns the numeric tag id of item "itemNo".                               */
+/* -------------------------------------------------------------------------- */
+
+long int exifGetTagID(struct exifResult *result, long int itemNo) {
+    if (itemNo < 0 || itemNo >= (*result).exifTableItemCount)
+        return EXIF_ERR_BOUNDS;
+
+    return (*result).exifTable[itemNo].tagID;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifGetTagName                                                             */
+/* returns the name of item "itemNo" or NULL for unknown tags. the name is    */
+/* static and outlives the result.                                            */
+/* -------------------------------------------------------------------------- */
+
+const char *exifGetTagName(struct exifResult *result, long int itemNo) {
+    if (itemNo < 0 || itemNo >= (*result).exifTableItemCount) return NULL;
+
+    return parseTagID(&(*result).exifTable[itemNo]);
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifGetTagValue                                                            */
+/* writes the formatted value of item "itemNo" to "buf" like snprintf.        */
+/* returns the length of the whole value, so a result of "bufSize" or more    */
+/* means it was truncated.                                                    */
+/* -------------------------------------------------------------------------- */
+
+long int exifGetTagValue(struct exifResult *result, long int itemNo,
+                         char *buf, long int bufSize) {
+    long int length = 0;
+    char *tagData = NULL;
+
+    if (itemNo < 0 || itemNo >= (*result).exifTableItemCount)
+        return EXIF_ERR_BOUNDS;
+
+    if ((tagData = parseTagData(&(*result).exifTable[itemNo])) == NULL)
+        return EXIF_ERR_MALLOC;
+
+    length = strlen(tagData);
+
+    if (bufSize > 0) snprintf(buf, bufSize, "%s", tagData);
+
+    free(tagData);
+
+    return length;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifFindTag                                                                */
+/* returns the item number of the first tag named "tagName" or                */
+/* EXIF_ERR_NO_TAG.                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int exifFindTag(struct exifResult *result, const char *tagName) {
+    struct exifItem *exifTag = NULL;
+
+    if ((exifTag = findTagByName((*result).exifTable,
+                                 (*result).exifTableItemCount,
+                                 (char *)tagName)) == NULL)
+        return EXIF_ERR_NO_TAG;
+
+    return exifTag - (*result).exifTable;
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifFreeResult                                                             */
+/* frees "result" and its tags.                                               */
+/* -------------------------------------------------------------------------- */
+
+void exifFreeResult(struct exifResult *result) {
+    if (result == NULL) return;
+
+    freeExifTableContext((*result).context, (*result).exifTable,
+                         (*result).exifTableItemCount);
+
+    exifRelease((*result).context, result);
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifErrorString                                                            */
+/* returns a description of the error code "rc".                              */
+/* -------------------------------------------------------------------------- */
+
+const char *exifErrorString(long int rc) {
+    switch (rc) {
+        case EXIF_ERR_FILE_OPEN:
+            return "can not open file";
+        case EXIF_ERR_NO_JPG:
+            return "not a jpg or tiff file";
+        case EXIF_ERR_NO_EXIF:
+            return "no exif data";
+        case EXIF_ERR_EXIF_FORMAT:
+        case EXIF_ERR_INVALID_FORMAT:
+            return "invalid exif byte order";
+        case EXIF_ERR_IFD_QUEUE:
+        case EXIF_ERR_ADD_IFD:
+            return "invalid ifd";
+        case EXIF_ERR_FILE_READ:
+            return "can not read file";
+        case EXIF_ERR_MARKER:
+            return "invalid marker";
+        case EXIF_ERR_MALLOC:
+            return "out of memory";
+        case EXIF_ERR_TYPE_SIZE:
+            return "invalid tag type";
+        case EXIF_ERR_PATTERN:
+            return "invalid pattern";
+        case EXIF_ERR_PATTERN_NOMATCH:
+            return "pattern does not match";
+        case EXIF_ERR_NO_GPS:
+            return "no gps position";
+        case EXIF_ERR_NO_TIME:
+            return "no date and time";
+        case EXIF_FILTERED:
+            return "filtered out";
+        case EXIF_ERR_NO_TAG:
+            return "no such tag";
+        case EXIF_ERR_NO_PREVIEW:
+            return "no preview image";
+        case EXIF_ERR_BOUNDS:
+            return "offset out of bounds";
+        case EXIF_ERR_IFD_LOOP:
+            return "ifd loop";
+        case EXIF_ERR_LIMIT:
+            return "limit exceeded";
+        default:
+            return rc < 0 ? "unknown error" : "no error";
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitApiItem                                                               */
+/* visitor of exifVisitFile and exifVisitMemory. passes "item" on to the      */
+/* apiVisit "arg".                                                            */
+/* -------------------------------------------------------------------------- */
+
+static long int visitApiItem(struct exifItem *item, void *arg) {
+    struct apiVisit *apiVisit = (struct apiVisit *)arg;
+
+    return (*apiVisit).visit((*apiVisit).visitArg, (*item).ifdID,
+                             (*item).tagID, (*item).tagType, (*item).tagCount,
+                             (*item).tagData, (int)(*item).exifFormat);
+}
+
+/* -------------------------------------------------------------------------- */
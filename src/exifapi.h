@@ -0,0 +1,147 @@
+#ifndef EXIFAPI_H_INCLUDED
+#define EXIFAPI_H_INCLUDED
+
+#include <stddef.h>
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    The stable interface of libexiflib. A context holds the limits, the     */
+/*    allocator and the logger. It is not changed by a read, so one context   */
+/*    can be shared by any number of threads once it is set up. A result      */
+/*    holds the tags of one file and belongs to the thread that read it.      */
+/*                                                                            */
+/*       struct exifContext *context = exifNewContext();                      */
+/*       struct exifResult *result = NULL;                                    */
+/*       char value[256];                                                     */
+/*                                                                            */
+/*       if (exifReadFile(context, "test.jpg", &result) >= 0) {               */
+/*           exifGetTagValue(result, exifFindTag(result, "Make"), value,      */
+/*                           sizeof(value));                                  */
+/*           exifFreeResult(result);                                          */
+/*       }                                                                    */
+/*                                                                            */
+/*       exifFreeContext(context);                                            */
+/*                                                                            */
+/*    Functions returning long int return a negative error code on failure,   */
+/*    one of the EXIF_ERR_* values below. exifErrorString describes it.       */
+/*                                                                            */
+/*    exifVisitFile does not build a result. It calls a visitor for every     */
+/*    tag with the ifd (1 for ifd0 and its chain, 2 for the exif ifd, 3 for   */
+/*    the gps ifd), the tag id, type and count, the raw tag data and its byte */
+/*    order (1 Intel, 2 Motorola). The data points into the mapped file and   */
+/*    is only valid during the call. A negative return value ends the visit   */
+/*    with that error, EXIF_VISIT_STOP ends it early.                         */
+/*                                                                            */
+/*    The xmp, iptc and icc metadata of a jpg file follow the exif tags with  */
+/*    the ifd 4, 5 and 6 and tag ids above 0xffff. Their values are ascii     */
+/*    and not null-terminated, except the long icc fields in Motorola order.  */
+/*    With exifSetMakerNotes, the known vendor tags of the maker note follow  */
+/*    with the ifd 7 and tag ids from 0x40001 on, in the byte order of the    */
+/*    maker note.                                                             */
+/*                                                                            */
+/*    Files are mapped into memory. With exifSetReadFiles, or if a file can   */
+/*    not be mapped, it is read with pread instead, and the values of an ifd  */
+/*    are fetched in a few sorted reads, e.g. on fuse or network mounts.      */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define EXIF_API_VERSION 1
+
+#define EXIF_VISIT_STOP 1
+
+/* error codes, exifErrorString describes them */
+
+#define EXIF_ERR_FILE_OPEN -701
+#define EXIF_ERR_NO_JPG -702
+#define EXIF_ERR_NO_EXIF -703
+#define EXIF_ERR_EXIF_FORMAT -704
+#define EXIF_ERR_IFD_QUEUE -705
+#define EXIF_ERR_ADD_IFD -706
+#define EXIF_ERR_FILE_READ -707
+#define EXIF_ERR_MARKER -708
+#define EXIF_ERR_INVALID_FORMAT -709
+#define EXIF_ERR_MALLOC -710
+#define EXIF_ERR_TYPE_SIZE -711
+
+#define EXIF_ERR_BOUNDS -717
+#define EXIF_ERR_IFD_LOOP -718
+#define EXIF_ERR_LIMIT -719
+#define EXIF_ERR_NO_TAG -720
+
+#define EXIF_API __attribute__((visibility("default")))
+
+/* -------------------------------------------------------------------------- */
+/* types                                                                      */
+/* -------------------------------------------------------------------------- */
+
+struct exifContext;
+struct exifResult;
+
+/* works like realloc, a "size" of zero frees "ptr" */
+
+typedef void *(*exifAllocFunction)(void *allocArg, void *ptr, size_t size);
+
+typedef void (*exifLogFunction)(void *logArg, int level, char *message);
+
+typedef long int (*exifVisitFunction)(void *visitArg, long int ifdID,
+                                      long int tagID, long int tagType,
+                                      long int tagCount,
+                                      const unsigned char *tagData,
+                                      int byteOrder);
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+EXIF_API struct exifContext *exifNewContext(void);
+
+EXIF_API void exifFreeContext(struct exifContext *context);
+
+EXIF_API void exifSetLimits(struct exifContext *context, long int maxIfds,
+                            long int maxTags, long int maxTagBytes);
+
+EXIF_API void exifSetAllocator(struct exifContext *context,
+                               exifAllocFunction alloc, void *allocArg);
+
+EXIF_API void exifSetLogger(struct exifContext *context, exifLogFunction log,
+                            void *logArg, int logLevel);
+
+EXIF_API void exifSetMakerNotes(struct exifContext *context, int makerNotes);
+
+EXIF_API void exifSetReadFiles(struct exifContext *context, int readFiles);
+
+EXIF_API long int exifReadFile(struct exifContext *context,
+                               const char *fileName,
+                               struct exifResult **result);
+
+EXIF_API long int exifVisitFile(struct exifContext *context,
+                                const char *fileName, exifVisitFunction visit,
+                                void *visitArg);
+
+EXIF_API long int exifVisitMemory(struct exifContext *context,
+                                  const unsigned char *data, long int size,
+                                  exifVisitFunction visit, void *visitArg);
+
+EXIF_API long int exifGetItemCount(struct exifResult *result);
+
+EXIF_API long int exifGetTagID(struct exifResult *result, long int itemNo);
+
+EXIF_API const char *exifGetTagName(struct exifResult *result,
+                                    long int itemNo);
+
+EXIF_API long int exifGetTagValue(struct exifResult *result, long int itemNo,
+                                  char *buf, long int bufSize);
+
+EXIF_API long int exifFindTag(struct exifResult *result, const char *tagName);
+
+EXIF_API void exifFreeResult(struct exifResult *result);
+
+EXIF_API const char *exifErrorString(long int rc);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
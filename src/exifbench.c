@@ -0,0 +1,126 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifbench.h"
+
+/* -------------------------------------------------------------------------- */
+/* readBenchIo                                                                */
+/* reads the i/o counters of the process from /proc/self/io to "io". files    */
+/* are usually mapped, not read, so the bytes exiflib used from mappings are  */
+/* added to the bytes read. returns 0 if successful or a negative value       */
+/* otherwise.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+long int readBenchIo(struct benchIo *io) {
+    char line[128];
+    long int found = 0;
+
+    FILE *fp = NULL;
+
+    memset(io, 0, sizeof(struct benchIo));
+
+    if ((fp = fopen("/proc/self/io", "r")) == NULL) return BENCH_ERR_PROC_IO;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        found = found + sscanf(line, "rchar: %ld", &(*io).readBytes);
+        found = found + sscanf(line, "syscr: %ld", &(*io).readCalls);
+        found = found + sscanf(line, "syscw: %ld", &(*io).writeCalls);
+    }
+
+    fclose(fp);
+
+    (*io).readBytes =
+        (*io).readBytes + __atomic_load_n(&exifBytesRead, __ATOMIC_RELAXED);
+
+    if (found != 3) return BENCH_ERR_PROC_IO;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* evictFileCache                                                             */
+/* asks the kernel to drop the cached pages of "fileName", so the next run    */
+/* reads it from the disk. returns 0 if successful or a negative value        */
+/* otherwise.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+long int evictFileCache(char *fileName) {
+    int fd = 0;
+    int rc = 0;
+
+    if ((fd = open(fileName, O_RDONLY)) < 0) return -errno;
+
+    rc = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+
+    close(fd);
+
+    return -rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* benchTime                                                                  */
+/* returns a monotonic time in seconds.                                       */
+/* -------------------------------------------------------------------------- */
+
+double benchTime(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* -------------------------------------------------------------------------- */
+/* printBenchRun                                                              */
+/* prints files/s, MB read/s, read and write syscalls per file and the p50    */
+/* and p99 latency per file of "run" to "stream". sorts the latencies.        */
+/* -------------------------------------------------------------------------- */
+
+void printBenchRun(FILE *stream, long int runNo, struct benchRun *run) {
+    long int n = (*run).fileCount;
+    long int calls = 0;
+    double bytes = 0;
+
+    if (n == 0 || (*run).elapsed <= 0) return;
+
+    bytes = (*run).ioEnd.readBytes - (*run).ioStart.readBytes;
+    calls = (*run).ioEnd.readCalls - (*run).ioStart.readCalls +
+            (*run).ioEnd.writeCalls - (*run).ioStart.writeCalls;
+
+    qsort((*run).latencies, n, sizeof(double), compareLatencies);
+
+    fprintf(stream,
+            "run %ld: %ld files, %ld errors, %.0f files/s, %.1f MB/s, "
+            "%.1f syscalls/file, p50 %.1f us, p99 %.1f us\n",
+            runNo, n, (*run).errorCount, n / (*run).elapsed,
+            bytes / 1e6 / (*run).elapsed, (double)calls / n,
+            getPercentile((*run).latencies, n, 0.50) * 1e6,
+            getPercentile((*run).latencies, n, 0.99) * 1e6);
+}
+
+/* -------------------------------------------------------------------------- */
+/* compareLatencies                                                           */
+/* qsort callback for latencies in ascending order.                           */
+/* -------------------------------------------------------------------------- */
+
+static int compareLatencies(const void *a, const void *b) {
+    double latencyA = *(double *)a;
+    double latencyB = *(double *)b;
+
+    return (latencyA > latencyB) - (latencyA < latencyB);
+}
+
+/* -------------------------------------------------------------------------- */
+/* getPercentile                                                              */
+/* returns the "p" percentile (nearest rank) of "sorted" of length "count".   */
+/* -------------------------------------------------------------------------- */
+
+static double getPercentile(double *sorted, long int count, double p) {
+    long int rank = (long int)(p * count + 0.999999);
+
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+
+    return sorted[rank - 1];
+}
+
+/* -------------------------------------------------------------------------- */
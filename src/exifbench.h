@@ -0,0 +1,71 @@
+#ifndef EXIFBENCH_H_INCLUDED
+#define EXIFBENCH_H_INCLUDED
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define BENCH_DEFAULT_RUNS 3
+
+#define BENCH_ERR_MALLOC -861
+#define BENCH_ERR_PROC_IO -862
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct benchIo {
+    long int readBytes;
+    long int readCalls;
+    long int writeCalls;
+};
+
+struct benchRun {
+    long int fileCount;
+    long int errorCount;
+    double elapsed;
+    double *latencies;
+    struct benchIo ioStart;
+    struct benchIo ioEnd;
+};
+
+/* -------------------------------------------------------------------------- */
+/* extern variables                                                           */
+/* -------------------------------------------------------------------------- */
+
+/* bytes read from mapped files, see exiflib.h */
+
+extern long int exifBytesRead;
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int readBenchIo(struct benchIo *io);
+
+long int evictFileCache(char *fileName);
+
+double benchTime(void);
+
+void printBenchRun(FILE *stream, long int runNo, struct benchRun *run);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static int compareLatencies(const void *a, const void *b);
+
+static double getPercentile(double *sorted, long int count, double p);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,304 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifcarve.h"
+
+/* -------------------------------------------------------------------------- */
+/* search function, chosen by findCarveCandidate                              */
+/* -------------------------------------------------------------------------- */
+
+static carveSearch carveSearchFunction = NULL;
+
+/* -------------------------------------------------------------------------- */
+/* carveFile                                                                  */
+/* reads the file or block device "fileName" from start to end and calls the  */
+/* hook of "scan" for every jpg with exif in it, with a source from the start */
+/* of the jpg to the end of its exif APP1 and the position of the jpg. the    */
+/* hook returns 0 for a hit, EXIF_FILTERED to skip the jpg or another         */
+/* negative value to reject it. returns the number of hits if successful or a */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+long int carveFile(char *fileName, struct carveScan *scan) {
+    long int rc = 0;
+    long int length = 0;
+    long int blockPos = 0;
+    long int scanEnd = 0;
+    long int hitCount = (*scan).hitCount;
+    int fd = -1;
+
+    unsigned char *block = NULL;
+
+    if ((fd = open(fileName, O_RDONLY)) < 0) return CARVE_ERR_OPEN;
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    if ((block = (unsigned char *)malloc(CARVE_BLOCK_SIZE +
+                                         CARVE_TAIL_LENGTH)) == NULL) {
+        close(fd);
+        return CARVE_ERR_MALLOC;
+    }
+
+    /* the tail of a block is searched again at the front of the next one */
+
+    while ((rc = readCarveBlock(fd, block + length,
+                                CARVE_BLOCK_SIZE + CARVE_TAIL_LENGTH -
+                                    length)) >= 0) {
+        (*scan).bytesRead = (*scan).bytesRead + rc;
+        length = length + rc;
+
+        if (length < CARVE_BLOCK_SIZE + CARVE_TAIL_LENGTH)
+            scanEnd = length;
+        else
+            scanEnd = CARVE_BLOCK_SIZE;
+
+        if ((rc = carveBlock(block, length, scanEnd, blockPos, scan)) < 0 ||
+            scanEnd == length)
+            break;
+
+        memmove(block, block + scanEnd, length - scanEnd);
+        length = length - scanEnd;
+        blockPos = blockPos + scanEnd;
+    }
+
+    free(block);
+    close(fd);
+
+    if (rc < 0) return rc;
+
+    return (*scan).hitCount - hitCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findCarveCandidate                                                         */
+/* returns the position of the first FF D8 FF E0 or FF D8 FF E1 in the        */
+/* "length" bytes of "data", or a negative value if there is none. the        */
+/* search uses avx2 or sse2 if the cpu has them.                              */
+/* -------------------------------------------------------------------------- */
+
+long int findCarveCandidate(unsigned char *data, long int length) {
+    if (carveSearchFunction == NULL) {
+        carveSearchFunction = findCandidateScalar;
+
+#ifdef CARVE_SIMD
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+            carveSearchFunction = findCandidateAvx2;
+        else if (__builtin_cpu_supports("sse2"))
+            carveSearchFunction = findCandidateSse2;
+#endif
+    }
+
+    return carveSearchFunction(data, length);
+}
+
+/* -------------------------------------------------------------------------- */
+/* carveBlock                                                                 */
+/* calls the hook of "scan" for the jpgs with exif starting before "scanEnd"  */
+/* in the "length" bytes of "block", which starts at "blockPos" of the file,  */
+/* for carveFile. always returns 0.                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int carveBlock(unsigned char *block, long int length,
+                           long int scanEnd, long int blockPos,
+                           struct carveScan *scan) {
+    long int rc = 0;
+    long int pos = 0;
+    long int exifEnd = 0;
+    long int searchEnd = scanEnd + 3 < length ? scanEnd + 3 : length;
+
+    struct exifSource source;
+
+    while (pos < scanEnd &&
+           (rc = findCarveCandidate(block + pos, searchEnd - pos)) >= 0) {
+        pos = pos + rc;
+
+        /* a jpg without exif is no hit, a cut off one is rejected */
+
+        if ((exifEnd = findCarveExif(block, length, pos)) <= 0) {
+            if (exifEnd < 0) (*scan).rejectCount = (*scan).rejectCount + 1;
+
+            pos = pos + 1;
+            continue;
+        }
+
+        openExifMemory(&source, block + pos, exifEnd - pos);
+
+        rc = (*scan).hook(&source, blockPos + pos, (*scan).hookArg);
+
+        closeExifSource(&source);
+
+        if (rc >= 0)
+            (*scan).hitCount = (*scan).hitCount + 1;
+        else if (rc != EXIF_FILTERED)
+            (*scan).rejectCount = (*scan).rejectCount + 1;
+
+        pos = pos + 1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findCarveExif                                                              */
+/* walks the APPn segments of the jpg at "pos" of the "length" bytes of       */
+/* "block" to its exif APP1. returns the end of the APP1, 0 if there is none  */
+/* or a negative value if the segments run past the block.                    */
+/* -------------------------------------------------------------------------- */
+
+static long int findCarveExif(unsigned char *block, long int length,
+                              long int pos) {
+    long int end = 0;
+
+    pos = pos + SOI_MARKER_LENGTH;
+
+    while (pos + 4 <= length && block[pos] == 0xFF && block[pos + 1] >= 0xE0 &&
+           block[pos + 1] <= 0xEF) {
+        end = pos + 2 + ((block[pos + 2] << 8) | block[pos + 3]);
+
+        if (end > length) return CARVE_ERR_READ;
+
+        if (block[pos + 1] == 0xE1 && end - pos >= 4 + EXIF_PREFIX_LENGTH &&
+            memcmp(block + pos + 4, exifPrefix, EXIF_PREFIX_LENGTH) == 0)
+            return end;
+
+        pos = end;
+    }
+
+    if (pos + 4 > length) return CARVE_ERR_READ;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* readCarveBlock                                                             */
+/* reads up to "length" bytes from "fd" to "block", less only at the end of   */
+/* the file. returns the number of bytes read or a negative value in case of  */
+/* an error.                                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int readCarveBlock(int fd, unsigned char *block, long int length) {
+    long int done = 0;
+    ssize_t n = 0;
+
+    while (done < length) {
+        n = read(fd, block + done, length - done);
+
+        if (n < 0 && errno == EINTR) continue;
+
+        if (n < 0) return CARVE_ERR_READ;
+
+        if (n == 0) break;
+
+        done = done + n;
+    }
+
+    return done;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findCandidateScalar                                                        */
+/* same as findCarveCandidate, byte by byte from one FF to the next.          */
+/* -------------------------------------------------------------------------- */
+
+static long int findCandidateScalar(unsigned char *data, long int length) {
+    unsigned char *pos = data;
+    unsigned char *next = NULL;
+
+    while (data + length - pos >= 4 &&
+           (next = memchr(pos, 0xFF, data + length - 3 - pos)) != NULL) {
+        if (next[1] == 0xD8 && next[2] == 0xFF && (next[3] & 0xFE) == 0xE0)
+            return next - data;
+
+        pos = next + 1;
+    }
+
+    return -1;
+}
+
+#ifdef CARVE_SIMD
+
+/* -------------------------------------------------------------------------- */
+/* findCandidateSse2                                                          */
+/* same as findCarveCandidate, 16 positions at a time. the four bytes of a    */
+/* candidate are compared in four loads, each one byte further.               */
+/* -------------------------------------------------------------------------- */
+
+__attribute__((target("sse2"))) static long int findCandidateSse2(
+    unsigned char *data, long int length) {
+    long int i = 0;
+    long int rc = 0;
+    int mask = 0;
+
+    __m128i ff = _mm_set1_epi8((char)0xFF);
+    __m128i d8 = _mm_set1_epi8((char)0xD8);
+    __m128i fe = _mm_set1_epi8((char)0xFE);
+    __m128i e0 = _mm_set1_epi8((char)0xE0);
+    __m128i match;
+
+    for (i = 0; i + 3 + 16 <= length; i = i + 16) {
+        match = _mm_and_si128(
+            _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)(data + i)), ff),
+                _mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)(data + i + 1)),
+                               d8)),
+            _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)(data + i + 2)), ff),
+                _mm_cmpeq_epi8(
+                    _mm_and_si128(_mm_loadu_si128((__m128i *)(data + i + 3)),
+                                  fe),
+                    e0)));
+
+        if ((mask = _mm_movemask_epi8(match)) != 0)
+            return i + __builtin_ctz(mask);
+    }
+
+    if ((rc = findCandidateScalar(data + i, length - i)) < 0) return rc;
+
+    return i + rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findCandidateAvx2                                                          */
+/* same as findCandidateSse2, 32 positions at a time.                         */
+/* -------------------------------------------------------------------------- */
+
+__attribute__((target("avx2"))) static long int findCandidateAvx2(
+    unsigned char *data, long int length) {
+    long int i = 0;
+    long int rc = 0;
+    unsigned int mask = 0;
+
+    __m256i ff = _mm256_set1_epi8((char)0xFF);
+    __m256i d8 = _mm256_set1_epi8((char)0xD8);
+    __m256i fe = _mm256_set1_epi8((char)0xFE);
+    __m256i e0 = _mm256_set1_epi8((char)0xE0);
+    __m256i match;
+
+    for (i = 0; i + 3 + 32 <= length; i = i + 32) {
+        match = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i *)(data + i)),
+                                  ff),
+                _mm256_cmpeq_epi8(
+                    _mm256_loadu_si256((__m256i *)(data + i + 1)), d8)),
+            _mm256_and_si256(
+                _mm256_cmpeq_epi8(
+                    _mm256_loadu_si256((__m256i *)(data + i + 2)), ff),
+                _mm256_cmpeq_epi8(
+                    _mm256_and_si256(
+                        _mm256_loadu_si256((__m256i *)(data + i + 3)), fe),
+                    e0)));
+
+        if ((mask = (unsigned int)_mm256_movemask_epi8(match)) != 0)
+            return i + __builtin_ctz(mask);
+    }
+
+    if ((rc = findCandidateScalar(data + i, length - i)) < 0) return rc;
+
+    return i + rc;
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,108 @@
+#ifndef EXIFCARVE_H_INCLUDED
+#define EXIFCARVE_H_INCLUDED
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CARVE_SIMD 1
+#endif
+
+#include "exiflib.h"
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    carving exif jpgs from disk images:                                     */
+/*                                                                            */
+/*       ... FF D8 FF E1 len len 'E' 'x' 'i' 'f' 00 00 'I' 'I' ...            */
+/*       ... FF D8 FF E0 len len 'J' 'F' 'I' 'F' ... FF E1 len len 'E' ...    */
+/*                                                                            */
+/*    the image is read from start to end in blocks of CARVE_BLOCK_SIZE, the  */
+/*    last CARVE_TAIL_LENGTH bytes of a block are moved to the front of the   */
+/*    next one, so the first segments of a jpg are always in one piece. the   */
+/*    blocks are searched for FF D8 FF E0 or FF D8 FF E1 with avx2 or sse2,   */
+/*    chosen when the first file is carved, 32 or 16 positions per compare.   */
+/*    only these candidates are looked at: the APPn segments are walked to    */
+/*    the exif APP1, and the jpg up to its end is given to a hook as a source */
+/*    in memory. the hook visits it, which checks every ifd and offset, so a  */
+/*    hit is a valid exif segment.                                            */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define CARVE_BLOCK_SIZE (16L * 1024 * 1024)
+#define CARVE_TAIL_LENGTH (4L * (4 + 0xFFFF))
+
+#define CARVE_DEFAULT_TAG_COUNT 3
+
+#define CARVE_ERR_MALLOC -911
+#define CARVE_ERR_OPEN -912
+#define CARVE_ERR_READ -913
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+typedef long int (*carveHook)(struct exifSource *source, long int pos,
+                              void *arg);
+
+typedef long int (*carveSearch)(unsigned char *data, long int length);
+
+struct carveScan {
+    carveHook hook;
+    void *hookArg;
+    long int hitCount;
+    long int rejectCount;
+    long int bytesRead;
+};
+
+/* -------------------------------------------------------------------------- */
+/* tags printed by default                                                    */
+/* -------------------------------------------------------------------------- */
+
+static char *carveDefaultTags[CARVE_DEFAULT_TAG_COUNT] = {
+    "Make", "Model", "DateTimeOriginal"};
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int carveFile(char *fileName, struct carveScan *scan);
+
+long int findCarveCandidate(unsigned char *data, long int length);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int carveBlock(unsigned char *block, long int length,
+                           long int scanEnd, long int blockPos,
+                           struct carveScan *scan);
+
+static long int findCarveExif(unsigned char *block, long int length,
+                              long int pos);
+
+static long int readCarveBlock(int fd, unsigned char *block, long int length);
+
+static long int findCandidateScalar(unsigned char *data, long int length);
+
+#ifdef CARVE_SIMD
+static long int findCandidateSse2(unsigned char *data, long int length);
+
+static long int findCandidateAvx2(unsigned char *data, long int length);
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+#endif
+
+/* -------------------------------------------------------------------------- */
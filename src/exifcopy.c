@@ -0,0 +1,141 @@
+/* -------------------------------------------------------------------------- */
+
+#define _GNU_SOURCE
+
+#include "exifcopy.h"
+
+/* -------------------------------------------------------------------------- */
+/* copyFileData                                                               */
+/* copies "length" bytes starting at "inPos" of file "fdIn" to the current    */
+/* position of file "fdOut". the data is copied inside the kernel using       */
+/* copy_file_range, falling back to sendfile if the file systems do not       */
+/* support it. no data passes through user space. returns 0 if successful or  */
+/* a negative value otherwise.                                                */
+/* -------------------------------------------------------------------------- */
+
+long int copyFileData(int fdIn, off_t inPos, int fdOut, off_t length) {
+    ssize_t n = 0;
+
+    while (length > 0) {
+        n = copy_file_range(fdIn, &inPos, fdOut, NULL,
+                            length < COPY_CHUNK_SIZE ? length : COPY_CHUNK_SIZE,
+                            0);
+
+        if (n < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+                      errno == EOPNOTSUPP || errno == EBADF))
+            return copyFileDataSendfile(fdIn, &inPos, fdOut, length);
+
+        if (n < 0 && errno == EINTR) continue;
+
+        if (n < 0) return COPY_ERR_COPY;
+
+        if (n == 0) return COPY_ERR_SHORT;
+
+        length = length - n;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* copyFile                                                                   */
+/* creates "dstFileName" from "srcFileName" using "mode". COPY_MODE_LINK      */
+/* tries a hard link first, COPY_MODE_LINK and COPY_MODE_REFLINK try to clone */
+/* the file (FICLONE) and all modes fall back to copyFileData. the mode and   */
+/* the timestamps of the source are kept. COPY_MODE_MOVE removes the source   */
+/* after copying. "dstFileName" may already exist and is truncated. returns   */
+/* 0 if successful or a negative value otherwise.                             */
+/* -------------------------------------------------------------------------- */
+
+long int copyFile(char *srcFileName, char *dstFileName, long int mode) {
+    long int rc = 0;
+    int fdIn = -1;
+    int fdOut = -1;
+
+    struct stat fileStat;
+    struct timespec fileTimes[2];
+
+    /* hard link */
+
+    if (mode == COPY_MODE_LINK) {
+        unlink(dstFileName);
+
+        if (link(srcFileName, dstFileName) == 0) return 0;
+
+        if (errno != EXDEV && errno != EPERM && errno != EMLINK)
+            return COPY_ERR_LINK;
+    }
+
+    /* open files */
+
+    if ((fdIn = open(srcFileName, O_RDONLY)) < 0) return COPY_ERR_OPEN;
+
+    if (fstat(fdIn, &fileStat) < 0) {
+        close(fdIn);
+        return COPY_ERR_STAT;
+    }
+
+    if ((fdOut = open(dstFileName, O_WRONLY | O_CREAT | O_TRUNC,
+                      fileStat.st_mode & 07777)) < 0) {
+        close(fdIn);
+        return COPY_ERR_OPEN;
+    }
+
+    /* clone or copy data */
+
+    if (mode == COPY_MODE_COPY || ioctl(fdOut, FICLONE, fdIn) < 0)
+        rc = copyFileData(fdIn, 0, fdOut, fileStat.st_size);
+
+    /* keep mode and timestamps */
+
+    if (rc == 0) {
+        fchmod(fdOut, fileStat.st_mode & 07777);
+        fileTimes[0] = fileStat.st_atim;
+        fileTimes[1] = fileStat.st_mtim;
+        futimens(fdOut, fileTimes);
+    }
+
+    close(fdIn);
+
+    if (close(fdOut) < 0 && rc == 0) rc = COPY_ERR_COPY;
+
+    if (rc < 0) {
+        unlink(dstFileName);
+        return rc;
+    }
+
+    /* remove source */
+
+    if (mode == COPY_MODE_MOVE && unlink(srcFileName) < 0)
+        return COPY_ERR_UNLINK;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* copyFileDataSendfile                                                       */
+/* fallback of copyFileData for kernels or file systems without               */
+/* copy_file_range. returns 0 if successful or a negative value otherwise.    */
+/* -------------------------------------------------------------------------- */
+
+static long int copyFileDataSendfile(int fdIn, off_t *inPos, int fdOut,
+                                     off_t length) {
+    ssize_t n = 0;
+
+    while (length > 0) {
+        n = sendfile(fdOut, fdIn, inPos,
+                     length < COPY_CHUNK_SIZE ? length : COPY_CHUNK_SIZE);
+
+        if (n < 0 && errno == EINTR) continue;
+
+        if (n < 0) return COPY_ERR_COPY;
+
+        if (n == 0) return COPY_ERR_SHORT;
+
+        length = length - n;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,52 @@
+#ifndef EXIFCOPY_H_INCLUDED
+#define EXIFCOPY_H_INCLUDED
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define COPY_MODE_MOVE 0
+#define COPY_MODE_COPY 1
+#define COPY_MODE_LINK 2
+#define COPY_MODE_REFLINK 3
+
+#define COPY_CHUNK_SIZE 0x40000000L
+
+#define COPY_ERR_OPEN -811
+#define COPY_ERR_STAT -812
+#define COPY_ERR_COPY -813
+#define COPY_ERR_SHORT -814
+#define COPY_ERR_LINK -815
+#define COPY_ERR_UNLINK -816
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int copyFileData(int fdIn, off_t inPos, int fdOut, off_t length);
+
+long int copyFile(char *srcFileName, char *dstFileName, long int mode);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int copyFileDataSendfile(int fdIn, off_t *inPos, int fdOut,
+                                     off_t length);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,348 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifdupe.h"
+
+/* -------------------------------------------------------------------------- */
+/* fingerprintFile                                                            */
+/* computes the candidate key and the meta hash of "item" and finds its       */
+/* payload. only the segment headers and the app1 block are read, the key     */
+/* tags are visited in the app1 block in memory. returns 0 if successful or a */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+long int fingerprintFile(struct dupeItem *item) {
+    long int i = 0;
+    long int rc = 0;
+    long int valueLength = 0;
+    int fd = 0;
+
+    off_t app1Pos = -1;
+    off_t app1Length = 0;
+    off_t sosPos = 0;
+    unsigned char *buf = NULL;
+    unsigned char tagNo = 0;
+    char *value = NULL;
+    char *buffer = NULL;
+
+    struct stat fileStat;
+    struct exifSource source;
+    struct dupeKeyVisit visit;
+    struct exifItem *tag = NULL;
+
+    (*item).payloadHashed = 0;
+    (*item).metaHash = DUPE_FNV_OFFSET;
+
+    /* find app1 block and payload */
+
+    if ((fd = open((*item).fileName, O_RDONLY)) < 0) return DUPE_ERR_FILE_OPEN;
+
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return DUPE_ERR_FILE_READ;
+    }
+
+    if ((rc = findJpegSegments(fd, fileStat.st_size, &app1Pos, &app1Length,
+                               &sosPos)) < 0) {
+        close(fd);
+        return rc;
+    }
+
+    (*item).payloadPos = sosPos;
+    (*item).payloadLength = fileStat.st_size - sosPos;
+
+    /* candidate key */
+
+    (*item).keyHash =
+        hashBytes(DUPE_FNV_OFFSET, (unsigned char *)&(*item).payloadLength,
+                  sizeof(off_t));
+
+    if (app1Pos < 0) {
+        close(fd);
+        return 0;
+    }
+
+    /* hash app1 block */
+
+    if ((buf = (unsigned char *)malloc(app1Length)) == NULL) {
+        close(fd);
+        return DUPE_ERR_MALLOC;
+    }
+
+    if (pread(fd, buf, app1Length, app1Pos) != app1Length) {
+        free(buf);
+        close(fd);
+        return DUPE_ERR_FILE_READ;
+    }
+
+    close(fd);
+
+    (*item).metaHash = hashBytes(DUPE_FNV_OFFSET, buf, app1Length);
+
+    /* the key tags are read from the tiff header after the app1 header */
+
+    memset(&visit, 0, sizeof(struct dupeKeyVisit));
+
+    for (i = 0; i < DUPE_KEY_TAG_COUNT; i++)
+        visit.tagIDs[i] = findTagIDByName(dupeKeyTags[i]);
+
+    openExifMemory(&source, buf + DUPE_APP1_HEADER_LENGTH,
+                   app1Length - DUPE_APP1_HEADER_LENGTH);
+
+    if (visitExifInfo(&exifDefaultContext, &source, visitDupeKeyTag, &visit) <
+        0)
+        visit.foundCount = 0;
+
+    for (i = 0; i < DUPE_KEY_TAG_COUNT && visit.foundCount > 0; i++) {
+        if (!visit.found[i]) continue;
+
+        tag = &visit.tags[i];
+        buffer = NULL;
+
+        if ((*tag).tagType == 2) {
+            value = (char *)(*tag).tagData;
+            valueLength = strnlen(value, (*tag).tagCount);
+        } else if ((value = buffer = parseTagData(tag)) != NULL)
+            valueLength = strlen(value);
+        else
+            continue;
+
+        tagNo = (unsigned char)i;
+
+        (*item).keyHash = hashBytes((*item).keyHash, &tagNo, 1);
+        (*item).keyHash =
+            hashBytes((*item).keyHash, (unsigned char *)value, valueLength);
+
+        free(buffer);
+    }
+
+    closeExifSource(&source);
+    free(buf);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* hashFilePayload                                                            */
+/* computes the payload hash of "item" from the start of scan to the end of   */
+/* the file. returns 0 if successful or a negative value otherwise.           */
+/* -------------------------------------------------------------------------- */
+
+long int hashFilePayload(struct dupeItem *item) {
+    int fd = 0;
+    ssize_t n = 0;
+    off_t pos = (*item).payloadPos;
+    off_t end = (*item).payloadPos + (*item).payloadLength;
+    uint64_t hash = DUPE_FNV_OFFSET;
+    unsigned char *buf = NULL;
+
+    if ((fd = open((*item).fileName, O_RDONLY)) < 0) return DUPE_ERR_FILE_OPEN;
+
+    if ((buf = (unsigned char *)malloc(DUPE_BUFFER_SIZE)) == NULL) {
+        close(fd);
+        return DUPE_ERR_MALLOC;
+    }
+
+    posix_fadvise(fd, pos, (*item).payloadLength, POSIX_FADV_SEQUENTIAL);
+
+    while (pos < end) {
+        n = end - pos < DUPE_BUFFER_SIZE ? end - pos : DUPE_BUFFER_SIZE;
+
+        if ((n = pread(fd, buf, n, pos)) <= 0) {
+            free(buf);
+            close(fd);
+            return DUPE_ERR_FILE_READ;
+        }
+
+        hash = hashBytes(hash, buf, n);
+        pos = pos + n;
+    }
+
+    free(buf);
+    close(fd);
+
+    (*item).payloadHash = hash;
+    (*item).payloadHashed = 1;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* compareFilePayloads                                                        */
+/* compares the payloads of "itemA" and "itemB" byte by byte, as equal        */
+/* hashes only make them likely duplicates. returns 0 if they are equal, 1 if */
+/* they differ or a negative value otherwise.                                 */
+/* -------------------------------------------------------------------------- */
+
+long int compareFilePayloads(struct dupeItem *itemA, struct dupeItem *itemB) {
+    long int rc = 0;
+    int fdA = -1;
+    int fdB = -1;
+    ssize_t n = 0;
+    off_t pos = 0;
+    unsigned char *buf = NULL;
+
+    if ((*itemA).payloadLength != (*itemB).payloadLength) return 1;
+
+    if ((fdA = open((*itemA).fileName, O_RDONLY)) < 0 ||
+        (fdB = open((*itemB).fileName, O_RDONLY)) < 0)
+        rc = DUPE_ERR_FILE_OPEN;
+    else if ((buf = (unsigned char *)malloc(2 * DUPE_BUFFER_SIZE)) == NULL)
+        rc = DUPE_ERR_MALLOC;
+
+    while (rc == 0 && pos < (*itemA).payloadLength) {
+        n = (*itemA).payloadLength - pos < DUPE_BUFFER_SIZE
+                ? (*itemA).payloadLength - pos
+                : DUPE_BUFFER_SIZE;
+
+        if (pread(fdA, buf, n, (*itemA).payloadPos + pos) != n ||
+            pread(fdB, buf + DUPE_BUFFER_SIZE, n, (*itemB).payloadPos + pos) !=
+                n)
+            rc = DUPE_ERR_FILE_READ;
+        else if (memcmp(buf, buf + DUPE_BUFFER_SIZE, n) != 0)
+            rc = 1;
+
+        pos = pos + n;
+    }
+
+    free(buf);
+    if (fdA >= 0) close(fdA);
+    if (fdB >= 0) close(fdB);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* sortDupeItems                                                              */
+/* sorts "items" by candidate key and payload hash, keeping the original      */
+/* order within equal items. items that could not be fingerprinted come       */
+/* last.                                                                      */
+/* -------------------------------------------------------------------------- */
+
+void sortDupeItems(struct dupeItem *items, long int itemCount) {
+    qsort(items, itemCount, sizeof(struct dupeItem), compareDupeItems);
+}
+
+/* -------------------------------------------------------------------------- */
+/* hashBytes                                                                  */
+/* continues the fnv-1a hash "hash" with "length" bytes of "bytes" and        */
+/* returns it.                                                                */
+/* -------------------------------------------------------------------------- */
+
+uint64_t hashBytes(uint64_t hash, unsigned char *bytes, long int length) {
+    long int i = 0;
+
+    for (i = 0; i < length; i++) hash = (hash ^ bytes[i]) * DUPE_FNV_PRIME;
+
+    return hash;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findJpegSegments                                                           */
+/* walks the segment headers of the jpg file "fd" up to the start of scan.    */
+/* writes the position and length of the exif app1 block (or -1 if there is   */
+/* none) and the position of the start of scan. returns 0 if successful or a  */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int findJpegSegments(int fd, off_t fileSize, off_t *app1Pos,
+                                 off_t *app1Length, off_t *sosPos) {
+    off_t pos = 2;
+    long int length = 0;
+    unsigned char header[10];
+
+    *app1Pos = -1;
+
+    if (pread(fd, header, 2, 0) != 2 || header[0] != 0xFF || header[1] != 0xD8)
+        return DUPE_ERR_NO_JPG;
+
+    while (pos + 4 <= fileSize) {
+        if (pread(fd, header, 4, pos) != 4) return DUPE_ERR_FILE_READ;
+
+        if (header[0] != 0xFF) return DUPE_ERR_NO_JPG;
+
+        /* fill bytes and markers without length */
+
+        if (header[1] == 0xFF) {
+            pos++;
+            continue;
+        }
+
+        if (header[1] == 0x01 || (header[1] >= 0xD0 && header[1] <= 0xD7)) {
+            pos = pos + 2;
+            continue;
+        }
+
+        /* start of scan - the payload follows */
+
+        if (header[1] == 0xDA) {
+            *sosPos = pos;
+            return 0;
+        }
+
+        length = (header[2] << 8) | header[3];
+
+        if (length < 2) return DUPE_ERR_NO_JPG;
+
+        if (header[1] == 0xE1 && *app1Pos < 0 && pos + 10 <= fileSize &&
+            pread(fd, header, 10, pos) == 10 &&
+            memcmp(header + 4, "Exif\0\0", 6) == 0) {
+            *app1Pos = pos;
+            *app1Length = length + 2;
+        }
+
+        pos = pos + 2 + length;
+    }
+
+    return DUPE_ERR_NO_JPG;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitDupeKeyTag                                                            */
+/* tag hook of fingerprintFile. keeps the first item of every candidate key   */
+/* tag in "arg" and stops the walk once all of them are found.                */
+/* -------------------------------------------------------------------------- */
+
+static long int visitDupeKeyTag(struct exifItem *item, void *arg) {
+    long int i = 0;
+
+    struct dupeKeyVisit *visit = (struct dupeKeyVisit *)arg;
+
+    for (i = 0; i < DUPE_KEY_TAG_COUNT; i++) {
+        if ((*visit).tagIDs[i] != (*item).tagID || (*visit).found[i]) continue;
+
+        (*visit).tags[i] = *item;
+        (*visit).found[i] = 1;
+        (*visit).foundCount++;
+    }
+
+    if ((*visit).foundCount == DUPE_KEY_TAG_COUNT) return EXIF_VISIT_STOP;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* compareDupeItems                                                           */
+/* qsort callback for sortDupeItems.                                          */
+/* -------------------------------------------------------------------------- */
+
+static int compareDupeItems(const void *a, const void *b) {
+    struct dupeItem *itemA = (struct dupeItem *)a;
+    struct dupeItem *itemB = (struct dupeItem *)b;
+
+    if (((*itemA).rc < 0) != ((*itemB).rc < 0))
+        return (*itemA).rc < 0 ? 1 : -1;
+
+    if ((*itemA).keyHash != (*itemB).keyHash)
+        return (*itemA).keyHash < (*itemB).keyHash ? -1 : 1;
+
+    if ((*itemA).payloadHashed != (*itemB).payloadHashed)
+        return (*itemA).payloadHashed - (*itemB).payloadHashed;
+
+    if ((*itemA).payloadHash != (*itemB).payloadHash)
+        return (*itemA).payloadHash < (*itemB).payloadHash ? -1 : 1;
+
+    return ((*itemA).itemNo > (*itemB).itemNo) -
+           ((*itemA).itemNo < (*itemB).itemNo);
+}
+
+/* -------------------------------------------------------------------------- */
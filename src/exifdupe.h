@@ -0,0 +1,112 @@
+#ifndef EXIFDUPE_H_INCLUDED
+#define EXIFDUPE_H_INCLUDED
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "exiflib.h"
+#include "exifparser.h"
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    duplicate detection:                                                    */
+/*                                                                            */
+/*       FF-D8|FF-E1-HL-LL|EXIF...|FF-xx-HL-LL|...|FF-DA|PAYLOAD|FF-D9        */
+/*       -----|-------------------|-----------|---|----------------------     */
+/*       SOI  |APP1 (META HASH)   |SEGMENTS   |...|SOS TO EOF (PAYLOAD HASH)  */
+/*                                                                            */
+/*    the first pass only reads the segment headers and the app1 block. the   */
+/*    candidate key combines ImageUniqueID, DateTimeOriginal,                 */
+/*    BodySerialNumber and the payload length, which do not change when       */
+/*    other tags are edited. only files sharing a candidate key get their     */
+/*    payload hashed in the second pass. files with the same payload hash     */
+/*    have their payloads compared byte by byte, the equal ones are           */
+/*    duplicates. the meta hash tells if their exif block differs.            */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define DUPE_FNV_OFFSET 14695981039346656037ULL
+#define DUPE_FNV_PRIME 1099511628211ULL
+#define DUPE_BUFFER_SIZE 0x100000L
+
+#define DUPE_KEY_TAG_COUNT 3
+#define DUPE_APP1_HEADER_LENGTH 10
+
+#define DUPE_ERR_MALLOC -851
+#define DUPE_ERR_FILE_OPEN -852
+#define DUPE_ERR_FILE_READ -853
+#define DUPE_ERR_NO_JPG -854
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct dupeItem {
+    char *fileName;
+    long int itemNo;
+    long int rc;
+
+    uint64_t keyHash;
+    uint64_t metaHash;
+    uint64_t payloadHash;
+    int payloadHashed;
+
+    off_t payloadPos;
+    off_t payloadLength;
+    struct dupeItem *groupHead;
+    int payloadEqual;
+};
+
+struct dupeKeyVisit {
+    long int tagIDs[DUPE_KEY_TAG_COUNT];
+    struct exifItem tags[DUPE_KEY_TAG_COUNT];
+    int found[DUPE_KEY_TAG_COUNT];
+    long int foundCount;
+};
+
+/* -------------------------------------------------------------------------- */
+/* candidate key tags                                                         */
+/* -------------------------------------------------------------------------- */
+
+static char *dupeKeyTags[DUPE_KEY_TAG_COUNT] = {
+    "ImageUniqueID", "DateTimeOriginal", "BodySerialNumber"};
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int fingerprintFile(struct dupeItem *item);
+
+long int hashFilePayload(struct dupeItem *item);
+
+long int compareFilePayloads(struct dupeItem *itemA, struct dupeItem *itemB);
+
+void sortDupeItems(struct dupeItem *items, long int itemCount);
+
+uint64_t hashBytes(uint64_t hash, unsigned char *bytes, long int length);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int findJpegSegments(int fd, off_t fileSize, off_t *app1Pos,
+                                 off_t *app1Length, off_t *sosPos);
+
+static long int visitDupeKeyTag(struct exifItem *item, void *arg);
+
+static int compareDupeItems(const void *a, const void *b);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
@@ -14,6 +14,7 @@ long int printExifInfo(FILE *stream, struct exifItem *exifTable,
                        int exifTableItemCount, char **tagTable,
                        int tagTableItemCount, int verbose) {
     long int i = 0;
+    long int phaseStart = 0;
 
     char *parsedTagID = NULL;
     char *parsedTagData = NULL;
@@ -21,11 +22,17 @@ long int printExifInfo(FILE *stream, struct exifItem *exifTable,
     if (stream == NULL) return 0;
 
     for (i = 0; i < exifTableItemCount; i++) {
+        phaseStart = startPhase();
+
         parsedTagID = parseTagID(&exifTable[i]);
         parsedTagData = parseTagData(&exifTable[i]);
 
+        endPhase(STATS_PHASE_FORMAT, phaseStart);
+
         if (!isInTagTable(parsedTagID, tagTable, tagTableItemCount)) continue;
 
+        phaseStart = startPhase();
+
         if (parsedTagID == NULL) {
             fprintf(stream, "[unknown]");
             fprintf(stream, "%*c", 36 - 9, ' ');
@@ -52,6 +59,8 @@ long int printExifInfo(FILE *stream, struct exifItem *exifTable,
             fprintf(stream, "\ttagCount      = %ld\n", exifTable[i].tagCount);
             fprintf(stream, "\ttagDataPos    = %ld\n", exifTable[i].tagDataPos);
         }
+
+        endPhase(STATS_PHASE_OUTPUT, phaseStart);
     }
 
     return 0;
@@ -70,21 +79,30 @@ long int printExifCsv(FILE *stream, struct exifItem *exifTable,
                       int exifTableItemCount, char **tagTable,
                       int tagTableItemCount, int verbose) {
     long int i = 0;
+    long int phaseStart = 0;
 
     char *tagData = NULL;
-    static struct exifItem *exifTag = NULL;
+    struct exifItem *exifTag = NULL;
 
     for (i = 0; i < tagTableItemCount; i++) {
+        phaseStart = startPhase();
+
         if ((exifTag = findTagByName(exifTable, exifTableItemCount,
-                                     tagTable[i])) == NULL) {
-            fprintf(stream, "n/a,");
-            continue;
-        }
+                                     tagTable[i])) == NULL)
+            tagData = NULL;
+        else
+            tagData = parseTagData(exifTag);
+
+        endPhase(STATS_PHASE_FORMAT, phaseStart);
+
+        phaseStart = startPhase();
 
-        if ((tagData = parseTagData(exifTag)) != NULL)
+        if (tagData != NULL)
             fprintf(stream, "%s,", tagData);
         else
             fprintf(stream, "n/a,");
+
+        endPhase(STATS_PHASE_OUTPUT, phaseStart);
     }
 
     fprintf(stream, "\n");
@@ -92,6 +110,37 @@ long int printExifCsv(FILE *stream, struct exifItem *exifTable,
     return 0;
 }
 
+/* -------------------------------------------------------------------------- */
+/* collectTagHook                                                             */
+/* visitor that keeps the first item of every tag in the tag table of the     */
+/* tagCollector "arg". its exif table needs room for "tagTableItemCount"      */
+/* items and can be used like an extracted table until the source is          */
+/* closed. always returns 0.                                                  */
+/* -------------------------------------------------------------------------- */
+
+long int collectTagHook(struct exifItem *item, void *arg) {
+    char *parsedTagID = NULL;
+
+    struct tagCollector *collector = (struct tagCollector *)arg;
+
+    if ((*collector).tagTableItemCount == 0) return 0;
+
+    parsedTagID = parseTagID(item);
+
+    if (!isInTagTable(parsedTagID, (*collector).tagTable,
+                      (*collector).tagTableItemCount))
+        return 0;
+
+    if (findTagByName((*collector).exifTable, (*collector).exifTableItemCount,
+                      parsedTagID) != NULL)
+        return 0;
+
+    (*collector).exifTable[(*collector).exifTableItemCount] = *item;
+    (*collector).exifTableItemCount++;
+
+    return 0;
+}
+
 /* -------------------------------------------------------------------------- */
 /* isInTagTable                                                               */
 /* returns true if "parsedTagId" is a member of "tagTable" of length          */
@@ -204,7 +253,7 @@ static long int parseSubPattern(char **subFileName, char *subPattern,
     long int toPos = 0;
 
     char *tagData = NULL;
-    static struct exifItem *exifTag = NULL;
+    struct exifItem *exifTag = NULL;
 
     /* extract tag id */
 
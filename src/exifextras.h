@@ -13,6 +13,17 @@
 
 #include "exifparser.h"
 
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct tagCollector {
+    char **tagTable;
+    long int tagTableItemCount;
+    struct exifItem *exifTable;
+    long int exifTableItemCount;
+};
+
 /* -------------------------------------------------------------------------- */
 /* public functions                                                           */
 /* -------------------------------------------------------------------------- */
@@ -25,6 +36,8 @@ long int printExifCsv(FILE *stream, struct exifItem *exifTable,
                       int exifTableItemCount, char **tagTable,
                       int tagTableItemCount, int verbose);
 
+long int collectTagHook(struct exifItem *item, void *arg);
+
 long int fileNameFromPattern(char **fileName, char *pattern, char *oldFileName,
                              struct exifItem *exifTable,
                              int exifTableItemCount);
@@ -0,0 +1,739 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exiffilter.h"
+
+/* -------------------------------------------------------------------------- */
+/* compileFilter                                                              */
+/* compiles the filter "expression" to "filter". returns 0 if successful or a */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+long int compileFilter(char *expression, struct exifFilter **filter) {
+    long int rc = 0;
+    long int i = 0;
+    long int depth = 0;
+    long int maxDepth = 0;
+
+    struct filterParser parser;
+
+    if ((*filter = (struct exifFilter *)calloc(1, sizeof(struct exifFilter))) ==
+        NULL)
+        return FILTER_ERR_MALLOC;
+
+    parser.pos = expression;
+    parser.filter = *filter;
+
+    if ((rc = parseFilterOr(&parser)) < 0) {
+        freeFilter(*filter);
+        *filter = NULL;
+        return rc;
+    }
+
+    skipFilterSpace(&parser);
+
+    if (*parser.pos != '\0') {
+        freeFilter(*filter);
+        *filter = NULL;
+        return FILTER_ERR_SYNTAX;
+    }
+
+    /* make sure the code fits on the evaluation stack */
+
+    for (i = 0; i < (**filter).opCount; i++) {
+        switch ((**filter).ops[i].op) {
+            case FILTER_OP_TAG:
+            case FILTER_OP_NUMBER:
+            case FILTER_OP_STRING:
+            case FILTER_OP_EXISTS:
+                depth++;
+                break;
+            case FILTER_OP_NOT:
+            case FILTER_OP_JUMP_FALSE:
+            case FILTER_OP_JUMP_TRUE:
+                break;
+            default:
+                depth--;
+                break;
+        }
+
+        if (depth > maxDepth) maxDepth = depth;
+    }
+
+    if (maxDepth > FILTER_MAX_STACK) {
+        freeFilter(*filter);
+        *filter = NULL;
+        return FILTER_ERR_TOO_COMPLEX;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* freeFilter                                                                 */
+/* releases the memory of a compiled "filter".                                */
+/* -------------------------------------------------------------------------- */
+
+void freeFilter(struct exifFilter *filter) {
+    long int i = 0;
+
+    if (filter == NULL) return;
+
+    for (i = 0; i < (*filter).opCount; i++) free((*filter).ops[i].string);
+
+    free((*filter).ops);
+    free(filter);
+}
+
+/* -------------------------------------------------------------------------- */
+/* extractExifInfoFiltered                                                    */
+/* same as extractExifInfo, but only for files matching "filter". the filter  */
+/* is evaluated during the extraction, which stops as soon as the file is     */
+/* known not to match. returns the number of exif items, EXIF_FILTERED if     */
+/* the file does not match or another negative value in case of an error.     */
+/* "filter" may be null.                                                      */
+/* -------------------------------------------------------------------------- */
+
+long int extractExifInfoFiltered(char *fileName, struct exifItem **exifTable,
+                                 struct exifFilter *filter) {
+    long int rc = 0;
+    long int i = 0;
+
+    struct filterState state;
+
+    if (filter == NULL) return extractExifInfo(fileName, exifTable);
+
+    state.filter = filter;
+    state.visitor = NULL;
+    state.visitorArg = NULL;
+
+    for (i = 0; i < (*filter).tagCount; i++)
+        state.slotState[i] = FILTER_SLOT_UNKNOWN;
+
+    *exifTable = NULL;
+
+    if ((rc = extractExifInfoHook(fileName, exifTable, filterTagHook,
+                                  &state)) < 0)
+        return rc;
+
+    /* tags not seen by now do not exist */
+
+    for (i = 0; i < (*filter).tagCount; i++)
+        if (state.slotState[i] == FILTER_SLOT_UNKNOWN)
+            state.slotState[i] = FILTER_SLOT_MISSING;
+
+    if (evaluateFilter(&state) != FILTER_TRUE) {
+        freeExifTable(*exifTable, rc);
+        *exifTable = NULL;
+        return EXIF_FILTERED;
+    }
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitExifInfoFiltered                                                      */
+/* same as visitExifInfo with the default context, but only for sources       */
+/* matching "filter". "visitor" is called for every tag until the file is     */
+/* known not to match. returns the number of tags visited, EXIF_FILTERED if   */
+/* the file does not match or another negative value in case of an error.     */
+/* "filter" may be null.                                                      */
+/* -------------------------------------------------------------------------- */
+
+long int visitExifInfoFiltered(struct exifSource *source,
+                               struct exifFilter *filter, exifTagHook visitor,
+                               void *visitorArg) {
+    long int rc = 0;
+    long int i = 0;
+
+    struct filterState state;
+
+    if (filter == NULL)
+        return visitExifInfo(&exifDefaultContext, source, visitor, visitorArg);
+
+    state.filter = filter;
+    state.visitor = visitor;
+    state.visitorArg = visitorArg;
+
+    for (i = 0; i < (*filter).tagCount; i++)
+        state.slotState[i] = FILTER_SLOT_UNKNOWN;
+
+    if ((rc = visitExifInfo(&exifDefaultContext, source, filterTagHook,
+                            &state)) < 0)
+        return rc;
+
+    /* tags not seen by now do not exist */
+
+    for (i = 0; i < (*filter).tagCount; i++)
+        if (state.slotState[i] == FILTER_SLOT_UNKNOWN)
+            state.slotState[i] = FILTER_SLOT_MISSING;
+
+    if (evaluateFilter(&state) != FILTER_TRUE) return EXIF_FILTERED;
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* filterTagHook                                                              */
+/* extraction hook. keeps the items referenced by the filter and evaluates    */
+/* the filter whenever one of them is found. returns EXIF_FILTERED as soon    */
+/* as the filter is false. otherwise passes the item on to the visitor of     */
+/* the state, if any. a visitor that stops early stops the walk if the        */
+/* filter is already true, otherwise it is detached and the walk goes on      */
+/* until the filter is decided.                                               */
+/* -------------------------------------------------------------------------- */
+
+static long int filterTagHook(struct exifItem *item, void *arg) {
+    long int i = 0;
+    long int rc = 0;
+    int found = 0;
+
+    struct filterState *state = (struct filterState *)arg;
+    struct exifFilter *filter = (*state).filter;
+
+    for (i = 0; i < (*filter).tagCount; i++) {
+        if ((*filter).tagIDs[i] == (*item).tagID &&
+            (*state).slotState[i] == FILTER_SLOT_UNKNOWN) {
+            (*state).slots[i] = *item;
+            (*state).slotState[i] = FILTER_SLOT_FOUND;
+            found = 1;
+        }
+    }
+
+    if (found && evaluateFilter(state) == FILTER_FALSE) return EXIF_FILTERED;
+
+    if ((*state).visitor == NULL) return 0;
+
+    if ((rc = (*state).visitor(item, (*state).visitorArg)) != EXIF_VISIT_STOP)
+        return rc;
+
+    if (evaluateFilter(state) == FILTER_TRUE) return EXIF_VISIT_STOP;
+
+    (*state).visitor = NULL;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* evaluateFilter                                                             */
+/* runs the filter code with the tags in "state". returns FILTER_TRUE,        */
+/* FILTER_FALSE or FILTER_UNKNOWN if the result depends on tags that have not */
+/* been seen yet.                                                             */
+/* -------------------------------------------------------------------------- */
+
+static int evaluateFilter(struct filterState *state) {
+    long int pc = 0;
+    long int top = -1;
+    int a = 0;
+    int b = 0;
+
+    struct exifFilter *filter = (*state).filter;
+    struct filterOp *op = NULL;
+    struct filterValue stack[FILTER_MAX_STACK];
+
+    for (pc = 0; pc < (*filter).opCount; pc++) {
+        op = &(*filter).ops[pc];
+
+        switch ((*op).op) {
+            case FILTER_OP_TAG:
+                top++;
+                stack[top].type = FILTER_VALUE_TRUTH;
+                if ((*state).slotState[(*op).arg] == FILTER_SLOT_FOUND) {
+                    stack[top].type = FILTER_VALUE_TAG;
+                    stack[top].tag = &(*state).slots[(*op).arg];
+                } else if ((*state).slotState[(*op).arg] == FILTER_SLOT_MISSING)
+                    stack[top].truth = FILTER_FALSE;
+                else
+                    stack[top].truth = FILTER_UNKNOWN;
+                break;
+
+            case FILTER_OP_NUMBER:
+                top++;
+                stack[top].type = FILTER_VALUE_NUMBER;
+                stack[top].number = (*op).number;
+                break;
+
+            case FILTER_OP_STRING:
+                top++;
+                stack[top].type = FILTER_VALUE_STRING;
+                stack[top].string = (*op).string;
+                break;
+
+            case FILTER_OP_EXISTS:
+                top++;
+                stack[top].type = FILTER_VALUE_TRUTH;
+                if ((*state).slotState[(*op).arg] == FILTER_SLOT_FOUND)
+                    stack[top].truth = FILTER_TRUE;
+                else if ((*state).slotState[(*op).arg] == FILTER_SLOT_MISSING)
+                    stack[top].truth = FILTER_FALSE;
+                else
+                    stack[top].truth = FILTER_UNKNOWN;
+                break;
+
+            case FILTER_OP_EQ:
+            case FILTER_OP_NE:
+            case FILTER_OP_LT:
+            case FILTER_OP_LE:
+            case FILTER_OP_GT:
+            case FILTER_OP_GE:
+                top--;
+                stack[top].truth =
+                    compareFilterValues(&stack[top], &stack[top + 1], (*op).op);
+                stack[top].type = FILTER_VALUE_TRUTH;
+                break;
+
+            case FILTER_OP_NOT:
+                if (stack[top].truth != FILTER_UNKNOWN)
+                    stack[top].truth = !stack[top].truth;
+                break;
+
+            case FILTER_OP_AND:
+                top--;
+                a = stack[top].truth;
+                b = stack[top + 1].truth;
+                if (a == FILTER_FALSE || b == FILTER_FALSE)
+                    stack[top].truth = FILTER_FALSE;
+                else if (a == FILTER_TRUE && b == FILTER_TRUE)
+                    stack[top].truth = FILTER_TRUE;
+                else
+                    stack[top].truth = FILTER_UNKNOWN;
+                break;
+
+            case FILTER_OP_OR:
+                top--;
+                a = stack[top].truth;
+                b = stack[top + 1].truth;
+                if (a == FILTER_TRUE || b == FILTER_TRUE)
+                    stack[top].truth = FILTER_TRUE;
+                else if (a == FILTER_FALSE && b == FILTER_FALSE)
+                    stack[top].truth = FILTER_FALSE;
+                else
+                    stack[top].truth = FILTER_UNKNOWN;
+                break;
+
+            case FILTER_OP_JUMP_FALSE:
+                if (stack[top].truth == FILTER_FALSE) pc = (*op).arg - 1;
+                break;
+
+            case FILTER_OP_JUMP_TRUE:
+                if (stack[top].truth == FILTER_TRUE) pc = (*op).arg - 1;
+                break;
+        }
+    }
+
+    return stack[0].truth;
+}
+
+/* -------------------------------------------------------------------------- */
+/* compareFilterValues                                                        */
+/* compares "a" and "b" using the comparison "op". returns FILTER_TRUE,       */
+/* FILTER_FALSE or FILTER_UNKNOWN if one of the tags has not been seen yet.   */
+/* -------------------------------------------------------------------------- */
+
+static int compareFilterValues(struct filterValue *a, struct filterValue *b,
+                               int op) {
+    int cmp = 0;
+    double numberA = 0;
+    double numberB = 0;
+    char *stringA = NULL;
+    char *stringB = NULL;
+    char *bufferA = NULL;
+    char *bufferB = NULL;
+
+    /* unknown or missing tags */
+
+    if ((*a).type == FILTER_VALUE_TRUTH || (*b).type == FILTER_VALUE_TRUTH) {
+        if (((*a).type == FILTER_VALUE_TRUTH &&
+             (*a).truth == FILTER_UNKNOWN) ||
+            ((*b).type == FILTER_VALUE_TRUTH && (*b).truth == FILTER_UNKNOWN))
+            return FILTER_UNKNOWN;
+        return FILTER_FALSE;
+    }
+
+    /* numbers - tags are numbers unless both are ascii */
+
+    if ((*a).type == FILTER_VALUE_NUMBER || (*b).type == FILTER_VALUE_NUMBER ||
+        ((*a).type == FILTER_VALUE_TAG && (*b).type == FILTER_VALUE_TAG &&
+         (*(*a).tag).tagType != 2 && (*(*b).tag).tagType != 2)) {
+        if (!valueToNumber(a, &numberA) || !valueToNumber(b, &numberB))
+            return FILTER_FALSE;
+        cmp = numberA < numberB ? -1 : numberA > numberB;
+    }
+
+    /* strings */
+
+    else {
+        stringA = valueToString(a, &bufferA);
+        stringB = valueToString(b, &bufferB);
+
+        if (stringA == NULL || stringB == NULL) {
+            free(bufferA);
+            free(bufferB);
+            return FILTER_FALSE;
+        }
+
+        cmp = strcmp(stringA, stringB);
+
+        free(bufferA);
+        free(bufferB);
+    }
+
+    switch (op) {
+        case FILTER_OP_EQ:
+            return cmp == 0;
+        case FILTER_OP_NE:
+            return cmp != 0;
+        case FILTER_OP_LT:
+            return cmp < 0;
+        case FILTER_OP_LE:
+            return cmp <= 0;
+        case FILTER_OP_GT:
+            return cmp > 0;
+        case FILTER_OP_GE:
+            return cmp >= 0;
+    }
+
+    return FILTER_FALSE;
+}
+
+/* -------------------------------------------------------------------------- */
+/* valueToNumber                                                              */
+/* converts "value" to "number". returns 1 if successful or 0 otherwise.      */
+/* -------------------------------------------------------------------------- */
+
+static int valueToNumber(struct filterValue *value, double *number) {
+    char *end = NULL;
+
+    if ((*value).type == FILTER_VALUE_NUMBER) {
+        *number = (*value).number;
+        return 1;
+    }
+
+    if ((*value).type == FILTER_VALUE_STRING) {
+        *number = strtod((*value).string, &end);
+        return end != (*value).string;
+    }
+
+    return parseTagNumber((*value).tag, number) == 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* valueToString                                                              */
+/* returns "value" as a string. ascii tags are used in place, other tags are  */
+/* parsed to "buffer", which has to be freed by the caller. returns null in   */
+/* case of an error.                                                          */
+/* -------------------------------------------------------------------------- */
+
+static char *valueToString(struct filterValue *value, char **buffer) {
+    struct exifItem *tag = (*value).tag;
+
+    if ((*value).type == FILTER_VALUE_STRING) return (*value).string;
+
+    if ((*tag).tagType == 2 && (*tag).tagCount > 0 &&
+        (*tag).tagData[(*tag).tagCount - 1] == '\0')
+        return (char *)(*tag).tagData;
+
+    *buffer = parseTagData(tag);
+
+    return *buffer;
+}
+
+/* -------------------------------------------------------------------------- */
+/* emitFilterOp                                                               */
+/* appends an operation to the code of "filter". returns the number of the    */
+/* operation if successful or a negative value otherwise.                     */
+/* -------------------------------------------------------------------------- */
+
+static long int emitFilterOp(struct exifFilter *filter, int op, long int arg,
+                             double number, char *string) {
+    long int opNo = (*filter).opCount;
+
+    if (((*filter).ops = (struct filterOp *)realloc(
+             (*filter).ops, sizeof(struct filterOp) * (opNo + 1))) == NULL) {
+        free(string);
+        return FILTER_ERR_MALLOC;
+    }
+
+    (*filter).ops[opNo].op = op;
+    (*filter).ops[opNo].arg = arg;
+    (*filter).ops[opNo].number = number;
+    (*filter).ops[opNo].string = string;
+
+    (*filter).opCount = opNo + 1;
+
+    return opNo;
+}
+
+/* -------------------------------------------------------------------------- */
+/* skipFilterSpace                                                            */
+/* moves the parser past white space.                                         */
+/* -------------------------------------------------------------------------- */
+
+static void skipFilterSpace(struct filterParser *parser) {
+    while (isspace((unsigned char)*(*parser).pos)) (*parser).pos++;
+}
+
+/* -------------------------------------------------------------------------- */
+/* matchFilterToken                                                           */
+/* returns 1 and moves the parser past "token" if it is next in the input.    */
+/* returns 0 otherwise.                                                       */
+/* -------------------------------------------------------------------------- */
+
+static int matchFilterToken(struct filterParser *parser, char *token) {
+    skipFilterSpace(parser);
+
+    if (strncmp((*parser).pos, token, strlen(token)) != 0) return 0;
+
+    (*parser).pos = (*parser).pos + strlen(token);
+
+    return 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseFilterOr                                                              */
+/* parses "and ( || and )*". the right side is skipped if the left side is    */
+/* true. returns 0 if successful or a negative value otherwise.               */
+/* -------------------------------------------------------------------------- */
+
+static long int parseFilterOr(struct filterParser *parser) {
+    long int rc = 0;
+    long int jump = 0;
+
+    if ((rc = parseFilterAnd(parser)) < 0) return rc;
+
+    while (matchFilterToken(parser, "||")) {
+        if ((jump = emitFilterOp((*parser).filter, FILTER_OP_JUMP_TRUE, 0, 0,
+                                 NULL)) < 0)
+            return jump;
+
+        if ((rc = parseFilterAnd(parser)) < 0) return rc;
+
+        if ((rc = emitFilterOp((*parser).filter, FILTER_OP_OR, 0, 0, NULL)) <
+            0)
+            return rc;
+
+        (*(*parser).filter).ops[jump].arg = (*(*parser).filter).opCount;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseFilterAnd                                                             */
+/* parses "unary ( && unary )*". the right side is skipped if the left side   */
+/* is false. returns 0 if successful or a negative value otherwise.           */
+/* -------------------------------------------------------------------------- */
+
+static long int parseFilterAnd(struct filterParser *parser) {
+    long int rc = 0;
+    long int jump = 0;
+
+    if ((rc = parseFilterUnary(parser)) < 0) return rc;
+
+    while (matchFilterToken(parser, "&&")) {
+        if ((jump = emitFilterOp((*parser).filter, FILTER_OP_JUMP_FALSE, 0, 0,
+                                 NULL)) < 0)
+            return jump;
+
+        if ((rc = parseFilterUnary(parser)) < 0) return rc;
+
+        if ((rc = emitFilterOp((*parser).filter, FILTER_OP_AND, 0, 0, NULL)) <
+            0)
+            return rc;
+
+        (*(*parser).filter).ops[jump].arg = (*(*parser).filter).opCount;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseFilterUnary                                                           */
+/* parses "! unary" or "primary". returns 0 if successful or a negative       */
+/* value otherwise.                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int parseFilterUnary(struct filterParser *parser) {
+    long int rc = 0;
+
+    skipFilterSpace(parser);
+
+    if (*(*parser).pos == '!' && *((*parser).pos + 1) != '=') {
+        (*parser).pos++;
+
+        if ((rc = parseFilterUnary(parser)) < 0) return rc;
+
+        if ((rc = emitFilterOp((*parser).filter, FILTER_OP_NOT, 0, 0, NULL)) <
+            0)
+            return rc;
+
+        return 0;
+    }
+
+    return parseFilterPrimary(parser);
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseFilterPrimary                                                         */
+/* parses "( expr )", a comparison or a tag name. returns 0 if successful or  */
+/* a negative value otherwise.                                                */
+/* -------------------------------------------------------------------------- */
+
+static long int parseFilterPrimary(struct filterParser *parser) {
+    long int rc = 0;
+    long int opNo = 0;
+    int isTag = 0;
+    int op = 0;
+
+    struct exifFilter *filter = (*parser).filter;
+
+    /* parentheses */
+
+    if (matchFilterToken(parser, "(")) {
+        if ((rc = parseFilterOr(parser)) < 0) return rc;
+
+        if (!matchFilterToken(parser, ")")) return FILTER_ERR_SYNTAX;
+
+        return 0;
+    }
+
+    /* left operand */
+
+    if ((opNo = parseFilterOperand(parser, &isTag)) < 0) return opNo;
+
+    /* comparison */
+
+    if (matchFilterToken(parser, "=="))
+        op = FILTER_OP_EQ;
+    else if (matchFilterToken(parser, "!="))
+        op = FILTER_OP_NE;
+    else if (matchFilterToken(parser, "<="))
+        op = FILTER_OP_LE;
+    else if (matchFilterToken(parser, ">="))
+        op = FILTER_OP_GE;
+    else if (matchFilterToken(parser, "<"))
+        op = FILTER_OP_LT;
+    else if (matchFilterToken(parser, ">"))
+        op = FILTER_OP_GT;
+
+    /* a tag on its own tests if the tag exists */
+
+    if (op == 0) {
+        if (!isTag) return FILTER_ERR_SYNTAX;
+
+        (*filter).ops[opNo].op = FILTER_OP_EXISTS;
+
+        return 0;
+    }
+
+    if ((rc = parseFilterOperand(parser, &isTag)) < 0) return rc;
+
+    if ((rc = emitFilterOp(filter, op, 0, 0, NULL)) < 0) return rc;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseFilterOperand                                                         */
+/* parses a tag name, a number or a quoted string. "isTag" is set if the      */
+/* operand is a tag name. returns the number of the operation emitted or a    */
+/* negative value in case of an error.                                        */
+/* -------------------------------------------------------------------------- */
+
+static long int parseFilterOperand(struct filterParser *parser, int *isTag) {
+    long int slot = 0;
+    long int length = 0;
+    double number = 0;
+    char *end = NULL;
+    char *name = NULL;
+    char *string = NULL;
+
+    skipFilterSpace(parser);
+
+    *isTag = 0;
+
+    /* quoted string */
+
+    if (*(*parser).pos == '"') {
+        (*parser).pos++;
+
+        if ((string = (char *)malloc(strlen((*parser).pos) + 1)) == NULL)
+            return FILTER_ERR_MALLOC;
+
+        while (*(*parser).pos != '"') {
+            if (*(*parser).pos == '\\' && *((*parser).pos + 1) != '\0')
+                (*parser).pos++;
+
+            if (*(*parser).pos == '\0') {
+                free(string);
+                return FILTER_ERR_SYNTAX;
+            }
+
+            string[length++] = *(*parser).pos++;
+        }
+
+        string[length] = '\0';
+        (*parser).pos++;
+
+        return emitFilterOp((*parser).filter, FILTER_OP_STRING, 0, 0, string);
+    }
+
+    /* tag name */
+
+    if (isalpha((unsigned char)*(*parser).pos) || *(*parser).pos == '_') {
+        while (isalnum((unsigned char)(*parser).pos[length]) ||
+               (*parser).pos[length] == '_')
+            length++;
+
+        if ((name = (char *)malloc(length + 1)) == NULL)
+            return FILTER_ERR_MALLOC;
+
+        memcpy(name, (*parser).pos, length);
+        name[length] = '\0';
+
+        slot = getFilterSlot((*parser).filter, name);
+
+        free(name);
+
+        if (slot < 0) return slot;
+
+        (*parser).pos = (*parser).pos + length;
+        *isTag = 1;
+
+        return emitFilterOp((*parser).filter, FILTER_OP_TAG, slot, 0, NULL);
+    }
+
+    /* number */
+
+    number = strtod((*parser).pos, &end);
+
+    if (end == (*parser).pos) return FILTER_ERR_SYNTAX;
+
+    (*parser).pos = end;
+
+    return emitFilterOp((*parser).filter, FILTER_OP_NUMBER, 0, number, NULL);
+}
+
+/* -------------------------------------------------------------------------- */
+/* getFilterSlot                                                              */
+/* returns the slot of tag "tagName" in "filter", adding the tag if needed.   */
+/* returns a negative value if the tag is unknown or there are too many tags. */
+/* -------------------------------------------------------------------------- */
+
+static long int getFilterSlot(struct exifFilter *filter, char *tagName) {
+    long int i = 0;
+    long int tagID = 0;
+
+    if ((tagID = findTagIDByName(tagName)) < 0) return FILTER_ERR_TAG;
+
+    for (i = 0; i < (*filter).tagCount; i++)
+        if ((*filter).tagIDs[i] == tagID) return i;
+
+    if ((*filter).tagCount == FILTER_MAX_TAGS) return FILTER_ERR_TOO_COMPLEX;
+
+    (*filter).tagIDs[(*filter).tagCount] = tagID;
+    (*filter).tagCount = (*filter).tagCount + 1;
+
+    return (*filter).tagCount - 1;
+}
+
+/* -------------------------------------------------------------------------- */
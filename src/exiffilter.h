@@ -0,0 +1,170 @@
+#ifndef EXIFFILTER_H_INCLUDED
+#define EXIFFILTER_H_INCLUDED
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exiflib.h"
+#include "exifparser.h"
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    filter expressions:                                                     */
+/*                                                                            */
+/*       expr    := and ( "||" and )*                                         */
+/*       and     := unary ( "&&" unary )*                                     */
+/*       unary   := "!" unary | primary                                       */
+/*       primary := "(" expr ")" | operand [ cmp operand ]                    */
+/*       cmp     := "==" | "!=" | "<" | "<=" | ">" | ">="                     */
+/*       operand := TAGNAME | NUMBER | "STRING"                               */
+/*                                                                            */
+/*    a tag name on its own is true if the tag exists. comparisons with a     */
+/*    number are numeric, all others compare strings. comparisons with a      */
+/*    missing tag are false.                                                  */
+/*                                                                            */
+/*    expressions are compiled to a small stack machine code. while a file    */
+/*    is extracted, tags that have not been seen yet are unknown, and the     */
+/*    code is evaluated with three-valued logic every time a referenced tag   */
+/*    is found. once the result is false, the extraction stops. a visit       */
+/*    keeps views into the source in the slots, so it is evaluated before     */
+/*    the source is closed.                                                   */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define FILTER_MAX_TAGS 32
+#define FILTER_MAX_STACK 64
+
+#define FILTER_OP_TAG 1
+#define FILTER_OP_NUMBER 2
+#define FILTER_OP_STRING 3
+#define FILTER_OP_EXISTS 4
+#define FILTER_OP_EQ 5
+#define FILTER_OP_NE 6
+#define FILTER_OP_LT 7
+#define FILTER_OP_LE 8
+#define FILTER_OP_GT 9
+#define FILTER_OP_GE 10
+#define FILTER_OP_NOT 11
+#define FILTER_OP_AND 12
+#define FILTER_OP_OR 13
+#define FILTER_OP_JUMP_FALSE 14
+#define FILTER_OP_JUMP_TRUE 15
+
+#define FILTER_FALSE 0
+#define FILTER_TRUE 1
+#define FILTER_UNKNOWN 2
+
+#define FILTER_SLOT_UNKNOWN 0
+#define FILTER_SLOT_FOUND 1
+#define FILTER_SLOT_MISSING 2
+
+#define FILTER_VALUE_TRUTH 0
+#define FILTER_VALUE_NUMBER 1
+#define FILTER_VALUE_STRING 2
+#define FILTER_VALUE_TAG 3
+
+#define FILTER_ERR_MALLOC -831
+#define FILTER_ERR_SYNTAX -832
+#define FILTER_ERR_TAG -833
+#define FILTER_ERR_TOO_COMPLEX -834
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct filterOp {
+    int op;
+    long int arg;
+    double number;
+    char *string;
+};
+
+struct exifFilter {
+    struct filterOp *ops;
+    long int opCount;
+
+    long int tagIDs[FILTER_MAX_TAGS];
+    long int tagCount;
+};
+
+struct filterState {
+    struct exifFilter *filter;
+    int slotState[FILTER_MAX_TAGS];
+    struct exifItem slots[FILTER_MAX_TAGS];
+    exifTagHook visitor;
+    void *visitorArg;
+};
+
+struct filterValue {
+    int type;
+    int truth;
+    double number;
+    char *string;
+    struct exifItem *tag;
+};
+
+struct filterParser {
+    char *pos;
+    struct exifFilter *filter;
+};
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int compileFilter(char *expression, struct exifFilter **filter);
+
+void freeFilter(struct exifFilter *filter);
+
+long int extractExifInfoFiltered(char *fileName, struct exifItem **exifTable,
+                                 struct exifFilter *filter);
+
+long int visitExifInfoFiltered(struct exifSource *source,
+                               struct exifFilter *filter, exifTagHook visitor,
+                               void *visitorArg);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int filterTagHook(struct exifItem *item, void *arg);
+
+static int evaluateFilter(struct filterState *state);
+
+static int compareFilterValues(struct filterValue *a, struct filterValue *b,
+                               int op);
+
+static int valueToNumber(struct filterValue *value, double *number);
+
+static char *valueToString(struct filterValue *value, char **buffer);
+
+static long int emitFilterOp(struct exifFilter *filter, int op, long int arg,
+                             double number, char *string);
+
+static void skipFilterSpace(struct filterParser *parser);
+
+static int matchFilterToken(struct filterParser *parser, char *token);
+
+static long int parseFilterOr(struct filterParser *parser);
+
+static long int parseFilterAnd(struct filterParser *parser);
+
+static long int parseFilterUnary(struct filterParser *parser);
+
+static long int parseFilterPrimary(struct filterParser *parser);
+
+static long int parseFilterOperand(struct filterParser *parser, int *isTag);
+
+static long int getFilterSlot(struct exifFilter *filter, char *tagName);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
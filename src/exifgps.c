@@ -0,0 +1,1177 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifgps.h"
+
+/* -------------------------------------------------------------------------- */
+/* addGpsIndexPoint                                                           */
+/* adds a point at "latitude" and "longitude" belonging to "fileName" to the  */
+/* in-memory "index". the index must be zero-initialized before the first     */
+/* call. returns 0 if successful or a negative value otherwise.               */
+/* -------------------------------------------------------------------------- */
+
+long int addGpsIndexPoint(struct gpsIndex *index, double latitude,
+                          double longitude, char *fileName) {
+    uint64_t nameLength = strlen(fileName) + 1;
+    struct gpsIndexPoint *point = NULL;
+
+    /* grow tables */
+
+    if ((*index).pointCount == (*index).pointCapacity) {
+        (*index).pointCapacity =
+            (*index).pointCapacity == 0 ? 1024 : (*index).pointCapacity * 2;
+
+        if (((*index).points = (struct gpsIndexPoint *)realloc(
+                 (*index).points, sizeof(struct gpsIndexPoint) *
+                                      (*index).pointCapacity)) == NULL)
+            return GPS_ERR_MALLOC;
+    }
+
+    while ((*index).namesLength + nameLength > (*index).namesCapacity) {
+        (*index).namesCapacity =
+            (*index).namesCapacity == 0 ? 65536 : (*index).namesCapacity * 2;
+
+        if (((*index).names = (char *)realloc((*index).names,
+                                              (*index).namesCapacity)) == NULL)
+            return GPS_ERR_MALLOC;
+    }
+
+    /* write point and name */
+
+    point = &(*index).points[(*index).pointCount];
+
+    (*point).key = interleaveBits(quantizeLongitude(longitude),
+                                  quantizeLatitude(latitude));
+    (*point).latitude = (float)latitude;
+    (*point).longitude = (float)longitude;
+    (*point).reserved = 0;
+    (*point).nameOffset = (*index).namesLength;
+
+    memcpy((*index).names + (*index).namesLength, fileName, nameLength);
+
+    (*index).namesLength = (*index).namesLength + nameLength;
+    (*index).pointCount = (*index).pointCount + 1;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeGpsIndex                                                              */
+/* sorts the points of the in-memory "index" and writes the index to          */
+/* "indexFileName". the file is written under a temporary name and renamed,   */
+/* so readers never see a partial index. returns 0 if successful or a         */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+long int writeGpsIndex(char *indexFileName, struct gpsIndex *index) {
+    FILE *fp = NULL;
+    char *tmpFileName = NULL;
+    struct gpsIndexHeader header;
+
+    qsort((*index).points, (*index).pointCount, sizeof(struct gpsIndexPoint),
+          compareGpsIndexPoints);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GPS_INDEX_MAGIC, GPS_INDEX_MAGIC_LENGTH);
+    header.pointCount = (*index).pointCount;
+    header.namesLength = (*index).namesLength;
+
+    if ((tmpFileName = (char *)malloc(strlen(indexFileName) + 5)) == NULL)
+        return GPS_ERR_MALLOC;
+
+    sprintf(tmpFileName, "%s.tmp", indexFileName);
+
+    if ((fp = fopen(tmpFileName, "w")) == NULL) {
+        free(tmpFileName);
+        return GPS_ERR_FILE_OPEN;
+    }
+
+    if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+        fwrite((*index).points, sizeof(struct gpsIndexPoint),
+               (*index).pointCount, fp) != (*index).pointCount ||
+        fwrite((*index).names, 1, (*index).namesLength, fp) !=
+            (*index).namesLength ||
+        fclose(fp) != 0 || rename(tmpFileName, indexFileName) != 0) {
+        unlink(tmpFileName);
+        free(tmpFileName);
+        return GPS_ERR_FILE_WRITE;
+    }
+
+    free(tmpFileName);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* openGpsIndex                                                               */
+/* maps the index file "indexFileName" into memory and sets up "index".       */
+/* returns 0 if successful or a negative value otherwise.                     */
+/* -------------------------------------------------------------------------- */
+
+long int openGpsIndex(char *indexFileName, struct gpsIndex *index) {
+    int fd = 0;
+    struct stat fileStat;
+    struct gpsIndexHeader *header = NULL;
+
+    memset(index, 0, sizeof(struct gpsIndex));
+
+    if ((fd = open(indexFileName, O_RDONLY)) < 0) return GPS_ERR_FILE_OPEN;
+
+    if (fstat(fd, &fileStat) < 0 ||
+        fileStat.st_size < (off_t)sizeof(struct gpsIndexHeader)) {
+        close(fd);
+        return GPS_ERR_INDEX_FORMAT;
+    }
+
+    (*index).mapLength = fileStat.st_size;
+
+    (*index).map =
+        mmap(NULL, (*index).mapLength, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if ((*index).map == MAP_FAILED) {
+        (*index).map = NULL;
+        return GPS_ERR_FILE_READ;
+    }
+
+    /* check header */
+
+    header = (struct gpsIndexHeader *)(*index).map;
+
+    if (memcmp((*header).magic, GPS_INDEX_MAGIC, GPS_INDEX_MAGIC_LENGTH) != 0 ||
+        sizeof(struct gpsIndexHeader) +
+                (*header).pointCount * sizeof(struct gpsIndexPoint) +
+                (*header).namesLength !=
+            (*index).mapLength) {
+        closeGpsIndex(index);
+        return GPS_ERR_INDEX_FORMAT;
+    }
+
+    (*index).pointCount = (*header).pointCount;
+    (*index).points =
+        (struct gpsIndexPoint *)((char *)(*index).map +
+                                 sizeof(struct gpsIndexHeader));
+    (*index).namesLength = (*header).namesLength;
+    (*index).names = (char *)((*index).points + (*index).pointCount);
+
+    madvise((*index).map, (*index).mapLength, MADV_RANDOM);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* closeGpsIndex                                                              */
+/* releases a mapped or in-memory "index".                                    */
+/* -------------------------------------------------------------------------- */
+
+void closeGpsIndex(struct gpsIndex *index) {
+    if ((*index).map != NULL) {
+        munmap((*index).map, (*index).mapLength);
+    } else {
+        free((*index).points);
+        free((*index).names);
+    }
+
+    memset(index, 0, sizeof(struct gpsIndex));
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseGpsQuery                                                              */
+/* parses a query argument "arg" to "query". four comma separated values      */
+/* "lat1,lon1,lat2,lon2" specify a box by two corners, three values           */
+/* "lat,lon,km" specify a circle. the box reaches east from lon1 to lon2, so  */
+/* a minimum longitude above the maximum one crosses the antimeridian.        */
+/* returns 0 if successful or a negative value otherwise.                     */
+/* -------------------------------------------------------------------------- */
+
+long int parseGpsQuery(char *arg, struct gpsQuery *query) {
+    int n = 0;
+    double v[4] = {0, 0, 0, 0};
+    double latitudeDelta = 0;
+    double longitudeDelta = 0;
+
+    memset(query, 0, sizeof(struct gpsQuery));
+
+    n = sscanf(arg, "%lf,%lf,%lf,%lf", &v[0], &v[1], &v[2], &v[3]);
+
+    if (n == 4) {
+        (*query).minLatitude = fmin(v[0], v[2]);
+        (*query).maxLatitude = fmax(v[0], v[2]);
+        (*query).minLongitude = wrapLongitude(v[1]);
+        (*query).maxLongitude = wrapLongitude(v[3]);
+    } else if (n == 3 && v[2] >= 0) {
+        (*query).radius = 1;
+        (*query).latitude = v[0];
+        (*query).longitude = wrapLongitude(v[1]);
+        (*query).distance = v[2];
+
+        /* bounding box of the circle, which may cross the antimeridian */
+
+        latitudeDelta = v[2] / GPS_KM_PER_DEGREE;
+        longitudeDelta = fabs(v[0]) + latitudeDelta >= 90
+                             ? 180
+                             : latitudeDelta /
+                                   cos((fabs(v[0]) + latitudeDelta) * M_PI /
+                                       180);
+
+        (*query).minLatitude = v[0] - latitudeDelta;
+        (*query).maxLatitude = v[0] + latitudeDelta;
+
+        if (longitudeDelta >= 180) {
+            (*query).minLongitude = -180;
+            (*query).maxLongitude = 180;
+        } else {
+            (*query).minLongitude =
+                wrapLongitude((*query).longitude - longitudeDelta);
+            (*query).maxLongitude =
+                wrapLongitude((*query).longitude + longitudeDelta);
+        }
+    } else
+        return GPS_ERR_QUERY;
+
+    if ((*query).minLatitude < -90) (*query).minLatitude = -90;
+    if ((*query).maxLatitude > 90) (*query).maxLatitude = 90;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* queryGpsIndex                                                              */
+/* calls "callback" for every point of "index" within "query". the box is     */
+/* covered by at most GPS_INDEX_MAX_CELLS grid cells, each of which is one    */
+/* binary search and one sequential scan. a negative value returned by        */
+/* "callback" stops the query. returns the number of points found or a        */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+long int queryGpsIndex(struct gpsIndex *index, struct gpsQuery *query,
+                       gpsQueryCallback callback, void *arg) {
+    long int count = 0;
+    long int rc = 0;
+
+    if ((*query).minLongitude <= (*query).maxLongitude)
+        return queryGpsBox(index, query, (*query).minLongitude,
+                           (*query).maxLongitude, callback, arg);
+
+    /* a box across the antimeridian is split in two */
+
+    if ((count = queryGpsBox(index, query, (*query).minLongitude, 180,
+                             callback, arg)) < 0)
+        return count;
+
+    if ((rc = queryGpsBox(index, query, -180, (*query).maxLongitude,
+                          callback, arg)) < 0)
+        return rc;
+
+    return count + rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* queryGpsBox                                                                */
+/* calls "callback" for every point of "index" within "query" and between     */
+/* "minLongitude" and "maxLongitude". returns the number of points found or a */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int queryGpsBox(struct gpsIndex *index, struct gpsQuery *query,
+                            double minLongitude, double maxLongitude,
+                            gpsQueryCallback callback, void *arg) {
+    long int rc = 0;
+    long int count = 0;
+
+    int shift = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t x0 = quantizeLongitude(minLongitude);
+    uint32_t x1 = quantizeLongitude(maxLongitude);
+    uint32_t y0 = quantizeLatitude((*query).minLatitude);
+    uint32_t y1 = quantizeLatitude((*query).maxLatitude);
+
+    uint64_t i = 0;
+    uint64_t keyFrom = 0;
+    uint64_t keyTo = 0;
+
+    struct gpsIndexPoint *point = NULL;
+
+    /* find the finest grid that covers the box with few cells */
+
+    while (((uint64_t)((x1 >> shift) - (x0 >> shift) + 1)) *
+               ((y1 >> shift) - (y0 >> shift) + 1) >
+           GPS_INDEX_MAX_CELLS)
+        shift++;
+
+    /* scan cells */
+
+    for (y = y0 >> shift; y <= y1 >> shift; y++) {
+        for (x = x0 >> shift; x <= x1 >> shift; x++) {
+            keyFrom = interleaveBits(x << shift, y << shift);
+            keyTo = keyFrom + ((uint64_t)1 << (2 * shift));
+
+            for (i = searchGpsIndex(index, keyFrom);
+                 i < (*index).pointCount && (*index).points[i].key < keyTo;
+                 i++) {
+                point = &(*index).points[i];
+
+                if ((*point).latitude < (*query).minLatitude ||
+                    (*point).latitude > (*query).maxLatitude ||
+                    (*point).longitude < minLongitude ||
+                    (*point).longitude > maxLongitude)
+                    continue;
+
+                if ((*query).radius &&
+                    haversineDistance((*query).latitude, (*query).longitude,
+                                      (*point).latitude, (*point).longitude) >
+                        (*query).distance)
+                    continue;
+
+                if ((*point).nameOffset >= (*index).namesLength)
+                    return GPS_ERR_INDEX_FORMAT;
+
+                if ((rc = callback(point, (*index).names + (*point).nameOffset,
+                                   arg)) < 0)
+                    return rc;
+
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+/* -------------------------------------------------------------------------- */
+/* haversineDistance                                                          */
+/* returns the great-circle distance in km between two points given in        */
+/* decimal degrees.                                                           */
+/* -------------------------------------------------------------------------- */
+
+double haversineDistance(double latitude1, double longitude1,
+                         double latitude2, double longitude2) {
+    double dLatitude = (latitude2 - latitude1) * M_PI / 180;
+    double dLongitude = (longitude2 - longitude1) * M_PI / 180;
+    double a = 0;
+
+    a = sin(dLatitude / 2) * sin(dLatitude / 2) +
+        cos(latitude1 * M_PI / 180) * cos(latitude2 * M_PI / 180) *
+            sin(dLongitude / 2) * sin(dLongitude / 2);
+
+    return 2 * GPS_EARTH_RADIUS * asin(sqrt(fmin(1, a)));
+}
+
+/* -------------------------------------------------------------------------- */
+/* quantizeLatitude                                                           */
+/* maps a latitude to an integer of GPS_INDEX_BITS bits.                      */
+/* -------------------------------------------------------------------------- */
+
+static uint32_t quantizeLatitude(double latitude) {
+    double q = (latitude + 90) / 180 * (1 << GPS_INDEX_BITS);
+
+    if (q < 0) return 0;
+    if (q >= (1 << GPS_INDEX_BITS)) return (1 << GPS_INDEX_BITS) - 1;
+
+    return (uint32_t)q;
+}
+
+/* -------------------------------------------------------------------------- */
+/* quantizeLongitude                                                          */
+/* maps a longitude to an integer of GPS_INDEX_BITS bits.                     */
+/* -------------------------------------------------------------------------- */
+
+static uint32_t quantizeLongitude(double longitude) {
+    double q = (longitude + 180) / 360 * (1 << GPS_INDEX_BITS);
+
+    if (q < 0) return 0;
+    if (q >= (1 << GPS_INDEX_BITS)) return (1 << GPS_INDEX_BITS) - 1;
+
+    return (uint32_t)q;
+}
+
+/* -------------------------------------------------------------------------- */
+/* wrapLongitude                                                              */
+/* maps a longitude outside of -180 to 180 back into that range.              */
+/* -------------------------------------------------------------------------- */
+
+static double wrapLongitude(double longitude) {
+    if (longitude >= -180 && longitude <= 180) return longitude;
+
+    longitude = fmod(longitude + 180, 360);
+    if (longitude < 0) longitude = longitude + 360;
+
+    return longitude - 180;
+}
+
+/* -------------------------------------------------------------------------- */
+/* interleaveBits                                                             */
+/* returns the z-order key of "x" and "y". the bits of "x" are placed at the  */
+/* even and the bits of "y" at the odd positions.                             */
+/* -------------------------------------------------------------------------- */
+
+static uint32_t interleaveBits(uint32_t x, uint32_t y) {
+    uint32_t key = 0;
+    int i = 0;
+
+    for (i = 0; i < GPS_INDEX_BITS; i++) {
+        key |= ((x >> i) & 1) << (2 * i);
+        key |= ((y >> i) & 1) << (2 * i + 1);
+    }
+
+    return key;
+}
+
+/* -------------------------------------------------------------------------- */
+/* compareGpsIndexPoints                                                      */
+/* qsort compare function for index points.                                   */
+/* -------------------------------------------------------------------------- */
+
+static int compareGpsIndexPoints(const void *a, const void *b) {
+    uint32_t keyA = ((struct gpsIndexPoint *)a)->key;
+    uint32_t keyB = ((struct gpsIndexPoint *)b)->key;
+
+    return keyA < keyB ? -1 : keyA > keyB;
+}
+
+/* -------------------------------------------------------------------------- */
+/* searchGpsIndex                                                             */
+/* returns the number of the first point in "index" with a key not smaller    */
+/* than "key".                                                                */
+/* -------------------------------------------------------------------------- */
+
+static uint64_t searchGpsIndex(struct gpsIndex *index, uint64_t key) {
+    uint64_t low = 0;
+    uint64_t high = (*index).pointCount;
+    uint64_t middle = 0;
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+
+        if ((*index).points[middle].key < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/* -------------------------------------------------------------------------- */
+/* loadGpsGazetteer                                                           */
+/* loads the places of a tab separated gazetteer "fileName" into              */
+/* "gazetteer" and arranges them as a k-d tree. lines are read in the         */
+/* geonames format (name in column 2, latitude and longitude in columns 5     */
+/* and 6, country code in column 9) or as "name, latitude, longitude".        */
+/* returns the number of places if successful or a negative value otherwise.  */
+/* -------------------------------------------------------------------------- */
+
+long int loadGpsGazetteer(char *fileName, struct gpsGazetteer *gazetteer) {
+    long int rc = 0;
+    long int fieldCount = 0;
+    char *line = NULL;
+    size_t lineLength = 0;
+    char *fields[GPS_GEONAMES_FIELDS];
+    char *tabPos = NULL;
+
+    FILE *fp = NULL;
+
+    memset(gazetteer, 0, sizeof(struct gpsGazetteer));
+
+    if ((fp = fopen(fileName, "r")) == NULL) return GPS_ERR_FILE_OPEN;
+
+    while (getline(&line, &lineLength, fp) > 0) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        /* split line */
+
+        fields[0] = line;
+        fieldCount = 1;
+
+        while (fieldCount < GPS_GEONAMES_FIELDS &&
+               (tabPos = strchr(fields[fieldCount - 1], '\t')) != NULL) {
+            *tabPos = '\0';
+            fields[fieldCount++] = tabPos + 1;
+        }
+
+        /* the rest of a geonames line follows the country code */
+
+        if (fieldCount == GPS_GEONAMES_FIELDS &&
+            (tabPos = strchr(fields[GPS_GEONAMES_FIELDS - 1], '\t')) != NULL)
+            *tabPos = '\0';
+
+        if (fieldCount == GPS_GEONAMES_FIELDS)
+            rc = addGpsPlace(gazetteer, fields[1], atof(fields[4]),
+                             atof(fields[5]), fields[8]);
+        else if (fieldCount == 3)
+            rc = addGpsPlace(gazetteer, fields[0], atof(fields[1]),
+                             atof(fields[2]), "");
+        else
+            continue;
+
+        if (rc < 0) break;
+    }
+
+    free(line);
+    fclose(fp);
+
+    if (rc < 0) {
+        freeGpsGazetteer(gazetteer);
+        return rc;
+    }
+
+    if ((*gazetteer).placeCount == 0) return GPS_ERR_GAZETTEER;
+
+    buildGpsTree((*gazetteer).places, (*gazetteer).placeCount, 0);
+
+    return (*gazetteer).placeCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* freeGpsGazetteer                                                           */
+/* releases the memory of "gazetteer".                                        */
+/* -------------------------------------------------------------------------- */
+
+void freeGpsGazetteer(struct gpsGazetteer *gazetteer) {
+    free((*gazetteer).places);
+    free((*gazetteer).names);
+
+    memset(gazetteer, 0, sizeof(struct gpsGazetteer));
+}
+
+/* -------------------------------------------------------------------------- */
+/* findNearestGpsPlace                                                        */
+/* returns the place of "gazetteer" nearest to "latitude" and "longitude"     */
+/* and writes its great-circle distance in km to "distance". the tree is      */
+/* searched by the straight-line distance of points on the unit sphere,       */
+/* which orders places the same way as the haversine distance. the function   */
+/* only reads the gazetteer and may be called from several threads.           */
+/* -------------------------------------------------------------------------- */
+
+struct gpsPlace *findNearestGpsPlace(struct gpsGazetteer *gazetteer,
+                                     double latitude, double longitude,
+                                     double *distance) {
+    float position[3];
+    float bestDistance = INFINITY;
+    struct gpsPlace *best = NULL;
+
+    toUnitVector(latitude, longitude, position);
+
+    searchGpsTree((*gazetteer).places, (*gazetteer).placeCount, 0, position,
+                  &best, &bestDistance);
+
+    if (best != NULL && distance != NULL)
+        *distance = haversineDistance(latitude, longitude, (*best).latitude,
+                                      (*best).longitude);
+
+    return best;
+}
+
+/* -------------------------------------------------------------------------- */
+/* toUnitVector                                                               */
+/* writes the position of "latitude" and "longitude" on the unit sphere to    */
+/* "position".                                                                */
+/* -------------------------------------------------------------------------- */
+
+static void toUnitVector(double latitude, double longitude, float *position) {
+    double phi = latitude * M_PI / 180;
+    double lambda = longitude * M_PI / 180;
+
+    position[0] = (float)(cos(phi) * cos(lambda));
+    position[1] = (float)(cos(phi) * sin(lambda));
+    position[2] = (float)sin(phi);
+}
+
+/* -------------------------------------------------------------------------- */
+/* addGpsPlace                                                                */
+/* appends a place to "gazetteer". returns 0 if successful or a negative      */
+/* value otherwise.                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int addGpsPlace(struct gpsGazetteer *gazetteer, char *name,
+                            double latitude, double longitude,
+                            char *countryCode) {
+    uint64_t nameLength = strlen(name) + 1;
+    struct gpsPlace *place = NULL;
+
+    if (latitude < -90 || latitude > 90 || longitude < -180 || longitude > 180)
+        return 0;
+
+    /* grow tables */
+
+    if ((*gazetteer).placeCount == (*gazetteer).placeCapacity) {
+        (*gazetteer).placeCapacity = (*gazetteer).placeCapacity == 0
+                                         ? 65536
+                                         : (*gazetteer).placeCapacity * 2;
+
+        if (((*gazetteer).places = (struct gpsPlace *)realloc(
+                 (*gazetteer).places,
+                 sizeof(struct gpsPlace) * (*gazetteer).placeCapacity)) ==
+            NULL)
+            return GPS_ERR_MALLOC;
+    }
+
+    while ((*gazetteer).namesLength + nameLength >
+           (*gazetteer).namesCapacity) {
+        (*gazetteer).namesCapacity = (*gazetteer).namesCapacity == 0
+                                         ? 1048576
+                                         : (*gazetteer).namesCapacity * 2;
+
+        if (((*gazetteer).names = (char *)realloc(
+                 (*gazetteer).names, (*gazetteer).namesCapacity)) == NULL)
+            return GPS_ERR_MALLOC;
+    }
+
+    if ((*gazetteer).namesLength + nameLength > UINT32_MAX)
+        return GPS_ERR_GAZETTEER;
+
+    /* write place and name */
+
+    place = &(*gazetteer).places[(*gazetteer).placeCount];
+
+    toUnitVector(latitude, longitude, (*place).position);
+    (*place).latitude = (float)latitude;
+    (*place).longitude = (float)longitude;
+    (*place).nameOffset = (uint32_t)(*gazetteer).namesLength;
+    snprintf((*place).countryCode, sizeof((*place).countryCode), "%s",
+             countryCode);
+
+    memcpy((*gazetteer).names + (*gazetteer).namesLength, name, nameLength);
+
+    (*gazetteer).namesLength = (*gazetteer).namesLength + nameLength;
+    (*gazetteer).placeCount = (*gazetteer).placeCount + 1;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* selectGpsPlace                                                             */
+/* reorders "places" so that place "k" is the one that would be there if the  */
+/* places were sorted by coordinate "axis", with no smaller one after it and  */
+/* no larger one before it (quickselect).                                     */
+/* -------------------------------------------------------------------------- */
+
+static void selectGpsPlace(struct gpsPlace *places, long int count,
+                           long int k, int axis) {
+    long int low = 0;
+    long int high = count - 1;
+    long int i = 0;
+    long int j = 0;
+    float pivot = 0;
+    struct gpsPlace swap;
+
+    while (low < high) {
+        pivot = places[low + (high - low) / 2].position[axis];
+        i = low;
+        j = high;
+
+        while (i <= j) {
+            while (places[i].position[axis] < pivot) i++;
+            while (places[j].position[axis] > pivot) j--;
+
+            if (i <= j) {
+                swap = places[i];
+                places[i] = places[j];
+                places[j] = swap;
+                i++;
+                j--;
+            }
+        }
+
+        if (k <= j)
+            high = j;
+        else if (k >= i)
+            low = i;
+        else
+            break;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* buildGpsTree                                                               */
+/* arranges "places" as an implicit k-d tree. the median by coordinate        */
+/* "depth" % 3 is the root, the places before and after it are the subtrees.  */
+/* -------------------------------------------------------------------------- */
+
+static void buildGpsTree(struct gpsPlace *places, long int count, int depth) {
+    long int middle = count / 2;
+
+    while (count > 1) {
+        selectGpsPlace(places, count, middle, depth % 3);
+
+        buildGpsTree(places, middle, depth + 1);
+
+        /* continue with the right subtree */
+
+        places = places + middle + 1;
+        count = count - middle - 1;
+        middle = count / 2;
+        depth++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* searchGpsTree                                                              */
+/* nearest neighbour search in the k-d tree "places" for "position". the      */
+/* nearest place so far and its squared distance are kept in "best" and       */
+/* "bestDistance".                                                            */
+/* -------------------------------------------------------------------------- */
+
+static void searchGpsTree(struct gpsPlace *places, long int count, int depth,
+                          float *position, struct gpsPlace **best,
+                          float *bestDistance) {
+    long int middle = 0;
+    int axis = 0;
+    float delta = 0;
+    float distance = 0;
+    struct gpsPlace *node = NULL;
+
+    while (count > 0) {
+        middle = count / 2;
+        axis = depth % 3;
+        node = &places[middle];
+
+        distance = ((*node).position[0] - position[0]) *
+                       ((*node).position[0] - position[0]) +
+                   ((*node).position[1] - position[1]) *
+                       ((*node).position[1] - position[1]) +
+                   ((*node).position[2] - position[2]) *
+                       ((*node).position[2] - position[2]);
+
+        if (distance < *bestDistance) {
+            *bestDistance = distance;
+            *best = node;
+        }
+
+        delta = position[axis] - (*node).position[axis];
+
+        /* search the near side first, the far side only if it can be closer */
+
+        if (delta < 0) {
+            searchGpsTree(places, middle, depth + 1, position, best,
+                          bestDistance);
+            places = places + middle + 1;
+            count = count - middle - 1;
+        } else {
+            searchGpsTree(places + middle + 1, count - middle - 1, depth + 1,
+                          position, best, bestDistance);
+            count = middle;
+        }
+
+        if (delta * delta >= *bestDistance) break;
+
+        depth++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* addGpsTrackPoint                                                           */
+/* adds a point to "track". the points are kept in memory in runs of at most  */
+/* GPS_TRACK_RUN_LENGTH points. a full run is sorted by time and written to   */
+/* a temporary file, so the memory used does not grow with the number of      */
+/* points. "track" must be zero-initialized before the first call. returns 0  */
+/* if successful or a negative value otherwise.                               */
+/* -------------------------------------------------------------------------- */
+
+long int addGpsTrackPoint(struct gpsTrack *track, char *time,
+                          double latitude, double longitude, char *name) {
+    long int rc = 0;
+    struct gpsTrackPoint *point = NULL;
+
+    if ((*track).points == NULL &&
+        ((*track).points = (struct gpsTrackPoint *)malloc(
+             sizeof(struct gpsTrackPoint) * GPS_TRACK_RUN_LENGTH)) == NULL)
+        return GPS_ERR_MALLOC;
+
+    if ((*track).pointCount == GPS_TRACK_RUN_LENGTH &&
+        (rc = writeGpsTrackRun(track)) < 0)
+        return rc;
+
+    point = &(*track).points[(*track).pointCount];
+
+    snprintf((*point).time, GPS_TIME_LENGTH, "%s", time);
+    (*point).latitude = latitude;
+    (*point).longitude = longitude;
+
+    if (((*point).name = strdup(name)) == NULL) return GPS_ERR_MALLOC;
+
+    (*track).pointCount = (*track).pointCount + 1;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeGpsTrack                                                              */
+/* prints all points of "track" ordered by time using "writer". if runs have  */
+/* been written to temporary files, the runs are merged, keeping only one     */
+/* point per run in memory. returns 0 if successful or a negative value       */
+/* otherwise.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+long int writeGpsTrack(struct gpsTrack *track, struct gpsWriter *writer) {
+    long int rc = 0;
+    long int i = 0;
+
+    long int *heap = NULL;
+    struct gpsTrackPoint *heads = NULL;
+    char **nameBuffers = NULL;
+    size_t *nameBufferLengths = NULL;
+
+    /* everything fits in memory */
+
+    if ((*track).runCount == 0) {
+        qsort((*track).points, (*track).pointCount,
+              sizeof(struct gpsTrackPoint), compareGpsTrackPoints);
+
+        for (i = 0; i < (*track).pointCount; i++)
+            printGpsPoint(writer, (*track).points[i].latitude,
+                          (*track).points[i].longitude,
+                          (*track).points[i].time, (*track).points[i].name);
+
+        return 0;
+    }
+
+    /* spill the last run and merge all runs */
+
+    if ((*track).pointCount > 0 && (rc = writeGpsTrackRun(track)) < 0)
+        return rc;
+
+    if ((heap = (long int *)malloc(sizeof(long int) * (*track).runCount)) !=
+            NULL &&
+        (heads = (struct gpsTrackPoint *)calloc(
+             (*track).runCount, sizeof(struct gpsTrackPoint))) != NULL &&
+        (nameBuffers = (char **)calloc((*track).runCount, sizeof(char *))) !=
+            NULL &&
+        (nameBufferLengths =
+             (size_t *)calloc((*track).runCount, sizeof(size_t))) != NULL)
+        rc = mergeGpsTrackRuns(track, writer, heap, heads, nameBuffers,
+                               nameBufferLengths);
+    else
+        rc = GPS_ERR_MALLOC;
+
+    if (nameBuffers != NULL)
+        for (i = 0; i < (*track).runCount; i++) free(nameBuffers[i]);
+
+    free(nameBufferLengths);
+    free(nameBuffers);
+    free(heads);
+    free(heap);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* freeGpsTrack                                                               */
+/* releases the memory and the temporary files of "track".                    */
+/* -------------------------------------------------------------------------- */
+
+void freeGpsTrack(struct gpsTrack *track) {
+    long int i = 0;
+
+    for (i = 0; i < (*track).pointCount; i++) free((*track).points[i].name);
+
+    for (i = 0; i < (*track).runCount; i++) fclose((*track).runs[i]);
+
+    free((*track).points);
+    free((*track).runs);
+
+    memset(track, 0, sizeof(struct gpsTrack));
+}
+
+/* -------------------------------------------------------------------------- */
+/* printGpsHeader                                                             */
+/* prints the start of a geojson or gpx document.                             */
+/* -------------------------------------------------------------------------- */
+
+void printGpsHeader(struct gpsWriter *writer) {
+    FILE *stream = (*writer).stream;
+
+    (*writer).pointCount = 0;
+
+    if ((*writer).format == GPS_FORMAT_GEOJSON) {
+        fprintf(stream, "{\"type\":\"FeatureCollection\",\"features\":[\n");
+    } else if ((*writer).format == GPS_FORMAT_GPX) {
+        fprintf(stream, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+        fprintf(stream, "<gpx version=\"1.1\" creator=\"exiftool\" ");
+        fprintf(stream, "xmlns=\"http://www.topografix.com/GPX/1/1\">\n");
+        if ((*writer).track) fprintf(stream, "<trk><trkseg>\n");
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* printGpsPoint                                                              */
+/* prints one point as a geojson feature, a gpx waypoint or a gpx track       */
+/* point. "time" may be null.                                                 */
+/* -------------------------------------------------------------------------- */
+
+void printGpsPoint(struct gpsWriter *writer, double latitude,
+                   double longitude, char *time, char *name) {
+    FILE *stream = (*writer).stream;
+
+    if ((*writer).format == GPS_FORMAT_GEOJSON) {
+        fprintf(stream,
+                "%s{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\","
+                "\"coordinates\":[%.6f,%.6f]},\"properties\":{\"file\":",
+                (*writer).pointCount == 0 ? "" : ",\n", longitude, latitude);
+        printJsonString(stream, name);
+        if (time != NULL) {
+            fprintf(stream, ",\"time\":");
+            printJsonString(stream, time);
+        }
+        fprintf(stream, "}}");
+    } else if ((*writer).format == GPS_FORMAT_GPX) {
+        fprintf(stream, "<%s lat=\"%.6f\" lon=\"%.6f\">",
+                (*writer).track ? "trkpt" : "wpt", latitude, longitude);
+        if (time != NULL) {
+            fprintf(stream, "<time>");
+            printXmlString(stream, time);
+            fprintf(stream, "</time>");
+        }
+        fprintf(stream, "<name>");
+        printXmlString(stream, name);
+        fprintf(stream, "</name></%s>\n", (*writer).track ? "trkpt" : "wpt");
+    } else {
+        fprintf(stream, "%.4f,%.4f\n", latitude, longitude);
+    }
+
+    (*writer).pointCount = (*writer).pointCount + 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* printGpsFooter                                                             */
+/* prints the end of a geojson or gpx document.                               */
+/* -------------------------------------------------------------------------- */
+
+void printGpsFooter(struct gpsWriter *writer) {
+    FILE *stream = (*writer).stream;
+
+    if ((*writer).format == GPS_FORMAT_GEOJSON) {
+        fprintf(stream, "\n]}\n");
+    } else if ((*writer).format == GPS_FORMAT_GPX) {
+        if ((*writer).track) fprintf(stream, "</trkseg></trk>\n");
+        fprintf(stream, "</gpx>\n");
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* compareGpsTrackPoints                                                      */
+/* qsort compare function for track points.                                   */
+/* -------------------------------------------------------------------------- */
+
+static int compareGpsTrackPoints(const void *a, const void *b) {
+    return strcmp(((struct gpsTrackPoint *)a)->time,
+                  ((struct gpsTrackPoint *)b)->time);
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeGpsTrackRun                                                           */
+/* sorts the points in memory and writes them to a new temporary file. each   */
+/* point is stored as time, latitude, longitude, name length and name, and    */
+/* its name is freed once written. returns 0 if successful or a negative      */
+/* value otherwise.                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int writeGpsTrackRun(struct gpsTrack *track) {
+    long int i = 0;
+    uint32_t nameLength = 0;
+    FILE *fp = NULL;
+    FILE **runs = NULL;
+    struct gpsTrackPoint *point = NULL;
+
+    qsort((*track).points, (*track).pointCount, sizeof(struct gpsTrackPoint),
+          compareGpsTrackPoints);
+
+    if ((runs = (FILE **)realloc((*track).runs, sizeof(FILE *) *
+                                                    ((*track).runCount + 1))) ==
+        NULL)
+        return GPS_ERR_MALLOC;
+
+    (*track).runs = runs;
+
+    if ((fp = tmpfile()) == NULL) return GPS_ERR_FILE_OPEN;
+
+    (*track).runs[(*track).runCount] = fp;
+    (*track).runCount = (*track).runCount + 1;
+
+    for (i = 0; i < (*track).pointCount; i++) {
+        point = &(*track).points[i];
+        nameLength = strlen((*point).name);
+
+        if (fwrite((*point).time, GPS_TIME_LENGTH, 1, fp) != 1 ||
+            fwrite(&(*point).latitude, sizeof(double), 1, fp) != 1 ||
+            fwrite(&(*point).longitude, sizeof(double), 1, fp) != 1 ||
+            fwrite(&nameLength, sizeof(nameLength), 1, fp) != 1 ||
+            fwrite((*point).name, 1, nameLength, fp) != nameLength)
+            return GPS_ERR_FILE_WRITE;
+
+        free((*point).name);
+        (*point).name = NULL;
+    }
+
+    (*track).pointCount = 0;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* readGpsTrackPoint                                                          */
+/* reads the next point of a run "fp" to "point". the name is kept in         */
+/* "nameBuffer" of size "nameBufferLength", which grows if needed. returns 1  */
+/* if a point was read, 0 at the end of the run or a negative value in case   */
+/* of an error.                                                               */
+/* -------------------------------------------------------------------------- */
+
+static long int readGpsTrackPoint(FILE *fp, struct gpsTrackPoint *point,
+                                  char **nameBuffer, size_t *nameBufferLength) {
+    uint32_t nameLength = 0;
+    char *name = NULL;
+
+    if (fread((*point).time, GPS_TIME_LENGTH, 1, fp) != 1) return 0;
+
+    if (fread(&(*point).latitude, sizeof(double), 1, fp) != 1 ||
+        fread(&(*point).longitude, sizeof(double), 1, fp) != 1 ||
+        fread(&nameLength, sizeof(nameLength), 1, fp) != 1)
+        return GPS_ERR_FILE_READ;
+
+    if (nameLength + 1 > *nameBufferLength) {
+        if ((name = (char *)realloc(*nameBuffer, nameLength + 1)) == NULL)
+            return GPS_ERR_MALLOC;
+        *nameBuffer = name;
+        *nameBufferLength = nameLength + 1;
+    }
+
+    if (fread(*nameBuffer, 1, nameLength, fp) != nameLength)
+        return GPS_ERR_FILE_READ;
+
+    (*nameBuffer)[nameLength] = '\0';
+    (*point).name = *nameBuffer;
+
+    return 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* mergeGpsTrackRuns                                                          */
+/* k-way merge of the runs of "track" using a min-heap "heap" of run          */
+/* numbers. "heads" holds the current point of each run, its name is kept in  */
+/* "nameBuffers". all arrays have one item per run. returns 0 if successful   */
+/* or a negative value otherwise.                                             */
+/* -------------------------------------------------------------------------- */
+
+static long int mergeGpsTrackRuns(struct gpsTrack *track,
+                                  struct gpsWriter *writer, long int *heap,
+                                  struct gpsTrackPoint *heads,
+                                  char **nameBuffers,
+                                  size_t *nameBufferLengths) {
+    long int rc = 0;
+    long int i = 0;
+    long int heapLength = 0;
+
+    /* read the first point of every run */
+
+    for (i = 0; i < (*track).runCount; i++) {
+        rewind((*track).runs[i]);
+
+        if ((rc = readGpsTrackPoint((*track).runs[i], &heads[i],
+                                    &nameBuffers[i], &nameBufferLengths[i])) <
+            0)
+            return rc;
+
+        if (rc > 0) heap[heapLength++] = i;
+    }
+
+    for (i = heapLength / 2 - 1; i >= 0; i--)
+        siftGpsTrackHeap(heap, heapLength, heads, i);
+
+    /* print the earliest point and replace it by the next one of its run */
+
+    while (heapLength > 0) {
+        i = heap[0];
+
+        printGpsPoint(writer, heads[i].latitude, heads[i].longitude,
+                      heads[i].time, heads[i].name);
+
+        if ((rc = readGpsTrackPoint((*track).runs[i], &heads[i],
+                                    &nameBuffers[i], &nameBufferLengths[i])) <
+            0)
+            return rc;
+
+        if (rc == 0) heap[0] = heap[--heapLength];
+
+        siftGpsTrackHeap(heap, heapLength, heads, 0);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* siftGpsTrackHeap                                                           */
+/* restores the min-heap "heap" of run numbers, ordered by the time of their  */
+/* current point in "heads", below position "i".                              */
+/* -------------------------------------------------------------------------- */
+
+static void siftGpsTrackHeap(long int *heap, long int heapLength,
+                             struct gpsTrackPoint *heads, long int i) {
+    long int smallest = 0;
+    long int child = 0;
+    long int swap = 0;
+
+    while (1) {
+        smallest = i;
+
+        for (child = 2 * i + 1; child <= 2 * i + 2; child++)
+            if (child < heapLength &&
+                strcmp(heads[heap[child]].time, heads[heap[smallest]].time) <
+                    0)
+                smallest = child;
+
+        if (smallest == i) break;
+
+        swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+
+        i = smallest;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* printJsonString                                                            */
+/* prints "string" as a quoted json string.                                   */
+/* -------------------------------------------------------------------------- */
+
+static void printJsonString(FILE *stream, char *string) {
+    unsigned char *c = (unsigned char *)string;
+
+    fputc('"', stream);
+
+    for (; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            fprintf(stream, "\\%c", *c);
+        else if (*c < 0x20)
+            fprintf(stream, "\\u%04x", *c);
+        else
+            fputc(*c, stream);
+    }
+
+    fputc('"', stream);
+}
+
+/* -------------------------------------------------------------------------- */
+/* printXmlString                                                             */
+/* prints "string" with the xml special characters escaped.                   */
+/* -------------------------------------------------------------------------- */
+
+static void printXmlString(FILE *stream, char *string) {
+    char *c = string;
+
+    for (; *c != '\0'; c++) {
+        if (*c == '&')
+            fprintf(stream, "&amp;");
+        else if (*c == '<')
+            fprintf(stream, "&lt;");
+        else if (*c == '>')
+            fprintf(stream, "&gt;");
+        else if (*c == '"')
+            fprintf(stream, "&quot;");
+        else
+            fputc(*c, stream);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,248 @@
+#ifndef EXIFGPS_H_INCLUDED
+#define EXIFGPS_H_INCLUDED
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    gps index file (all integers in host byte order):                       */
+/*                                                                            */
+/*       HEADER (32 BYTES)|POINT 1|...|POINT N|FILE NAMES                     */
+/*                                                                            */
+/*    the points are sorted by their key. the key interleaves the bits of     */
+/*    the quantized longitude and latitude (z-order), so points that are      */
+/*    close to each other are mostly close in the file and every cell of a    */
+/*    regular grid is one contiguous range of keys. the file names are        */
+/*    null-terminated strings referenced by their offset.                     */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define GPS_INDEX_MAGIC "EXIFGPS1"
+#define GPS_INDEX_MAGIC_LENGTH 8
+#define GPS_INDEX_BITS 16
+#define GPS_INDEX_MAX_CELLS 64
+
+#define GPS_EARTH_RADIUS 6371.0088
+#define GPS_KM_PER_DEGREE 111.195
+
+#define GPS_ERR_MALLOC -821
+#define GPS_ERR_FILE_OPEN -822
+#define GPS_ERR_FILE_WRITE -823
+#define GPS_ERR_FILE_READ -824
+#define GPS_ERR_INDEX_FORMAT -825
+#define GPS_ERR_QUERY -826
+#define GPS_ERR_GAZETTEER -827
+
+#define GPS_ERR_TRACK -828
+
+#define GPS_FORMAT_TEXT 0
+#define GPS_FORMAT_GEOJSON 1
+#define GPS_FORMAT_GPX 2
+
+#define GPS_TIME_LENGTH 24
+#define GPS_TRACK_RUN_LENGTH 65536
+
+#define GPS_GEONAMES_FIELDS 9
+#define GPS_GEOCODE_BATCH 4096
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct gpsIndexHeader {
+    char magic[GPS_INDEX_MAGIC_LENGTH];
+    uint64_t pointCount;
+    uint64_t namesLength;
+    uint64_t reserved;
+};
+
+struct gpsIndexPoint {
+    uint32_t key;
+    float latitude;
+    float longitude;
+    uint32_t reserved;
+    uint64_t nameOffset;
+};
+
+struct gpsIndex {
+    void *map;
+    size_t mapLength;
+
+    uint64_t pointCount;
+    uint64_t pointCapacity;
+    struct gpsIndexPoint *points;
+
+    uint64_t namesLength;
+    uint64_t namesCapacity;
+    char *names;
+};
+
+struct gpsQuery {
+    double minLatitude;
+    double minLongitude;
+    double maxLatitude;
+    double maxLongitude;
+
+    int radius;
+    double latitude;
+    double longitude;
+    double distance;
+};
+
+struct gpsPlace {
+    float position[3];
+    float latitude;
+    float longitude;
+    uint32_t nameOffset;
+    char countryCode[4];
+};
+
+struct gpsGazetteer {
+    long int placeCount;
+    long int placeCapacity;
+    struct gpsPlace *places;
+
+    uint64_t namesLength;
+    uint64_t namesCapacity;
+    char *names;
+};
+
+struct gpsTrackPoint {
+    char time[GPS_TIME_LENGTH];
+    double latitude;
+    double longitude;
+    char *name;
+};
+
+struct gpsTrack {
+    long int pointCount;
+    struct gpsTrackPoint *points;
+
+    long int runCount;
+    FILE **runs;
+};
+
+struct gpsWriter {
+    FILE *stream;
+    int format;
+    int track;
+    long int pointCount;
+};
+
+typedef long int (*gpsQueryCallback)(struct gpsIndexPoint *point, char *name,
+                                     void *arg);
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int addGpsIndexPoint(struct gpsIndex *index, double latitude,
+                          double longitude, char *fileName);
+
+long int writeGpsIndex(char *indexFileName, struct gpsIndex *index);
+
+long int openGpsIndex(char *indexFileName, struct gpsIndex *index);
+
+void closeGpsIndex(struct gpsIndex *index);
+
+long int parseGpsQuery(char *arg, struct gpsQuery *query);
+
+long int queryGpsIndex(struct gpsIndex *index, struct gpsQuery *query,
+                       gpsQueryCallback callback, void *arg);
+
+double haversineDistance(double latitude1, double longitude1,
+                         double latitude2, double longitude2);
+
+long int loadGpsGazetteer(char *fileName, struct gpsGazetteer *gazetteer);
+
+void freeGpsGazetteer(struct gpsGazetteer *gazetteer);
+
+struct gpsPlace *findNearestGpsPlace(struct gpsGazetteer *gazetteer,
+                                     double latitude, double longitude,
+                                     double *distance);
+
+long int addGpsTrackPoint(struct gpsTrack *track, char *time,
+                          double latitude, double longitude, char *name);
+
+long int writeGpsTrack(struct gpsTrack *track, struct gpsWriter *writer);
+
+void freeGpsTrack(struct gpsTrack *track);
+
+void printGpsHeader(struct gpsWriter *writer);
+
+void printGpsPoint(struct gpsWriter *writer, double latitude,
+                   double longitude, char *time, char *name);
+
+void printGpsFooter(struct gpsWriter *writer);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int queryGpsBox(struct gpsIndex *index, struct gpsQuery *query,
+                            double minLongitude, double maxLongitude,
+                            gpsQueryCallback callback, void *arg);
+
+static uint32_t quantizeLatitude(double latitude);
+
+static uint32_t quantizeLongitude(double longitude);
+
+static double wrapLongitude(double longitude);
+
+static uint32_t interleaveBits(uint32_t x, uint32_t y);
+
+static int compareGpsIndexPoints(const void *a, const void *b);
+
+static uint64_t searchGpsIndex(struct gpsIndex *index, uint64_t key);
+
+static void toUnitVector(double latitude, double longitude, float *position);
+
+static long int addGpsPlace(struct gpsGazetteer *gazetteer, char *name,
+                            double latitude, double longitude,
+                            char *countryCode);
+
+static void selectGpsPlace(struct gpsPlace *places, long int count,
+                           long int k, int axis);
+
+static void buildGpsTree(struct gpsPlace *places, long int count, int depth);
+
+static void searchGpsTree(struct gpsPlace *places, long int count, int depth,
+                          float *position, struct gpsPlace **best,
+                          float *bestDistance);
+
+static int compareGpsTrackPoints(const void *a, const void *b);
+
+static long int writeGpsTrackRun(struct gpsTrack *track);
+
+static long int readGpsTrackPoint(FILE *fp, struct gpsTrackPoint *point,
+                                  char **nameBuffer, size_t *nameBufferLength);
+
+static long int mergeGpsTrackRuns(struct gpsTrack *track,
+                                  struct gpsWriter *writer, long int *heap,
+                                  struct gpsTrackPoint *heads,
+                                  char **nameBuffers,
+                                  size_t *nameBufferLengths);
+
+static void siftGpsTrackHeap(long int *heap, long int heapLength,
+                             struct gpsTrackPoint *heads, long int i);
+
+static void printJsonString(FILE *stream, char *string);
+
+static void printXmlString(FILE *stream, char *string);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
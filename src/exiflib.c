@@ -1,81 +1,524 @@
 /* -------------------------------------------------------------------------- */
 
 #include "exiflib.h"
+#include "exifmakernote.h"
+#include "exifmeta.h"
+
+/* -------------------------------------------------------------------------- */
+/* variables                                                                  */
+/* -------------------------------------------------------------------------- */
+
+struct exifContext exifDefaultContext = {
+    {EXIF_DEFAULT_MAX_IFDS, EXIF_DEFAULT_MAX_TAGS, EXIF_DEFAULT_MAX_TAG_BYTES},
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    0,
+    0,
+    0};
+
+long int exifBytesRead = 0;
 
 /* -------------------------------------------------------------------------- */
 /* extractExifInfo                                                            */
-/* extracts the exif information from a jpg file to an exif table. returns    */
-/* the number of exif items if successful or a negative value otherwise.      */
+/* extracts the exif information from a jpg or tiff file to an exif table.    */
+/* returns the number of exif items if successful or a negative value         */
+/* otherwise.                                                                 */
 /* -------------------------------------------------------------------------- */
 
 long int extractExifInfo(char *fileName, struct exifItem **exifTable) {
-    long int i = 0;
+    return extractExifInfoHook(fileName, exifTable, NULL, NULL);
+}
+
+/* -------------------------------------------------------------------------- */
+/* extractExifInfoHook                                                        */
+/* same as extractExifInfo, but calls "hook" with "hookArg" for every item    */
+/* as soon as it is added to the exif table. if "hook" returns a negative     */
+/* value, the extraction stops and the value is returned. if it returns       */
+/* EXIF_VISIT_STOP, the extraction stops and the table so far is returned.    */
+/* "hook" may be null.                                                        */
+/* -------------------------------------------------------------------------- */
+
+long int extractExifInfoHook(char *fileName, struct exifItem **exifTable,
+                             exifTagHook hook, void *hookArg) {
+    return extractExifInfoContext(&exifDefaultContext, fileName, exifTable,
+                                  hook, hookArg);
+}
+
+/* -------------------------------------------------------------------------- */
+/* extractExifInfoContext                                                     */
+/* same as extractExifInfoHook, but uses the limits, allocator and logger of  */
+/* "context". the table must be freed with freeExifTableContext.              */
+/* -------------------------------------------------------------------------- */
+
+long int extractExifInfoContext(struct exifContext *context, char *fileName,
+                                struct exifItem **exifTable, exifTagHook hook,
+                                void *hookArg) {
     long int rc = 0;
 
-    FILE *fp = NULL;
+    struct exifSource source;
+    struct tableVisit visit = {context, NULL, 0, hook, hookArg};
+
+    if ((rc = openExifSource(context, fileName, &source)) == 0)
+        rc = visitExifInfo(context, &source, addItemToExifTable, &visit);
+
+    closeExifSource(&source);
+
+    if (rc < 0) {
+        freeExifTableContext(context, visit.exifTable,
+                             visit.exifTableItemCount);
+        *exifTable = NULL;
+        return rc;
+    }
+
+    *exifTable = visit.exifTable;
+
+    return visit.exifTableItemCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* openExifSource                                                             */
+/* maps the file "fileName" into memory as "source", or reads it if mapping   */
+/* fails or "context" asks for it. returns 0 if successful or a negative      */
+/* value otherwise. "source" must be closed with closeExifSource in both      */
+/* cases.                                                                     */
+/* -------------------------------------------------------------------------- */
+
+long int openExifSource(struct exifContext *context, char *fileName,
+                        struct exifSource *source) {
+    long int rc = 0;
+    long int phaseStart = 0;
+    long int spanStart = 0;
+
+    openExifMemory(source, NULL, 0);
+
+    (*source).fileName = fileName;
+    (*source).spanStart = traceStart();
+
+    /* open file */
+
+    phaseStart = startPhase();
+    spanStart = traceStart();
+
+    rc = mapExifFile(source, fileName, (*context).readFiles);
+
+    endPhase(STATS_PHASE_OPEN, phaseStart);
+    traceSpan("open", fileName, spanStart);
+
+    if (rc < 0) return rc;
+
+    countStat(filesOpened, 1);
+
+    debugger(context, 1, "\nfileName = %s", fileName);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* openExifMemory                                                             */
+/* uses the "size" bytes at "data" as "source". the data is not copied and    */
+/* must live until the source is closed.                                      */
+/* -------------------------------------------------------------------------- */
+
+void openExifMemory(struct exifSource *source, unsigned char *data,
+                    long int size) {
+    (*source).fileName = NULL;
+    (*source).data = data;
+    (*source).size = size;
+    (*source).readEnd = 0;
+    (*source).spanStart = 0;
+    (*source).mapped = 0;
+    (*source).fd = -1;
+    (*source).pageMap = NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* closeExifSource                                                            */
+/* unmaps or frees "source". items visited in it are invalid afterwards. for  */
+/* files, the time since openExifSource is recorded as a file span and the    */
+/* file is counted as done.                                                   */
+/* -------------------------------------------------------------------------- */
+
+void closeExifSource(struct exifSource *source) {
+    if ((*source).mapped) munmap((*source).data, (*source).size);
+
+    /* the kernel counts the bytes of a read source itself */
+
+    if ((*source).fd >= 0) {
+        free((*source).data);
+        free((*source).pageMap);
+        close((*source).fd);
+    } else
+        __atomic_fetch_add(&exifBytesRead, (*source).readEnd,
+                           __ATOMIC_RELAXED);
+
+    if ((*source).fileName != NULL) {
+        traceSpan("file", (*source).fileName, (*source).spanStart);
+        countProgress(progressFilesDone);
+    }
+
+    (*source).data = NULL;
+    (*source).size = 0;
+    (*source).readEnd = 0;
+    (*source).mapped = 0;
+    (*source).fd = -1;
+    (*source).pageMap = NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* loadExifSource                                                             */
+/* makes sure the "length" bytes at "pos" of "source" are in its data. only a */
+/* read source has to read them, at least SOURCE_READ_AHEAD bytes from the    */
+/* first page missing, up to the next page read before. returns 0 if          */
+/* successful or a negative value otherwise.                                  */
+/* -------------------------------------------------------------------------- */
+
+long int loadExifSource(struct exifSource *source, long int pos,
+                        long int length) {
+    long int page = 0;
+    long int lastPage = 0;
+    long int start = 0;
+    long int end = 0;
+    ssize_t n = 0;
+
+    unsigned char *pageMap = (*source).pageMap;
+
+    if (pos < 0 || length < 0 || pos > (*source).size - length)
+        return EXIF_ERR_FILE_READ;
+
+    if ((*source).fd < 0 || length == 0) return 0;
+
+    /* skip the pages read before */
+
+    page = pos / SOURCE_PAGE_SIZE;
+    lastPage = (pos + length - 1) / SOURCE_PAGE_SIZE;
+
+    while (page <= lastPage && (pageMap[page >> 3] & (1 << (page & 7))))
+        page++;
+
+    if (page > lastPage) return 0;
+
+    /* read ahead, the next value is usually close */
+
+    start = page * SOURCE_PAGE_SIZE;
+
+    while ((lastPage + 1) * SOURCE_PAGE_SIZE < (*source).size &&
+           (lastPage + 1) * SOURCE_PAGE_SIZE < start + SOURCE_READ_AHEAD &&
+           !(pageMap[(lastPage + 1) >> 3] & (1 << ((lastPage + 1) & 7))))
+        lastPage++;
+
+    end = (lastPage + 1) * SOURCE_PAGE_SIZE;
+
+    if (end > (*source).size) end = (*source).size;
+
+    for (pos = start; pos < end; pos = pos + n) {
+        n = pread((*source).fd, (*source).data + pos, end - pos, pos);
+
+        if (n < 0 && errno == EINTR)
+            n = 0;
+        else if (n <= 0)
+            return EXIF_ERR_FILE_READ;
+    }
+
+    for (; page <= lastPage; page++)
+        pageMap[page >> 3] = pageMap[page >> 3] | (1 << (page & 7));
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitExifInfo                                                              */
+/* walks the ifds of "source" and calls "visitor" with "visitorArg" for every */
+/* tag. the tag data of the item points into "source". if "visitor" returns   */
+/* a negative value, the walk stops and the value is returned. if it returns  */
+/* EXIF_VISIT_STOP, the walk stops early. returns the number of tags visited  */
+/* if successful or a negative value otherwise.                               */
+/* -------------------------------------------------------------------------- */
 
-    long int exifTableItemCount = 0;
+long int visitExifInfo(struct exifContext *context, struct exifSource *source,
+                       exifTagHook visitor, void *visitorArg) {
+    long int i = 0;
+    long int rc = 0;
+    long int tagCount = 0;
 
-    struct queueItem *ifdQueue = NULL;
+    struct queueItem queueBuffer[EXIF_DEFAULT_MAX_IFDS];
+    struct queueItem *ifdQueue = queueBuffer;
     long int ifdQueueItemCount = 0;
 
     long int exifFormat = 0;
-    long int soiMarkerPos = 0;
-    long int exifMarkerPos = 0;
+    long int tiffPos = 0;
+    long int ifdPos = 0;
+    long int exifEnd = 0;
+    long int phaseStart = 0;
+    long int spanStart = 0;
+    long int exifFound = 0;
 
-    /* open file */
+    struct metaSegments segments;
+    struct makerNoteVisit makerNote = {visitor, visitorArg, 0,     0,
+                                       NULL,    0,          source};
 
-    if ((fp = fopen(fileName, "r")) == NULL) return EXIF_ERR_FILE_OPEN;
+    memset(&segments, 0, sizeof(struct metaSegments));
 
-    debugger(1, "\nfileName = %s", fileName);
+    /* find the tiff header */
 
-    /* find soi file marker to make sure it is a jpg */
+    phaseStart = startPhase();
+    spanStart = traceStart();
 
-    if ((soiMarkerPos = findMarkerInFile(fp, soiMarker, SOI_MARKER_LENGTH, 0)) <
-        0)
-        return EXIF_ERR_NO_JPG;
+    if ((rc = findTiffHeader(context, source, &segments, &tiffPos,
+                             &exifFormat, &exifEnd)) == 0 &&
+        (ifdPos = getFirstIfd(source, tiffPos, exifFormat)) < 0)
+        rc = ifdPos;
 
-    debugger(1, "soiMarkerPos = %ld", soiMarkerPos);
+    endPhase(STATS_PHASE_MARKER, phaseStart);
 
-    /* find exif file marker to make sure there is exif information */
+    /* a jpg file without exif may still have other metadata */
 
-    if ((exifMarkerPos = findMarkerInFile(fp, exifMarker, EXIF_MARKER_LENGTH,
-                                          rc + SOI_MARKER_LENGTH)) < 0)
-        return EXIF_ERR_NO_EXIF;
+    exifFound = rc == 0;
 
-    debugger(1, "exifMarkerPos = %ld", exifMarkerPos);
+    if (rc == EXIF_ERR_NO_EXIF && segments.count > 0) rc = 0;
 
-    /* determine exif format (intel or motorola) */
+    if (rc < 0) {
+        traceSpan("extract", (*source).fileName, spanStart);
+        return rc;
+    }
 
-    if ((exifFormat = getExifFormat(fp, exifMarkerPos)) < 0)
-        return EXIF_ERR_EXIF_FORMAT;
+    /* the queue only needs the heap for raised limits */
 
-    debugger(1, "exifFormat = %ld", exifFormat);
+    if ((*context).limits.maxIfds > EXIF_DEFAULT_MAX_IFDS &&
+        (ifdQueue = (struct queueItem *)exifAllocate(
+             context, NULL,
+             sizeof(struct queueItem) * (*context).limits.maxIfds)) == NULL)
+        return EXIF_ERR_MALLOC;
 
     /* add ifd0 to queue */
 
-    if ((rc = addIfdToQueue(&ifdQueue, &ifdQueueItemCount,
-                            exifMarkerPos + EXIF_MARKER_LENGTH +
-                                2  // exif marker has two extra bytes
-                                + EXIF_HEADER_LENGTH,
-                            IFD_ID_IFD)) < 0)
-        return rc;
+    if (exifFound)
+        rc = addIfdToQueue(context, ifdQueue, &ifdQueueItemCount, ifdPos,
+                           IFD_ID_IFD);
+
+    /* the maker note is only decoded on request, it is noted on the way */
+
+    if ((*context).makerNotes) {
+        visitor = noteMakerNote;
+        visitorArg = &makerNote;
+    }
 
     /* process queue - more queue items will be added during process */
 
-    for (i = 0; i < ifdQueueItemCount; i++) {
-        if ((rc = addIfdToExifTable(exifTable, &exifTableItemCount, fp,
-                                    ifdQueue[i].ifdPos, ifdQueue[i].ifdID,
-                                    exifMarkerPos, exifFormat, &ifdQueue,
-                                    &ifdQueueItemCount)) < 0)
-            return rc;
+    phaseStart = startPhase();
+
+    for (i = 0; rc == 0 && i < ifdQueueItemCount; i++) {
+        if ((rc = visitIfd(context, source, ifdQueue[i].ifdPos,
+                           ifdQueue[i].ifdID, tiffPos, exifEnd,
+                           exifFormat, ifdQueue, &ifdQueueItemCount,
+                           &tagCount, visitor, visitorArg)) < 0)
+            break;
+
+        countStat(ifdsVisited, 1);
     }
 
+    visitor = makerNote.visitor;
+    visitorArg = makerNote.visitorArg;
+
+    if (rc == 0 && makerNote.makerNoteLength > 0)
+        rc = visitMakerNotes(context, source, tiffPos, exifEnd, exifFormat,
+                             &makerNote, &tagCount);
+
+    /* the other metadata of a jpg file follows the ifds */
+
+    if (rc == 0)
+        rc = visitMetaSegments(context, source, &segments, &tagCount, visitor,
+                               visitorArg);
+
+    if (rc == 0 && !exifFound && tagCount == 0) rc = EXIF_ERR_NO_EXIF;
+
+    endPhase(STATS_PHASE_IFD, phaseStart);
+    traceSpan("extract", (*source).fileName, spanStart);
+
     /* clean up and return */
 
-    fclose(fp);
+    if (ifdQueue != queueBuffer) exifRelease(context, ifdQueue);
+
+    if (rc < 0) return rc;
+
+    return tagCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findExifPreview                                                            */
+/* finds the largest jpg preview embedded in the ifds of "source" and writes  */
+/* its position and length in the file to "preview". the preview data is not  */
+/* read beyond its soi marker. returns 0 if successful, EXIF_ERR_NO_PREVIEW   */
+/* if there is none or another negative value otherwise.                      */
+/* -------------------------------------------------------------------------- */
+
+long int findExifPreview(struct exifContext *context,
+                         struct exifSource *source,
+                         struct exifPreview *preview) {
+    long int i = 0;
+    long int rc = 0;
+    long int tagCount = 0;
+
+    struct queueItem queueBuffer[EXIF_DEFAULT_MAX_IFDS];
+    struct queueItem *ifdQueue = queueBuffer;
+    long int ifdQueueItemCount = 0;
+
+    long int exifFormat = 0;
+    long int tiffPos = 0;
+    long int ifdPos = 0;
+    long int exifEnd = 0;
+
+    struct metaSegments segments;
+    struct previewVisit visit;
+
+    memset(&segments, 0, sizeof(struct metaSegments));
+
+    (*preview).pos = 0;
+    (*preview).length = 0;
+
+    /* find the tiff header */
 
-    return exifTableItemCount;
+    if ((rc = findTiffHeader(context, source, &segments, &tiffPos,
+                             &exifFormat, &exifEnd)) < 0)
+        return rc;
+
+    if ((ifdPos = getFirstIfd(source, tiffPos, exifFormat)) < 0) return ifdPos;
+
+    if ((*context).limits.maxIfds > EXIF_DEFAULT_MAX_IFDS &&
+        (ifdQueue = (struct queueItem *)exifAllocate(
+             context, NULL,
+             sizeof(struct queueItem) * (*context).limits.maxIfds)) == NULL)
+        return EXIF_ERR_MALLOC;
+
+    visit.context = context;
+    visit.source = source;
+    visit.ifdQueue = ifdQueue;
+    visit.ifdQueueItemCount = &ifdQueueItemCount;
+    visit.tiffPos = tiffPos;
+    visit.exifEnd = exifEnd;
+    visit.lastTagPos = -1;
+    visit.preview = preview;
+
+    /* walk ifd0, its links and the sub ifds added by the visitor */
+
+    rc = addIfdToQueue(context, ifdQueue, &ifdQueueItemCount, ifdPos,
+                       IFD_ID_IFD);
+
+    for (i = 0; rc == 0 && i < ifdQueueItemCount; i++)
+        rc = visitIfd(context, source, ifdQueue[i].ifdPos, ifdQueue[i].ifdID,
+                      tiffPos, exifEnd, exifFormat, ifdQueue,
+                      &ifdQueueItemCount, &tagCount, findPreviewHook, &visit);
+
+    if (ifdQueue != queueBuffer) exifRelease(context, ifdQueue);
+
+    /* a broken ifd after the preview does not lose it */
+
+    if ((*preview).length > 0) return 0;
+
+    if (rc < 0) return rc;
+
+    return EXIF_ERR_NO_PREVIEW;
+}
+
+/* -------------------------------------------------------------------------- */
+/* freeExifTable                                                              */
+/* releases "exifTable" of length "exifTableItemCount" including the tag      */
+/* data of its items.                                                         */
+/* -------------------------------------------------------------------------- */
+
+void freeExifTable(struct exifItem *exifTable, long int exifTableItemCount) {
+    freeExifTableContext(&exifDefaultContext, exifTable, exifTableItemCount);
+}
+
+/* -------------------------------------------------------------------------- */
+/* freeExifTableContext                                                       */
+/* same as freeExifTable for a table read with "context".                     */
+/* -------------------------------------------------------------------------- */
+
+void freeExifTableContext(struct exifContext *context,
+                          struct exifItem *exifTable,
+                          long int exifTableItemCount) {
+    long int i = 0;
+
+    if (exifTable == NULL) return;
+
+    for (i = 0; i < exifTableItemCount; i++)
+        exifRelease(context, exifTable[i].tagData);
+
+    exifRelease(context, exifTable);
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifAllocate                                                               */
+/* resizes "ptr" to "size" bytes like realloc with the allocator of           */
+/* "context". "size" zero is rounded up to one byte, so the result is only    */
+/* NULL if the allocation failed.                                             */
+/* -------------------------------------------------------------------------- */
+
+void *exifAllocate(struct exifContext *context, void *ptr, size_t size) {
+    countStat(allocations, 1);
+
+    if (size == 0) size = 1;
+
+    if ((*context).alloc == NULL) return realloc(ptr, size);
+
+    return (*context).alloc((*context).allocArg, ptr, size);
+}
+
+/* -------------------------------------------------------------------------- */
+/* exifRelease                                                                */
+/* frees "ptr" with the allocator of "context".                               */
+/* -------------------------------------------------------------------------- */
+
+void exifRelease(struct exifContext *context, void *ptr) {
+    if (ptr == NULL) return;
+
+    if ((*context).alloc == NULL)
+        free(ptr);
+    else
+        (*context).alloc((*context).allocArg, ptr, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+/* getTagTypeSize                                                             */
+/* returns the data type size of type "tagType", counting an ifd (13) as a   */
+/* long. in case of an error a negative value is returned.                    */
+/* -------------------------------------------------------------------------- */
+
+long int getTagTypeSize(long int tagType) {
+    long int tagTypeSize = 0;
+
+    switch (tagType) {
+        case 1:
+        case 6:
+            tagTypeSize = 1;
+            break;
+        case 2:
+        case 7:
+            tagTypeSize = 1;
+            break;
+        case 3:
+        case 8:
+            tagTypeSize = 2;
+            break;
+        case 4:
+        case 9:
+        case 11:
+        case 13:
+            tagTypeSize = 4;
+            break;
+        case 5:
+        case 10:
+        case 12:
+            tagTypeSize = 8;
+            break;
+        default:
+            tagTypeSize = EXIF_ERR_TYPE_SIZE;
+            break;
+    }
+
+    return tagTypeSize;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -91,7 +534,7 @@ long int castUInt8(unsigned char *bytes, long int exifFormat) {
         cast = (long int)(*((uint8_t *)bytes));
 
     else if (exifFormat == EXIF_FORMAT_MOTO)
-        cast = (long int)(*((uint8_t *)reverseByteOrder(bytes, 1)));
+        cast = (long int)bytes[0];
 
     else
         return 0;
@@ -107,12 +550,13 @@ long int castUInt8(unsigned char *bytes, long int exifFormat) {
 
 long int castUInt16(unsigned char *bytes, long int exifFormat) {
     long int cast = 0;
+    uint16_t value = 0;
 
-    if (exifFormat == EXIF_FORMAT_INTEL)
-        cast = (long int)(*((uint16_t *)bytes));
-
-    else if (exifFormat == EXIF_FORMAT_MOTO)
-        cast = (long int)(*((uint16_t *)reverseByteOrder(bytes, 2)));
+    if (exifFormat == EXIF_FORMAT_INTEL) {
+        memcpy(&value, bytes, sizeof(value));
+        cast = (long int)value;
+    } else if (exifFormat == EXIF_FORMAT_MOTO)
+        cast = (long int)((bytes[0] << 8) | bytes[1]);
 
     else
         return 0;
@@ -128,12 +572,14 @@ long int castUInt16(unsigned char *bytes, long int exifFormat) {
 
 long int castUInt32(unsigned char *bytes, long int exifFormat) {
     long int cast = 0;
+    uint32_t value = 0;
 
-    if (exifFormat == EXIF_FORMAT_INTEL)
-        cast = (long int)(*((uint32_t *)bytes));
-
-    else if (exifFormat == EXIF_FORMAT_MOTO)
-        cast = (long int)(*((uint32_t *)reverseByteOrder(bytes, 4)));
+    if (exifFormat == EXIF_FORMAT_INTEL) {
+        memcpy(&value, bytes, sizeof(value));
+        cast = (long int)value;
+    } else if (exifFormat == EXIF_FORMAT_MOTO)
+        cast = (long int)(((uint32_t)bytes[0] << 24) | (bytes[1] << 16) |
+                           (bytes[2] << 8) | bytes[3]);
 
     else
         return 0;
@@ -149,12 +595,15 @@ long int castUInt32(unsigned char *bytes, long int exifFormat) {
 
 long int castInt32(unsigned char *bytes, long int exifFormat) {
     long int cast = 0;
+    int32_t value = 0;
 
-    if (exifFormat == EXIF_FORMAT_INTEL)
-        cast = (long int)(*((int32_t *)bytes));
-
-    else if (exifFormat == EXIF_FORMAT_MOTO)
-        cast = (long int)(*((int32_t *)reverseByteOrder(bytes, 4)));
+    if (exifFormat == EXIF_FORMAT_INTEL) {
+        memcpy(&value, bytes, sizeof(value));
+        cast = (long int)value;
+    } else if (exifFormat == EXIF_FORMAT_MOTO)
+        cast = (long int)(int32_t)(((uint32_t)bytes[0] << 24) |
+                                    (bytes[1] << 16) | (bytes[2] << 8) |
+                                    bytes[3]);
 
     else
         return 0;
@@ -163,292 +612,974 @@ long int castInt32(unsigned char *bytes, long int exifFormat) {
 }
 
 /* -------------------------------------------------------------------------- */
-/* reverseByteOrder                                                           */
-/* returns "bytes" in reverse byte order. size specifies the number of bytes  */
-/* to reverse. returns the reversed char or NULL in case of an error.         */
+/* mapExifFile                                                                */
+/* maps the regular file "fileName" read-only into "source". if it can not be */
+/* mapped or "readFiles" is set, the file is kept open and read on demand by  */
+/* loadExifSource. empty files and other file types give an empty source.     */
+/* returns 0 if successful or a negative value otherwise.                     */
 /* -------------------------------------------------------------------------- */
 
-static unsigned char *reverseByteOrder(unsigned char *bytes, long int size) {
-    long int i = 0;
-    unsigned char *buf = NULL;
+static long int mapExifFile(struct exifSource *source, char *fileName,
+                            int readFiles) {
+    int fd = -1;
+    void *data = MAP_FAILED;
+
+    struct stat fileStat;
 
-    if ((buf = (unsigned char *)malloc(size)) == NULL) return NULL;
+    if ((fd = open(fileName, O_RDONLY)) < 0) return EXIF_ERR_FILE_OPEN;
 
-    for (i = 0; i < size; i++) {
-        buf[i] = bytes[size - i - 1];
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return EXIF_ERR_FILE_READ;
     }
 
-    return buf;
-}
+    if (!S_ISREG(fileStat.st_mode) || fileStat.st_size == 0) {
+        close(fd);
+        return 0;
+    }
 
-/* -------------------------------------------------------------------------- */
-/* checkMarker                                                                */
-/* checks if a marker of length "markerLength" can be found in a file "fp"    */
-/* at a position "markerPos. returns 1 if the marker is found at this         */
-/* position or 0 otherwise. in case of an error a negative value is returned. */
-/* -------------------------------------------------------------------------- */
+    if (!readFiles)
+        data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-static long int checkMarker(FILE *fp, unsigned char *marker,
-                            long int markerLength, long int markerPos) {
-    long int markerFound = 0;
-    unsigned char *buf = NULL;
+    if (data != MAP_FAILED) {
+        (*source).data = (unsigned char *)data;
+        (*source).size = fileStat.st_size;
+        (*source).mapped = 1;
 
-    if ((buf = (unsigned char *)malloc(markerLength)) == NULL)
-        return EXIF_ERR_MALLOC;
+        close(fd);
 
-    if (fseek(fp, markerPos, SEEK_SET) != 0) {
-        free(buf);
-        return EXIF_ERR_FILE_READ;
+        return 0;
     }
 
-    if (fread(buf, 1, markerLength, fp) != markerLength) {
-        free(buf);
-        return EXIF_ERR_FILE_READ;
+    /* a file that is read keeps its descriptor until it is closed */
+
+    if (((*source).data = (unsigned char *)malloc(fileStat.st_size)) == NULL ||
+        ((*source).pageMap = (unsigned char *)calloc(
+             fileStat.st_size / SOURCE_PAGE_SIZE / 8 + 1, 1)) == NULL) {
+        free((*source).data);
+        (*source).data = NULL;
+        close(fd);
+        return EXIF_ERR_MALLOC;
     }
 
-    if (memcmp(buf, marker, markerLength) == 0) markerFound = 1;
+    (*source).size = fileStat.st_size;
+    (*source).fd = fd;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* getSourceData                                                              */
+/* returns a pointer to the "length" bytes at "pos" in "source" or NULL if    */
+/* they are not all inside the source.                                        */
+/* -------------------------------------------------------------------------- */
+
+static unsigned char *getSourceData(struct exifSource *source, long int pos,
+                                    long int length) {
+    if (pos < 0 || length < 0 || pos > (*source).size - length) return NULL;
 
-    free(buf);
+    if ((*source).fd >= 0 && loadExifSource(source, pos, length) < 0)
+        return NULL;
 
-    return markerFound;
+    if (pos + length > (*source).readEnd) (*source).readEnd = pos + length;
+
+    return (*source).data + pos;
 }
 
 /* -------------------------------------------------------------------------- */
-/* findMarkerInFile                                                           */
-/* searches for a marker "marker" of length "markerLength" in a file "fp",    */
-/* starting at "startPos". returns the position of the marker if it exists.   */
-/* otherwise it returns a negative value.                                     */
+/* getFileType                                                                */
+/* tells the format of the file in "source" from its first bytes. returns     */
+/* EXIF_FILE_JPG, EXIF_FILE_TIFF, EXIF_FILE_HEIF, EXIF_FILE_PNG,              */
+/* EXIF_FILE_WEBP or EXIF_ERR_NO_JPG for all other formats.                   */
 /* -------------------------------------------------------------------------- */
 
-static long int findMarkerInFile(FILE *fp, unsigned char *marker,
-                                 long int markerLength, long int startPos) {
-    long int fileSize = 0;
-    long int markerPos = EXIF_ERR_MARKER;
-    long int i = 0;
+static long int getFileType(struct exifSource *source) {
+    if (checkMarker(source, soiMarker, SOI_MARKER_LENGTH, 0) == 1)
+        return EXIF_FILE_JPG;
 
-    if (fseek(fp, 0L, SEEK_END) != 0) return EXIF_ERR_FILE_READ;
+    if (getTiffFormat(source, 0) > 0) return EXIF_FILE_TIFF;
 
-    if ((fileSize = ftell(fp)) == -1L) return EXIF_ERR_FILE_READ;
+    if (checkHeifBrand(source) == 1) return EXIF_FILE_HEIF;
 
-    if (fileSize - markerLength <= startPos) return EXIF_ERR_FILE_READ;
+    if (checkMarker(source, pngSignature, PNG_SIGNATURE_LENGTH, 0) == 1)
+        return EXIF_FILE_PNG;
 
-    for (i = startPos; i < fileSize - markerLength; i++) {
-        if (checkMarker(fp, marker, markerLength, i) == 1) {
-            markerPos = i;
-            break;
-        }
-    }
+    if (checkMarker(source, riffMarker, RIFF_MARKER_LENGTH, 0) == 1 &&
+        checkMarker(source, webpMarker, RIFF_MARKER_LENGTH, 8) == 1)
+        return EXIF_FILE_WEBP;
 
-    return markerPos;
+    return EXIF_ERR_NO_JPG;
 }
 
 /* -------------------------------------------------------------------------- */
-/* getExifFormat                                                              */
-/* checks an exif header for intel/moto in file "fp" at position              */
-/* "exifMarkerPos". returns the type of the header if successful or a         */
-/* negative value otherwise.                                                  */
+/* findTiffHeader                                                             */
+/* finds the tiff header of the jpg or tiff file in "source" and writes its   */
+/* position to "tiffPos", its byte order to "exifFormat" and the position     */
+/* after the exif data to "exifEnd". returns 0 if successful or a negative    */
+/* value otherwise. the other metadata segments of a jpg file are noted in    */
+/* "segments".                                                                */
 /* -------------------------------------------------------------------------- */
 
-static long int getExifFormat(FILE *fp, long int exifMarkerPos) {
-    long int exifFormat = 0;
+static long int findTiffHeader(struct exifContext *context,
+                               struct exifSource *source,
+                               struct metaSegments *segments, long int *tiffPos,
+                               long int *exifFormat, long int *exifEnd) {
+    long int rc = 0;
+    long int fileType = 0;
+    long int exifMarkerPos = 0;
 
-    if (checkMarker(fp, exifHeaderIntel, EXIF_HEADER_LENGTH,
-                    exifMarkerPos + EXIF_MARKER_LENGTH + 2) == 1)
-        exifFormat = EXIF_FORMAT_INTEL;
+    if ((fileType = getFileType(source)) < 0) return fileType;
 
-    else if (checkMarker(fp, exifHeaderMoto, EXIF_HEADER_LENGTH,
-                         exifMarkerPos + EXIF_MARKER_LENGTH + 2) == 1)
-        exifFormat = EXIF_FORMAT_MOTO;
+    debugger(context, 1, "fileType = %ld", fileType);
+
+    switch (fileType) {
+        /* a tiff file is exif data from start to end */
+
+        case EXIF_FILE_TIFF:
+            *tiffPos = 0;
+            *exifEnd = (*source).size;
+            break;
+
+        /* the other formats keep it in an item or chunk */
+
+        case EXIF_FILE_HEIF:
+            rc = findHeifExif(context, source, tiffPos, exifEnd);
+            break;
+
+        case EXIF_FILE_PNG:
+            rc = findPngExif(context, source, tiffPos, exifEnd);
+            break;
+
+        case EXIF_FILE_WEBP:
+            rc = findWebpExif(context, source, tiffPos, exifEnd);
+            break;
+
+        /* in a jpg file it follows the exif header of app1 */
+
+        default:
+            if ((rc = findExifSegment(context, source, segments,
+                                      &exifMarkerPos, exifFormat, exifEnd)) <
+                0)
+                return rc;
+
+            *tiffPos = exifMarkerPos + EXIF_MARKER_LENGTH +
+                       2  // exif marker has two extra bytes
+                       + EXIF_HEADER_LENGTH - TIFF_HEADER_LENGTH;
+
+            return 0;
+    }
+
+    if (rc < 0) return rc;
+
+    /* some writers keep the exif header of app1 in front of the tiff header */
+
+    if (checkMarker(source, exifPrefix, EXIF_PREFIX_LENGTH, *tiffPos) == 1)
+        *tiffPos = *tiffPos + EXIF_PREFIX_LENGTH;
+
+    if ((*exifFormat = getTiffFormat(source, *tiffPos)) < 0)
+        return EXIF_ERR_EXIF_FORMAT;
+
+    debugger(context, 1, "exifFormat = %ld", *exifFormat);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* checkHeifBrand                                                             */
+/* checks if "source" starts with an ftyp box that lists a heif brand as      */
+/* major or compatible brand. returns 1 if it does or 0 otherwise.            */
+/* -------------------------------------------------------------------------- */
+
+static long int checkHeifBrand(struct exifSource *source) {
+    long int i = 0;
+    long int pos = 0;
+    long int ftypEnd = 0;
+    unsigned char *buf = NULL;
+
+    if ((buf = getSourceData(source, 0, BOX_HEADER_LENGTH)) == NULL ||
+        memcmp(buf + 4, "ftyp", 4) != 0)
+        return 0;
+
+    /* the major brand and minor version are followed by compatible brands */
+
+    ftypEnd = castUInt32(buf, EXIF_FORMAT_MOTO);
+
+    for (pos = BOX_HEADER_LENGTH; pos + 4 <= ftypEnd; pos = pos + 4) {
+        if (pos == BOX_HEADER_LENGTH + 4) continue;
+
+        if ((buf = getSourceData(source, pos, 4)) == NULL) return 0;
+
+        for (i = 0; i < HEIF_BRAND_COUNT; i++)
+            if (memcmp(buf, heifBrands[i], 4) == 0) return 1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findHeifExif                                                               */
+/* finds the exif item of the heif file in "source" through its meta box and  */
+/* writes the position of its tiff header to "tiffPos" and the position       */
+/* after the item to "exifEnd". returns 0 if successful or a negative value   */
+/* otherwise.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+static long int findHeifExif(struct exifContext *context,
+                             struct exifSource *source, long int *tiffPos,
+                             long int *exifEnd) {
+    long int rc = 0;
+    long int metaPos = 0;
+    long int metaEnd = 0;
+    long int boxPos = 0;
+    long int boxEnd = 0;
+    long int itemID = 0;
+    long int method = 0;
+    long int extentPos = 0;
+    long int extentLength = 0;
+    long int prefixPos = 0;
+    long int prefix = 0;
+
+    /* meta is a full box, its boxes follow version and flags */
+
+    if ((metaPos = findBox(source, 0, (*source).size, "meta", &metaEnd)) < 0)
+        return metaPos;
+
+    metaPos = metaPos + 4;
+
+    /* get the id of the exif item from the item infos */
+
+    if ((boxPos = findBox(source, metaPos, metaEnd, "iinf", &boxEnd)) < 0)
+        return boxPos;
+
+    if ((itemID = findHeifExifItem(source, boxPos, boxEnd)) < 0) return itemID;
+
+    debugger(context, 1, "exifItemID = %ld", itemID);
+
+    /* get its extent from the item locations */
+
+    if ((boxPos = findBox(source, metaPos, metaEnd, "iloc", &boxEnd)) < 0)
+        return boxPos;
+
+    if ((rc = getHeifItemExtent(source, boxPos, boxEnd, itemID, &method,
+                                &extentPos, &extentLength)) < 0)
+        return rc;
+
+    /* construction method 1 is an offset into the idat box of meta */
+
+    if (method == 1) {
+        if ((boxPos = findBox(source, metaPos, metaEnd, "idat", &boxEnd)) < 0)
+            return boxPos;
+
+        extentPos = extentPos + boxPos;
+    } else if (method != 0)
+        return EXIF_ERR_NO_EXIF;
+
+    /* a length of 0 runs to the end of the file */
+
+    if (extentLength == 0) extentLength = (*source).size - extentPos;
+
+    if (extentPos > (*source).size || extentLength > (*source).size - extentPos)
+        return EXIF_ERR_BOUNDS;
+
+    debugger(context, 1, "exifItemPos = %ld", extentPos);
+
+    /* the item starts with the offset of the tiff header */
+
+    prefixPos = extentPos;
+
+    if ((prefix = getBoxInt(source, &prefixPos, 4)) < 0) return prefix;
+
+    *tiffPos = prefixPos + prefix;
+    *exifEnd = extentPos + extentLength;
+
+    debugger(context, 1, "tiffPos = %ld", *tiffPos);
+    debugger(context, 1, "exifEnd = %ld", *exifEnd);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findBox                                                                    */
+/* searches the boxes from "pos" to "end" in "source" for the first one of    */
+/* type "boxType" and writes the position after it to "boxEnd". returns the   */
+/* position of its content or a negative value if there is none.              */
+/* -------------------------------------------------------------------------- */
+
+static long int findBox(struct exifSource *source, long int pos, long int end,
+                        char *boxType, long int *boxEnd) {
+    long int boxSize = 0;
+    long int headerLength = 0;
+    long int sizePos = 0;
+    unsigned char *buf = NULL;
+
+    while (pos < end) {
+        if ((buf = getSourceData(source, pos, BOX_HEADER_LENGTH)) == NULL)
+            return EXIF_ERR_FILE_READ;
+
+        boxSize = castUInt32(buf, EXIF_FORMAT_MOTO);
+        headerLength = BOX_HEADER_LENGTH;
+
+        /* size 1 is followed by a 64 bit size, size 0 runs to the end */
+
+        if (boxSize == 1) {
+            sizePos = pos + BOX_HEADER_LENGTH;
+            headerLength = BOX_HEADER_LENGTH + 8;
+
+            if ((boxSize = getBoxInt(source, &sizePos, 8)) < 0) return boxSize;
+        } else if (boxSize == 0)
+            boxSize = end - pos;
+
+        if (boxSize < headerLength || boxSize > end - pos)
+            return EXIF_ERR_BOUNDS;
+
+        if (memcmp(buf + 4, boxType, 4) == 0) {
+            *boxEnd = pos + boxSize;
+            return pos + headerLength;
+        }
+
+        pos = pos + boxSize;
+    }
+
+    return EXIF_ERR_NO_EXIF;
+}
+
+/* -------------------------------------------------------------------------- */
+/* getBoxInt                                                                  */
+/* returns the big endian integer of "length" bytes in "source" at "pos" and  */
+/* moves "pos" after it. a length of 0 gives 0. in case of an error a         */
+/* negative value is returned.                                                */
+/* -------------------------------------------------------------------------- */
+
+static long int getBoxInt(struct exifSource *source, long int *pos,
+                          long int length) {
+    long int i = 0;
+    long int value = 0;
+    unsigned char *buf = NULL;
+
+    if (length > 8 || (buf = getSourceData(source, *pos, length)) == NULL)
+        return EXIF_ERR_FILE_READ;
+
+    for (i = 0; i < length; i++) {
+        if (value > (LONG_MAX >> 8)) return EXIF_ERR_BOUNDS;
+
+        value = (value << 8) | buf[i];
+    }
+
+    *pos = *pos + length;
+
+    return value;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findHeifExifItem                                                           */
+/* searches the infe boxes of the iinf box from "pos" to "end" in "source"    */
+/* for the item of type "Exif". returns its id or a negative value if there   */
+/* is none.                                                                   */
+/* -------------------------------------------------------------------------- */
+
+static long int findHeifExifItem(struct exifSource *source, long int pos,
+                                 long int end) {
+    long int version = 0;
+    long int itemID = 0;
+    long int infePos = 0;
+    long int infeEnd = 0;
+    unsigned char *buf = NULL;
+
+    /* skip version, flags and the entry count, the infe boxes are walked */
+
+    if ((buf = getSourceData(source, pos, 1)) == NULL)
+        return EXIF_ERR_FILE_READ;
+
+    pos = pos + 4 + (buf[0] == 0 ? 2 : 4);
+
+    while ((infePos = findBox(source, pos, end, "infe", &infeEnd)) >= 0) {
+        if ((buf = getSourceData(source, infePos, 1)) == NULL)
+            return EXIF_ERR_FILE_READ;
+
+        version = buf[0];
+        infePos = infePos + 4;
+
+        /* only version 2 and 3 have an item type */
+
+        if (version >= 2) {
+            if ((itemID = getBoxInt(source, &infePos, version == 2 ? 2 : 4)) <
+                0)
+                return itemID;
+
+            if ((buf = getSourceData(source, infePos + 2, 4)) == NULL)
+                return EXIF_ERR_FILE_READ;
+
+            if (memcmp(buf, "Exif", 4) == 0) return itemID;
+        }
+
+        pos = infeEnd;
+    }
+
+    return infePos;
+}
+
+/* -------------------------------------------------------------------------- */
+/* getHeifItemExtent                                                          */
+/* searches the iloc box from "pos" to "end" in "source" for the item         */
+/* "itemID" and writes the construction method, position and length of its    */
+/* first extent to "method", "extentPos" and "extentLength". returns 0 if     */
+/* successful or a negative value otherwise.                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int getHeifItemExtent(struct exifSource *source, long int pos,
+                                  long int end, long int itemID,
+                                  long int *method, long int *extentPos,
+                                  long int *extentLength) {
+    long int i = 0;
+    long int j = 0;
+    long int version = 0;
+    long int offsetSize = 0;
+    long int lengthSize = 0;
+    long int baseOffsetSize = 0;
+    long int indexSize = 0;
+    long int itemCount = 0;
+    long int extentCount = 0;
+    long int id = 0;
+    long int itemMethod = 0;
+    long int baseOffset = 0;
+    long int offset = 0;
+    long int length = 0;
+    unsigned char *buf = NULL;
+
+    /* version and the sizes of the fields that follow */
+
+    if ((buf = getSourceData(source, pos, 6)) == NULL)
+        return EXIF_ERR_FILE_READ;
+
+    version = buf[0];
+    offsetSize = buf[4] >> 4;
+    lengthSize = buf[4] & 0x0F;
+    baseOffsetSize = buf[5] >> 4;
+    indexSize = version == 1 || version == 2 ? buf[5] & 0x0F : 0;
+
+    pos = pos + 6;
+
+    if ((itemCount = getBoxInt(source, &pos, version < 2 ? 2 : 4)) < 0)
+        return itemCount;
+
+    /* walk the items up to the wanted one */
+
+    for (i = 0; i < itemCount && pos < end; i++) {
+        if ((id = getBoxInt(source, &pos, version < 2 ? 2 : 4)) < 0) return id;
+
+        itemMethod = 0;
+
+        if (version == 1 || version == 2) {
+            if ((itemMethod = getBoxInt(source, &pos, 2)) < 0)
+                return itemMethod;
+
+            itemMethod = itemMethod & 0x0F;
+        }
+
+        pos = pos + 2;  // data reference index
+
+        if ((baseOffset = getBoxInt(source, &pos, baseOffsetSize)) < 0)
+            return baseOffset;
+
+        if ((extentCount = getBoxInt(source, &pos, 2)) < 0) return extentCount;
+
+        for (j = 0; j < extentCount && pos < end; j++) {
+            pos = pos + indexSize;
+
+            if ((offset = getBoxInt(source, &pos, offsetSize)) < 0)
+                return offset;
+
+            if ((length = getBoxInt(source, &pos, lengthSize)) < 0)
+                return length;
+
+            if (id == itemID && j == 0) {
+                *method = itemMethod;
+                *extentPos = baseOffset + offset;
+                *extentLength = length;
+            }
+        }
+
+        if (id == itemID) return extentCount > 0 ? 0 : EXIF_ERR_NO_EXIF;
+    }
+
+    return EXIF_ERR_NO_EXIF;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findPngExif                                                                */
+/* walks the chunks of the png file in "source" up to the exif chunk and      */
+/* writes the position of its data to "tiffPos" and the position after it to  */
+/* "exifEnd". returns 0 if successful or a negative value otherwise.          */
+/* -------------------------------------------------------------------------- */
+
+static long int findPngExif(struct exifContext *context,
+                            struct exifSource *source, long int *tiffPos,
+                            long int *exifEnd) {
+    long int pos = PNG_SIGNATURE_LENGTH;
+    long int chunkLength = 0;
+    unsigned char *buf = NULL;
+
+    /* length, type, data and crc - the data of other chunks is skipped */
+
+    while ((buf = getSourceData(source, pos, 8)) != NULL) {
+        chunkLength = castUInt32(buf, EXIF_FORMAT_MOTO);
+
+        if (chunkLength > (*source).size - pos - 12) return EXIF_ERR_BOUNDS;
+
+        if (memcmp(buf + 4, "eXIf", 4) == 0) {
+            *tiffPos = pos + 8;
+            *exifEnd = pos + 8 + chunkLength;
+
+            debugger(context, 1, "tiffPos = %ld", *tiffPos);
+            debugger(context, 1, "exifEnd = %ld", *exifEnd);
+
+            return 0;
+        }
+
+        if (memcmp(buf + 4, "IEND", 4) == 0) return EXIF_ERR_NO_EXIF;
+
+        pos = pos + 12 + chunkLength;
+    }
+
+    return EXIF_ERR_NO_EXIF;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findWebpExif                                                               */
+/* walks the chunks of the webp file in "source" up to the exif chunk and     */
+/* writes the position of its data to "tiffPos" and the position after it to  */
+/* "exifEnd". returns 0 if successful or a negative value otherwise.          */
+/* -------------------------------------------------------------------------- */
+
+static long int findWebpExif(struct exifContext *context,
+                             struct exifSource *source, long int *tiffPos,
+                             long int *exifEnd) {
+    long int pos = RIFF_HEADER_LENGTH;
+    long int riffEnd = 0;
+    long int chunkLength = 0;
+    unsigned char *buf = NULL;
+
+    /* the riff size counts from after the size field */
+
+    if ((buf = getSourceData(source, 4, 4)) == NULL) return EXIF_ERR_FILE_READ;
+
+    riffEnd = 8 + castUInt32(buf, EXIF_FORMAT_INTEL);
+
+    if (riffEnd > (*source).size) riffEnd = (*source).size;
+
+    /* type and little endian length, odd chunks are padded */
+
+    while (pos + 8 <= riffEnd) {
+        if ((buf = getSourceData(source, pos, 8)) == NULL)
+            return EXIF_ERR_FILE_READ;
+
+        chunkLength = castUInt32(buf + 4, EXIF_FORMAT_INTEL);
+
+        if (chunkLength > riffEnd - pos - 8) return EXIF_ERR_BOUNDS;
+
+        if (memcmp(buf, "EXIF", 4) == 0) {
+            *tiffPos = pos + 8;
+            *exifEnd = pos + 8 + chunkLength;
+
+            debugger(context, 1, "tiffPos = %ld", *tiffPos);
+            debugger(context, 1, "exifEnd = %ld", *exifEnd);
+
+            return 0;
+        }
+
+        pos = pos + 8 + chunkLength + (chunkLength & 1);
+    }
+
+    return EXIF_ERR_NO_EXIF;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findExifSegment                                                            */
+/* finds the exif app1 segment of the jpg file in "source" and writes its     */
+/* position to "exifMarkerPos", its byte order to "exifFormat" and the        */
+/* position after the segment to "exifEnd". the segments with other metadata  */
+/* are noted in "segments". returns 0 if successful or a negative value       */
+/* otherwise.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+static long int findExifSegment(struct exifContext *context,
+                                struct exifSource *source,
+                                struct metaSegments *segments,
+                                long int *exifMarkerPos, long int *exifFormat,
+                                long int *exifEnd) {
+    /* walk the segments once, the exif app1 is one of them */
+
+    walkJpgSegments(context, source, segments);
+
+    if ((*exifMarkerPos = (*segments).exifMarkerPos) == 0)
+        return EXIF_ERR_NO_EXIF;
+
+    debugger(context, 1, "exifMarkerPos = %ld", *exifMarkerPos);
+
+    /* determine exif format (intel or motorola) */
+
+    if ((*exifFormat = getExifFormat(source, *exifMarkerPos)) < 0)
+        return EXIF_ERR_EXIF_FORMAT;
+
+    debugger(context, 1, "exifFormat = %ld", *exifFormat);
+
+    /* all offsets must stay inside the app1 segment */
+
+    if ((*exifEnd = getExifEnd(source, *exifMarkerPos)) < 0) return *exifEnd;
+
+    debugger(context, 1, "exifEnd = %ld", *exifEnd);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* checkMarker                                                                */
+/* checks if a marker of length "markerLength" can be found in "source" at a  */
+/* position "markerPos". returns 1 if the marker is found at this position    */
+/* or 0 otherwise. in case of an error a negative value is returned.          */
+/* -------------------------------------------------------------------------- */
+
+static long int checkMarker(struct exifSource *source, unsigned char *marker,
+                            long int markerLength, long int markerPos) {
+    unsigned char *buf = NULL;
+
+    if ((buf = getSourceData(source, markerPos, markerLength)) == NULL)
+        return EXIF_ERR_FILE_READ;
+
+    if (memcmp(buf, marker, markerLength) == 0) return 1;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* walkJpgSegments                                                            */
+/* walks the segments of the jpg file in "source" up to the start of scan and */
+/* notes the first exif app1 and the first xmp, iptc and icc segments in      */
+/* "segments". bytes between segments are skipped up to the next marker like  */
+/* a decoder does. returns the number of segments walked.                     */
+/* -------------------------------------------------------------------------- */
+
+static long int walkJpgSegments(struct exifContext *context,
+                                struct exifSource *source,
+                                struct metaSegments *segments) {
+    long int pos = SOI_MARKER_LENGTH;
+    long int marker = 0;
+    long int segmentCount = 0;
+    long int segmentPos = 0;
+    long int segmentEnd = 0;
+    long int length = 0;
+    unsigned char *buf = NULL;
+    unsigned char *next = NULL;
+
+    while ((buf = getSourceData(source, pos, 4)) != NULL) {
+        /* resync at the next marker, fill bytes belong to it */
+
+        if (buf[0] != 0xFF) {
+            length = (*source).size - pos;
+            if (length > SOURCE_READ_AHEAD) length = SOURCE_READ_AHEAD;
+
+            if ((buf = getSourceData(source, pos, length)) == NULL) break;
+
+            if ((next = memchr(buf, 0xFF, length)) == NULL)
+                pos = pos + length;
+            else
+                pos = pos + (next - buf);
+
+            continue;
+        }
+
+        if (buf[1] == 0xFF || buf[1] == 0x00) {
+            pos++;
+            continue;
+        }
+
+        marker = buf[1];
+
+        /* the metadata ends with the start of scan */
+
+        if (marker == JPG_MARKER_SOS || marker == JPG_MARKER_EOI) break;
+
+        /* restart and tem markers have no length */
+
+        if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01) {
+            pos = pos + 2;
+            continue;
+        }
+
+        segmentPos = pos + 4;
+        segmentEnd = pos + 2 + ((buf[2] << 8) | buf[3]);
+
+        if (segmentEnd < segmentPos) {
+            pos = pos + 2;
+            continue;
+        }
+
+        if (segmentEnd > (*source).size) segmentEnd = (*source).size;
+
+        segmentCount++;
+
+        if (marker == JPG_MARKER_APP1 && (*segments).exifMarkerPos == 0 &&
+            checkMarker(source, exifPrefix, EXIF_PREFIX_LENGTH, segmentPos) ==
+                1) {
+            (*segments).exifMarkerPos = pos;
+        } else if (marker == JPG_MARKER_APP1 && (*segments).xmpPos == 0 &&
+                   checkMarker(source, xmpHeader, XMP_HEADER_LENGTH,
+                               segmentPos) == 1) {
+            (*segments).xmpPos = segmentPos + XMP_HEADER_LENGTH;
+            (*segments).xmpEnd = segmentEnd;
+            (*segments).count++;
+        } else if (marker == JPG_MARKER_APP13 && (*segments).iptcPos == 0 &&
+                   checkMarker(source, photoshopHeader,
+                               PHOTOSHOP_HEADER_LENGTH, segmentPos) == 1) {
+            (*segments).iptcPos = segmentPos + PHOTOSHOP_HEADER_LENGTH;
+            (*segments).iptcEnd = segmentEnd;
+            (*segments).count++;
+        } else if (marker == JPG_MARKER_APP2 && (*segments).iccPos == 0 &&
+                   checkMarker(source, iccProfileHeader,
+                               ICC_PROFILE_HEADER_LENGTH, segmentPos) == 1 &&
+                   (buf = getSourceData(source,
+                                        segmentPos + ICC_PROFILE_HEADER_LENGTH,
+                                        2)) != NULL &&
+                   buf[0] == 1) {
+            // the header is in the chunk with sequence number one
+            (*segments).iccPos = segmentPos + ICC_PROFILE_HEADER_LENGTH + 2;
+            (*segments).iccEnd = segmentEnd;
+            (*segments).count++;
+        }
+
+        pos = segmentEnd;
+    }
+
+    debugger(context, 1, "segmentCount = %ld", segmentCount);
+
+    return segmentCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitMetaSegments                                                          */
+/* calls "visitor" with "visitorArg" for the xmp, iptc and icc items in the   */
+/* "segments" of "source". "tagCount" counts the tags visited so far. returns */
+/* 0 if successful, EXIF_VISIT_STOP if the visitor stopped the walk or a      */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int visitMetaSegments(struct exifContext *context,
+                                  struct exifSource *source,
+                                  struct metaSegments *segments,
+                                  long int *tagCount, exifTagHook visitor,
+                                  void *visitorArg) {
+    long int rc = 0;
+    long int length = 0;
+    unsigned char *data = NULL;
+
+    if ((length = (*segments).xmpEnd - (*segments).xmpPos) > 0 &&
+        (data = getSourceData(source, (*segments).xmpPos, length)) != NULL &&
+        (rc = visitXmpPacket(context, data, (*segments).xmpPos, length,
+                             tagCount, visitor, visitorArg)) != 0)
+        return rc;
+
+    if ((length = (*segments).iptcEnd - (*segments).iptcPos) > 0 &&
+        (data = getSourceData(source, (*segments).iptcPos, length)) != NULL &&
+        (rc = visitIptcResources(context, data, (*segments).iptcPos, length,
+                                 tagCount, visitor, visitorArg)) != 0)
+        return rc;
+
+    if ((length = (*segments).iccEnd - (*segments).iccPos) > 0 &&
+        (data = getSourceData(source, (*segments).iccPos, length)) != NULL &&
+        (rc = visitIccHeader(context, data, (*segments).iccPos, length,
+                             tagCount, visitor, visitorArg)) != 0)
+        return rc;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* getExifFormat                                                              */
+/* checks an exif header for intel/moto in "source" at position               */
+/* "exifMarkerPos". ifd0 does not have to follow the tiff header, files with  */
+/* a rewritten exif segment have it elsewhere. returns the type of the header */
+/* if successful or a negative value otherwise.                               */
+/* -------------------------------------------------------------------------- */
+
+static long int getExifFormat(struct exifSource *source,
+                              long int exifMarkerPos) {
+    long int prefixPos = exifMarkerPos + EXIF_MARKER_LENGTH + 2;
+
+    if (checkMarker(source, exifPrefix, EXIF_PREFIX_LENGTH, prefixPos) != 1)
+        return EXIF_ERR_INVALID_FORMAT;
+
+    return getTiffFormat(source, prefixPos + EXIF_PREFIX_LENGTH);
+}
+
+/* -------------------------------------------------------------------------- */
+/* getExifEnd                                                                 */
+/* returns the position after the app1 segment starting at "exifMarkerPos"    */
+/* in "source". the segment length is always big endian. returns a negative   */
+/* value in case of an error.                                                 */
+/* -------------------------------------------------------------------------- */
+
+static long int getExifEnd(struct exifSource *source, long int exifMarkerPos) {
+    unsigned char *buf = NULL;
+
+    if ((buf = getSourceData(source, exifMarkerPos + EXIF_MARKER_LENGTH, 2)) ==
+        NULL)
+        return EXIF_ERR_FILE_READ;
+
+    return exifMarkerPos + EXIF_MARKER_LENGTH + ((buf[0] << 8) | buf[1]);
+}
+
+/* -------------------------------------------------------------------------- */
+/* getTiffFormat                                                              */
+/* checks a tiff header for intel/moto in "source" at position "tiffPos".     */
+/* besides 42, the magic numbers of orf and rw2 raw files are accepted.       */
+/* returns the byte order if successful or a negative value otherwise.        */
+/* -------------------------------------------------------------------------- */
+
+static long int getTiffFormat(struct exifSource *source, long int tiffPos) {
+    long int exifFormat = 0;
+    long int magic = 0;
+    unsigned char *buf = NULL;
+
+    if ((buf = getSourceData(source, tiffPos, TIFF_HEADER_LENGTH)) == NULL)
+        return EXIF_ERR_FILE_READ;
+
+    if (buf[0] == 0x49 && buf[1] == 0x49)
+        exifFormat = EXIF_FORMAT_INTEL;
+
+    else if (buf[0] == 0x4D && buf[1] == 0x4D)
+        exifFormat = EXIF_FORMAT_MOTO;
+
+    else
+        return EXIF_ERR_INVALID_FORMAT;
+
+    magic = castUInt16(buf + 2, exifFormat);
 
-    else
+    if (magic != 0x002A && magic != 0x4F52 && magic != 0x5352 &&
+        magic != 0x0055)
         return EXIF_ERR_INVALID_FORMAT;
 
     return exifFormat;
 }
 
 /* -------------------------------------------------------------------------- */
-/* getIfdTagCount                                                             */
-/* returns the number of tags in an image file directory located in           */
-/* the file "fp" at position "ifdPos". if case of an error a negative value   */
-/* is returned.                                                               */
+/* getFirstIfd                                                                */
+/* returns the position of ifd0 from the tiff header in "source" at position  */
+/* "tiffPos". in case of an error a negative value is returned.               */
 /* -------------------------------------------------------------------------- */
 
-static long int getIfdTagCount(FILE *fp, long int ifdPos, long int exifFormat) {
-    long int tagCount = 0;
-    char buf[2] = "";
-
-    if (fseek(fp, ifdPos, SEEK_SET) != 0) return EXIF_ERR_FILE_READ;
-
-    if (fread(buf, 1, 2, fp) != 2) return EXIF_ERR_FILE_READ;
+static long int getFirstIfd(struct exifSource *source, long int tiffPos,
+                            long int exifFormat) {
+    unsigned char *buf = NULL;
 
-    tagCount = castUInt16(buf, exifFormat);
+    if ((buf = getSourceData(source, tiffPos + 4, 4)) == NULL)
+        return EXIF_ERR_FILE_READ;
 
-    return tagCount;
+    return tiffPos + castUInt32(buf, exifFormat);
 }
 
 /* -------------------------------------------------------------------------- */
-/* getIfdLink                                                                 */
-/* returns the link in an image file directory located in                     */
-/* the file "fp" at position "ifdPos" with "ifdTagsCount" tags. in case of    */
-/* an error a negative value is returned.                                     */
+/* getIfdTagCount                                                             */
+/* returns the number of tags in an image file directory located in           */
+/* "source" at position "ifdPos". if case of an error a negative value is     */
+/* returned.                                                                  */
 /* -------------------------------------------------------------------------- */
 
-static long int getIfdLink(FILE *fp, long int ifdPos, long int ifdTagCount,
-                           long int exifFormat) {
-    long int ifdLink = 0;
-    unsigned char buf[4] = "";
+static long int getIfdTagCount(struct exifSource *source, long int ifdPos,
+                               long int exifFormat) {
+    unsigned char *buf = NULL;
 
-    if (fseek(fp, ifdPos + IFD_HEADER_LENGTH + EXIF_TAG_LENGTH * ifdTagCount,
-              SEEK_SET) != 0)
+    if ((buf = getSourceData(source, ifdPos, 2)) == NULL)
         return EXIF_ERR_FILE_READ;
 
-    if (fread(buf, 1, 4, fp) != 4) return EXIF_ERR_FILE_READ;
-
-    ifdLink = castUInt32(buf, exifFormat);
-
-    return ifdLink;
+    return castUInt16(buf, exifFormat);
 }
 
 /* -------------------------------------------------------------------------- */
-/* getTagId                                                                   */
-/* returns the tag id of the exif tag in file "fp" at position "tagPos".      */
-/* in case of an error a negative value is returned.                          */
+/* getIfdLink                                                                 */
+/* returns the link in an image file directory located in "source" at         */
+/* position "ifdPos" with "ifdTagsCount" tags. in case of an error a          */
+/* negative value is returned.                                                */
 /* -------------------------------------------------------------------------- */
 
-static long int getTagID(FILE *fp, long int tagPos, long int exifFormat) {
-    long int tagID = 0;
-    unsigned char buf[2] = "";
-
-    if (fseek(fp, tagPos, SEEK_SET) != 0) return EXIF_ERR_FILE_READ;
-
-    if (fread(&buf, 1, 2, fp) != 2) return EXIF_ERR_FILE_READ;
+static long int getIfdLink(struct exifSource *source, long int ifdPos,
+                           long int ifdTagCount, long int exifFormat) {
+    unsigned char *buf = NULL;
 
-    tagID = castUInt16(buf, exifFormat);
+    if ((buf = getSourceData(
+             source, ifdPos + IFD_HEADER_LENGTH + EXIF_TAG_LENGTH * ifdTagCount,
+             4)) == NULL)
+        return EXIF_ERR_FILE_READ;
 
-    return tagID;
+    return castUInt32(buf, exifFormat);
 }
 
 /* -------------------------------------------------------------------------- */
-/* getTagType                                                                 */
-/* returns the tag type of the exif tag in file "fp" at position "tagPos".    */
+/* getTagId                                                                   */
+/* returns the tag id of the exif tag in "source" at position "tagPos".       */
 /* in case of an error a negative value is returned.                          */
 /* -------------------------------------------------------------------------- */
 
-static long int getTagType(FILE *fp, long int tagPos, long int exifFormat) {
-    long int tagType = 0;
-    unsigned char buf[2] = "";
-
-    if (fseek(fp, tagPos + 2, SEEK_SET) != 0) return EXIF_ERR_FILE_READ;
-
-    if (fread(&buf, 1, 2, fp) != 2) return EXIF_ERR_FILE_READ;
+static long int getTagID(struct exifSource *source, long int tagPos,
+                         long int exifFormat) {
+    unsigned char *buf = NULL;
 
-    tagType = castUInt16(buf, exifFormat);
+    if ((buf = getSourceData(source, tagPos, 2)) == NULL)
+        return EXIF_ERR_FILE_READ;
 
-    return tagType;
+    return castUInt16(buf, exifFormat);
 }
 
 /* -------------------------------------------------------------------------- */
-/* getTagTypeSize                                                             */
-/* returns the data type size of type "tagType". in case of an error a        */
-/* negative value is returned.                                                */
+/* getTagType                                                                 */
+/* returns the tag type of the exif tag in "source" at position "tagPos".     */
+/* in case of an error a negative value is returned.                          */
 /* -------------------------------------------------------------------------- */
 
-static long int getTagTypeSize(long int tagType) {
-    long int tagTypeSize = 0;
+static long int getTagType(struct exifSource *source, long int tagPos,
+                           long int exifFormat) {
+    unsigned char *buf = NULL;
 
-    switch (tagType) {
-        case 1:
-        case 6:
-            tagTypeSize = 1;
-            break;
-        case 2:
-        case 7:
-            tagTypeSize = 1;
-            break;
-        case 3:
-        case 8:
-            tagTypeSize = 2;
-            break;
-        case 4:
-        case 9:
-        case 11:
-            tagTypeSize = 4;
-            break;
-        case 5:
-        case 10:
-        case 12:
-            tagTypeSize = 8;
-            break;
-        default:
-            tagTypeSize = EXIF_ERR_TYPE_SIZE;
-            break;
-    }
+    if ((buf = getSourceData(source, tagPos + 2, 2)) == NULL)
+        return EXIF_ERR_FILE_READ;
 
-    return tagTypeSize;
+    return castUInt16(buf, exifFormat);
 }
 
 /* -------------------------------------------------------------------------- */
 /* getTagCount                                                                */
-/* returns the tag count of the exif tag in file "fp" at position "tagPos".   */
+/* returns the tag count of the exif tag in "source" at position "tagPos".    */
 /* in case of an error a negative value is returned.                          */
 /* -------------------------------------------------------------------------- */
 
-static long int getTagCount(FILE *fp, long int tagPos, long int exifFormat) {
-    long int tagCount = 0;
-    unsigned char buf[4] = "";
-
-    if (fseek(fp, tagPos + 4, SEEK_SET) != 0) return EXIF_ERR_FILE_READ;
-
-    if (fread(buf, 1, 4, fp) != 4) return EXIF_ERR_FILE_READ;
+static long int getTagCount(struct exifSource *source, long int tagPos,
+                            long int exifFormat) {
+    unsigned char *buf = NULL;
 
-    tagCount = castUInt32(buf, exifFormat);
+    if ((buf = getSourceData(source, tagPos + 4, 4)) == NULL)
+        return EXIF_ERR_FILE_READ;
 
-    return tagCount;
+    return castUInt32(buf, exifFormat);
 }
 
 /* -------------------------------------------------------------------------- */
 /* getTagDataPos                                                              */
-/* returns the data position of the exif tag in file "fp" at position         */
+/* returns the data position of the exif tag in "source" at position          */
 /* "tagPos" with tyoe size "tagTypeSize" and tag count "tagCount". uses       */
-/* "exifMarkerPos" to determine the actual position in the file, not the      */
-/* relative one. in case of an error a negative value  is returned.           */
+/* "tiffPos" to determine the actual position in the file, not the relative   */
+/* one. in case of an error a negative value  is returned.                    */
 /* -------------------------------------------------------------------------- */
 
-static long int getTagDataPos(FILE *fp, long int tagPos, long int exifFormat,
-                              long int tagTypeSize, long int tagCount,
-                              long int exifMarkerPos) {
-    long int tagDataPos = 0;
-    unsigned char buf[4] = "";
-
-    if (fseek(fp, tagPos + 8, SEEK_SET) != 0) return EXIF_ERR_FILE_READ;
-
-    if (tagTypeSize * tagCount <= 4) {
-        tagDataPos = tagPos + 8;
-    } else {
-        if (fread(buf, 1, 4, fp) != 4) return EXIF_ERR_FILE_READ;
-
-        tagDataPos = castUInt32(buf, exifFormat) + exifMarkerPos + 10;
-    }
-
-    return tagDataPos;
-}
-
-/* -------------------------------------------------------------------------- */
-/* getTagData                                                                 */
-/* reads the data of an exif tag in file "fp" at position "tagDataPos".       */
-/* the length of the data is given by "tagTypeSize" times "tagCount".         */
-/* writes the data to "tagData" and returns 0 if successful. Otherwise a      */
-/* negative value is returned.                                                */
-/* -------------------------------------------------------------------------- */
+static long int getTagDataPos(struct exifSource *source, long int tagPos,
+                              long int exifFormat, long int tagTypeSize,
+                              long int tagCount, long int tiffPos) {
+    unsigned char *buf = NULL;
 
-static long int getTagData(FILE *fp, long int tagDataPos, long int tagTypeSize,
-                           long int tagCount, unsigned char *tagData) {
-    if (fseek(fp, tagDataPos, SEEK_SET) != 0) return EXIF_ERR_FILE_READ;
+    if (tagTypeSize * tagCount <= 4) return tagPos + 8;
 
-    if (fread(tagData, tagTypeSize, tagCount, fp) != tagCount)
+    if ((buf = getSourceData(source, tagPos + 8, 4)) == NULL)
         return EXIF_ERR_FILE_READ;
 
-    return 0;
+    return castUInt32(buf, exifFormat) + tiffPos;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -459,67 +1590,48 @@ static long int getTagData(FILE *fp, long int tagDataPos, long int tagTypeSize,
 /* successful, otherwise a value smaller than 0 is returned.                  */
 /* -------------------------------------------------------------------------- */
 
-static long int allocateExifTable(struct exifItem **exifTable,
+static long int allocateExifTable(struct exifContext *context,
+                                  struct exifItem **exifTable,
                                   long int exifTableItemCount) {
-    if (exifTableItemCount == 0) {
-        if ((*exifTable = (struct exifItem *)malloc(sizeof(struct exifItem))) ==
-            NULL)
-            return EXIF_ERR_MALLOC;
-    } else {
-        if ((*exifTable = (struct exifItem *)realloc(
-                 *exifTable,
-                 sizeof(struct exifItem) * (exifTableItemCount + 1))) == NULL)
-            return EXIF_ERR_MALLOC;
-    }
-
-    return 0;
-}
+    struct exifItem *table = NULL;
 
-/* -------------------------------------------------------------------------- */
-/* allocateIfdQueue                                                           */
-/* allocates memory for a new queue item in an existing or new "ifdQueue".    */
-/* if "ifdQueue" is an existing table "ifdQueueItemCount" sould be greater    */
-/* than zero. the function allocates one more table item. returns 0 if        */
-/* successful, otherwise a value smaller than 0 is returned.                  */
-/* -------------------------------------------------------------------------- */
+    if ((table = (struct exifItem *)exifAllocate(
+             context, exifTableItemCount == 0 ? NULL : *exifTable,
+             sizeof(struct exifItem) * (exifTableItemCount + 1))) == NULL)
+        return EXIF_ERR_MALLOC;
 
-static long int allocateIfdQueue(struct queueItem **ifdQueue,
-                                 long int ifdQueueItemCount) {
-    if (ifdQueueItemCount == 0) {
-        if ((*ifdQueue =
-                 (struct queueItem *)malloc(sizeof(struct queueItem))) == NULL)
-            return EXIF_ERR_MALLOC;
-    } else {
-        if ((*ifdQueue = (struct queueItem *)realloc(
-                 *ifdQueue,
-                 sizeof(struct queueItem) * (ifdQueueItemCount + 1))) == NULL)
-            return EXIF_ERR_MALLOC;
-    }
+    *exifTable = table;
 
     return 0;
 }
 
 /* -------------------------------------------------------------------------- */
 /* addIfdToQueue                                                              */
-/* adds a new ifd position "ifdPos" with an ifd id "ifdID" to the ifd queue.  */
-/* returns 0 if successful or a negative value otherwise.                     */
+/* adds a new ifd position "ifdPos" with an ifd id "ifdID" to the ifd queue,  */
+/* which has room for the ifd limit of "context". the queue holds every ifd   */
+/* visited, so a position that is already queued is a loop. returns 0 if      */
+/* successful or a negative value otherwise.                                  */
 /* -------------------------------------------------------------------------- */
 
-static long int addIfdToQueue(struct queueItem **ifdQueue,
+static long int addIfdToQueue(struct exifContext *context,
+                              struct queueItem *ifdQueue,
                               long int *ifdQueueItemCount, long int ifdPos,
                               long int ifdID) {
-    long int rc = 0;
+    long int i = 0;
 
     long int itemNo = *ifdQueueItemCount;
 
-    /* create new queue item */
+    /* check for loops and the ifd limit */
+
+    for (i = 0; i < itemNo; i++)
+        if (ifdQueue[i].ifdPos == ifdPos) return EXIF_ERR_IFD_LOOP;
 
-    if ((rc = allocateIfdQueue(ifdQueue, itemNo)) < 0) return rc;
+    if (itemNo >= (*context).limits.maxIfds) return EXIF_ERR_LIMIT;
 
-    /* write exif format and ifd info */
+    /* write ifd info */
 
-    (*ifdQueue)[itemNo].ifdPos = ifdPos;
-    (*ifdQueue)[itemNo].ifdID = ifdID;
+    ifdQueue[itemNo].ifdPos = ifdPos;
+    ifdQueue[itemNo].ifdID = ifdID;
 
     /* increment queue item count */
 
@@ -529,27 +1641,25 @@ static long int addIfdToQueue(struct queueItem **ifdQueue,
 }
 
 /* -------------------------------------------------------------------------- */
-/* addItemToExifTable                                                         */
-/* adds a single tag item from file "fp" to "exifTable" which already         */
-/* contains "exifTableItemCount" items. the tag is specified by its           */
-/* position "tagPos". the "ifdID" will be attached to the item.               */
-/* if a known offset tag is identified, it will be added to the "ifdQueue"    */
-/* which already contains "ifdQueueItemCount" items. "exifMarkerPos" is used  */
-/* to determine the data position. returns 0 if successful or a negative      */
-/* value otherwise.                                                           */
+/* readExifItem                                                               */
+/* reads a single tag from "source" to "item". the tag is specified by its    */
+/* position "tagPos". the "ifdID" will be attached to the item and its tag    */
+/* data points into "source". if a known offset tag is identified, it will    */
+/* be added to the "ifdQueue" which already contains "ifdQueueItemCount"      */
+/* items. "tiffPos" is used to determine the data position, which must end    */
+/* before "exifEnd". returns 0 if successful, EXIF_TAG_SKIPPED for a tag      */
+/* without a value or with more data than the limit or a negative value       */
+/* otherwise.                                                                 */
 /* -------------------------------------------------------------------------- */
 
-static long int addItemToExifTable(struct exifItem **exifTable,
-                                   long int *exifTableItemCount, FILE *fp,
-                                   long int tagPos, long int ifdID,
-                                   long int exifMarkerPos, long int exifFormat,
-                                   struct queueItem **ifdQueue,
-                                   long int *ifdQueueItemCount) {
-    long int i = 0;
+static long int readExifItem(struct exifContext *context,
+                             struct exifSource *source, struct exifItem *item,
+                             long int tagPos, long int ifdID,
+                             long int tiffPos, long int exifEnd,
+                             long int exifFormat, struct queueItem *ifdQueue,
+                             long int *ifdQueueItemCount) {
     long int rc = 0;
 
-    long int itemNo = *exifTableItemCount;
-
     long int tagID = 0;
     long int tagType = 0;
     long int tagTypeSize = 0;
@@ -558,99 +1668,94 @@ static long int addItemToExifTable(struct exifItem **exifTable,
 
     long int offset = 0;
 
-    unsigned char *tagData = NULL;
-
-    /* create new table item */
-
-    if ((rc = allocateExifTable(exifTable, *exifTableItemCount)) < 0) return rc;
-
-    debugger(2, "adding exif item %ld", itemNo + 1);
-
     /* write tag position, format and ifd info */
 
-    (*exifTable)[itemNo].exifFormat = exifFormat;
-    (*exifTable)[itemNo].ifdID = ifdID;
-    (*exifTable)[itemNo].tagPos = tagPos;
+    (*item).exifFormat = exifFormat;
+    (*item).ifdID = ifdID;
+    (*item).tagPos = tagPos;
 
-    debugger(3, "exifFormat = %ld", exifFormat);
-    debugger(3, "ifdID = %ld", ifdID);
-    debugger(3, "tagPos = %ld", tagPos);
+    debugger(context, 3, "exifFormat = %ld", exifFormat);
+    debugger(context, 3, "ifdID = %ld", ifdID);
+    debugger(context, 3, "tagPos = %ld", tagPos);
 
     /* get and write tag id */
 
-    if ((tagID = getTagID(fp, tagPos, exifFormat)) < 0) return tagID;
+    if ((tagID = getTagID(source, tagPos, exifFormat)) < 0) return tagID;
 
-    debugger(3, "tagID = 0x%04x", tagID);
+    debugger(context, 3, "tagID = 0x%04x", tagID);
 
-    (*exifTable)[itemNo].tagID = tagID;
+    (*item).tagID = tagID;
 
     /* get and write tag type */
 
-    if ((tagType = getTagType(fp, tagPos, exifFormat)) < 0) return tagType;
+    if ((tagType = getTagType(source, tagPos, exifFormat)) < 0) return tagType;
 
-    (*exifTable)[itemNo].tagType = tagType;
+    (*item).tagType = tagType;
 
-    debugger(3, "tagType = %ld", tagType);
+    debugger(context, 3, "tagType = %ld", tagType);
 
     /* get and write tag type size */
 
     if ((tagTypeSize = getTagTypeSize(tagType)) < 0) return tagTypeSize;
 
-    (*exifTable)[itemNo].tagTypeSize = tagTypeSize;
+    (*item).tagTypeSize = tagTypeSize;
 
-    debugger(3, "tagTypeSize = %ld", tagTypeSize);
+    debugger(context, 3, "tagTypeSize = %ld", tagTypeSize);
 
     /* get and write tag count */
 
-    if ((tagCount = getTagCount(fp, tagPos, exifFormat)) < 0) return tagCount;
+    if ((tagCount = getTagCount(source, tagPos, exifFormat)) < 0)
+        return tagCount;
 
-    (*exifTable)[itemNo].tagCount = tagCount;
+    (*item).tagCount = tagCount;
 
-    debugger(3, "tagCount = %ld", tagCount);
+    debugger(context, 3, "tagCount = %ld", tagCount);
 
-    /* get and write tag data pos */
+    /* a tag without a value has nothing to format or cast */
 
-    if ((tagDataPos = getTagDataPos(fp, tagPos, exifFormat, tagTypeSize,
-                                    tagCount, exifMarkerPos)) < 0)
-        return tagDataPos;
+    if (tagCount == 0) return EXIF_TAG_SKIPPED;
 
-    (*exifTable)[itemNo].tagDataPos = tagDataPos;
+    /* icc, xmp or strip tables of a tiff file can exceed the limit. such a   */
+    /* tag is skipped and the rest of the file is still read.                 */
 
-    debugger(3, "tagDataPos = %ld", tagDataPos);
+    if (tagCount > (*context).limits.maxTagBytes / tagTypeSize) {
+        debugger(context, 2, "tag 0x%04x skipped, over the byte limit", tagID);
+        return EXIF_TAG_SKIPPED;
+    }
 
-    /* get and write tag data */
+    /* get and write tag data pos */
 
-    if (((*exifTable)[itemNo].tagData =
-             (unsigned char *)malloc(tagTypeSize * tagCount)) == NULL)
-        return EXIF_ERR_MALLOC;
+    if ((tagDataPos = getTagDataPos(source, tagPos, exifFormat, tagTypeSize,
+                                    tagCount, tiffPos)) < 0)
+        return tagDataPos;
 
-    if ((rc = getTagData(fp, tagDataPos, tagTypeSize, tagCount,
-                         (*exifTable)[itemNo].tagData)) < 0)
-        return rc;
+    (*item).tagDataPos = tagDataPos;
 
-    /* increment table item count */
+    debugger(context, 3, "tagDataPos = %ld", tagDataPos);
+
+    if (tagDataPos + tagTypeSize * tagCount > exifEnd) return EXIF_ERR_BOUNDS;
+
+    /* point to the tag data */
 
-    *exifTableItemCount = *exifTableItemCount + 1;
+    if (((*item).tagData = getSourceData(source, tagDataPos,
+                                         tagTypeSize * tagCount)) == NULL)
+        return EXIF_ERR_FILE_READ;
 
     /* add exitoffset and gpsinfo to ifd queue */
 
     if (tagID == 0x8769) {
-        offset = castUInt32((*exifTable)[itemNo].tagData, exifFormat);
+        offset = castUInt32((*item).tagData, exifFormat);
 
-        if ((rc =
-                 addIfdToQueue(ifdQueue, ifdQueueItemCount,
-                               offset + exifMarkerPos + 10,  // relative to TIFF
-                               IFD_ID_EXIFOFFSET)) < 0)
+        if ((rc = addIfdToQueue(context, ifdQueue, ifdQueueItemCount,
+                                offset + tiffPos, IFD_ID_EXIFOFFSET)) < 0)
             return rc;
     }
 
     if (tagID == 0x8825) {
-        offset = castUInt32((*exifTable)[itemNo].tagData, exifFormat);
+        offset = castUInt32((*item).tagData, exifFormat);
 
-        if ((rc =
-                 addIfdToQueue(ifdQueue, ifdQueueItemCount,
-                               offset + exifMarkerPos + 10,  // relative to TIFF
-                               IFD_ID_GPSINFO)) < 0)
+        if ((rc = addIfdToQueue(context, ifdQueue, ifdQueueItemCount,
+                                offset + tiffPos, IFD_ID_GPSINFO)) < 0)
             return rc;
     }
 
@@ -658,63 +1763,199 @@ static long int addItemToExifTable(struct exifItem **exifTable,
 }
 
 /* -------------------------------------------------------------------------- */
-/* addIfdToExifTable                                                          */
-/* adds a complete ifd from file "fp" to "exifTable" which already            */
-/* contains "exifTableItemCount" items. the ifd is specified by its           */
-/* position "ifdPos". the "ifdID" will be attached to all items.              */
-/* if the ifd contains a link, it will be added to the "ifdQueue"             */
-/* which already contains "ifdQueueItemCount" items. "exifMarkerPos" is used  */
-/* to determine the data position. returns 0 if successful or a negative      */
+/* planIfdReads                                                               */
+/* reads the "ifdTagCount" entries of the ifd at "ifdPos" of the read source  */
+/* "source" at once, then the values outside of them, sorted by position and  */
+/* merged if they are less than SOURCE_READ_GAP apart. values that are not    */
+/* valid are left to readExifItem. "tiffPos", "exifEnd" and "exifFormat" are  */
+/* used like there. returns the number of merged reads.                       */
+/* -------------------------------------------------------------------------- */
+
+static long int planIfdReads(struct exifContext *context,
+                             struct exifSource *source, long int ifdPos,
+                             long int ifdTagCount, long int tiffPos,
+                             long int exifEnd, long int exifFormat) {
+    long int i = 0;
+    long int readCount = 0;
+    long int extentCount = 0;
+    long int tagPos = 0;
+    long int tagTypeSize = 0;
+    long int tagCount = 0;
+    long int tagDataPos = 0;
+
+    struct sourceExtent *extents = NULL;
+    struct sourceExtent merged = {0, 0};
+
+    if (loadExifSource(source, ifdPos,
+                       IFD_HEADER_LENGTH + EXIF_TAG_LENGTH * ifdTagCount) < 0 ||
+        ifdTagCount == 0 ||
+        (extents = (struct sourceExtent *)exifAllocate(
+             context, NULL, sizeof(struct sourceExtent) * ifdTagCount)) ==
+            NULL)
+        return 0;
+
+    /* collect the values outside of the entries */
+
+    for (i = 0; i < ifdTagCount; i++) {
+        tagPos = ifdPos + IFD_HEADER_LENGTH + EXIF_TAG_LENGTH * i;
+
+        if ((tagTypeSize = getTagTypeSize(
+                 getTagType(source, tagPos, exifFormat))) <= 0 ||
+            (tagCount = getTagCount(source, tagPos, exifFormat)) < 0 ||
+            tagCount > (*context).limits.maxTagBytes / tagTypeSize ||
+            tagTypeSize * tagCount <= 4)
+            continue;
+
+        tagDataPos = getTagDataPos(source, tagPos, exifFormat, tagTypeSize,
+                                   tagCount, tiffPos);
+
+        if (tagDataPos < 0 || tagDataPos + tagTypeSize * tagCount > exifEnd)
+            continue;
+
+        extents[extentCount].pos = tagDataPos;
+        extents[extentCount].end = tagDataPos + tagTypeSize * tagCount;
+        extentCount++;
+    }
+
+    /* merge close values and read them */
+
+    qsort(extents, extentCount, sizeof(struct sourceExtent),
+          compareSourceExtents);
+
+    for (i = 0; i < extentCount; i++) {
+        if (i > 0 && extents[i].pos <= merged.end + SOURCE_READ_GAP) {
+            if (extents[i].end > merged.end) merged.end = extents[i].end;
+            continue;
+        }
+
+        if (i > 0) {
+            loadExifSource(source, merged.pos, merged.end - merged.pos);
+            readCount++;
+        }
+
+        merged = extents[i];
+    }
+
+    if (extentCount > 0) {
+        loadExifSource(source, merged.pos, merged.end - merged.pos);
+        readCount++;
+    }
+
+    exifRelease(context, extents);
+
+    return readCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* compareSourceExtents                                                       */
+/* qsort callback for planIfdReads.                                           */
+/* -------------------------------------------------------------------------- */
+
+static int compareSourceExtents(const void *a, const void *b) {
+    struct sourceExtent *extentA = (struct sourceExtent *)a;
+    struct sourceExtent *extentB = (struct sourceExtent *)b;
+
+    if ((*extentA).pos != (*extentB).pos)
+        return (*extentA).pos < (*extentB).pos ? -1 : 1;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitIfd                                                                   */
+/* reads a complete ifd from "source" and calls "visitor" for all of its      */
+/* tags. the ifd is specified by its position "ifdPos". the "ifdID" will be   */
+/* attached to all items. if the ifd contains a link, it will be added to     */
+/* the "ifdQueue" which already contains "ifdQueueItemCount" items.           */
+/* "tiffPos" is used to determine the data position, the ifd must end before  */
+/* "exifEnd". "tagCount" counts the tags visited so far. returns 0 if         */
+/* successful, EXIF_VISIT_STOP if the visitor stopped the walk or a negative  */
 /* value otherwise.                                                           */
 /* -------------------------------------------------------------------------- */
 
-static long int addIfdToExifTable(struct exifItem **exifTable,
-                                  long int *exifTableItemCount, FILE *fp,
-                                  long int ifdPos, long int ifdID,
-                                  long int exifMarkerPos, long int exifFormat,
-                                  struct queueItem **ifdQueue,
-                                  long int *ifdQueueItemCount) {
+static long int visitIfd(struct exifContext *context, struct exifSource *source,
+                         long int ifdPos, long int ifdID,
+                         long int tiffPos, long int exifEnd,
+                         long int exifFormat, struct queueItem *ifdQueue,
+                         long int *ifdQueueItemCount, long int *tagCount,
+                         exifTagHook visitor, void *visitorArg) {
     long int rc = 0;
     long int i = 0;
     long int ifdTagCount = 0;
     long int ifdLink = 0;
+    long int ifdReads = 0;
     long int tagPos = 0;
 
-    debugger(2, "ifdPos = %ld", ifdPos);
+    struct exifItem item;
+
+    debugger(context, 2, "ifdPos = %ld", ifdPos);
 
     /* get number of tags in image file directory */
 
-    if ((ifdTagCount = getIfdTagCount(fp, ifdPos, exifFormat)) < 0)
+    if ((ifdTagCount = getIfdTagCount(source, ifdPos, exifFormat)) < 0)
         return ifdTagCount;
 
-    debugger(2, "ifdTagCount = %ld", ifdTagCount);
+    debugger(context, 2, "ifdTagCount = %ld", ifdTagCount);
+
+    if (ifdPos + IFD_HEADER_LENGTH + EXIF_TAG_LENGTH * ifdTagCount > exifEnd)
+        return EXIF_ERR_BOUNDS;
+
+    if (*tagCount + ifdTagCount > (*context).limits.maxTags)
+        return EXIF_ERR_LIMIT;
+
+    /* a read source gets the values of the ifd in a few large reads */
+
+    if ((*source).fd >= 0) {
+        ifdReads = planIfdReads(context, source, ifdPos, ifdTagCount, tiffPos,
+                                exifEnd, exifFormat);
 
-    /* get link to next image file directory */
+        debugger(context, 2, "ifdReads = %ld", ifdReads);
+    }
+
+    /* get link to next image file directory - a missing link ends the chain */
 
-    if ((ifdLink = getIfdLink(fp, ifdPos, ifdTagCount, exifFormat)) < 0)
+    if (ifdPos + IFD_HEADER_LENGTH + EXIF_TAG_LENGTH * ifdTagCount + 4 >
+        exifEnd)
+        ifdLink = 0;
+    else if ((ifdLink = getIfdLink(source, ifdPos, ifdTagCount, exifFormat)) <
+             0)
         return ifdLink;
 
-    debugger(2, "ifdLink = %ld", ifdLink);
+    debugger(context, 2, "ifdLink = %ld", ifdLink);
 
     /* add link to ifd queue */
 
     if (ifdLink > 0) {
-        if ((rc = addIfdToQueue(ifdQueue, ifdQueueItemCount,
-                                ifdLink + exifMarkerPos + 10, ifdID)) <
-            0)  // relative to TIFF
+        if ((rc = addIfdToQueue(context, ifdQueue, ifdQueueItemCount,
+                                ifdLink + tiffPos, ifdID)) < 0)
             return rc;
     }
 
-    /* add items to exif table */
+    /* visit tags */
 
     tagPos = ifdPos + 2;
 
     for (i = 0; i < ifdTagCount; i++) {
-        if ((rc = addItemToExifTable(exifTable, exifTableItemCount, fp, tagPos,
-                                     ifdID, exifMarkerPos, exifFormat, ifdQueue,
-                                     ifdQueueItemCount)) < 0)
+        debugger(context, 2, "visiting exif item %ld", *tagCount + 1);
+
+        if ((rc = readExifItem(context, source, &item, tagPos, ifdID,
+                               tiffPos, exifEnd, exifFormat, ifdQueue,
+                               ifdQueueItemCount)) < 0)
             return rc;
 
+        if (rc == EXIF_TAG_SKIPPED) {
+            tagPos = tagPos + 12;
+            continue;
+        }
+
+        *tagCount = *tagCount + 1;
+
+        countStat(tagsVisited, 1);
+
+        if ((rc = visitor(&item, visitorArg)) < 0) return rc;
+
+        if (rc > 0) return EXIF_VISIT_STOP;
+
         tagPos = tagPos + 12;
     }
 
@@ -722,21 +1963,218 @@ static long int addIfdToExifTable(struct exifItem **exifTable,
 }
 
 /* -------------------------------------------------------------------------- */
+/* noteMakerNote                                                              */
+/* visitor of visitExifInfo if maker notes are decoded. notes the make and    */
+/* the maker note in the makerNoteVisit "arg" and passes "item" on to its     */
+/* visitor. returns the result of that visitor.                               */
+/* -------------------------------------------------------------------------- */
+
+static long int noteMakerNote(struct exifItem *item, void *arg) {
+    struct makerNoteVisit *makerNote = (struct makerNoteVisit *)arg;
+
+    if ((*item).tagID == 0x010f && (*item).ifdID == IFD_ID_IFD &&
+        (*makerNote).make == NULL) {
+        (*makerNote).make = (*item).tagData;
+        (*makerNote).makeLength = (*item).tagCount;
+    }
+
+    if ((*item).tagID == 0x927c && (*item).ifdID == IFD_ID_EXIFOFFSET &&
+        (*makerNote).makerNoteLength == 0) {
+        (*makerNote).makerNotePos = (*item).tagDataPos;
+        (*makerNote).makerNoteLength = (*item).tagTypeSize * (*item).tagCount;
+    }
+
+    return (*makerNote).visitor(item, (*makerNote).visitorArg);
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitMakerNotes                                                            */
+/* decodes the maker note noted in "makerNote" with the exif data of "source" */
+/* from the tiff header at "tiffPos" to "exifEnd" in byte order "exifFormat". */
+/* only the maker note is loaded here, visitMakerNote loads the vendor ifds   */
+/* and values it needs, so a raw file is not read up to "exifEnd". "tagCount" */
+/* counts the tags visited so far. returns like visitMakerNote.               */
+/* -------------------------------------------------------------------------- */
+
+static long int visitMakerNotes(struct exifContext *context,
+                                struct exifSource *source, long int tiffPos,
+                                long int exifEnd, long int exifFormat,
+                                struct makerNoteVisit *makerNote,
+                                long int *tagCount) {
+    long int notePos = (*makerNote).makerNotePos;
+    long int noteLength = (*makerNote).makerNoteLength;
+    unsigned char *data = NULL;
+
+    if (notePos < tiffPos || noteLength > exifEnd - notePos ||
+        getSourceData(source, notePos, noteLength) == NULL ||
+        (data = getSourceData(source, tiffPos, 0)) == NULL)
+        return 0;
+
+    return visitMakerNote(context, data, tiffPos, exifEnd - tiffPos,
+                          exifFormat, makerNote, tagCount);
+}
+
+/* -------------------------------------------------------------------------- */
+/* findPreviewHook                                                            */
+/* visitor of findExifPreview. collects the preview tags of each ifd in the   */
+/* previewVisit "arg", which are sorted by tag id, and queues the sub ifds.   */
+/* an ifd starts wherever a tag does not follow the one before. returns 0.    */
+/* -------------------------------------------------------------------------- */
+
+static long int findPreviewHook(struct exifItem *item, void *arg) {
+    long int i = 0;
+    long int value = getPreviewValue(item);
+
+    struct previewVisit *visit = (struct previewVisit *)arg;
+
+    if ((*item).tagPos != (*visit).lastTagPos + EXIF_TAG_LENGTH) {
+        (*visit).subfileType = 0;
+        (*visit).compression = 0;
+        (*visit).stripPos = -1;
+        (*visit).jpgPos = -1;
+    }
+
+    (*visit).lastTagPos = (*item).tagPos;
+
+    if ((*item).tagID == 0x00fe)
+        (*visit).subfileType = value;
+    else if ((*item).tagID == 0x0103)
+        (*visit).compression = value;
+    else if ((*item).tagID == 0x0111 && (*item).tagCount == 1)
+        (*visit).stripPos = value;
+    else if ((*item).tagID == 0x0117 && (*item).tagCount == 1 &&
+             (*visit).stripPos >= 0 &&
+             ((*visit).compression == 6 ||
+              ((*visit).compression == 7 && (*visit).subfileType == 1)))
+        addPreviewCandidate(visit, (*visit).stripPos, value);
+    else if ((*item).tagID == 0x0201)
+        (*visit).jpgPos = value;
+    else if ((*item).tagID == 0x0202 && (*visit).jpgPos >= 0)
+        addPreviewCandidate(visit, (*visit).jpgPos, value);
+
+    /* sub ifds of raw files - a broken one is skipped */
+
+    if ((*item).tagID == 0x014a &&
+        ((*item).tagType == 4 || (*item).tagType == 13))
+        for (i = 0; i < (*item).tagCount; i++)
+            addIfdToQueue((*visit).context, (*visit).ifdQueue,
+                          (*visit).ifdQueueItemCount,
+                          castUInt32((*item).tagData + i * 4,
+                                     (*item).exifFormat) +
+                              (*visit).tiffPos,
+                          IFD_ID_IFD);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* getPreviewValue                                                            */
+/* returns the first short or long value of "item", or -1 for other types.    */
+/* -------------------------------------------------------------------------- */
+
+static long int getPreviewValue(struct exifItem *item) {
+    if ((*item).tagType == 3)
+        return castUInt16((*item).tagData, (*item).exifFormat);
+
+    if ((*item).tagType == 4)
+        return castUInt32((*item).tagData, (*item).exifFormat);
+
+    return -1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* addPreviewCandidate                                                        */
+/* keeps the preview of "length" bytes at offset "pos" from the tiff header   */
+/* in the previewVisit "visit" if it lies in the exif data, starts with the   */
+/* soi marker and is the largest one so far.                                  */
+/* -------------------------------------------------------------------------- */
+
+static void addPreviewCandidate(struct previewVisit *visit, long int pos,
+                                long int length) {
+    unsigned char *data = NULL;
+
+    if (pos < 0 || length <= SOI_MARKER_LENGTH ||
+        length <= (*(*visit).preview).length)
+        return;
+
+    pos = pos + (*visit).tiffPos;
+
+    if (pos > (*visit).exifEnd - length) return;
+
+    if ((data = getSourceData((*visit).source, pos, SOI_MARKER_LENGTH)) ==
+            NULL ||
+        data[0] != 0xFF || data[1] != 0xD8)
+        return;
+
+    (*(*visit).preview).pos = pos;
+    (*(*visit).preview).length = length;
+}
+
+/* -------------------------------------------------------------------------- */
+/* addItemToExifTable                                                         */
+/* visitor of extractExifInfoContext. copies "item" with its tag data to the  */
+/* table of the tableVisit "arg" and calls its hook. returns the result of    */
+/* the hook if successful or a negative value otherwise.                      */
+/* -------------------------------------------------------------------------- */
+
+static long int addItemToExifTable(struct exifItem *item, void *arg) {
+    long int rc = 0;
+
+    struct tableVisit *visit = (struct tableVisit *)arg;
+    struct exifContext *context = (*visit).context;
+    long int itemNo = (*visit).exifTableItemCount;
+    long int tagDataLength = (*item).tagTypeSize * (*item).tagCount;
+    unsigned char *tagData = NULL;
 
-void debugger(int debugLevel, char *fmt, ...) {
-    if (debugLevel <= debug) {
-        va_list va;
+    /* create new table item */
 
-        fprintf(stderr, "[DBG] ");
+    if ((rc = allocateExifTable(context, &(*visit).exifTable, itemNo)) < 0)
+        return rc;
 
-        va_start(va, fmt);
+    (*visit).exifTable[itemNo] = *item;
 
-        vfprintf(stderr, fmt, va);
+    /* copy tag data - the maker note blob is only recorded by position and */
+    /* length, its tags are decoded on request                              */
 
-        va_end(va);
+    if ((*item).tagID != 0x927c || (*item).tagType != 7) {
+        if ((tagData = (unsigned char *)exifAllocate(context, NULL,
+                                                     tagDataLength)) == NULL)
+            return EXIF_ERR_MALLOC;
 
-        fprintf(stderr, "\n");
+        memcpy(tagData, (*item).tagData, tagDataLength);
     }
+
+    (*visit).exifTable[itemNo].tagData = tagData;
+
+    /* increment table item count */
+
+    (*visit).exifTableItemCount = itemNo + 1;
+
+    if ((*visit).hook == NULL) return 0;
+
+    return (*visit).hook(&(*visit).exifTable[itemNo], (*visit).hookArg);
+}
+
+/* -------------------------------------------------------------------------- */
+/* logMessage                                                                 */
+/* formats a debug message of "level" and passes it to the logger of          */
+/* "context" or prints it to stderr if there is none.                         */
+/* -------------------------------------------------------------------------- */
+
+void logMessage(struct exifContext *context, int level, char *fmt, ...) {
+    char message[EXIF_LOG_LENGTH];
+    va_list va;
+
+    va_start(va, fmt);
+
+    vsnprintf(message, sizeof(message), fmt, va);
+
+    va_end(va);
+
+    if ((*context).log != NULL)
+        (*context).log((*context).logArg, level, message);
+    else
+        fprintf(stderr, "[DBG] %s\n", message);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -8,8 +8,17 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
+
+#include "exifapi.h"
+#include "exifprogress.h"
+#include "exifstats.h"
+#include "exiftrace.h"
 
 /* -------------------------------------------------------------------------- */
 /* info box                                                                   */
@@ -44,6 +53,81 @@
 /*       ID   |TYPE |COUNT      |DATA OR                                      */
 /*            |     |           |LINK TO DATA                                 */
 /*                                                                            */
+/*    5) A file is mapped into memory as an exif source and the ifds are      */
+/*       walked there. visitExifInfo calls a visitor for every tag with an    */
+/*       item whose tag data points into the source, so nothing is copied.    */
+/*       The item is only valid until the source is closed.                   */
+/*       extractExifInfo is a visitor that copies every item into a table.    */
+/*                                                                            */
+/*    6) The first bytes of a file tell its format. A jpg file starts with    */
+/*       the soi marker FF-D8. A tiff file starts with a tiff header at       */
+/*       offset 0, and so do the raw formats built on tiff (dng, nef, cr2,    */
+/*       arw, orf, rw2). Their ifds are walked like the ones in app1.         */
+/*       All offsets are relative to the tiff header at "tiffPos". The        */
+/*       exif data ends at "exifEnd": the end of app1 in a jpg file, or the   */
+/*       end of the file for tiff. Other formats are rejected without a       */
+/*       search.                                                              */
+/*                                                                            */
+/*       49-49-2A-00-XX-XX-XX-XX   4D-4D-00-2A-XX-XX-XX-XX                    */
+/*       II   |42   |LINK TO IFD0  MM   |42   |LINK TO IFD0                   */
+/*                                                                            */
+/*    7) A heif file (heic, avif) is a tree of boxes. A box starts with its   */
+/*       size and type, both big endian. Only the boxes on the way to the     */
+/*       exif item are read, the image data in between is skipped:            */
+/*                                                                            */
+/*       ftyp            brands, checked for a heif brand                     */
+/*       meta/iinf/infe  item infos, the item of type "Exif" gives its id     */
+/*       meta/iloc       item locations, the id gives offset and length       */
+/*       meta/idat       item data for construction method 1                  */
+/*                                                                            */
+/*       The exif item starts with the offset of the tiff header after a      */
+/*       4 byte prefix, usually 6 for "Exif\0\0":                             */
+/*                                                                            */
+/*       00-00-00-06|45-78-69-66-00-00|49-49-2A-00-08-00-00-00                */
+/*       OFFSET     |EXIF             |TIFF-HEADER                            */
+/*                                                                            */
+/*    8) A png file is a signature followed by chunks, a webp file a riff     */
+/*       header followed by chunks. The chunks are walked by their lengths,   */
+/*       so the image data is never read. The data of the exif chunk is the   */
+/*       tiff structure, sometimes with "Exif\0\0" in front:                  */
+/*                                                                            */
+/*       png:  XX-XX-XX-XX|65-58-49-66|DATA|XX-XX-XX-XX                       */
+/*             LENGTH (BE)|eXIf       |    |CRC                               */
+/*                                                                            */
+/*       webp: 45-58-49-46|XX-XX-XX-XX|DATA|00 IF LENGTH IS ODD               */
+/*             EXIF       |LENGTH (LE)|    |                                  */
+/*                                                                            */
+/*    9) The segments of a jpg file are walked once by their lengths up to    */
+/*       the start of scan, so the image data is never read. Besides app1     */
+/*       with exif, the walk notes app1 with xmp, app13 with iptc and app2    */
+/*       with the first icc chunk. They are visited after the ifds, see       */
+/*       exifmeta.h, and a jpg file with only them is not an error.           */
+/*                                                                            */
+/*       FF-D8|FF-E0-HL-LL|...|FF-E1-HL-LL|...|FF-DA|IMAGE DATA               */
+/*       SOI  |APP0 LENGTH|   |APP1 LENGTH|   |SOS  |                         */
+/*                                                                            */
+/*   10) An embedded jpg preview is given by an offset and a length tag in    */
+/*       the same ifd. findExifPreview walks ifd0, its links (ifd1 with the   */
+/*       thumbnail) and the sub ifds of raw files, and returns the largest    */
+/*       one that starts with FF-D8. Only its position is returned, the data  */
+/*       is copied by the caller:                                             */
+/*                                                                            */
+/*       0x0201/0x0202  JPEGInterchangeFormat and its length                  */
+/*       0x0111/0x0117  one strip with compression 6 (old jpeg), or 7 (jpeg)  */
+/*                      in a reduced resolution ifd (NewSubfileType 1)        */
+/*                                                                            */
+/*   11) A file that can not be mapped, e.g. on a fuse mount, or any file     */
+/*       if the context has readFiles set, is read with pread into a          */
+/*       buffer as large as the file, so tag data still points into the       */
+/*       source. Pages are read on first use, at least SOURCE_READ_AHEAD      */
+/*       bytes at a time. Before the tags of an ifd are read, its entries     */
+/*       are read in one piece and the values outside of them are sorted      */
+/*       by position. Values less than SOURCE_READ_GAP apart are merged,      */
+/*       so the values of an ifd take a few large reads, not one each:        */
+/*                                                                            */
+/*       IFD|...|VALUE 3|VALUE 1|.........|VALUE 2|                           */
+/*          |   |<-- read 1 --->| (gap)   |read 2 |                           */
+/*                                                                            */
 /*                                                                            */
 /* -------------------------------------------------------------------------- */
 /* definitions                                                                */
@@ -53,30 +137,72 @@
 #define EXIF_MARKER_LENGTH 2
 #define EXIF_HEADER_LENGTH 14
 #define IFD_HEADER_LENGTH 2
+#define TIFF_HEADER_LENGTH 8
+#define BOX_HEADER_LENGTH 8
+#define EXIF_PREFIX_LENGTH 6
+#define PNG_SIGNATURE_LENGTH 8
+#define RIFF_MARKER_LENGTH 4
+#define RIFF_HEADER_LENGTH 12
+#define HEIF_BRAND_COUNT 6
 #define EXIF_TAG_LENGTH 12
+#define XMP_HEADER_LENGTH 29
+#define PHOTOSHOP_HEADER_LENGTH 14
+#define ICC_PROFILE_HEADER_LENGTH 12
+
+#define JPG_MARKER_APP1 0xE1
+#define JPG_MARKER_APP2 0xE2
+#define JPG_MARKER_APP13 0xED
+#define JPG_MARKER_SOS 0xDA
+#define JPG_MARKER_EOI 0xD9
 
 #define EXIF_FORMAT_INTEL 1
 #define EXIF_FORMAT_MOTO 2
 
-#define EXIF_ERR_FILE_OPEN -701
-#define EXIF_ERR_NO_JPG -702
-#define EXIF_ERR_NO_EXIF -703
-#define EXIF_ERR_EXIF_FORMAT -704
-#define EXIF_ERR_IFD_QUEUE -705
-#define EXIF_ERR_ADD_IFD -706
+#define EXIF_FILE_JPG 1
+#define EXIF_FILE_TIFF 2
+#define EXIF_FILE_HEIF 3
+#define EXIF_FILE_PNG 4
+#define EXIF_FILE_WEBP 5
 
-#define EXIF_ERR_FILE_READ -707
-#define EXIF_ERR_MARKER -708
-#define EXIF_ERR_INVALID_FORMAT -709
-#define EXIF_ERR_MALLOC -710
-#define EXIF_ERR_TYPE_SIZE -711
+#define SOURCE_PAGE_SIZE 4096
+#define SOURCE_READ_AHEAD (64L * 1024)
+#define SOURCE_READ_GAP (32L * 1024)
+
+/* the error codes the api returns are defined in exifapi.h */
 
 #define EXIF_ERR_PATTERN -712
 #define EXIF_ERR_PATTERN_NOMATCH -713
+#define EXIF_ERR_NO_GPS -714
+#define EXIF_ERR_NO_TIME -715
+#define EXIF_FILTERED -716
+#define EXIF_ERR_NO_PREVIEW -721
+
+#define EXIF_DEFAULT_MAX_IFDS 16
+#define EXIF_DEFAULT_MAX_TAGS 2048
+#define EXIF_DEFAULT_MAX_TAG_BYTES 65536
+
+#define EXIF_LOG_LENGTH 256
+
+/* readExifItem skips a tag without failing the file */
+
+#define EXIF_TAG_SKIPPED 2
+
+/* debug output costs a compare when it is off - the arguments are not        */
+/* evaluated.                                                                 */
+
+#define debugger(context, debugLevel, ...)                                  \
+    do {                                                                    \
+        if ((debugLevel) <= (*(context)).logLevel)                          \
+            logMessage((context), (debugLevel), __VA_ARGS__);               \
+    } while (0)
 
 #define IFD_ID_IFD 1
 #define IFD_ID_EXIFOFFSET 2
 #define IFD_ID_GPSINFO 3
+#define IFD_ID_XMP 4
+#define IFD_ID_IPTC 5
+#define IFD_ID_ICC 6
+#define IFD_ID_MAKERNOTE 7
 
 /* -------------------------------------------------------------------------- */
 /* structs                                                                    */
@@ -96,32 +222,141 @@ struct exifItem {
     unsigned char *tagData;
 };
 
+typedef long int (*exifTagHook)(struct exifItem *item, void *arg);
+
+struct exifLimits {
+    long int maxIfds;
+    long int maxTags;
+    long int maxTagBytes;
+};
+
+struct exifContext {
+    struct exifLimits limits;
+    exifAllocFunction alloc;
+    void *allocArg;
+    exifLogFunction log;
+    void *logArg;
+    int logLevel;
+    int makerNotes;
+    int readFiles;
+};
+
+struct exifSource {
+    char *fileName;
+    unsigned char *data;
+    long int size;
+    long int readEnd;
+    long int spanStart;
+    int mapped;
+    int fd;
+    unsigned char *pageMap;
+};
+
+struct tableVisit {
+    struct exifContext *context;
+    struct exifItem *exifTable;
+    long int exifTableItemCount;
+    exifTagHook hook;
+    void *hookArg;
+};
+
+struct exifResult {
+    struct exifContext *context;
+    struct exifItem *exifTable;
+    long int exifTableItemCount;
+};
+
+struct apiVisit {
+    exifVisitFunction visit;
+    void *visitArg;
+};
+
 struct queueItem {
     long int ifdPos;
     long int ifdID;
 };
 
+struct makerNoteVisit {
+    exifTagHook visitor;
+    void *visitorArg;
+    long int makerNotePos;
+    long int makerNoteLength;
+    unsigned char *make;
+    long int makeLength;
+    struct exifSource *source;
+};
+
+struct exifPreview {
+    long int pos;
+    long int length;
+};
+
+struct previewVisit {
+    struct exifContext *context;
+    struct exifSource *source;
+    struct queueItem *ifdQueue;
+    long int *ifdQueueItemCount;
+    long int tiffPos;
+    long int exifEnd;
+    long int lastTagPos;
+    long int subfileType;
+    long int compression;
+    long int stripPos;
+    long int jpgPos;
+    struct exifPreview *preview;
+};
+
+struct sourceExtent {
+    long int pos;
+    long int end;
+};
+
+struct metaSegments {
+    long int exifMarkerPos;
+    long int xmpPos;
+    long int xmpEnd;
+    long int iptcPos;
+    long int iptcEnd;
+    long int iccPos;
+    long int iccEnd;
+    long int count;
+};
+
 /* -------------------------------------------------------------------------- */
 /* exif markers                                                               */
 /* -------------------------------------------------------------------------- */
 
 static unsigned char soiMarker[SOI_MARKER_LENGTH] = {0xFF, 0xD8};
 
-static unsigned char exifMarker[EXIF_MARKER_LENGTH] = {0xFF, 0xE1};
+static unsigned char exifPrefix[EXIF_PREFIX_LENGTH] = {0x45, 0x78, 0x69,
+                                                       0x66, 0x00, 0x00};
 
-static unsigned char exifHeaderIntel[EXIF_HEADER_LENGTH] = {
-    0x45, 0x78, 0x69, 0x66, 0x00, 0x00, 0x49,
-    0x49, 0x2A, 0x00, 0x08, 0x00, 0x00, 0x00};
+static unsigned char xmpHeader[XMP_HEADER_LENGTH] =
+    "http://ns.adobe.com/xap/1.0/";
 
-static unsigned char exifHeaderMoto[EXIF_HEADER_LENGTH] = {
-    0x45, 0x78, 0x69, 0x66, 0x00, 0x00, 0x4D,
-    0x4D, 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08};
+static unsigned char photoshopHeader[PHOTOSHOP_HEADER_LENGTH] =
+    "Photoshop 3.0";
+
+static unsigned char iccProfileHeader[ICC_PROFILE_HEADER_LENGTH] =
+    "ICC_PROFILE";
+
+static unsigned char pngSignature[PNG_SIGNATURE_LENGTH] = {
+    0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
+
+static unsigned char riffMarker[RIFF_MARKER_LENGTH] = {0x52, 0x49, 0x46, 0x46};
+
+static unsigned char webpMarker[RIFF_MARKER_LENGTH] = {0x57, 0x45, 0x42, 0x50};
+
+static char heifBrands[HEIF_BRAND_COUNT][5] = {"mif1", "msf1", "heic",
+                                               "heix", "avif", "avis"};
 
 /* -------------------------------------------------------------------------- */
 /* extern variables                                                           */
 /* -------------------------------------------------------------------------- */
 
-extern int debug;
+extern struct exifContext exifDefaultContext;
+
+extern long int exifBytesRead;
 
 /* -------------------------------------------------------------------------- */
 /* public functions                                                           */
@@ -129,6 +364,43 @@ extern int debug;
 
 long int extractExifInfo(char *fileName, struct exifItem **exifTable);
 
+long int extractExifInfoHook(char *fileName, struct exifItem **exifTable,
+                             exifTagHook hook, void *hookArg);
+
+long int extractExifInfoContext(struct exifContext *context, char *fileName,
+                                struct exifItem **exifTable, exifTagHook hook,
+                                void *hookArg);
+
+long int openExifSource(struct exifContext *context, char *fileName,
+                        struct exifSource *source);
+
+void openExifMemory(struct exifSource *source, unsigned char *data,
+                    long int size);
+
+void closeExifSource(struct exifSource *source);
+
+long int loadExifSource(struct exifSource *source, long int pos,
+                        long int length);
+
+long int visitExifInfo(struct exifContext *context, struct exifSource *source,
+                       exifTagHook visitor, void *visitorArg);
+
+long int findExifPreview(struct exifContext *context,
+                         struct exifSource *source,
+                         struct exifPreview *preview);
+
+void freeExifTable(struct exifItem *exifTable, long int exifTableItemCount);
+
+void freeExifTableContext(struct exifContext *context,
+                          struct exifItem *exifTable,
+                          long int exifTableItemCount);
+
+void *exifAllocate(struct exifContext *context, void *ptr, size_t size);
+
+void exifRelease(struct exifContext *context, void *ptr);
+
+long int getTagTypeSize(long int tagType);
+
 long int castUInt8(unsigned char *bytes, long int exifFormat);
 
 long int castUInt16(unsigned char *bytes, long int exifFormat);
@@ -137,65 +409,147 @@ long int castUInt32(unsigned char *bytes, long int exifFormat);
 
 long int castInt32(unsigned char *bytes, long int exifFormat);
 
-void debugger(int debugLevel, char *fmt, ...);
+void logMessage(struct exifContext *context, int level, char *fmt, ...);
 
 /* -------------------------------------------------------------------------- */
 /* static functions                                                           */
 /* -------------------------------------------------------------------------- */
 
-static unsigned char *reverseByteOrder(unsigned char *bytes, long int size);
+static long int mapExifFile(struct exifSource *source, char *fileName,
+                            int readFiles);
 
-static long int checkMarker(FILE *fp, unsigned char *marker,
-                            long int markerLength, long int markerPos);
+static unsigned char *getSourceData(struct exifSource *source, long int pos,
+                                    long int length);
 
-static long int findMarkerInFile(FILE *fp, unsigned char *marker,
-                                 long int markerLength, long int startPos);
+static long int getFileType(struct exifSource *source);
 
-static long int getExifFormat(FILE *fp, long int exifMarkerPos);
+static long int findTiffHeader(struct exifContext *context,
+                               struct exifSource *source,
+                               struct metaSegments *segments, long int *tiffPos,
+                               long int *exifFormat, long int *exifEnd);
 
-static long int getIfdTagCount(FILE *fp, long int ifdPos, long int exifFormat);
+static long int checkHeifBrand(struct exifSource *source);
 
-static long int getIfdLink(FILE *fp, long int ifdPos, long int ifdTagCount,
-                           long int exifFormat);
+static long int findHeifExif(struct exifContext *context,
+                             struct exifSource *source, long int *tiffPos,
+                             long int *exifEnd);
+
+static long int findBox(struct exifSource *source, long int pos, long int end,
+                        char *boxType, long int *boxEnd);
+
+static long int getBoxInt(struct exifSource *source, long int *pos,
+                          long int length);
+
+static long int findHeifExifItem(struct exifSource *source, long int pos,
+                                 long int end);
 
-static long int getTagID(FILE *fp, long int tagPos, long int exifFormat);
+static long int getHeifItemExtent(struct exifSource *source, long int pos,
+                                  long int end, long int itemID,
+                                  long int *method, long int *extentPos,
+                                  long int *extentLength);
 
-static long int getTagType(FILE *fp, long int tagPos, long int exifFormat);
+static long int findPngExif(struct exifContext *context,
+                            struct exifSource *source, long int *tiffPos,
+                            long int *exifEnd);
 
-static long int getTagTypeSize(long int tagType);
+static long int findWebpExif(struct exifContext *context,
+                             struct exifSource *source, long int *tiffPos,
+                             long int *exifEnd);
 
-static long int getTagCount(FILE *fp, long int tagPos, long int exifFormat);
+static long int findExifSegment(struct exifContext *context,
+                                struct exifSource *source,
+                                struct metaSegments *segments,
+                                long int *exifMarkerPos, long int *exifFormat,
+                                long int *exifEnd);
 
-static long int getTagDataPos(FILE *fp, long int tagPos, long int exifFormat,
-                              long int tagTypeSize, long int tagCount,
+static long int walkJpgSegments(struct exifContext *context,
+                                struct exifSource *source,
+                                struct metaSegments *segments);
+
+static long int visitMetaSegments(struct exifContext *context,
+                                  struct exifSource *source,
+                                  struct metaSegments *segments,
+                                  long int *tagCount, exifTagHook visitor,
+                                  void *visitorArg);
+
+static long int checkMarker(struct exifSource *source, unsigned char *marker,
+                            long int markerLength, long int markerPos);
+
+static long int getExifFormat(struct exifSource *source,
                               long int exifMarkerPos);
 
-static long int getTagData(FILE *fp, long int tagDataPos, long int tagTypeSize,
-                           long int tagCount, unsigned char *tagData);
+static long int getExifEnd(struct exifSource *source, long int exifMarkerPos);
 
-static long int allocateExifTable(struct exifItem **exifTable,
-                                  long int exifTableItemCount);
+static long int getTiffFormat(struct exifSource *source, long int tiffPos);
+
+static long int getFirstIfd(struct exifSource *source, long int tiffPos,
+                            long int exifFormat);
+
+static long int getIfdTagCount(struct exifSource *source, long int ifdPos,
+                               long int exifFormat);
+
+static long int getIfdLink(struct exifSource *source, long int ifdPos,
+                           long int ifdTagCount, long int exifFormat);
+
+static long int getTagID(struct exifSource *source, long int tagPos,
+                         long int exifFormat);
+
+static long int getTagType(struct exifSource *source, long int tagPos,
+                           long int exifFormat);
+
+static long int getTagCount(struct exifSource *source, long int tagPos,
+                            long int exifFormat);
 
-static long int allocateIfdQueue(struct queueItem **ifdQueue,
-                                 long int ifdQueueItemCount);
+static long int getTagDataPos(struct exifSource *source, long int tagPos,
+                              long int exifFormat, long int tagTypeSize,
+                              long int tagCount, long int tiffPos);
 
-static long int addIfdToQueue(struct queueItem **ifdQueue,
+static long int allocateExifTable(struct exifContext *context,
+                                  struct exifItem **exifTable,
+                                  long int exifTableItemCount);
+
+static long int addIfdToQueue(struct exifContext *context,
+                              struct queueItem *ifdQueue,
                               long int *ifdQueueItemCount, long int ifdPos,
                               long int ifdID);
 
-static long int addItemToExifTable(struct exifItem **exifTable,
-                                   long int *exifTableItemCount, FILE *fp,
-                                   long int tagPos, long int ifdID,
-                                   long int exifMarkerPos, long int exifFormat,
-                                   struct queueItem **ifdQueue,
-                                   long int *ifdQueueItemCount);
-
-static long int addIfdToExifTable(struct exifItem **exifTable,
-                                  long int *exifTableItemCount, FILE *fp,
-                                  long int ifdPos, long int ifdID,
-                                  long int exifMarkerPos, long int exifFormat,
-                                  struct queueItem **ifdQueue,
-                                  long int *ifdQueueItemCount);
+static long int readExifItem(struct exifContext *context,
+                             struct exifSource *source, struct exifItem *item,
+                             long int tagPos, long int ifdID,
+                             long int tiffPos, long int exifEnd,
+                             long int exifFormat, struct queueItem *ifdQueue,
+                             long int *ifdQueueItemCount);
+
+static long int planIfdReads(struct exifContext *context,
+                             struct exifSource *source, long int ifdPos,
+                             long int ifdTagCount, long int tiffPos,
+                             long int exifEnd, long int exifFormat);
+
+static int compareSourceExtents(const void *a, const void *b);
+
+static long int visitIfd(struct exifContext *context, struct exifSource *source,
+                         long int ifdPos, long int ifdID,
+                         long int tiffPos, long int exifEnd,
+                         long int exifFormat, struct queueItem *ifdQueue,
+                         long int *ifdQueueItemCount, long int *tagCount,
+                         exifTagHook visitor, void *visitorArg);
+
+static long int noteMakerNote(struct exifItem *item, void *arg);
+
+static long int visitMakerNotes(struct exifContext *context,
+                                struct exifSource *source, long int tiffPos,
+                                long int exifEnd, long int exifFormat,
+                                struct makerNoteVisit *makerNote,
+                                long int *tagCount);
+
+static long int findPreviewHook(struct exifItem *item, void *arg);
+
+static long int getPreviewValue(struct exifItem *item);
+
+static void addPreviewCandidate(struct previewVisit *visit, long int pos,
+                                long int length);
+
+static long int addItemToExifTable(struct exifItem *item, void *arg);
 
 /* -------------------------------------------------------------------------- */
 
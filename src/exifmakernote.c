@@ -0,0 +1,242 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifmakernote.h"
+
+/* -------------------------------------------------------------------------- */
+/* visitMakerNote                                                             */
+/* decodes the maker note noted in "makerNote" and calls its visitor for      */
+/* every known vendor tag. "data" holds the "length" bytes of exif data from  */
+/* the tiff header on, found at "dataPos" in the file, with the byte order    */
+/* "exifFormat". only the maker note itself must be loaded, the rest is       */
+/* loaded from the source of "makerNote" as it is needed. "tagCount" counts   */
+/* the tags visited so far. returns 0 if successful, EXIF_VISIT_STOP if the   */
+/* visitor stopped the walk or a negative value otherwise. an unknown or      */
+/* broken maker note is not an error.                                         */
+/* -------------------------------------------------------------------------- */
+
+long int visitMakerNote(struct exifContext *context, unsigned char *data,
+                        long int dataPos, long int length,
+                        long int exifFormat, struct makerNoteVisit *makerNote,
+                        long int *tagCount) {
+    long int notePos = (*makerNote).makerNotePos - dataPos;
+    long int noteLength = (*makerNote).makerNoteLength;
+    long int base = 0;
+    long int ifdPos = 0;
+
+    struct makerNoteVendor *vendor = NULL;
+
+    if (notePos < 0 || noteLength > length - notePos) return 0;
+
+    if ((vendor = findMakerNoteVendor(data + notePos, noteLength, makerNote)) ==
+        NULL)
+        return 0;
+
+    debugger(context, 1, "makerNoteVendor = %ld", (*vendor).vendor);
+
+    if (noteLength < (*vendor).ifdOffset + 4 ||
+        noteLength < (*vendor).formatPos + 2)
+        return 0;
+
+    /* byte order and base of the offsets */
+
+    if ((*vendor).exifFormat != 0)
+        exifFormat = (*vendor).exifFormat;
+    else if ((*vendor).formatPos >= 0 &&
+             (exifFormat = getMakerNoteFormat(
+                  data + notePos + (*vendor).formatPos)) == 0)
+        return 0;
+
+    if ((*vendor).base == MAKERNOTE_BASE_TIFF)
+        base = 0;
+    else
+        base = notePos + (*vendor).base;
+
+    /* the ifd follows the header or is linked from there */
+
+    ifdPos = notePos + (*vendor).ifdOffset;
+
+    if ((*vendor).ifdLink)
+        ifdPos = base + castUInt32(data + ifdPos, exifFormat);
+
+    return visitVendorIfd(context, data, dataPos, length, ifdPos, base,
+                          exifFormat, (*vendor).vendor, 0, makerNote,
+                          tagCount);
+}
+
+/* -------------------------------------------------------------------------- */
+/* findMakerNoteVendor                                                        */
+/* returns the vendor of the maker note of "length" bytes at "data", found by */
+/* its header or by the make in "makerNote", or NULL if it is not known.      */
+/* -------------------------------------------------------------------------- */
+
+static struct makerNoteVendor *findMakerNoteVendor(
+    unsigned char *data, long int length, struct makerNoteVisit *makerNote) {
+    long int i = 0;
+    long int makeLength = 0;
+
+    struct makerNoteVendor *vendor = NULL;
+
+    for (i = 0; i < MAKERNOTE_VENDOR_COUNT; i++) {
+        vendor = &makerNoteVendors[i];
+
+        if ((*vendor).header != NULL) {
+            if (length >= (*vendor).headerLength &&
+                memcmp(data, (*vendor).header, (*vendor).headerLength) == 0)
+                return vendor;
+
+            continue;
+        }
+
+        /* a maker note without header is known by the make */
+
+        makeLength = strlen((*vendor).make);
+
+        if ((*makerNote).make != NULL &&
+            (*makerNote).makeLength >= makeLength &&
+            memcmp((*makerNote).make, (*vendor).make, makeLength) == 0)
+            return vendor;
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* getMakerNoteFormat                                                         */
+/* returns the byte order of the "II" or "MM" mark at "data", or 0.           */
+/* -------------------------------------------------------------------------- */
+
+static long int getMakerNoteFormat(unsigned char *data) {
+    if (data[0] == 0x49 && data[1] == 0x49) return EXIF_FORMAT_INTEL;
+
+    if (data[0] == 0x4D && data[1] == 0x4D) return EXIF_FORMAT_MOTO;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitVendorIfd                                                             */
+/* visits the known tags of "vendor" in the ifd at "ifdPos" of "data". the    */
+/* data of a tag is at an offset from "base" if it does not fit into the      */
+/* tag. "depth" counts the sub ifds on the way. the other arguments and the   */
+/* return value are those of visitMakerNote.                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int visitVendorIfd(struct exifContext *context, unsigned char *data,
+                               long int dataPos, long int length,
+                               long int ifdPos, long int base,
+                               long int exifFormat, long int vendor,
+                               long int depth, struct makerNoteVisit *makerNote,
+                               long int *tagCount) {
+    long int rc = 0;
+    long int i = 0;
+    long int j = 0;
+    long int ifdTagCount = 0;
+    long int tagPos = 0;
+    long int tagID = 0;
+    long int tagType = 0;
+    long int tagTypeSize = 0;
+    long int count = 0;
+    long int valuePos = 0;
+
+    struct makerNoteLookupItem *tag = NULL;
+    struct exifItem item;
+
+    if (ifdPos < 0 || ifdPos > length - IFD_HEADER_LENGTH) return 0;
+
+    /* a read source loads the ifd and the values as they are needed */
+
+    if (loadExifSource((*makerNote).source, dataPos + ifdPos,
+                       IFD_HEADER_LENGTH) < 0)
+        return 0;
+
+    ifdTagCount = castUInt16(data + ifdPos, exifFormat);
+
+    if (ifdTagCount > (length - ifdPos - IFD_HEADER_LENGTH) / EXIF_TAG_LENGTH ||
+        loadExifSource((*makerNote).source,
+                       dataPos + ifdPos + IFD_HEADER_LENGTH,
+                       ifdTagCount * EXIF_TAG_LENGTH) < 0)
+        return 0;
+
+    for (i = 0; i < ifdTagCount; i++) {
+        tagPos = ifdPos + IFD_HEADER_LENGTH + i * EXIF_TAG_LENGTH;
+        tagID = castUInt16(data + tagPos, exifFormat);
+
+        /* only the known tags are read */
+
+        for (j = 0; j < MAKERNOTE_LOOKUP_COUNT; j++)
+            if (makerNoteTags[j].vendor == vendor &&
+                makerNoteTags[j].vendorTagID == tagID)
+                break;
+
+        if (j == MAKERNOTE_LOOKUP_COUNT) continue;
+
+        tag = &makerNoteTags[j];
+        tagType = castUInt16(data + tagPos + 2, exifFormat);
+        count = castUInt32(data + tagPos + 4, exifFormat);
+
+        if ((tagTypeSize = getTagTypeSize(tagType)) < 0 || count == 0 ||
+            count > (*context).limits.maxTagBytes / tagTypeSize)
+            continue;
+
+        if (tagTypeSize * count <= 4)
+            valuePos = tagPos + 8;
+        else
+            valuePos = base + castUInt32(data + tagPos + 8, exifFormat);
+
+        if (valuePos < 0 || valuePos > length - tagTypeSize * count ||
+            loadExifSource((*makerNote).source, dataPos + valuePos,
+                           tagTypeSize * count) < 0)
+            continue;
+
+        /* a sub ifd is linked by an offset */
+
+        if ((*tag).index == MAKERNOTE_SUB_IFD) {
+            if (depth > 0 || tagTypeSize * count != 4) continue;
+
+            if ((rc = visitVendorIfd(
+                     context, data, dataPos, length,
+                     base + castUInt32(data + valuePos, exifFormat), base,
+                     exifFormat, (*tag).tagID, depth + 1, makerNote,
+                     tagCount)) != 0)
+                return rc;
+
+            continue;
+        }
+
+        /* some values are one entry of an array */
+
+        if ((*tag).index >= 0) {
+            if ((*tag).index >= count) continue;
+
+            valuePos = valuePos + (*tag).index * tagTypeSize;
+            count = 1;
+        }
+
+        if (*tagCount >= (*context).limits.maxTags) return EXIF_ERR_LIMIT;
+
+        item.exifFormat = exifFormat;
+        item.ifdID = IFD_ID_MAKERNOTE;
+        item.tagPos = dataPos + tagPos;
+        item.tagID = (*tag).tagID;
+        item.tagType = tagType;
+        item.tagTypeSize = tagTypeSize;
+        item.tagCount = count;
+        item.tagDataPos = dataPos + valuePos;
+        item.tagData = data + valuePos;
+
+        debugger(context, 3, "tagID = 0x%05lx", item.tagID);
+
+        *tagCount = *tagCount + 1;
+
+        countStat(tagsVisited, 1);
+
+        if ((rc = (*makerNote).visitor(&item, (*makerNote).visitorArg)) < 0)
+            return rc;
+
+        if (rc > 0) return EXIF_VISIT_STOP;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
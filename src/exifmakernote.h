@@ -0,0 +1,158 @@
+#ifndef EXIFMAKERNOTE_H_INCLUDED
+#define EXIFMAKERNOTE_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exiflib.h"
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    The maker note (tag 0x927c of the exif ifd) is a blob of often tens of  */
+/*    KB. Most vendors keep an ifd in it, but each one with its own header,   */
+/*    byte order and base for the offsets. It is only decoded if the context  */
+/*    asks for it, i.e. if one of its tags was requested. Its tags get common */
+/*    ids from 0x40001 on, so "LensType" is the lens type of every vendor.    */
+/*                                                                            */
+/*    VENDOR    HEADER              IFD AT         OFFSETS FROM  BYTE ORDER   */
+/*    Nikon     "Nikon\0" 02 XX     tiff header    note + 10     tiff header  */
+/*                                  at note + 10                              */
+/*    Canon     none (Make)         note           tiff header   exif         */
+/*    Sony      "SONY DSC \0\0\0"   note + 12      tiff header   exif         */
+/*    Fujifilm  "FUJIFILM" XX-XX..  link at 8      note          intel        */
+/*    Olympus   "OLYMPUS\0" II 03   note + 12      note          at note + 8  */
+/*    Olympus   "OLYMP\0" 01 00     note + 8       tiff header   exif         */
+/*                                                                            */
+/*    A broken maker note ends its decoding without an error, the exif tags   */
+/*    are not affected.                                                       */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define MAKERNOTE_VENDOR_COUNT 6
+#define MAKERNOTE_LOOKUP_COUNT 22
+
+#define MAKERNOTE_NIKON 1
+#define MAKERNOTE_CANON 2
+#define MAKERNOTE_SONY 3
+#define MAKERNOTE_FUJIFILM 4
+#define MAKERNOTE_OLYMPUS 5
+#define MAKERNOTE_OLYMPUS_EQUIPMENT 6
+
+#define MAKERNOTE_BASE_TIFF -1
+
+#define MAKERNOTE_WHOLE -1
+#define MAKERNOTE_SUB_IFD -2
+
+#define TAG_ID_MAKERNOTE 0x40000
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct makerNoteVendor {
+    long int vendor;
+    char *make;
+    char *header;
+    long int headerLength;
+    long int formatPos;
+    long int exifFormat;
+    long int ifdOffset;
+    long int ifdLink;
+    long int base;
+};
+
+struct makerNoteLookupItem {
+    long int vendor;
+    long int vendorTagID;
+    long int index;
+    long int tagID;
+};
+
+/* -------------------------------------------------------------------------- */
+/* lookup tables                                                              */
+/* -------------------------------------------------------------------------- */
+
+/* a vendor with a header is found by it, one without by the make. the byte   */
+/* order is read at "formatPos", fixed by "exifFormat" or taken from exif.    */
+/* the ifd is at "ifdOffset", or linked from there. offsets count from        */
+/* "base" in the maker note or from the tiff header.                          */
+
+static struct makerNoteVendor makerNoteVendors[MAKERNOTE_VENDOR_COUNT] = {
+
+    {MAKERNOTE_NIKON, "NIKON", "Nikon\0\2", 7, 10, 0, 14, 1, 10},
+    {MAKERNOTE_SONY, "SONY", "SONY DSC \0\0\0", 12, -1, 0, 12, 0,
+     MAKERNOTE_BASE_TIFF},
+    {MAKERNOTE_FUJIFILM, "FUJIFILM", "FUJIFILM", 8, -1, EXIF_FORMAT_INTEL, 8, 1,
+     0},
+    {MAKERNOTE_OLYMPUS, "OLYMPUS", "OLYMPUS\0", 8, 8, 0, 12, 0, 0},
+    {MAKERNOTE_OLYMPUS, "OLYMPUS", "OLYMP\0", 6, -1, 0, 8, 0,
+     MAKERNOTE_BASE_TIFF},
+    {MAKERNOTE_CANON, "Canon", NULL, 0, -1, 0, 0, 0, MAKERNOTE_BASE_TIFF}
+
+};
+
+/* the vendor tags with their common tag id. an index picks one value of an   */
+/* array, a sub ifd is walked as the vendor in "tagID".                       */
+
+static struct makerNoteLookupItem makerNoteTags[MAKERNOTE_LOOKUP_COUNT] = {
+
+    {MAKERNOTE_NIKON, 0x0004, MAKERNOTE_WHOLE, 0x40007},
+    {MAKERNOTE_NIKON, 0x001d, MAKERNOTE_WHOLE, 0x40004},
+    {MAKERNOTE_NIKON, 0x0083, MAKERNOTE_WHOLE, 0x40001},
+    {MAKERNOTE_NIKON, 0x0084, MAKERNOTE_WHOLE, 0x40006},
+    {MAKERNOTE_NIKON, 0x00a7, MAKERNOTE_WHOLE, 0x40002},
+    {MAKERNOTE_CANON, 0x0001, 22, 0x40001},
+    {MAKERNOTE_CANON, 0x0006, MAKERNOTE_WHOLE, 0x40008},
+    {MAKERNOTE_CANON, 0x0007, MAKERNOTE_WHOLE, 0x40005},
+    {MAKERNOTE_CANON, 0x000c, MAKERNOTE_WHOLE, 0x40004},
+    {MAKERNOTE_CANON, 0x0010, MAKERNOTE_WHOLE, 0x4000a},
+    {MAKERNOTE_CANON, 0x0096, MAKERNOTE_WHOLE, 0x40003},
+    {MAKERNOTE_SONY, 0x0102, MAKERNOTE_WHOLE, 0x40007},
+    {MAKERNOTE_SONY, 0xb001, MAKERNOTE_WHOLE, 0x4000a},
+    {MAKERNOTE_SONY, 0xb027, MAKERNOTE_WHOLE, 0x40001},
+    {MAKERNOTE_FUJIFILM, 0x0010, MAKERNOTE_WHOLE, 0x40003},
+    {MAKERNOTE_FUJIFILM, 0x1000, MAKERNOTE_WHOLE, 0x40007},
+    {MAKERNOTE_FUJIFILM, 0x1401, MAKERNOTE_WHOLE, 0x40009},
+    {MAKERNOTE_OLYMPUS, 0x0207, MAKERNOTE_WHOLE, 0x40008},
+    {MAKERNOTE_OLYMPUS, 0x2010, MAKERNOTE_SUB_IFD, MAKERNOTE_OLYMPUS_EQUIPMENT},
+    {MAKERNOTE_OLYMPUS_EQUIPMENT, 0x0101, MAKERNOTE_WHOLE, 0x40004},
+    {MAKERNOTE_OLYMPUS_EQUIPMENT, 0x0102, MAKERNOTE_WHOLE, 0x40003},
+    {MAKERNOTE_OLYMPUS_EQUIPMENT, 0x0201, MAKERNOTE_WHOLE, 0x40001}
+
+};
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int visitMakerNote(struct exifContext *context, unsigned char *data,
+                        long int dataPos, long int length,
+                        long int exifFormat, struct makerNoteVisit *makerNote,
+                        long int *tagCount);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static struct makerNoteVendor *findMakerNoteVendor(
+    unsigned char *data, long int length, struct makerNoteVisit *makerNote);
+
+static long int getMakerNoteFormat(unsigned char *data);
+
+static long int visitVendorIfd(struct exifContext *context, unsigned char *data,
+                               long int dataPos, long int length,
+                               long int ifdPos, long int base,
+                               long int exifFormat, long int vendor,
+                               long int depth, struct makerNoteVisit *makerNote,
+                               long int *tagCount);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,619 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifmeta.h"
+
+/* -------------------------------------------------------------------------- */
+/* visitXmpPacket                                                             */
+/* tokenizes the xmp packet of "length" bytes at "data", found at "dataPos"   */
+/* in the file, and calls "visitor" with "visitorArg" for every value of a    */
+/* known property. "tagCount" counts the tags visited so far. returns 0 if    */
+/* successful, EXIF_VISIT_STOP if the visitor stopped the walk or a negative  */
+/* value otherwise. broken xml ends the packet without an error.              */
+/* -------------------------------------------------------------------------- */
+
+long int visitXmpPacket(struct exifContext *context, unsigned char *data,
+                        long int dataPos, long int length, long int *tagCount,
+                        exifTagHook visitor, void *visitorArg) {
+    long int rc = 0;
+    long int pos = 0;
+    long int start = 0;
+    long int end = 0;
+    long int nameLength = 0;
+    long int tagID = 0;
+    unsigned char quote = 0;
+
+    long int opened = 0;
+    long int propertyID = 0;
+    unsigned char *propertyName = NULL;
+    long int propertyNameLength = 0;
+
+    struct xmpPrefixItem prefixes[XMP_NAMESPACE_COUNT];
+
+    readXmpPrefixes(data, length, prefixes);
+
+    while (pos < length) {
+        /* text is a value if it is inside a known property */
+
+        if (data[pos] != '<') {
+            start = skipXmpSpace(data, pos, length);
+
+            for (pos = start; pos < length && data[pos] != '<'; pos++)
+                ;
+
+            for (end = pos; end > start && isspace(data[end - 1]); end--)
+                ;
+
+            if (propertyID != 0 && end > start &&
+                (rc = visitXmpValue(context, propertyID, data + start,
+                                    dataPos + start, end - start, tagCount,
+                                    visitor, visitorArg)) != 0)
+                return rc;
+
+            continue;
+        }
+
+        pos++;
+
+        /* processing instructions, comments and doctypes are skipped */
+
+        if (pos < length && (data[pos] == '?' || data[pos] == '!')) {
+            while (pos < length && data[pos] != '>') pos++;
+            pos++;
+            continue;
+        }
+
+        /* an end tag closes the property of the same name */
+
+        if (pos < length && data[pos] == '/') {
+            nameLength = getXmpNameLength(data + pos + 1, length - pos - 1);
+
+            if (propertyID != 0 && nameLength == propertyNameLength &&
+                memcmp(data + pos + 1, propertyName, nameLength) == 0)
+                propertyID = 0;
+
+            while (pos < length && data[pos] != '>') pos++;
+            pos++;
+            continue;
+        }
+
+        /* a start tag may open a property */
+
+        nameLength = getXmpNameLength(data + pos, length - pos);
+        opened = 0;
+
+        if (propertyID == 0 &&
+            (tagID = findXmpProperty(data + pos, nameLength, prefixes)) > 0) {
+            opened = 1;
+            propertyID = tagID;
+            propertyName = data + pos;
+            propertyNameLength = nameLength;
+        }
+
+        pos = pos + nameLength;
+
+        /* attributes of known names are values too */
+
+        while ((pos = skipXmpSpace(data, pos, length)) < length &&
+               data[pos] != '>' && data[pos] != '/') {
+            start = pos;
+            nameLength = getXmpNameLength(data + pos, length - pos);
+            pos = skipXmpSpace(data, pos + nameLength, length);
+
+            if (nameLength == 0 || pos >= length || data[pos] != '=')
+                return 0;
+
+            pos = skipXmpSpace(data, pos + 1, length);
+
+            if (pos >= length || (data[pos] != '"' && data[pos] != '\''))
+                return 0;
+
+            quote = data[pos];
+
+            for (end = pos + 1; end < length && data[end] != quote; end++)
+                ;
+
+            if (end >= length) return 0;
+
+            if ((tagID = findXmpProperty(data + start, nameLength,
+                                         prefixes)) > 0 &&
+                (rc = visitXmpValue(context, tagID, data + pos + 1,
+                                    dataPos + pos + 1, end - pos - 1,
+                                    tagCount, visitor, visitorArg)) != 0)
+                return rc;
+
+            pos = end + 1;
+        }
+
+        /* an empty element closes its own property */
+
+        if (pos < length && data[pos] == '/' && opened) propertyID = 0;
+
+        while (pos < length && data[pos] != '>') pos++;
+        pos++;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitIptcResources                                                         */
+/* walks the photoshop resources of "length" bytes at "data", found at        */
+/* "dataPos" in the file, and visits the iptc records of resource 0x0404.     */
+/* returns like visitXmpPacket.                                               */
+/* -------------------------------------------------------------------------- */
+
+long int visitIptcResources(struct exifContext *context, unsigned char *data,
+                            long int dataPos, long int length,
+                            long int *tagCount, exifTagHook visitor,
+                            void *visitorArg) {
+    long int rc = 0;
+    long int pos = 0;
+    long int resourceID = 0;
+    long int resourcePos = 0;
+    long int resourceSize = 0;
+
+    /* signature, id, padded pascal name, size and padded data */
+
+    while (pos + 12 <= length && memcmp(data + pos, "8BIM", 4) == 0) {
+        resourceID = castUInt16(data + pos + 4, EXIF_FORMAT_MOTO);
+        resourcePos = pos + 6 + ((data[pos + 6] + 2) & ~1);
+
+        if (resourcePos + 4 > length) return 0;
+
+        resourceSize = castUInt32(data + resourcePos, EXIF_FORMAT_MOTO);
+        resourcePos = resourcePos + 4;
+
+        if (resourceSize > length - resourcePos) return 0;
+
+        if (resourceID == 0x0404 &&
+            (rc = visitIimRecords(context, data + resourcePos,
+                                  dataPos + resourcePos, resourceSize,
+                                  tagCount, visitor, visitorArg)) != 0)
+            return rc;
+
+        pos = resourcePos + resourceSize + (resourceSize & 1);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitIccHeader                                                             */
+/* visits the fields of the icc profile header of "length" bytes at "data",   */
+/* found at "dataPos" in the file, and its description if it is in the same   */
+/* chunk. returns like visitXmpPacket.                                        */
+/* -------------------------------------------------------------------------- */
+
+long int visitIccHeader(struct exifContext *context, unsigned char *data,
+                        long int dataPos, long int length, long int *tagCount,
+                        exifTagHook visitor, void *visitorArg) {
+    long int rc = 0;
+    long int i = 0;
+
+    struct iccLookupItem *field = NULL;
+
+    if (length < ICC_HEADER_LENGTH || memcmp(data + 36, "acsp", 4) != 0)
+        return 0;
+
+    for (i = 0; i < ICC_LOOKUP_COUNT; i++) {
+        field = &iccLookupTable[i];
+
+        /* unset signatures are zero */
+
+        if ((*field).tagType == 2 && data[(*field).offset] == 0) continue;
+
+        if ((rc = visitMetaItem(context, IFD_ID_ICC,
+                                TAG_ID_ICC + (*field).offset, (*field).tagType,
+                                (*field).tagCount, data + (*field).offset,
+                                dataPos + (*field).offset, tagCount, visitor,
+                                visitorArg)) != 0)
+            return rc;
+    }
+
+    return visitIccDescription(context, data, dataPos, length, tagCount,
+                               visitor, visitorArg);
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitIimRecords                                                            */
+/* visits the datasets of the iptc application record in the "length" bytes   */
+/* of iim records at "data", found at "dataPos" in the file. returns like     */
+/* visitXmpPacket.                                                            */
+/* -------------------------------------------------------------------------- */
+
+static long int visitIimRecords(struct exifContext *context,
+                                unsigned char *data, long int dataPos,
+                                long int length, long int *tagCount,
+                                exifTagHook visitor, void *visitorArg) {
+    long int rc = 0;
+    long int pos = 0;
+    long int dataSet = 0;
+    long int size = 0;
+
+    /* tag marker, record, dataset and size - extended sizes end the list */
+
+    while (pos + 5 <= length && data[pos] == 0x1C) {
+        dataSet = data[pos + 2];
+        size = castUInt16(data + pos + 3, EXIF_FORMAT_MOTO);
+
+        if ((size & 0x8000) || size > length - pos - 5) return 0;
+
+        if (data[pos + 1] == 2 && dataSet != 0 &&
+            (rc = visitMetaItem(context, IFD_ID_IPTC, TAG_ID_IPTC + dataSet, 2,
+                                size, data + pos + 5, dataPos + pos + 5,
+                                tagCount, visitor, visitorArg)) != 0)
+            return rc;
+
+        pos = pos + 5 + size;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitIccDescription                                                        */
+/* visits the ascii text of the v2 "desc" tag of the icc profile at "data"    */
+/* if it lies within its "length" bytes. returns like visitXmpPacket.         */
+/* -------------------------------------------------------------------------- */
+
+static long int visitIccDescription(struct exifContext *context,
+                                    unsigned char *data, long int dataPos,
+                                    long int length, long int *tagCount,
+                                    exifTagHook visitor, void *visitorArg) {
+    long int i = 0;
+    long int tableCount = 0;
+    long int tagPos = 0;
+    long int textLength = 0;
+
+    if (length < ICC_HEADER_LENGTH + 4) return 0;
+
+    tableCount = castUInt32(data + ICC_HEADER_LENGTH, EXIF_FORMAT_MOTO);
+
+    /* signature, offset and size of every tag */
+
+    for (i = 0;
+         i < tableCount && ICC_HEADER_LENGTH + 4 + (i + 1) * 12 <= length;
+         i++) {
+        tagPos = ICC_HEADER_LENGTH + 4 + i * 12;
+
+        if (memcmp(data + tagPos, "desc", 4) != 0) continue;
+
+        tagPos = castUInt32(data + tagPos + 4, EXIF_FORMAT_MOTO);
+
+        /* type "desc", reserved, ascii count and text */
+
+        if (tagPos > length - 12 || memcmp(data + tagPos, "desc", 4) != 0)
+            return 0;
+
+        textLength = castUInt32(data + tagPos + 8, EXIF_FORMAT_MOTO);
+
+        if (textLength == 0 || textLength > length - tagPos - 12) return 0;
+
+        return visitMetaItem(context, IFD_ID_ICC, TAG_ID_ICC_DESCRIPTION, 2,
+                             textLength, data + tagPos + 12,
+                             dataPos + tagPos + 12, tagCount, visitor,
+                             visitorArg);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* readXmpPrefixes                                                            */
+/* writes the prefix that the xmp packet of "length" bytes at "data" declares */
+/* for every namespace of the namespace table to "prefixes". the length of a  */
+/* namespace without a declaration is -1. scopes are not tracked, the last    */
+/* declaration wins.                                                          */
+/* -------------------------------------------------------------------------- */
+
+static void readXmpPrefixes(unsigned char *data, long int length,
+                            struct xmpPrefixItem *prefixes) {
+    long int i = 0;
+    long int pos = 0;
+    long int end = 0;
+    long int nameLength = 0;
+    unsigned char *name = NULL;
+
+    for (i = 0; i < XMP_NAMESPACE_COUNT; i++) prefixes[i].length = -1;
+
+    /* xmlns:prefix="uri" */
+
+    for (pos = 0; pos + 6 < length; pos++) {
+        if (memcmp(data + pos, "xmlns:", 6) != 0) continue;
+
+        name = data + pos + 6;
+        nameLength = getXmpNameLength(name, length - pos - 6);
+        pos = skipXmpSpace(data, pos + 6 + nameLength, length);
+
+        if (pos >= length || data[pos] != '=') continue;
+
+        pos = skipXmpSpace(data, pos + 1, length);
+
+        if (pos >= length || (data[pos] != '"' && data[pos] != '\'')) continue;
+
+        for (end = pos + 1; end < length && data[end] != data[pos]; end++)
+            ;
+
+        for (i = 0; i < XMP_NAMESPACE_COUNT; i++) {
+            if ((long int)strlen(xmpNamespaceTable[i].uri) == end - pos - 1 &&
+                memcmp(xmpNamespaceTable[i].uri, data + pos + 1,
+                       end - pos - 1) == 0) {
+                prefixes[i].name = name;
+                prefixes[i].length = nameLength;
+            }
+        }
+
+        pos = end;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* findXmpProperty                                                            */
+/* returns the tag id of the xmp property "name" of length "nameLength" or 0  */
+/* if it is not known. a prefix declared in "prefixes" is replaced by the one */
+/* of the lookup table, other prefixes are taken as they are.                 */
+/* -------------------------------------------------------------------------- */
+
+static long int findXmpProperty(unsigned char *name, long int nameLength,
+                                struct xmpPrefixItem *prefixes) {
+    long int i = 0;
+    long int nameStart = 0;
+    long int localLength = 0;
+    long int prefixLength = 0;
+    char *prefix = (char *)name;
+    char *xmpName = NULL;
+
+    while (nameStart < nameLength && name[nameStart] != ':') nameStart++;
+
+    if (nameStart == nameLength) return 0;
+
+    prefixLength = nameStart;
+    localLength = nameLength - nameStart - 1;
+
+    for (i = 0; i < XMP_NAMESPACE_COUNT; i++) {
+        if (prefixes[i].length == nameStart &&
+            memcmp(prefixes[i].name, name, nameStart) == 0) {
+            prefix = xmpNamespaceTable[i].prefix;
+            prefixLength = strlen(prefix);
+            break;
+        }
+    }
+
+    for (i = 0; i < XMP_LOOKUP_COUNT; i++) {
+        xmpName = xmpLookupTable[i].xmpName;
+
+        if ((long int)strlen(xmpName) == prefixLength + 1 + localLength &&
+            memcmp(xmpName, prefix, prefixLength) == 0 &&
+            xmpName[prefixLength] == ':' &&
+            memcmp(xmpName + prefixLength + 1, name + nameStart + 1,
+                   localLength) == 0)
+            return xmpLookupTable[i].tagID;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitXmpValue                                                              */
+/* visits the xmp value of "length" bytes at "data", found at "dataPos" in    */
+/* the file, as the tag "tagID". a value with references is decoded to a      */
+/* copy first. returns like visitMetaItem.                                    */
+/* -------------------------------------------------------------------------- */
+
+static long int visitXmpValue(struct exifContext *context, long int tagID,
+                              unsigned char *data, long int dataPos,
+                              long int length, long int *tagCount,
+                              exifTagHook visitor, void *visitorArg) {
+    long int rc = 0;
+    long int decodedLength = 0;
+    unsigned char *decoded = NULL;
+
+    /* most values have no references and are visited in place */
+
+    if (length > (*context).limits.maxTagBytes ||
+        memchr(data, '&', length) == NULL)
+        return visitMetaItem(context, IFD_ID_XMP, tagID, 2, length, data,
+                             dataPos, tagCount, visitor, visitorArg);
+
+    /* a reference is never shorter than its character */
+
+    if ((decoded = (unsigned char *)exifAllocate(context, NULL, length)) ==
+        NULL)
+        return EXIF_ERR_MALLOC;
+
+    decodedLength = decodeXmpEntities(data, length, decoded);
+
+    rc = visitMetaItem(context, IFD_ID_XMP, tagID, 2, decodedLength, decoded,
+                       dataPos, tagCount, visitor, visitorArg);
+
+    exifRelease(context, decoded);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* decodeXmpEntities                                                          */
+/* writes the "length" bytes at "data" to "buf" with the references decoded.  */
+/* unknown references are copied as they are. returns the number of bytes     */
+/* written, which is at most "length".                                        */
+/* -------------------------------------------------------------------------- */
+
+static long int decodeXmpEntities(unsigned char *data, long int length,
+                                  unsigned char *buf) {
+    long int pos = 0;
+    long int out = 0;
+    long int n = 0;
+    long int size = 0;
+
+    while (pos < length) {
+        if (data[pos] == '&' &&
+            (n = decodeXmpReference(data + pos, length - pos, buf + out,
+                                    &size)) > 0) {
+            pos = pos + n;
+            out = out + size;
+        } else {
+            buf[out++] = data[pos++];
+        }
+    }
+
+    return out;
+}
+
+/* -------------------------------------------------------------------------- */
+/* decodeXmpReference                                                         */
+/* decodes the entity or character reference at the start of the "length"     */
+/* bytes at "data" to "buf" as utf-8 and writes its byte count to "size".     */
+/* returns the length of the reference or 0 if it is not a valid one.         */
+/* -------------------------------------------------------------------------- */
+
+static long int decodeXmpReference(unsigned char *data, long int length,
+                                   unsigned char *buf, long int *size) {
+    long int i = 0;
+    long int end = 0;
+    long int base = 10;
+    long int digit = 0;
+    unsigned long int code = 0;
+
+    for (end = 1;
+         end < length && end < XMP_REFERENCE_LENGTH && data[end] != ';'; end++)
+        ;
+
+    if (end >= length || data[end] != ';') return 0;
+
+    /* &amp; &lt; &gt; &quot; &apos; */
+
+    for (i = 0; i < XMP_ENTITY_COUNT; i++) {
+        if ((long int)strlen(xmpEntityTable[i].name) == end - 1 &&
+            memcmp(xmpEntityTable[i].name, data + 1, end - 1) == 0) {
+            buf[0] = xmpEntityTable[i].character;
+            *size = 1;
+            return end + 1;
+        }
+    }
+
+    /* &#decimal; and &#xhex; */
+
+    if (data[1] != '#') return 0;
+
+    i = 2;
+
+    if (data[i] == 'x') {
+        base = 16;
+        i++;
+    }
+
+    if (i == end) return 0;
+
+    for (; i < end; i++) {
+        if (isdigit(data[i]))
+            digit = data[i] - '0';
+        else if (base == 16 && isxdigit(data[i]))
+            digit = tolower(data[i]) - 'a' + 10;
+        else
+            return 0;
+
+        code = code * base + digit;
+    }
+
+    if (code == 0 || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+        return 0;
+
+    if (code < 0x80) {
+        buf[0] = code;
+        *size = 1;
+    } else if (code < 0x800) {
+        buf[0] = 0xC0 | (code >> 6);
+        buf[1] = 0x80 | (code & 0x3F);
+        *size = 2;
+    } else if (code < 0x10000) {
+        buf[0] = 0xE0 | (code >> 12);
+        buf[1] = 0x80 | ((code >> 6) & 0x3F);
+        buf[2] = 0x80 | (code & 0x3F);
+        *size = 3;
+    } else {
+        buf[0] = 0xF0 | (code >> 18);
+        buf[1] = 0x80 | ((code >> 12) & 0x3F);
+        buf[2] = 0x80 | ((code >> 6) & 0x3F);
+        buf[3] = 0x80 | (code & 0x3F);
+        *size = 4;
+    }
+
+    return end + 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* getXmpNameLength                                                           */
+/* returns the length of the xml name at the start of the "length" bytes at   */
+/* "data".                                                                    */
+/* -------------------------------------------------------------------------- */
+
+static long int getXmpNameLength(unsigned char *data, long int length) {
+    long int i = 0;
+
+    while (i < length && !isspace(data[i]) && data[i] != '>' &&
+           data[i] != '/' && data[i] != '=')
+        i++;
+
+    return i;
+}
+
+/* -------------------------------------------------------------------------- */
+/* skipXmpSpace                                                               */
+/* returns the position of the first byte after "pos" in "data" that is not   */
+/* white space, or "length".                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int skipXmpSpace(unsigned char *data, long int pos,
+                             long int length) {
+    while (pos < length && isspace(data[pos])) pos++;
+
+    return pos;
+}
+
+/* -------------------------------------------------------------------------- */
+/* visitMetaItem                                                              */
+/* calls "visitor" with "visitorArg" for an item of "tagCount" values of      */
+/* type "tagType" at "data", found at "dataPos" in the file. "visitCount"     */
+/* counts the tags visited so far and is checked against the limits. an item  */
+/* with more data than the limit is skipped. returns 0 if successful,         */
+/* EXIF_VISIT_STOP if the visitor stopped the walk or a negative value        */
+/* otherwise.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+static long int visitMetaItem(struct exifContext *context, long int ifdID,
+                              long int tagID, long int tagType,
+                              long int tagCount, unsigned char *data,
+                              long int dataPos, long int *visitCount,
+                              exifTagHook visitor, void *visitorArg) {
+    long int rc = 0;
+
+    struct exifItem item;
+
+    if (*visitCount >= (*context).limits.maxTags) return EXIF_ERR_LIMIT;
+
+    if (tagCount > (*context).limits.maxTagBytes) return 0;
+
+    item.exifFormat = EXIF_FORMAT_MOTO;
+    item.ifdID = ifdID;
+    item.tagPos = dataPos;
+    item.tagID = tagID;
+    item.tagType = tagType;
+    item.tagTypeSize = tagType == 4 ? 4 : 1;
+    item.tagCount = tagCount;
+    item.tagDataPos = dataPos;
+    item.tagData = data;
+
+    debugger(context, 3, "tagID = 0x%05lx", tagID);
+
+    *visitCount = *visitCount + 1;
+
+    countStat(tagsVisited, 1);
+
+    if ((rc = visitor(&item, visitorArg)) < 0) return rc;
+
+    if (rc > 0) return EXIF_VISIT_STOP;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
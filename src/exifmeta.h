@@ -0,0 +1,218 @@
+#ifndef EXIFMETA_H_INCLUDED
+#define EXIFMETA_H_INCLUDED
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exiflib.h"
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    Besides exif, a jpg file can hold more metadata in its app segments.    */
+/*    Their values are visited as exif items with tag ids above 0xffff, so    */
+/*    they never clash with exif tags and can be printed, filtered and        */
+/*    collected by name like them. The tag data points into the source.       */
+/*                                                                            */
+/*    1) XMP (app1, "http://ns.adobe.com/xap/1.0/\0") is an xml packet. It    */
+/*       is tokenized in one pass without building a tree. A known property   */
+/*       is taken from an attribute of rdf:Description or from the text of    */
+/*       its element, for lists every rdf:li. Its prefix is resolved through  */
+/*       the xmlns declarations of the packet, so "xap:Rating" is found as    */
+/*       "xmp:Rating". The predefined entities and character references are   */
+/*       decoded, such a value is visited from a copy instead of the source.  */
+/*                                                                            */
+/*       <rdf:Description xmp:Rating="5">                                     */
+/*         <dc:subject><rdf:Bag><rdf:li>beach</rdf:li></rdf:Bag></dc:subject> */
+/*                                                                            */
+/*    2) IPTC (app13, "Photoshop 3.0\0") is a list of photoshop resources.    */
+/*       Resource 0x0404 holds the iptc iim records, every dataset of the     */
+/*       application record 2 becomes an item with the id 0x20200 + dataset.  */
+/*                                                                            */
+/*       38-42-49-4D|04-04|NAME|XX-XX-XX-XX|IIM RECORDS|...                   */
+/*       8BIM       |ID   |    |SIZE       |           |                      */
+/*                                                                            */
+/*       1C |02    |XX     |XX-XX|DATA|1C|...                                 */
+/*       TAG|RECORD|DATASET|SIZE |    |                                       */
+/*                                                                            */
+/*    3) ICC (app2, "ICC_PROFILE\0", sequence and count) starts with a 128    */
+/*       byte header in the first chunk. Its fields become items with the     */
+/*       id 0x30000 + offset, the v2 description with 0x30100.                */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define XMP_LOOKUP_COUNT 20
+#define XMP_NAMESPACE_COUNT 6
+#define XMP_ENTITY_COUNT 5
+#define XMP_REFERENCE_LENGTH 16
+#define ICC_LOOKUP_COUNT 11
+
+#define ICC_HEADER_LENGTH 128
+
+#define TAG_ID_IPTC 0x20200
+#define TAG_ID_ICC 0x30000
+#define TAG_ID_ICC_DESCRIPTION 0x30100
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct xmpLookupItem {
+    char *xmpName;
+    long int tagID;
+};
+
+struct xmpNamespaceItem {
+    char *uri;
+    char *prefix;
+};
+
+struct xmpPrefixItem {
+    unsigned char *name;
+    long int length;
+};
+
+struct xmpEntityItem {
+    char *name;
+    unsigned char character;
+};
+
+struct iccLookupItem {
+    long int offset;
+    long int tagType;
+    long int tagCount;
+};
+
+/* -------------------------------------------------------------------------- */
+/* lookup tables                                                              */
+/* -------------------------------------------------------------------------- */
+
+static struct xmpLookupItem xmpLookupTable[XMP_LOOKUP_COUNT] = {
+
+    {"xmp:Rating", 0x10001},
+    {"xmp:Label", 0x10002},
+    {"xmp:CreatorTool", 0x10003},
+    {"xmp:CreateDate", 0x10004},
+    {"xmp:ModifyDate", 0x10005},
+    {"xmp:MetadataDate", 0x10006},
+    {"dc:creator", 0x10007},
+    {"dc:title", 0x10008},
+    {"dc:description", 0x10009},
+    {"dc:rights", 0x1000a},
+    {"dc:subject", 0x1000b},
+    {"photoshop:Headline", 0x1000c},
+    {"photoshop:City", 0x1000d},
+    {"photoshop:State", 0x1000e},
+    {"photoshop:Country", 0x1000f},
+    {"photoshop:DateCreated", 0x10010},
+    {"Iptc4xmpCore:Location", 0x10011},
+    {"xmpMM:DocumentID", 0x10012},
+    {"xmpMM:InstanceID", 0x10013},
+    {"xmpRights:UsageTerms", 0x10014}
+
+};
+
+/* the prefixes of the lookup table are the usual ones of these namespaces */
+
+static struct xmpNamespaceItem xmpNamespaceTable[XMP_NAMESPACE_COUNT] = {
+
+    {"http://ns.adobe.com/xap/1.0/", "xmp"},
+    {"http://purl.org/dc/elements/1.1/", "dc"},
+    {"http://ns.adobe.com/photoshop/1.0/", "photoshop"},
+    {"http://iptc.org/std/Iptc4xmpCore/1.0/xmlns/", "Iptc4xmpCore"},
+    {"http://ns.adobe.com/xap/1.0/mm/", "xmpMM"},
+    {"http://ns.adobe.com/xap/1.0/rights/", "xmpRights"}
+
+};
+
+static struct xmpEntityItem xmpEntityTable[XMP_ENTITY_COUNT] = {
+
+    {"amp", '&'}, {"lt", '<'}, {"gt", '>'}, {"quot", '"'}, {"apos", '\''}
+
+};
+
+static struct iccLookupItem iccLookupTable[ICC_LOOKUP_COUNT] = {
+
+    {0, 4, 1},   // profile size
+    {4, 2, 4},   // cmm type
+    {8, 1, 1},   // major version
+    {12, 2, 4},  // profile class
+    {16, 2, 4},  // color space
+    {20, 2, 4},  // connection space
+    {40, 2, 4},  // platform
+    {48, 2, 4},  // device manufacturer
+    {52, 2, 4},  // device model
+    {64, 4, 1},  // rendering intent
+    {80, 2, 4}   // creator
+
+};
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int visitXmpPacket(struct exifContext *context, unsigned char *data,
+                        long int dataPos, long int length, long int *tagCount,
+                        exifTagHook visitor, void *visitorArg);
+
+long int visitIptcResources(struct exifContext *context, unsigned char *data,
+                            long int dataPos, long int length,
+                            long int *tagCount, exifTagHook visitor,
+                            void *visitorArg);
+
+long int visitIccHeader(struct exifContext *context, unsigned char *data,
+                        long int dataPos, long int length, long int *tagCount,
+                        exifTagHook visitor, void *visitorArg);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int visitIimRecords(struct exifContext *context,
+                                unsigned char *data, long int dataPos,
+                                long int length, long int *tagCount,
+                                exifTagHook visitor, void *visitorArg);
+
+static long int visitIccDescription(struct exifContext *context,
+                                    unsigned char *data, long int dataPos,
+                                    long int length, long int *tagCount,
+                                    exifTagHook visitor, void *visitorArg);
+
+static void readXmpPrefixes(unsigned char *data, long int length,
+                            struct xmpPrefixItem *prefixes);
+
+static long int findXmpProperty(unsigned char *name, long int nameLength,
+                                struct xmpPrefixItem *prefixes);
+
+static long int visitXmpValue(struct exifContext *context, long int tagID,
+                              unsigned char *data, long int dataPos,
+                              long int length, long int *tagCount,
+                              exifTagHook visitor, void *visitorArg);
+
+static long int decodeXmpEntities(unsigned char *data, long int length,
+                                  unsigned char *buf);
+
+static long int decodeXmpReference(unsigned char *data, long int length,
+                                   unsigned char *buf, long int *size);
+
+static long int getXmpNameLength(unsigned char *data, long int length);
+
+static long int skipXmpSpace(unsigned char *data, long int pos,
+                             long int length);
+
+static long int visitMetaItem(struct exifContext *context, long int ifdID,
+                              long int tagID, long int tagType,
+                              long int tagCount, unsigned char *data,
+                              long int dataPos, long int *visitCount,
+                              exifTagHook visitor, void *visitorArg);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
+
+/* -------------------------------------------------------------------------- */
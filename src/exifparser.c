@@ -78,6 +78,10 @@ char *parseTagType(struct exifItem *tag) {
             if (sprintf_wr(&tagTypeName, "DOUBLEF") < 0) return NULL;
             break;
 
+        case 13:
+            if (sprintf_wr(&tagTypeName, "IFD") < 0) return NULL;
+            break;
+
         default:
 
             break;
@@ -88,11 +92,13 @@ char *parseTagType(struct exifItem *tag) {
 
 /* -------------------------------------------------------------------------- */
 /* parseTagData                                                               */
-/* parsed the tag data of an exif item "tag".                                 */
+/* parsed the tag data of an exif item "tag". returns NULL for a tag without  */
+/* data.                                                                      */
 /* -------------------------------------------------------------------------- */
 
 char *parseTagData(struct exifItem *tag) {
     char *tagData = NULL;
+    char *previous = NULL;
     long int i = 0;
 
     int n = 0;
@@ -101,21 +107,24 @@ char *parseTagData(struct exifItem *tag) {
     double fnumber = 0.0;
     long int ldnumber = 0;
 
+    if ((*tag).tagCount < 1 || (*tag).tagData == NULL) return NULL;
+
     switch ((*tag).tagType) {
         case 1:  // byte
             for (i = 0; i < (*tag).tagCount; i++) {
                 ldnumber = castUInt8((*tag).tagData + i, (*tag).exifFormat);
-                if ((n = sprintf_wr(&tagData,
-                                    length == 0 ? "%s%ld" : "%s | %ld",
-                                    length == 0 ? "" : tagData, ldnumber)) < 0)
-                    return NULL;
+                previous = tagData;
+                n = sprintf_wr(&tagData, length == 0 ? "%s%ld" : "%s | %ld",
+                               length == 0 ? "" : previous, ldnumber);
+                free(previous);
+                if (n < 0) return NULL;
                 length += n;
             }
             break;
 
-        case 2:  // ascii
-            if (snprintf_wr(&tagData, (*tag).tagCount * (*tag).tagTypeSize,
-                            "%s", (*tag).tagData) < 0)
+        case 2:  // ascii - the data is not always null-terminated
+            if (snprintf_wr(&tagData, (*tag).tagCount * (*tag).tagTypeSize + 1,
+                            "%.*s", (int)(*tag).tagCount, (*tag).tagData) < 0)
                 return NULL;
             break;
 
@@ -124,7 +133,8 @@ char *parseTagData(struct exifItem *tag) {
             if (sprintf_wr(&tagData, "%ld", ldnumber) < 0) return NULL;
             break;
 
-        case 4:  // long
+        case 4:   // long
+        case 13:  // ifd
             ldnumber = castUInt32((*tag).tagData, (*tag).exifFormat);
             if (sprintf_wr(&tagData, "%ld", ldnumber) < 0) return NULL;
             break;
@@ -137,10 +147,11 @@ char *parseTagData(struct exifItem *tag) {
                 ldnumber =
                     castUInt32((*tag).tagData + (i * 8) + 4, (*tag).exifFormat);
                 fnumber = fnumber / (double)ldnumber;
-                if ((n = sprintf_wr(&tagData,
-                                    length == 0 ? "%s%.4f" : "%s | %.4f",
-                                    length == 0 ? "" : tagData, fnumber)) < 0)
-                    return NULL;
+                previous = tagData;
+                n = sprintf_wr(&tagData, length == 0 ? "%s%.4f" : "%s | %.4f",
+                               length == 0 ? "" : previous, fnumber);
+                free(previous);
+                if (n < 0) return NULL;
                 length += n;
             }
             break;
@@ -153,10 +164,11 @@ char *parseTagData(struct exifItem *tag) {
                 ldnumber =
                     castInt32((*tag).tagData + (i * 8) + 4, (*tag).exifFormat);
                 fnumber = fnumber / (double)ldnumber;
-                if ((n = sprintf_wr(&tagData,
-                                    length == 0 ? "%s%.4f" : "%s | %.4f",
-                                    length == 0 ? "" : tagData, fnumber)) < 0)
-                    return NULL;
+                previous = tagData;
+                n = sprintf_wr(&tagData, length == 0 ? "%s%.4f" : "%s | %.4f",
+                               length == 0 ? "" : previous, fnumber);
+                free(previous);
+                if (n < 0) return NULL;
                 length += n;
             }
             break;
@@ -169,61 +181,208 @@ char *parseTagData(struct exifItem *tag) {
     return tagData;
 }
 
+/* -------------------------------------------------------------------------- */
+/* parseTagNumber                                                             */
+/* writes the first value of a numeric exif item "tag" to "number". ascii     */
+/* data is converted if it starts with a number. returns 0 if successful or   */
+/* a negative value otherwise.                                                */
+/* -------------------------------------------------------------------------- */
+
+long int parseTagNumber(struct exifItem *tag, double *number) {
+    char *end = NULL;
+    long int denominator = 0;
+
+    if ((*tag).tagCount < 1 || (*tag).tagData == NULL)
+        return EXIF_ERR_INVALID_FORMAT;
+
+    switch ((*tag).tagType) {
+        case 1:  // byte
+        case 7:  // undefined
+            *number = castUInt8((*tag).tagData, (*tag).exifFormat);
+            break;
+
+        case 2:  // ascii
+            *number = strtod((char *)(*tag).tagData, &end);
+            if (end == (char *)(*tag).tagData) return EXIF_ERR_INVALID_FORMAT;
+            break;
+
+        case 3:  // short
+            *number = castUInt16((*tag).tagData, (*tag).exifFormat);
+            break;
+
+        case 4:   // long
+        case 13:  // ifd
+            *number = castUInt32((*tag).tagData, (*tag).exifFormat);
+            break;
+
+        case 6:  // sbyte
+            *number = (int8_t)castUInt8((*tag).tagData, (*tag).exifFormat);
+            break;
+
+        case 8:  // sshort
+            *number = (int16_t)castUInt16((*tag).tagData, (*tag).exifFormat);
+            break;
+
+        case 9:  // slong
+            *number = castInt32((*tag).tagData, (*tag).exifFormat);
+            break;
+
+        case 5:  // rational
+            if ((denominator = castUInt32((*tag).tagData + 4,
+                                          (*tag).exifFormat)) == 0)
+                return EXIF_ERR_INVALID_FORMAT;
+            *number = (double)castUInt32((*tag).tagData, (*tag).exifFormat) /
+                      denominator;
+            break;
+
+        case 10:  // srational
+            if ((denominator = castInt32((*tag).tagData + 4,
+                                         (*tag).exifFormat)) == 0)
+                return EXIF_ERR_INVALID_FORMAT;
+            *number = (double)castInt32((*tag).tagData, (*tag).exifFormat) /
+                      denominator;
+            break;
+
+        default:
+            return EXIF_ERR_INVALID_FORMAT;
+    }
+
+    return 0;
+}
+
 /* -------------------------------------------------------------------------- */
 /* parseSpecialGPS                                                            */
 /* special parser for gps data.                                               */
 /* -------------------------------------------------------------------------- */
 
 char *parseSpecialGPS(struct exifItem *exifTable, long int exifTableItemCount) {
-    struct exifItem *tag = NULL;
     char *gps = NULL;
 
     double latitude = 0;
     double longitude = 0;
 
-    if ((tag = findTagByName(exifTable, exifTableItemCount, "GPSLatitude")) ==
-        NULL)
+    if (parseGPSCoordinates(exifTable, exifTableItemCount, &latitude,
+                            &longitude) < 0)
         return NULL;
 
-    latitude =
-        ((double)castUInt32((*tag).tagData + (0 * 8), (*tag).exifFormat) /
-         castUInt32((*tag).tagData + (0 * 8) + 4, (*tag).exifFormat)) +
-        ((double)castUInt32((*tag).tagData + (1 * 8), (*tag).exifFormat) /
-         castUInt32((*tag).tagData + (1 * 8) + 4, (*tag).exifFormat)) /
-            60 +
-        ((double)castUInt32((*tag).tagData + (2 * 8), (*tag).exifFormat) /
-         castUInt32((*tag).tagData + (2 * 8) + 4, (*tag).exifFormat)) /
-            3600;
+    if (sprintf_wr(&gps, "%.4f,%.4f", latitude, longitude) < 0) return NULL;
+
+    return gps;
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseGPSCoordinates                                                        */
+/* writes the gps position of "exifTable" in signed decimal degrees to        */
+/* "latitude" and "longitude". returns 0 if successful or a negative value    */
+/* if the table does not contain a complete position.                         */
+/* -------------------------------------------------------------------------- */
+
+long int parseGPSCoordinates(struct exifItem *exifTable,
+                             long int exifTableItemCount, double *latitude,
+                             double *longitude) {
+    struct exifItem *tag = NULL;
+
+    if ((tag = findTagByName(exifTable, exifTableItemCount, "GPSLatitude")) ==
+            NULL ||
+        (*tag).tagCount < 3)
+        return EXIF_ERR_NO_GPS;
+
+    *latitude = parseDegrees(tag);
 
     if ((tag = findTagByName(exifTable, exifTableItemCount, "GPSLongitude")) ==
-        NULL)
-        return NULL;
+            NULL ||
+        (*tag).tagCount < 3)
+        return EXIF_ERR_NO_GPS;
 
-    longitude =
-        ((double)castUInt32((*tag).tagData + (0 * 8), (*tag).exifFormat) /
-         castUInt32((*tag).tagData + (0 * 8) + 4, (*tag).exifFormat)) +
-        ((double)castUInt32((*tag).tagData + (1 * 8), (*tag).exifFormat) /
-         castUInt32((*tag).tagData + (1 * 8) + 4, (*tag).exifFormat)) /
-            60 +
-        ((double)castUInt32((*tag).tagData + (2 * 8), (*tag).exifFormat) /
-         castUInt32((*tag).tagData + (2 * 8) + 4, (*tag).exifFormat)) /
-            3600;
+    *longitude = parseDegrees(tag);
 
     if ((tag = findTagByName(exifTable, exifTableItemCount,
                              "GPSLongitudeRef")) == NULL)
-        return NULL;
+        return EXIF_ERR_NO_GPS;
 
-    if (strcmp("W", parseTagData(tag)) == 0) longitude = 0 - longitude;
+    if ((*tag).tagData[0] == 'W') *longitude = 0 - *longitude;
 
     if ((tag = findTagByName(exifTable, exifTableItemCount,
                              "GPSLatitudeRef")) == NULL)
-        return NULL;
+        return EXIF_ERR_NO_GPS;
 
-    if (strcmp("S", parseTagData(tag)) == 0) latitude = 0 - latitude;
+    if ((*tag).tagData[0] == 'S') *latitude = 0 - *latitude;
 
-    if (sprintf_wr(&gps, "%.4f,%.4f", latitude, longitude) < 0) return NULL;
+    return 0;
+}
 
-    return gps;
+/* -------------------------------------------------------------------------- */
+/* parseDateTimeISO                                                           */
+/* writes the time a picture was taken as "YYYY-MM-DDTHH:MM:SS" to            */
+/* "dateTime", which must hold DATETIME_ISO_LENGTH chars. DateTimeOriginal    */
+/* is used if present, otherwise GPSDateStamp and GPSTimeStamp (utc, marked   */
+/* with a trailing "Z"). returns 0 if successful or a negative value if the   */
+/* table contains no time.                                                    */
+/* -------------------------------------------------------------------------- */
+
+long int parseDateTimeISO(struct exifItem *exifTable,
+                          long int exifTableItemCount, char *dateTime) {
+    struct exifItem *tag = NULL;
+    struct exifItem *timeTag = NULL;
+    int n[6] = {0, 0, 0, 0, 0, 0};
+
+    if ((tag = findTagByName(exifTable, exifTableItemCount,
+                             "DateTimeOriginal")) != NULL &&
+        (*tag).tagType == 2 && (*tag).tagCount >= 19 &&
+        sscanf((char *)(*tag).tagData, "%4d:%2d:%2d %2d:%2d:%2d", &n[0], &n[1],
+               &n[2], &n[3], &n[4], &n[5]) == 6) {
+        snprintf(dateTime, DATETIME_ISO_LENGTH,
+                 "%04d-%02d-%02dT%02d:%02d:%02d", n[0], n[1], n[2], n[3], n[4],
+                 n[5]);
+        return 0;
+    }
+
+    if ((tag = findTagByName(exifTable, exifTableItemCount, "GPSDateStamp")) ==
+            NULL ||
+        (*tag).tagType != 2 || (*tag).tagCount < 10 ||
+        sscanf((char *)(*tag).tagData, "%4d:%2d:%2d", &n[0], &n[1], &n[2]) !=
+            3)
+        return EXIF_ERR_NO_TIME;
+
+    if ((timeTag = findTagByName(exifTable, exifTableItemCount,
+                                 "GPSTimeStamp")) != NULL &&
+        (*timeTag).tagType == 5 && (*timeTag).tagCount >= 3) {
+        n[3] = parseRational(timeTag, 0);
+        n[4] = parseRational(timeTag, 1);
+        n[5] = parseRational(timeTag, 2);
+    }
+
+    snprintf(dateTime, DATETIME_ISO_LENGTH, "%04d-%02d-%02dT%02d:%02d:%02dZ",
+             n[0], n[1], n[2], n[3] % 100, n[4] % 100, n[5] % 100);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseRational                                                              */
+/* returns rational number "i" of tag "tag", or zero if its denominator is    */
+/* zero.                                                                      */
+/* -------------------------------------------------------------------------- */
+
+static double parseRational(struct exifItem *tag, long int i) {
+    long int denominator =
+        castUInt32((*tag).tagData + (i * 8) + 4, (*tag).exifFormat);
+
+    if (denominator == 0) return 0;
+
+    return (double)castUInt32((*tag).tagData + (i * 8), (*tag).exifFormat) /
+           denominator;
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseDegrees                                                               */
+/* converts a gps tag "tag" of three rationals (degrees, minutes and          */
+/* seconds) to decimal degrees.                                               */
+/* -------------------------------------------------------------------------- */
+
+static double parseDegrees(struct exifItem *tag) {
+    return parseRational(tag, 0) + parseRational(tag, 1) / 60 +
+           parseRational(tag, 2) / 3600;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -251,6 +410,53 @@ struct exifItem *findTagByName(struct exifItem *exifTable,
     return result;
 }
 
+/* -------------------------------------------------------------------------- */
+/* findTagIDByName                                                            */
+/* returns the tag id of the tag named "tagName" using the lookup table, or   */
+/* a negative value if the name is unknown.                                   */
+/* -------------------------------------------------------------------------- */
+
+long int findTagIDByName(char *tagName) {
+    int i = 0;
+
+    for (i = 0; i < LOOKUP_TAG_ID; i++) {
+        if (strcmp(idLookupTable[i].tagName, tagName) == 0)
+            return idLookupTable[i].tagID;
+    }
+
+    return EXIF_ERR_INVALID_FORMAT;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findMakerNoteTag                                                           */
+/* returns 1 if "text", e.g. a tag list, filter or pattern, contains the name */
+/* of a maker note tag as a whole word, or 0 otherwise.                       */
+/* -------------------------------------------------------------------------- */
+
+long int findMakerNoteTag(char *text) {
+    int i = 0;
+    long int length = 0;
+    char *match = NULL;
+
+    if (text == NULL) return 0;
+
+    for (i = 0; i < LOOKUP_TAG_ID; i++) {
+        if ((idLookupTable[i].tagID & 0xF0000) != TAG_ID_MAKERNOTE) continue;
+
+        length = strlen(idLookupTable[i].tagName);
+
+        for (match = strstr(text, idLookupTable[i].tagName); match != NULL;
+             match = strstr(match + 1, idLookupTable[i].tagName)) {
+            if ((match == text ||
+                 (!isalnum(match[-1]) && match[-1] != '_')) &&
+                !isalnum(match[length]) && match[length] != '_')
+                return 1;
+        }
+    }
+
+    return 0;
+}
+
 /* -------------------------------------------------------------------------- */
 /* sprintf_wr                                                                 */
 /* wrapper for sprintf that included memory management.                       */
@@ -273,6 +479,8 @@ int sprintf_wr(char **buf, char *fmt, ...) {
         return EXIF_ERR_MALLOC;
     }
 
+    countStat(allocations, 1);
+
     vsnprintf(*buf, length + 1, fmt, va2);
 
     va_end(va2);
@@ -282,10 +490,11 @@ int sprintf_wr(char **buf, char *fmt, ...) {
 
 /* -------------------------------------------------------------------------- */
 /* snprintf_wr                                                                */
-/* wrapper for snprintf that included memory management.                      */
+/* wrapper for snprintf that included memory management. returns "n" if       */
+/* successful or a negative value otherwise.                                  */
 /* -------------------------------------------------------------------------- */
 
-size_t snprintf_wr(char **buf, size_t n, char *fmt, ...) {
+long int snprintf_wr(char **buf, size_t n, char *fmt, ...) {
     va_list va;
 
     va_start(va, fmt);
@@ -295,6 +504,8 @@ size_t snprintf_wr(char **buf, size_t n, char *fmt, ...) {
         return EXIF_ERR_MALLOC;
     }
 
+    countStat(allocations, 1);
+
     vsnprintf(*buf, n, fmt, va);
 
     va_end(va);
@@ -1,6 +1,7 @@
 #ifndef EXIFPARSER_H_INCLUDED
 #define EXIFPARSER_H_INCLUDED
 
+#include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
 #include <math.h>
@@ -12,12 +13,18 @@
 #include <sys/stat.h>
 
 #include "exiflib.h"
+#include "exifmakernote.h"
 
 /* -------------------------------------------------------------------------- */
 /* definitions                                                                */
 /* -------------------------------------------------------------------------- */
 
-#define LOOKUP_TAG_ID 146
+#define LOOKUP_TAG_ID 210
+
+/* "YYYY-MM-DDTHH:MM:SSZ" with room for any int in the fields of a broken     */
+/* file                                                                       */
+
+#define DATETIME_ISO_LENGTH 49
 
 /* -------------------------------------------------------------------------- */
 /* structs                                                                    */
@@ -179,7 +186,71 @@ static struct idLookupItem idLookupTable[LOOKUP_TAG_ID] = {
     {0x001c, "GPSAreaInformation"},
     {0x001d, "GPSDateStamp"},
     {0x001e, "GPSDifferential"},
-    {0x001f, "GPSHPositioningError"}
+    {0x001f, "GPSHPositioningError"},
+    {0x10001, "XMPRating"},
+    {0x10002, "XMPLabel"},
+    {0x10003, "XMPCreatorTool"},
+    {0x10004, "XMPCreateDate"},
+    {0x10005, "XMPModifyDate"},
+    {0x10006, "XMPMetadataDate"},
+    {0x10007, "XMPCreator"},
+    {0x10008, "XMPTitle"},
+    {0x10009, "XMPDescription"},
+    {0x1000a, "XMPRights"},
+    {0x1000b, "XMPSubject"},
+    {0x1000c, "XMPHeadline"},
+    {0x1000d, "XMPCity"},
+    {0x1000e, "XMPState"},
+    {0x1000f, "XMPCountry"},
+    {0x10010, "XMPDateCreated"},
+    {0x10011, "XMPLocation"},
+    {0x10012, "XMPDocumentID"},
+    {0x10013, "XMPInstanceID"},
+    {0x10014, "XMPUsageTerms"},
+    {0x20205, "IPTCObjectName"},
+    {0x2020f, "IPTCCategory"},
+    {0x20214, "IPTCSupplementalCategories"},
+    {0x20219, "IPTCKeywords"},
+    {0x20228, "IPTCSpecialInstructions"},
+    {0x20237, "IPTCDateCreated"},
+    {0x2023c, "IPTCTimeCreated"},
+    {0x20250, "IPTCByline"},
+    {0x20255, "IPTCBylineTitle"},
+    {0x2025a, "IPTCCity"},
+    {0x2025c, "IPTCSublocation"},
+    {0x2025f, "IPTCProvinceState"},
+    {0x20264, "IPTCCountryCode"},
+    {0x20265, "IPTCCountryName"},
+    {0x20267, "IPTCOriginalTransmissionReference"},
+    {0x20269, "IPTCHeadline"},
+    {0x2026e, "IPTCCredit"},
+    {0x20273, "IPTCSource"},
+    {0x20274, "IPTCCopyrightNotice"},
+    {0x20276, "IPTCContact"},
+    {0x20278, "IPTCCaption"},
+    {0x2027a, "IPTCWriter"},
+    {0x30000, "ICCProfileSize"},
+    {0x30004, "ICCCMMType"},
+    {0x30008, "ICCVersion"},
+    {0x3000c, "ICCProfileClass"},
+    {0x30010, "ICCColorSpace"},
+    {0x30014, "ICCConnectionSpace"},
+    {0x30028, "ICCPlatform"},
+    {0x30030, "ICCDeviceManufacturer"},
+    {0x30034, "ICCDeviceModel"},
+    {0x30040, "ICCRenderingIntent"},
+    {0x30050, "ICCCreator"},
+    {0x30100, "ICCDescription"},
+    {0x40001, "LensType"},
+    {0x40002, "ShutterCount"},
+    {0x40003, "InternalSerialNumber"},
+    {0x40004, "SerialNumber"},
+    {0x40005, "FirmwareVersion"},
+    {0x40006, "Lens"},
+    {0x40007, "Quality"},
+    {0x40008, "CameraType"},
+    {0x40009, "FilmMode"},
+    {0x4000a, "ModelID"}
 
 };
 
@@ -193,14 +264,35 @@ char *parseTagType(struct exifItem *tag);
 
 char *parseTagData(struct exifItem *tag);
 
+long int parseTagNumber(struct exifItem *tag, double *number);
+
 char *parseSpecialGPS(struct exifItem *exifTable, long int exifTableItemCount);
 
+long int parseGPSCoordinates(struct exifItem *exifTable,
+                             long int exifTableItemCount, double *latitude,
+                             double *longitude);
+
+long int parseDateTimeISO(struct exifItem *exifTable,
+                          long int exifTableItemCount, char *dateTime);
+
 struct exifItem *findTagByName(struct exifItem *exifTable,
                                int exifTableItemCount, char *tagName);
 
+long int findTagIDByName(char *tagName);
+
+long int findMakerNoteTag(char *text);
+
 int sprintf_wr(char **buf, char *fmt, ...);
 
-size_t snprintf_wr(char **buf, size_t n, char *fmt, ...);
+long int snprintf_wr(char **buf, size_t n, char *fmt, ...);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static double parseDegrees(struct exifItem *tag);
+
+static double parseRational(struct exifItem *tag, long int i);
 
 /* -------------------------------------------------------------------------- */
 
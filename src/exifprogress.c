@@ -0,0 +1,137 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifprogress.h"
+
+/* -------------------------------------------------------------------------- */
+/* variables                                                                  */
+/* -------------------------------------------------------------------------- */
+
+int progressEnabled = 0;
+long int progressFilesDone = 0;
+long int progressFilesFound = 0;
+
+static pthread_t progressThread;
+static int progressStop = 0;
+static struct progressSample progressStart;
+
+/* -------------------------------------------------------------------------- */
+/* startProgress                                                              */
+/* starts the sampler thread, which prints the progress to stderr every       */
+/* PROGRESS_INTERVAL seconds and at once on SIGUSR1. SIGUSR1 is blocked in    */
+/* the calling thread and so in all threads it starts later, only the         */
+/* sampler waits for it. call before any worker threads are started. returns  */
+/* 0 if successful or a negative value otherwise.                             */
+/* -------------------------------------------------------------------------- */
+
+long int startProgress(void) {
+    sigset_t signals;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+
+    if (pthread_sigmask(SIG_BLOCK, &signals, NULL) != 0)
+        return PROGRESS_ERR_SIGNAL;
+
+    takeProgressSample(&progressStart);
+    progressEnabled = 1;
+
+    if (pthread_create(&progressThread, NULL, progressLoop, NULL) != 0) {
+        progressEnabled = 0;
+        return PROGRESS_ERR_THREAD;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* stopProgress                                                               */
+/* wakes and stops the sampler thread, which prints a last line.              */
+/* -------------------------------------------------------------------------- */
+
+void stopProgress(void) {
+    if (!progressEnabled) return;
+
+    __atomic_store_n(&progressStop, 1, __ATOMIC_RELAXED);
+
+    pthread_kill(progressThread, SIGUSR1);
+    pthread_join(progressThread, NULL);
+
+    progressEnabled = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* progressLoop                                                               */
+/* thread function of the sampler. waits for SIGUSR1 or the next interval     */
+/* and prints a line.                                                         */
+/* -------------------------------------------------------------------------- */
+
+static void *progressLoop(void *arg) {
+    sigset_t signals;
+    struct timespec interval = {PROGRESS_INTERVAL, 0};
+    struct progressSample sample;
+
+    (void)arg;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+
+    /* the wake up from stopProgress prints the last line */
+
+    do {
+        if (sigtimedwait(&signals, NULL, &interval) < 0 && errno == EINTR)
+            continue;
+
+        takeProgressSample(&sample);
+        printProgress(stderr, &sample);
+    } while (!__atomic_load_n(&progressStop, __ATOMIC_RELAXED));
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/* takeProgressSample                                                         */
+/* reads the counters, the bytes read by the process and the time into        */
+/* "sample".                                                                  */
+/* -------------------------------------------------------------------------- */
+
+static void takeProgressSample(struct progressSample *sample) {
+    struct benchIo io;
+
+    (*sample).filesDone = __atomic_load_n(&progressFilesDone, __ATOMIC_RELAXED);
+    (*sample).filesFound =
+        __atomic_load_n(&progressFilesFound, __ATOMIC_RELAXED);
+    (*sample).readBytes = readBenchIo(&io) == 0 ? io.readBytes : 0;
+    (*sample).time = benchTime();
+}
+
+/* -------------------------------------------------------------------------- */
+/* printProgress                                                              */
+/* prints files done and found, files/s and MB/s since the start and the      */
+/* estimated time left of "sample" to "stream".                               */
+/* -------------------------------------------------------------------------- */
+
+static void printProgress(FILE *stream, struct progressSample *sample) {
+    double elapsed = (*sample).time - progressStart.time;
+    double filesPerSecond = 0;
+    double bytesPerSecond = 0;
+    long int filesLeft = (*sample).filesFound - (*sample).filesDone;
+
+    if (elapsed > 0) {
+        filesPerSecond = (*sample).filesDone / elapsed;
+        bytesPerSecond = ((*sample).readBytes - progressStart.readBytes) /
+                         elapsed;
+    }
+
+    if (filesLeft < 0) filesLeft = 0;
+
+    fprintf(stream, "progress: %ld/%ld files, %.0f files/s, %.1f MB/s, ",
+            (*sample).filesDone, (*sample).filesFound, filesPerSecond,
+            bytesPerSecond / 1e6);
+
+    if (filesPerSecond > 0)
+        fprintf(stream, "eta %.0f s\n", filesLeft / filesPerSecond);
+    else
+        fprintf(stream, "eta n/a\n");
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,72 @@
+#ifndef EXIFPROGRESS_H_INCLUDED
+#define EXIFPROGRESS_H_INCLUDED
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "exifbench.h"
+
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define PROGRESS_INTERVAL 1
+
+#define PROGRESS_ERR_SIGNAL -881
+#define PROGRESS_ERR_THREAD -882
+
+/* workers only bump relaxed atomic counters - the sampler thread reads and   */
+/* prints them.                                                               */
+
+#define countProgress(counter)                                          \
+    do {                                                                \
+        if (progressEnabled)                                            \
+            __atomic_fetch_add(&(counter), 1, __ATOMIC_RELAXED);        \
+    } while (0)
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct progressSample {
+    long int filesDone;
+    long int filesFound;
+    long int readBytes;
+    double time;
+};
+
+/* -------------------------------------------------------------------------- */
+/* variables                                                                  */
+/* -------------------------------------------------------------------------- */
+
+extern int progressEnabled;
+extern long int progressFilesDone;
+extern long int progressFilesFound;
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int startProgress(void);
+
+void stopProgress(void);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static void *progressLoop(void *arg);
+
+static void takeProgressSample(struct progressSample *sample);
+
+static void printProgress(FILE *stream, struct progressSample *sample);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
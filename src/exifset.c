@@ -0,0 +1,512 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifset.h"
+
+/* -------------------------------------------------------------------------- */
+/* parseSetEdits                                                              */
+/* parses the "tagTableItemCount" edits in "tagTable", each "Tag=value",      */
+/* "Tag+=shift" or "Tag-=shift", to "edits". the values point into            */
+/* "tagTable". returns the number of edits if successful or a negative value  */
+/* otherwise.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+long int parseSetEdits(char **tagTable, long int tagTableItemCount,
+                       struct setEdit **edits) {
+    long int i = 0;
+    long int rc = 0;
+    long int nameLength = 0;
+
+    char *equalPos = NULL;
+    struct setEdit *edit = NULL;
+
+    if ((*edits = (struct setEdit *)calloc(tagTableItemCount + 1,
+                                           sizeof(struct setEdit))) == NULL)
+        return SET_ERR_MALLOC;
+
+    for (i = 0; i < tagTableItemCount; i++) {
+        edit = &(*edits)[i];
+
+        if ((equalPos = strchr(tagTable[i], '=')) == NULL) return SET_ERR_EDIT;
+
+        nameLength = equalPos - tagTable[i];
+        (*edit).op = SET_OP_ASSIGN;
+        (*edit).value = equalPos + 1;
+
+        /* a time shift has a sign in front of the equal sign */
+
+        if (nameLength > 0 && (equalPos[-1] == '+' || equalPos[-1] == '-')) {
+            (*edit).op = SET_OP_SHIFT;
+            nameLength--;
+
+            if ((rc = parseSetShift(equalPos + 1, &(*edit).shift)) < 0)
+                return rc;
+
+            if (equalPos[-1] == '-') (*edit).shift = -(*edit).shift;
+        }
+
+        if (((*edit).tagName = (char *)malloc(nameLength + 1)) == NULL)
+            return SET_ERR_MALLOC;
+
+        memcpy((*edit).tagName, tagTable[i], nameLength);
+        (*edit).tagName[nameLength] = '\0';
+
+        /* only the tags of the ifds can be edited */
+
+        if (((*edit).tagID = findTagIDByName((*edit).tagName)) < 0 ||
+            (*edit).tagID > 0xffff)
+            return SET_ERR_TAG;
+    }
+
+    return tagTableItemCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* setFileTags                                                                */
+/* applies the "editCount" edits in "edits" to the file "fileName" if it      */
+/* matches "filter", which may be null. with "simulate", the file is not      */
+/* written. returns the number of tags edited, EXIF_FILTERED if the file does */
+/* not match or another negative value otherwise.                             */
+/* -------------------------------------------------------------------------- */
+
+long int setFileTags(char *fileName, struct setEdit *edits,
+                     long int editCount, struct exifFilter *filter,
+                     int simulate) {
+    long int i = 0;
+    long int rc = 0;
+    int jpg = 0;
+
+    struct exifSource source;
+    struct setState state = {edits, editCount, NULL, 0, NULL, NULL, 0, 0};
+
+    if ((state.found = (int *)calloc(editCount, sizeof(int))) == NULL ||
+        (state.growIfds = (long int *)calloc(editCount, sizeof(long int))) ==
+            NULL) {
+        free(state.found);
+        return SET_ERR_MALLOC;
+    }
+
+    if ((rc = openExifSource(&exifDefaultContext, fileName, &source)) < 0) {
+        free(state.found);
+        free(state.growIfds);
+        return rc;
+    }
+
+    /* collect the patches in one walk */
+
+    if (loadExifSource(&source, 0, PNG_SIGNATURE_LENGTH) == 0 &&
+        memcmp(source.data, pngSignature, PNG_SIGNATURE_LENGTH) == 0)
+        rc = SET_ERR_FORMAT;
+    else
+        rc = visitExifInfoFiltered(&source, filter, setTagHook, &state);
+
+    if (rc >= 0 && state.rc < 0) rc = state.rc;
+
+    /* missing text tags are added to jpg files, also without exif */
+
+    jpg = loadExifSource(&source, 0, SOI_MARKER_LENGTH) == 0 &&
+          memcmp(source.data, soiMarker, SOI_MARKER_LENGTH) == 0;
+
+    if (rc == EXIF_ERR_NO_EXIF && jpg && filter == NULL) rc = 0;
+
+    for (i = 0; i < editCount && rc >= 0 && jpg; i++)
+        if (!state.found[i] &&
+            (state.growIfds[i] = findNewTagIfd(&edits[i])) > 0)
+            state.growCount = state.growCount + 1;
+
+    /* write them - every edit is checked before the first byte is written */
+
+    if (rc >= 0 && state.growCount > 0)
+        rc = growSetTags(fileName, &source, &state, simulate);
+    else if (rc >= 0 && !simulate)
+        rc = writeSetPatches(fileName, state.patches, state.patchCount);
+
+    closeExifSource(&source);
+    freeSetPatches(state.patches, state.patchCount);
+    free(state.found);
+    free(state.growIfds);
+
+    if (rc < 0) return rc;
+
+    return state.patchCount + state.growCount;
+}
+
+/* -------------------------------------------------------------------------- */
+/* parseSetShift                                                              */
+/* parses the time "text", e.g. "1d12h" or "30s", to seconds in "shift".      */
+/* returns 0 if successful or a negative value otherwise.                     */
+/* -------------------------------------------------------------------------- */
+
+static long int parseSetShift(char *text, long int *shift) {
+    long int number = 0;
+    char *end = NULL;
+
+    *shift = 0;
+
+    if (*text == '\0') return SET_ERR_EDIT;
+
+    while (*text != '\0') {
+        if (*text < '0' || *text > '9') return SET_ERR_EDIT;
+
+        number = strtol(text, &end, 10);
+
+        if (*end == 'd')
+            *shift = *shift + number * 86400;
+        else if (*end == 'h')
+            *shift = *shift + number * 3600;
+        else if (*end == 'm')
+            *shift = *shift + number * 60;
+        else if (*end == 's')
+            *shift = *shift + number;
+        else
+            return SET_ERR_EDIT;
+
+        text = end + 1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* setTagHook                                                                 */
+/* visitor of setFileTags. adds a patch to the setState "arg" for every edit  */
+/* of "item". a text that does not fit in ifd0 or the exif ifd is marked to   */
+/* grow instead. the first edit that can not be made is kept in the state, so */
+/* the walk goes on for the filter. returns 0 if successful or a negative     */
+/* value otherwise.                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int setTagHook(struct exifItem *item, void *arg) {
+    long int i = 0;
+    long int rc = 0;
+
+    struct setState *state = (struct setState *)arg;
+    struct setPatch *patches = NULL;
+
+    for (i = 0; i < (*state).editCount && (*state).rc == 0; i++) {
+        if ((*state).edits[i].tagID != (*item).tagID) continue;
+
+        (*state).found[i] = 1;
+
+        if ((patches = (struct setPatch *)realloc(
+                 (*state).patches,
+                 sizeof(struct setPatch) * ((*state).patchCount + 1))) == NULL)
+            return SET_ERR_MALLOC;
+
+        (*state).patches = patches;
+
+        rc = makeSetPatch(&(*state).edits[i], item,
+                          &patches[(*state).patchCount]);
+
+        if (rc == SET_ERR_FIT && (*item).tagType == 2 &&
+            (*state).edits[i].op == SET_OP_ASSIGN &&
+            ((*item).ifdID == IFD_ID_IFD ||
+             (*item).ifdID == IFD_ID_EXIFOFFSET)) {
+            free(patches[(*state).patchCount].data);
+
+            if ((*state).growIfds[i] == 0)
+                (*state).growCount = (*state).growCount + 1;
+
+            (*state).growIfds[i] = (*item).ifdID;
+        } else if (rc < 0) {
+            free(patches[(*state).patchCount].data);
+            (*state).rc = rc;
+        } else
+            (*state).patchCount = (*state).patchCount + 1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* makeSetPatch                                                               */
+/* writes the patch of "edit" for the tag "item" to "patch". returns 0 if     */
+/* successful or a negative value otherwise.                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int makeSetPatch(struct setEdit *edit, struct exifItem *item,
+                             struct setPatch *patch) {
+    (*patch).pos = (*item).tagDataPos;
+    (*patch).length = (*item).tagTypeSize * (*item).tagCount;
+
+    if (((*patch).data = (unsigned char *)calloc((*patch).length + 1, 1)) ==
+        NULL)
+        return SET_ERR_MALLOC;
+
+    if ((*item).tagType == 2) return makeAsciiPatch(edit, item, patch);
+
+    if ((*edit).op == SET_OP_SHIFT) return SET_ERR_VALUE;
+
+    return makeNumberPatch(edit, item, patch);
+}
+
+/* -------------------------------------------------------------------------- */
+/* makeAsciiPatch                                                             */
+/* writes the new text or the shifted date of "edit" for the ascii tag        */
+/* "item" to "patch". returns 0 if successful or a negative value otherwise.  */
+/* -------------------------------------------------------------------------- */
+
+static long int makeAsciiPatch(struct setEdit *edit, struct exifItem *item,
+                               struct setPatch *patch) {
+    long int length = 0;
+
+    /* six ints of any size and their separators */
+
+    char date[SET_DATE_BUFFER_LENGTH];
+    struct tm dateTime;
+    time_t seconds = 0;
+
+    /* a new text is padded with zeros */
+
+    if ((*edit).op == SET_OP_ASSIGN) {
+        if ((length = strlen((*edit).value)) >= (*patch).length)
+            return SET_ERR_FIT;
+
+        memcpy((*patch).data, (*edit).value, length);
+
+        return 0;
+    }
+
+    /* a date "YYYY:MM:DD HH:MM:SS" is shifted */
+
+    if ((*patch).length < SET_DATE_LENGTH) return SET_ERR_VALUE;
+
+    memcpy(date, (*item).tagData, SET_DATE_LENGTH);
+    date[SET_DATE_LENGTH] = '\0';
+
+    memset(&dateTime, 0, sizeof(struct tm));
+
+    if (sscanf(date, "%4d:%2d:%2d %2d:%2d:%2d", &dateTime.tm_year,
+               &dateTime.tm_mon, &dateTime.tm_mday, &dateTime.tm_hour,
+               &dateTime.tm_min, &dateTime.tm_sec) != 6 ||
+        dateTime.tm_mon < 1 || dateTime.tm_mon > 12 || dateTime.tm_mday < 1)
+        return SET_ERR_VALUE;
+
+    dateTime.tm_year = dateTime.tm_year - 1900;
+    dateTime.tm_mon = dateTime.tm_mon - 1;
+
+    seconds = timegm(&dateTime) + (*edit).shift;
+
+    if (gmtime_r(&seconds, &dateTime) == NULL || dateTime.tm_year < -1900 ||
+        dateTime.tm_year > 9999 - 1900)
+        return SET_ERR_VALUE;
+
+    snprintf(date, sizeof(date), "%04d:%02d:%02d %02d:%02d:%02d",
+             dateTime.tm_year + 1900, dateTime.tm_mon + 1, dateTime.tm_mday,
+             dateTime.tm_hour, dateTime.tm_min, dateTime.tm_sec);
+
+    /* only the date is written, the rest of the slot is kept */
+
+    memcpy((*patch).data, date, SET_DATE_LENGTH);
+    (*patch).length = SET_DATE_LENGTH;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* makeNumberPatch                                                            */
+/* writes the number of "edit" for the single valued numeric tag "item" to    */
+/* "patch", in its type and byte order. rationals are given as "n/d" or as a  */
+/* decimal number. returns 0 if successful or a negative value otherwise.     */
+/* -------------------------------------------------------------------------- */
+
+static long int makeNumberPatch(struct setEdit *edit, struct exifItem *item,
+                                struct setPatch *patch) {
+    long int tagType = (*item).tagType;
+    long int size = (*item).tagTypeSize;
+    double number = 0;
+    double numerator = 0;
+    double denominator = 1;
+    double min = 0;
+    double max = 0;
+
+    char *end = NULL;
+
+    if ((*item).tagCount != 1) return SET_ERR_FIT;
+
+    /* rationals */
+
+    if (tagType == 5 || tagType == 10) {
+        numerator = strtod((*edit).value, &end);
+
+        if (end == (*edit).value) return SET_ERR_VALUE;
+
+        if (*end == '/') {
+            denominator = strtod(end + 1, &end);
+
+            if (denominator <= 0 || denominator != floor(denominator))
+                return SET_ERR_VALUE;
+        } else
+            while (numerator != floor(numerator) &&
+                   denominator < SET_MAX_DENOMINATOR) {
+                numerator = numerator * 10;
+                denominator = denominator * 10;
+            }
+
+        if (*end != '\0') return SET_ERR_VALUE;
+
+        numerator = round(numerator);
+        min = tagType == 5 ? 0 : INT32_MIN;
+        max = tagType == 5 ? UINT32_MAX : INT32_MAX;
+
+        if (numerator < min || numerator > max || denominator > max)
+            return SET_ERR_FIT;
+
+        storeExifValue((*patch).data, 4,
+                      (uint32_t)(int64_t)numerator, (*item).exifFormat);
+        storeExifValue((*patch).data + 4, 4,
+                      (uint32_t)(int64_t)denominator, (*item).exifFormat);
+
+        return 0;
+    }
+
+    /* integers */
+
+    if (tagType != 1 && tagType != 3 && tagType != 4 && tagType != 6 &&
+        tagType != 8 && tagType != 9)
+        return SET_ERR_VALUE;
+
+    number = strtod((*edit).value, &end);
+
+    if (end == (*edit).value || *end != '\0' || number != floor(number))
+        return SET_ERR_VALUE;
+
+    if (tagType == 6 || tagType == 8 || tagType == 9) {
+        min = -ldexp(1, size * 8 - 1);
+        max = ldexp(1, size * 8 - 1) - 1;
+    } else
+        max = ldexp(1, size * 8) - 1;
+
+    if (number < min || number > max) return SET_ERR_FIT;
+
+    storeExifValue((*patch).data, size, (uint32_t)(int64_t)number,
+                  (*item).exifFormat);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findNewTagIfd                                                              */
+/* returns the ifd a missing tag of the text "edit" is added to, or 0 if it   */
+/* is not added.                                                              */
+/* -------------------------------------------------------------------------- */
+
+static long int findNewTagIfd(struct setEdit *edit) {
+    long int i = 0;
+
+    if ((*edit).op != SET_OP_ASSIGN) return 0;
+
+    for (i = 0; i < SET_NEW_TAG_COUNT; i++)
+        if (setNewTags[i].tagID == (*edit).tagID) return setNewTags[i].ifdID;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* growSetTags                                                                */
+/* rewrites the exif segment of the jpg "source" of "fileName" with the       */
+/* patches and the texts to grow of "state". with "simulate", the file is not */
+/* written. returns 0 if successful or a negative value otherwise.            */
+/* -------------------------------------------------------------------------- */
+
+static long int growSetTags(char *fileName, struct exifSource *source,
+                            struct setState *state, int simulate) {
+    long int i = 0;
+    long int rc = 0;
+    long int oldLength = 0;
+
+    struct setPatch *patch = NULL;
+    struct setEdit *edit = NULL;
+    struct exifRewrite rewrite;
+
+    if ((rc = openExifRewrite(&rewrite, source)) == WRITE_ERR_FORMAT)
+        rc = SET_ERR_FIT;
+
+    oldLength = rewrite.tiffLength;
+
+    /* the patches go to the copy of the block */
+
+    for (i = 0; i < (*state).patchCount && rc >= 0; i++) {
+        patch = &(*state).patches[i];
+
+        if ((*patch).pos < rewrite.tiffPos ||
+            (*patch).pos + (*patch).length > rewrite.tiffPos + oldLength)
+            rc = SET_ERR_FIT;
+        else
+            memcpy(rewrite.tiff + (*patch).pos - rewrite.tiffPos,
+                   (*patch).data, (*patch).length);
+    }
+
+    /* then the texts grow */
+
+    for (i = 0; i < (*state).editCount && rc >= 0; i++) {
+        edit = &(*state).edits[i];
+
+        if ((*state).growIfds[i] > 0)
+            rc = setRewriteTag(&rewrite, (*state).growIfds[i], (*edit).tagID,
+                               2, strlen((*edit).value) + 1,
+                               (unsigned char *)(*edit).value);
+    }
+
+    if (rc >= 0 && !simulate) rc = writeJpgFile(fileName, source, &rewrite, 0);
+
+    closeExifRewrite(&rewrite);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeSetPatches                                                            */
+/* writes the "patchCount" patches in "patches" to the file "fileName" in     */
+/* their order, so a later edit of the same tag wins. the patches are written */
+/* in place and can not be undone, so a write that fails after the first      */
+/* byte returns SET_ERR_FILE_PARTIAL. returns 0 if successful or a negative   */
+/* value otherwise.                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int writeSetPatches(char *fileName, struct setPatch *patches,
+                                long int patchCount) {
+    long int i = 0;
+    long int done = 0;
+    long int written = 0;
+    int fd = -1;
+    ssize_t n = 0;
+
+    if (patchCount == 0) return 0;
+
+    if ((fd = open(fileName, O_WRONLY)) < 0) return SET_ERR_FILE_OPEN;
+
+    for (i = 0; i < patchCount; i++) {
+        for (done = 0; done < patches[i].length; done = done + n) {
+            n = pwrite(fd, patches[i].data + done, patches[i].length - done,
+                       patches[i].pos + done);
+
+            if (n < 0 && errno == EINTR) n = 0;
+
+            if (n < 0) {
+                close(fd);
+                return written > 0 ? SET_ERR_FILE_PARTIAL : SET_ERR_FILE_WRITE;
+            }
+
+            written = written + n;
+        }
+    }
+
+    if (close(fd) < 0) return SET_ERR_FILE_PARTIAL;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* freeSetPatches                                                             */
+/* releases the "patchCount" patches in "patches".                            */
+/* -------------------------------------------------------------------------- */
+
+static void freeSetPatches(struct setPatch *patches, long int patchCount) {
+    long int i = 0;
+
+    for (i = 0; i < patchCount; i++) free(patches[i].data);
+
+    free(patches);
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,160 @@
+#ifndef EXIFSET_H_INCLUDED
+#define EXIFSET_H_INCLUDED
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "exiffilter.h"
+#include "exiflib.h"
+#include "exifparser.h"
+#include "exifwrite.h"
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    in place editing:                                                       */
+/*                                                                            */
+/*       set +Artist="Jane Doe" +DateTimeOriginal+=1h30m +FNumber=5.6         */
+/*                                                                            */
+/*    an edit gives a tag a new value or shifts its date by += or -= a time   */
+/*    in d, h, m and s. the ifds are walked once in the mapped file, and      */
+/*    every tag to edit gets a patch with the position and the new bytes of   */
+/*    its value. a value that fits the slot of the old one is written over    */
+/*    it with pwrite: ascii values are padded with zeros, numbers keep their  */
+/*    type and byte order. nothing else of the file is read or written. a     */
+/*    file is only written if all of its edits can be made, a missing tag is  */
+/*    not an error. png files are not edited, the crc of the chunk would be   */
+/*    wrong.                                                                  */
+/*                                                                            */
+/*    in jpg files, a text that is longer than the old one and a missing      */
+/*    text tag of setNewTags are written by rewriting the exif segment (see   */
+/*    exifwrite.h). the patches that fit are made in the rewritten block.     */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define SET_OP_ASSIGN 1
+#define SET_OP_SHIFT 2
+
+#define SET_DATE_LENGTH 19
+#define SET_DATE_BUFFER_LENGTH 72
+#define SET_MAX_DENOMINATOR 1000000
+#define SET_NEW_TAG_COUNT 14
+
+#define SET_ERR_MALLOC -891
+#define SET_ERR_EDIT -892
+#define SET_ERR_TAG -893
+#define SET_ERR_VALUE -894
+#define SET_ERR_FIT -895
+#define SET_ERR_FORMAT -896
+#define SET_ERR_FILE_OPEN -897
+#define SET_ERR_FILE_WRITE -898
+#define SET_ERR_FILE_PARTIAL -899
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct setNewTag {
+    long int tagID;
+    long int ifdID;
+};
+
+struct setEdit {
+    char *tagName;
+    long int tagID;
+    int op;
+    char *value;
+    long int shift;
+};
+
+struct setPatch {
+    long int pos;
+    long int length;
+    unsigned char *data;
+};
+
+struct setState {
+    struct setEdit *edits;
+    long int editCount;
+    struct setPatch *patches;
+    long int patchCount;
+    int *found;
+    long int *growIfds;
+    long int growCount;
+    long int rc;
+};
+
+/* -------------------------------------------------------------------------- */
+/* text tags added if missing                                                 */
+/* -------------------------------------------------------------------------- */
+
+static struct setNewTag setNewTags[SET_NEW_TAG_COUNT] = {
+    {0x010e, IFD_ID_IFD},        /* ImageDescription */
+    {0x010f, IFD_ID_IFD},        /* Make */
+    {0x0110, IFD_ID_IFD},        /* Model */
+    {0x0131, IFD_ID_IFD},        /* Software */
+    {0x0132, IFD_ID_IFD},        /* DateTime */
+    {0x013b, IFD_ID_IFD},        /* Artist */
+    {0x8298, IFD_ID_IFD},        /* Copyright */
+    {0x9003, IFD_ID_EXIFOFFSET}, /* DateTimeOriginal */
+    {0x9004, IFD_ID_EXIFOFFSET}, /* DateTimeDigitized */
+    {0xa420, IFD_ID_EXIFOFFSET}, /* ImageUniqueID */
+    {0xa430, IFD_ID_EXIFOFFSET}, /* CameraOwnerName */
+    {0xa431, IFD_ID_EXIFOFFSET}, /* BodySerialNumber */
+    {0xa433, IFD_ID_EXIFOFFSET}, /* LensMake */
+    {0xa434, IFD_ID_EXIFOFFSET}, /* LensModel */
+};
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int parseSetEdits(char **tagTable, long int tagTableItemCount,
+                       struct setEdit **edits);
+
+long int setFileTags(char *fileName, struct setEdit *edits,
+                     long int editCount, struct exifFilter *filter,
+                     int simulate);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int parseSetShift(char *text, long int *shift);
+
+static long int setTagHook(struct exifItem *item, void *arg);
+
+static long int makeSetPatch(struct setEdit *edit, struct exifItem *item,
+                             struct setPatch *patch);
+
+static long int makeAsciiPatch(struct setEdit *edit, struct exifItem *item,
+                               struct setPatch *patch);
+
+static long int makeNumberPatch(struct setEdit *edit, struct exifItem *item,
+                                struct setPatch *patch);
+
+static long int findNewTagIfd(struct setEdit *edit);
+
+static long int growSetTags(char *fileName, struct exifSource *source,
+                            struct setState *state, int simulate);
+
+static long int writeSetPatches(char *fileName, struct setPatch *patches,
+                                long int patchCount);
+
+static void freeSetPatches(struct setPatch *patches, long int patchCount);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,138 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifstats.h"
+
+/* -------------------------------------------------------------------------- */
+/* variables                                                                  */
+/* -------------------------------------------------------------------------- */
+
+int statsEnabled = 0;
+__thread struct exifStats *threadStats = NULL;
+
+static struct exifStats **statsTable = NULL;
+static long int statsTableItemCount = 0;
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct benchIo statsIoStart;
+static long int statsTimeStart = 0;
+
+static char *phaseNames[STATS_PHASE_COUNT] = {"open", "marker search",
+                                              "ifd walk", "formatting",
+                                              "output"};
+
+/* -------------------------------------------------------------------------- */
+/* startStats                                                                 */
+/* turns the counters on and takes the i/o counters of the process as the     */
+/* starting point.                                                            */
+/* -------------------------------------------------------------------------- */
+
+void startStats(void) {
+    statsEnabled = 1;
+    statsTimeStart = statsClock();
+    readBenchIo(&statsIoStart);
+}
+
+/* -------------------------------------------------------------------------- */
+/* registerThreadStats                                                        */
+/* allocates the counters of the calling thread and adds them to the stats    */
+/* table. the counters live until the process exits, so they survive the      */
+/* worker threads. returns the counters or NULL in case of an error.          */
+/* -------------------------------------------------------------------------- */
+
+struct exifStats *registerThreadStats(void) {
+    struct exifStats **table = NULL;
+    struct exifStats *stats = NULL;
+
+    if ((stats = (struct exifStats *)calloc(1, sizeof(struct exifStats))) ==
+        NULL)
+        return NULL;
+
+    pthread_mutex_lock(&statsLock);
+
+    if ((table = (struct exifStats **)realloc(
+             statsTable, sizeof(struct exifStats *) *
+                             (statsTableItemCount + 1))) == NULL) {
+        pthread_mutex_unlock(&statsLock);
+        free(stats);
+        return NULL;
+    }
+
+    statsTable = table;
+    statsTable[statsTableItemCount++] = stats;
+
+    pthread_mutex_unlock(&statsLock);
+
+    threadStats = stats;
+
+    return stats;
+}
+
+/* -------------------------------------------------------------------------- */
+/* statsClock                                                                 */
+/* returns a monotonic time in nanoseconds.                                   */
+/* -------------------------------------------------------------------------- */
+
+long int statsClock(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/* -------------------------------------------------------------------------- */
+/* printStats                                                                 */
+/* adds up the counters of all threads and prints them to "stream" with the   */
+/* bytes read and read syscalls of the process since startStats. phase times  */
+/* are summed over all threads, so with several workers they can exceed the   */
+/* wall time.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+void printStats(FILE *stream) {
+    long int i = 0;
+    long int j = 0;
+    long int wallTime = 0;
+    struct exifStats total;
+    struct benchIo ioEnd;
+
+    if (!statsEnabled) return;
+
+    wallTime = statsClock() - statsTimeStart;
+
+    memset(&total, 0, sizeof(struct exifStats));
+
+    pthread_mutex_lock(&statsLock);
+
+    for (i = 0; i < statsTableItemCount; i++) {
+        total.filesOpened += (*statsTable[i]).filesOpened;
+        total.ifdsVisited += (*statsTable[i]).ifdsVisited;
+        total.tagsVisited += (*statsTable[i]).tagsVisited;
+        total.allocations += (*statsTable[i]).allocations;
+
+        for (j = 0; j < STATS_PHASE_COUNT; j++)
+            total.phaseTime[j] += (*statsTable[i]).phaseTime[j];
+    }
+
+    pthread_mutex_unlock(&statsLock);
+
+    fprintf(stream, "stats: %ld threads, %.3f s wall time\n",
+            statsTableItemCount, wallTime / 1e9);
+    fprintf(stream, "  files opened   %12ld\n", total.filesOpened);
+
+    if (readBenchIo(&ioEnd) == 0) {
+        fprintf(stream, "  bytes read     %12ld\n",
+                ioEnd.readBytes - statsIoStart.readBytes);
+        fprintf(stream, "  read syscalls  %12ld\n",
+                ioEnd.readCalls - statsIoStart.readCalls);
+    }
+
+    fprintf(stream, "  ifds visited   %12ld\n", total.ifdsVisited);
+    fprintf(stream, "  tags visited   %12ld\n", total.tagsVisited);
+    fprintf(stream, "  allocations    %12ld\n", total.allocations);
+
+    for (j = 0; j < STATS_PHASE_COUNT; j++)
+        fprintf(stream, "  %-14s %12.3f ms\n", phaseNames[j],
+                total.phaseTime[j] / 1e6);
+}
+
+/* -------------------------------------------------------------------------- */
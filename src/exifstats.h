@@ -0,0 +1,73 @@
+#ifndef EXIFSTATS_H_INCLUDED
+#define EXIFSTATS_H_INCLUDED
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "exifbench.h"
+
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define STATS_PHASE_OPEN 0
+#define STATS_PHASE_MARKER 1
+#define STATS_PHASE_IFD 2
+#define STATS_PHASE_FORMAT 3
+#define STATS_PHASE_OUTPUT 4
+#define STATS_PHASE_COUNT 5
+
+/* counters cost a branch when stats are off. the first counter a thread      */
+/* touches registers its stats.                                               */
+
+#define countStat(field, n)                                          \
+    do {                                                             \
+        if (statsEnabled) {                                          \
+            if (threadStats == NULL) registerThreadStats();          \
+            if (threadStats != NULL) (*threadStats).field += (n);    \
+        }                                                            \
+    } while (0)
+
+#define startPhase() (statsEnabled ? statsClock() : 0)
+
+#define endPhase(phase, start) \
+    countStat(phaseTime[(phase)], statsEnabled ? statsClock() - (start) : 0)
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct exifStats {
+    long int filesOpened;
+    long int ifdsVisited;
+    long int tagsVisited;
+    long int allocations;
+    long int phaseTime[STATS_PHASE_COUNT];
+};
+
+/* -------------------------------------------------------------------------- */
+/* variables                                                                  */
+/* -------------------------------------------------------------------------- */
+
+extern int statsEnabled;
+extern __thread struct exifStats *threadStats;
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+void startStats(void);
+
+struct exifStats *registerThreadStats(void);
+
+long int statsClock(void);
+
+void printStats(FILE *stream);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
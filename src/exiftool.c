@@ -8,10 +8,33 @@
 
 int main(int argc, char *argv[]) {
     long int rc = 0;
+    long int phaseStart = 0;
+    long int spanStart = 0;
 
     /* process */
 
-    if ((rc = processArgs(argc, argv)) < 0) return rc;
+    rc = processArgs(argc, argv);
+
+    stopProgress();
+
+    /* print stats and write the trace - the last flush of stdout is output */
+    /* as well                                                               */
+
+    if (statsEnabled || traceEnabled) {
+        phaseStart = startPhase();
+        spanStart = traceStart();
+
+        fflush(stdout);
+
+        endPhase(STATS_PHASE_OUTPUT, phaseStart);
+        traceSpan("write", NULL, spanStart);
+    }
+
+    printStats(stderr);
+
+    if (writeTrace() < 0) fprintf(stderr, "exiftool: error writing trace\n");
+
+    if (rc < 0) return rc;
 
     return 0;
 }
@@ -26,9 +49,15 @@ static long int processArgs(int argc, char *argv[]) {
     int rc = 0;
     int i = 0;
     int task = 0;
+    int benchTask = 0;
+    int argShift = 0;
     long int fileCount = 0;
+    long int spanStart = 0;
     long int tagCount = 0;
-    struct options opt = {0, 0, 0, NULL, 0};
+    struct options opt = {
+        0,    0,   0,   NULL, 0, COPY_MODE_MOVE, WORKER_DEFAULT_COUNT,
+        NULL, NULL, NULL, GPS_FORMAT_TEXT, 0, NULL, NULL, NULL, 0,
+        NULL, 1,    BENCH_DEFAULT_RUNS, 0, 0, NULL, 0};
     char **fileTable = NULL;
     char **tagTable = NULL;
 
@@ -48,6 +77,18 @@ static long int processArgs(int argc, char *argv[]) {
         return task;
     }
 
+    /* bench runs the task given as second argument */
+
+    if (task == TASK_BENCH) {
+        if (argc <= 2 || (benchTask = getTask(argv[2])) < 0) {
+            fprintf(stderr, "exiftool: invalid bench task\n");
+            fprintf(stderr, "Try 'exiftool help' for more information.\n");
+            return ERR_ARG_INVALID;
+        }
+
+        argShift = 1;
+    }
+
     /* get options */
 
     if ((rc = getOptions(argc, argv, &opt)) < 0) {
@@ -56,6 +97,22 @@ static long int processArgs(int argc, char *argv[]) {
         return rc;
     }
 
+    if (opt.stats) startStats();
+    if (opt.trace != NULL) startTrace(opt.trace);
+
+    if (opt.progress && (rc = startProgress()) < 0) {
+        fprintf(stderr, "exiftool: can't start progress (%d)\n", rc);
+        return rc;
+    }
+
+    /* compile filter */
+
+    if (opt.where != NULL && (rc = compileFilter(opt.where, &opt.filter)) < 0) {
+        fprintf(stderr, "exiftool: invalid filter '%s' (%d)\n", opt.where, rc);
+        fprintf(stderr, "Try 'exiftool help' for more information.\n");
+        return ERR_FILTER;
+    }
+
     /* get tag list */
 
     if ((tagCount = getTagList(argc, argv, &tagTable)) < 0) {
@@ -64,9 +121,20 @@ static long int processArgs(int argc, char *argv[]) {
         return rc;
     }
 
+    /* maker notes are only decoded if one of their tags is used */
+
+    exifDefaultContext.makerNotes = usesMakerNotes(&opt, tagTable, tagCount);
+
     /* get file list */
 
-    if ((fileCount = getFileList(argc, argv, &fileTable, opt.recursive)) < 0) {
+    spanStart = traceStart();
+
+    fileCount = getFileList(argc - argShift, argv + argShift, &fileTable,
+                            opt.recursive, task == TASK_CARVE);
+
+    traceSpan("walk", NULL, spanStart);
+
+    if (fileCount < 0) {
         fprintf(stderr, "exiftool: error processing file list\n");
         fprintf(stderr, "Try 'exiftool help' for more information.\n");
         return fileCount;
@@ -99,6 +167,45 @@ static long int processArgs(int argc, char *argv[]) {
             return rc;
     }
 
+    else if (task == TASK_AGG) {
+        if ((rc = taskAgg(stdout, &opt, fileTable, fileCount)) < 0) return rc;
+    }
+
+    else if (task == TASK_DUPES) {
+        if ((rc = taskDupes(stdout, &opt, fileTable, fileCount)) < 0)
+            return rc;
+    }
+
+    else if (task == TASK_THUMB) {
+        if ((rc = taskThumb(stdout, &opt, fileTable, fileCount)) < 0)
+            return rc;
+    }
+
+    else if (task == TASK_SET) {
+        if ((rc = taskSet(stdout, &opt, fileTable, fileCount, tagTable,
+                          tagCount)) < 0)
+            return rc;
+    }
+
+    else if (task == TASK_STRIP) {
+        if ((rc = taskStrip(stdout, &opt, fileTable, fileCount)) < 0)
+            return rc;
+    }
+
+    else if (task == TASK_CARVE) {
+        if ((rc = taskCarve(stdout, &opt, fileTable, fileCount, tagTable,
+                            tagCount)) < 0)
+            return rc;
+    }
+
+    else if (task == TASK_BENCH) {
+        if ((rc = taskBench(stdout, &opt, benchTask, fileTable, fileCount,
+                            tagTable, tagCount)) < 0)
+            return rc;
+    }
+
+    freeFilter(opt.filter);
+
     return 0;
 }
 
@@ -122,6 +229,20 @@ static long int getTask(char *arg) {
         task = TASK_CSV;
     else if (strcmp("rename", arg) == 0)
         task = TASK_RENAME;
+    else if (strcmp("agg", arg) == 0)
+        task = TASK_AGG;
+    else if (strcmp("dupes", arg) == 0)
+        task = TASK_DUPES;
+    else if (strcmp("bench", arg) == 0)
+        task = TASK_BENCH;
+    else if (strcmp("thumb", arg) == 0)
+        task = TASK_THUMB;
+    else if (strcmp("set", arg) == 0)
+        task = TASK_SET;
+    else if (strcmp("strip", arg) == 0)
+        task = TASK_STRIP;
+    else if (strcmp("carve", arg) == 0)
+        task = TASK_CARVE;
     else
         return ERR_ARG_INVALID;
 
@@ -146,11 +267,66 @@ static long int getOptions(int argc, char *argv[], struct options *opt) {
             (*opt).verbose = 1;
         else if (strncmp("-d=", argv[i], 3) == 0) {
             (*opt).debug = atoi(argv[i] + 3);
-            debug = (*opt).debug;
+            exifDefaultContext.logLevel = (*opt).debug;
         } else if (strncmp("-p=", argv[i], 3) == 0)
             (*opt).pattern = argv[i] + 3;
         else if (strcmp("-s", argv[i]) == 0)
             (*opt).simulate = 1;
+        else if (strncmp("-j=", argv[i], 3) == 0) {
+            if (((*opt).workers = atoi(argv[i] + 3)) < 1)
+                return ERR_OPT_INVALID;
+        } else if (strcmp("--mode=move", argv[i]) == 0)
+            (*opt).mode = COPY_MODE_MOVE;
+        else if (strcmp("--mode=copy", argv[i]) == 0)
+            (*opt).mode = COPY_MODE_COPY;
+        else if (strcmp("--mode=link", argv[i]) == 0)
+            (*opt).mode = COPY_MODE_LINK;
+        else if (strcmp("--mode=reflink", argv[i]) == 0)
+            (*opt).mode = COPY_MODE_REFLINK;
+        else if (strncmp("--index=", argv[i], 8) == 0)
+            (*opt).index = argv[i] + 8;
+        else if (strncmp("--within=", argv[i], 9) == 0)
+            (*opt).within = argv[i] + 9;
+        else if (strncmp("--geocode=", argv[i], 10) == 0)
+            (*opt).geocode = argv[i] + 10;
+        else if (strcmp("--format=geojson", argv[i]) == 0)
+            (*opt).format = GPS_FORMAT_GEOJSON;
+        else if (strcmp("--format=gpx", argv[i]) == 0)
+            (*opt).format = GPS_FORMAT_GPX;
+        else if (strcmp("--track", argv[i]) == 0)
+            (*opt).track = 1;
+        else if (strncmp("--where=", argv[i], 8) == 0)
+            (*opt).where = argv[i] + 8;
+        else if (strncmp("--by=", argv[i], 5) == 0)
+            (*opt).by = argv[i] + 5;
+        else if (strcmp("--count", argv[i]) == 0)
+            (*opt).count = 1;
+        else if (strncmp("--hist=", argv[i], 7) == 0)
+            (*opt).hist = argv[i] + 7;
+        else if (strncmp("--bin=", argv[i], 6) == 0) {
+            if (((*opt).bin = atof(argv[i] + 6)) <= 0) return ERR_OPT_INVALID;
+        } else if (strncmp("--runs=", argv[i], 7) == 0) {
+            if (((*opt).runs = atoi(argv[i] + 7)) < 1) return ERR_OPT_INVALID;
+        } else if (strcmp("--cold", argv[i]) == 0)
+            (*opt).cold = 1;
+        else if (strncmp("--max-ifds=", argv[i], 11) == 0) {
+            if ((exifDefaultContext.limits.maxIfds = atol(argv[i] + 11)) < 1)
+                return ERR_OPT_INVALID;
+        } else if (strncmp("--max-tags=", argv[i], 11) == 0) {
+            if ((exifDefaultContext.limits.maxTags = atol(argv[i] + 11)) < 1)
+                return ERR_OPT_INVALID;
+        } else if (strncmp("--max-tag-bytes=", argv[i], 16) == 0) {
+            if ((exifDefaultContext.limits.maxTagBytes =
+                     atol(argv[i] + 16)) < 1)
+                return ERR_OPT_INVALID;
+        } else if (strcmp("--read", argv[i]) == 0)
+            exifDefaultContext.readFiles = 1;
+        else if (strcmp("--stats", argv[i]) == 0)
+            (*opt).stats = 1;
+        else if (strncmp("--trace=", argv[i], 8) == 0)
+            (*opt).trace = argv[i] + 8;
+        else if (strcmp("--progress", argv[i]) == 0)
+            (*opt).progress = 1;
         else
             return ERR_OPT_INVALID;
     }
@@ -209,6 +385,23 @@ static long int getTagList(int argc, char *argv[], char ***tagTable) {
     return count;
 }
 
+/* -------------------------------------------------------------------------- */
+/* usesMakerNotes                                                             */
+/* returns 1 if a maker note tag is used by the "tagCount" tags in            */
+/* "tagTable" or by the filter, grouping or pattern in "opt", or 0 otherwise. */
+/* -------------------------------------------------------------------------- */
+
+static int usesMakerNotes(struct options *opt, char **tagTable,
+                          long int tagCount) {
+    long int i = 0;
+
+    for (i = 0; i < tagCount; i++)
+        if (findMakerNoteTag(tagTable[i])) return 1;
+
+    return findMakerNoteTag((*opt).where) || findMakerNoteTag((*opt).by) ||
+           findMakerNoteTag((*opt).hist) || findMakerNoteTag((*opt).pattern);
+}
+
 /* -------------------------------------------------------------------------- */
 /* allocateFileTable                                                          */
 /* allocates memory for a new file item in an existing or new "fileTable"     */
@@ -236,11 +429,14 @@ static long int allocateFileTable(char ***fileTable, int fileTableItemCount) {
 /* adds a file or directory of name "fileName" to the file table "fileTable"  */
 /* if "fileTable" is an existing table "fileTableItemCount" should be greater */
 /* than zero. if "recursive" is true, this function is a recursive function   */
-/* and adds directories. returns the number of items added or 0 otherwise.    */
+/* and adds directories. if "devices" is true, a block device is added too,   */
+/* but not one found in a directory. returns the number of items added or 0   */
+/* otherwise.                                                                 */
 /* -------------------------------------------------------------------------- */
 
 static long int addFileToFileTable(char *fileName, char ***fileTable,
-                                   long int fileTableItemCount, int recursive) {
+                                   long int fileTableItemCount, int recursive,
+                                   int devices) {
     long int rc = 0;
     long int count = 0;
 
@@ -255,9 +451,9 @@ static long int addFileToFileTable(char *fileName, char ***fileTable,
 
     if (stat(fileName, &fileStat) < 0) return ERR_FILESTAT;
 
-    /* regular file */
+    /* regular file, or a block device to carve */
 
-    if (S_ISREG(fileStat.st_mode)) {
+    if (S_ISREG(fileStat.st_mode) || (devices && S_ISBLK(fileStat.st_mode))) {
         if ((rc = allocateFileTable(fileTable, fileTableItemCount)) < 0)
             return rc;
 
@@ -269,6 +465,8 @@ static long int addFileToFileTable(char *fileName, char ***fileTable,
             return ERR_MEMCPY;
 
         count = 1;
+
+        countProgress(progressFilesFound);
     } else if (S_ISDIR(fileStat.st_mode) && recursive == 1) {
         if ((dir = opendir(fileName)) == NULL) return ERR_DIROPEN;
 
@@ -283,7 +481,7 @@ static long int addFileToFileTable(char *fileName, char ***fileTable,
 
             if ((rc = addFileToFileTable(relFileName, fileTable,
                                          fileTableItemCount + count,
-                                         recursive)) < 0)
+                                         recursive, 0)) < 0)
                 return rc;
 
             free(relFileName);
@@ -300,12 +498,13 @@ static long int addFileToFileTable(char *fileName, char ***fileTable,
 /* -------------------------------------------------------------------------- */
 /* getFileList                                                                */
 /* checks "argc" command line arguments "argv" for files and writes them      */
-/* to the "fileTable". set recursive to true to search directories.           */
-/* returns a negative value in case of an error.                              */
+/* to the "fileTable". set recursive to true to search directories and        */
+/* devices to true to accept block devices. returns a negative value in case  */
+/* of an error.                                                               */
 /* -------------------------------------------------------------------------- */
 
 static long int getFileList(int argc, char *argv[], char ***fileTable,
-                            int recursive) {
+                            int recursive, int devices) {
     long int i = 0;
     long int rc = 0;
     long int count = 0;
@@ -315,7 +514,8 @@ static long int getFileList(int argc, char *argv[], char ***fileTable,
         if (strncmp("-", argv[i], 1) == 0 || strncmp("+", argv[i], 1) == 0)
             continue;
 
-        if ((rc = addFileToFileTable(argv[i], fileTable, count, recursive)) < 0)
+        if ((rc = addFileToFileTable(argv[i], fileTable, count, recursive,
+                                     devices)) < 0)
             return rc;
 
         count = count + rc;
@@ -339,7 +539,14 @@ static void taskHelp(FILE *stream) {
     fprintf(stream, "  csv               Print specified tag(s) as csv\n");
     fprintf(stream, "  gps               Print gps coordinates\n");
     fprintf(stream,
-            "  rename            Rename files based on a given pattern\n\n");
+            "  rename            Rename files based on a given pattern\n");
+    fprintf(stream, "  agg               Count files per group of tags\n");
+    fprintf(stream, "  dupes             Print groups of duplicate images\n");
+    fprintf(stream, "  thumb             Write the embedded preview images\n");
+    fprintf(stream, "  set               Change tags in place\n");
+    fprintf(stream, "  strip             Remove the metadata of jpg files\n");
+    fprintf(stream, "  carve             Find jpgs with exif in disk images\n");
+    fprintf(stream, "  bench x           Benchmark task x file by file\n\n");
 
     fprintf(stream, "Options\n");
     fprintf(stream, "  -r                Search directories recursively\n");
@@ -351,7 +558,56 @@ static void taskHelp(FILE *stream) {
     fprintf(stream, "  -p=x              Use pattern x to rename files\n");
     fprintf(stream, "                    No default is given\n");
     fprintf(stream, "  -s                Toogle rename simulation\n");
-    fprintf(stream, "                    Default is off\n\n");
+    fprintf(stream, "                    Default is off\n");
+    fprintf(stream, "  -j=x              Use x worker threads\n");
+    fprintf(stream, "                    Default is %d\n",
+            WORKER_DEFAULT_COUNT);
+    fprintf(stream, "  --mode=x          Rename by move, copy, link or\n");
+    fprintf(stream, "                    reflink. Default is move\n");
+    fprintf(stream, "  --index=x         Write gps positions to index x,\n");
+    fprintf(stream, "                    or query index x with --within\n");
+    fprintf(stream, "  --within=x        Query the gps index for a box\n");
+    fprintf(stream, "                    lat1,lon1,lat2,lon2 from west to\n");
+    fprintf(stream, "                    east or a circle lat,lon,km\n");
+    fprintf(stream, "  --geocode=x       Add the nearest place of the\n");
+    fprintf(stream, "                    gazetteer x to gps positions\n");
+    fprintf(stream, "  --format=x        Print gps positions as geojson\n");
+    fprintf(stream, "                    or gpx. Default is text\n");
+    fprintf(stream, "  --track           Order gps positions by time\n");
+    fprintf(stream, "                    Default is off\n");
+    fprintf(stream, "  --where=x         Only process files matching the\n");
+    fprintf(stream,
+            "                    expression x, e.g. 'Make == \"NIKON\"\n");
+    fprintf(stream, "                    && FocalLength > 100'\n");
+    fprintf(stream,
+            "  --by=x            Group by the comma separated tags x,\n");
+    fprintf(stream, "                    e.g. Model,DateTimeOriginal;1:4\n");
+    fprintf(stream, "  --count           Count files per group, also with\n");
+    fprintf(stream, "                    --hist. Default without --hist\n");
+    fprintf(stream, "  --hist=x          Count files per group and bin of\n");
+    fprintf(stream, "                    the numeric tag x\n");
+    fprintf(stream, "  --bin=x           Use bins of width x. Default is 1\n");
+    fprintf(stream, "  --runs=x          Run the benchmark x times\n");
+    fprintf(stream, "                    Default is %d\n", BENCH_DEFAULT_RUNS);
+    fprintf(stream, "  --cold            Drop the files from the page cache\n");
+    fprintf(stream, "                    before every benchmark run\n");
+    fprintf(stream, "  --max-ifds=x      Read at most x ifds per file\n");
+    fprintf(stream, "                    Default is %d\n",
+            EXIF_DEFAULT_MAX_IFDS);
+    fprintf(stream, "  --max-tags=x      Read at most x tags per file\n");
+    fprintf(stream, "                    Default is %d\n",
+            EXIF_DEFAULT_MAX_TAGS);
+    fprintf(stream, "  --max-tag-bytes=x Skip tags with more than x bytes\n");
+    fprintf(stream, "                    Default is %d\n",
+            EXIF_DEFAULT_MAX_TAG_BYTES);
+    fprintf(stream, "  --read            Read files instead of mapping\n");
+    fprintf(stream, "                    them, e.g. on fuse mounts\n");
+    fprintf(stream, "  --stats           Print counters and phase times to\n");
+    fprintf(stream, "                    stderr at exit\n");
+    fprintf(stream, "  --trace=x         Write a chrome trace of the files\n");
+    fprintf(stream, "                    and phases per thread to x\n");
+    fprintf(stream, "  --progress        Print the progress to stderr every\n");
+    fprintf(stream, "                    second and on SIGUSR1\n\n");
 
     fprintf(stream, "Tags\n");
     fprintf(stream, "  +[tag]            Specifies which tags to print\n\n");
@@ -367,8 +623,52 @@ static void taskHelp(FILE *stream) {
     fprintf(stream, "  Prints the tags 'Model' and 'Make' only\n\n");
     fprintf(stream, "  $ exiftool csv +Model +Make *.jpg > test.csv\n");
     fprintf(stream, "  Prints the tags 'Model' and 'Make' to a csv\n\n");
+    fprintf(stream, "  $ exiftool csv +Make +Model -r raw > raw.csv\n");
+    fprintf(stream,
+            "  Also reads tiff, dng, nef, cr2, arw, orf, heic, avif, png\n");
+    fprintf(stream, "  and webp files\n\n");
+    fprintf(stream, "  $ exiftool csv +XMPRating +IPTCKeywords *.jpg\n");
+    fprintf(stream, "  Also reads the xmp, iptc and icc segments of jpg\n");
+    fprintf(stream, "  files, their tags start with XMP, IPTC and ICC\n\n");
+    fprintf(stream, "  $ exiftool csv +LensType +ShutterCount *.jpg\n");
+    fprintf(stream, "  Decodes the maker note only for its tags\n\n");
+    fprintf(stream, "  $ exiftool thumb test.jpg > thumb.jpg\n");
+    fprintf(stream, "  Writes the thumbnail of test.jpg to thumb.jpg\n\n");
+    fprintf(stream, "  $ exiftool thumb -r -p=thumbs/[OldFileName].jpg raw\n");
+    fprintf(stream, "  Writes the largest preview of each raw file to the\n");
+    fprintf(stream, "  folder thumbs\n\n");
+    fprintf(stream, "  $ exiftool set +Artist=\"Jane Doe\" -r photos\n");
+    fprintf(stream, "  Sets the artist of all images below photos\n\n");
+    fprintf(stream, "  $ exiftool set +DateTimeOriginal+=1h *.jpg\n");
+    fprintf(stream, "  Moves the time the images were taken one hour on\n\n");
+    fprintf(stream, "  $ exiftool set +Copyright=\"Jane Doe\" *.jpg\n");
+    fprintf(stream, "  Also adds a missing or longer copyright to jpg\n");
+    fprintf(stream, "  files by rewriting their exif segment\n\n");
+    fprintf(stream, "  $ exiftool strip -r export\n");
+    fprintf(stream, "  Removes exif, xmp, iptc and comments of the jpg\n");
+    fprintf(stream, "  files below export, keeping icc and orientation\n\n");
+    fprintf(stream, "  $ exiftool carve +Model +DateTimeOriginal disk.img\n");
+    fprintf(stream, "  Prints the offset and tags of every jpg with exif\n");
+    fprintf(stream, "  in the disk image or block device disk.img\n\n");
     fprintf(stream, "  $ exiftool gps test.jpg\n");
     fprintf(stream, "  Prints the gps information in test.jpg\n\n");
+    fprintf(stream, "  $ exiftool gps --index=gps.idx --within=48,11,49,12\n");
+    fprintf(stream, "  Prints the files in gps.idx within the given box\n\n");
+    fprintf(stream, "  $ exiftool gps --format=gpx --track *.jpg\n");
+    fprintf(stream, "  Prints the gps positions as a gpx track\n\n");
+    fprintf(stream, "  $ exiftool csv +Model --where='FocalLength > 100'"
+                    " *.jpg\n");
+    fprintf(stream, "  Prints the model of images with a focal length above\n");
+    fprintf(stream, "  100 mm\n\n");
+    fprintf(stream,
+            "  $ exiftool agg -r --by=Model --hist=FocalLength photos\n");
+    fprintf(stream, "  Prints a focal length histogram per camera model\n\n");
+    fprintf(stream, "  $ exiftool dupes -r backup photos\n");
+    fprintf(stream, "  Prints groups of images with the same image data\n\n");
+    fprintf(stream, "  $ exiftool bench print --cold --runs=5 -r photos\n");
+    fprintf(stream, "  Prints files/s, MB/s, syscalls and latency per run\n\n");
+    fprintf(stream, "  $ exiftool gps --geocode=cities500.txt *.jpg\n");
+    fprintf(stream, "  Prints the gps information and the nearest city\n\n");
     fprintf(stream,
             "  $ exiftool rename -p=\"test/cam_[Make].jpg\" test.jpg\n");
     fprintf(stream, "  Renames test.jpg to 'test/cam_NIKON.jpg or similar,\n");
@@ -376,7 +676,11 @@ static void taskHelp(FILE *stream) {
     fprintf(stream,
             "  $ exiftool rename -p=\"test/cam_[Make;1:3].jpg\" test.jpg\n");
     fprintf(stream, "  Renames test.jpg to 'test/cam_NIK.jpg or similar,\n");
-    fprintf(stream, "  depending on the exif information in the file.\n");
+    fprintf(stream, "  depending on the exif information in the file.\n\n");
+    fprintf(stream, "  $ exiftool rename --mode=copy -p=\"cam/[Make].jpg\" ");
+    fprintf(stream, "test.jpg\n");
+    fprintf(stream, "  Copies test.jpg to 'cam/NIKON.jpg' or similar and\n");
+    fprintf(stream, "  keeps the original file.\n");
 }
 
 /* -------------------------------------------------------------------------- */
@@ -390,21 +694,31 @@ static long int taskPrint(FILE *stream, struct options *opt, char **fileTable,
                           long int tagTableItemCount) {
     long int i = 0;
     long int rc = 0;
+    long int spanStart = 0;
     long int exifTableItemCount = 0;
     struct exifItem *exifTable = NULL;
 
     for (i = 0; i < fileTableItemCount; i++) {
-        if ((exifTableItemCount = extractExifInfo(fileTable[i], &exifTable)) <
-            0) {
-            fprintf(stderr, "exiftool: exiflib error %ld\n",
-                    exifTableItemCount);
-            return exifTableItemCount;
+        if ((exifTableItemCount = extractExifInfoFiltered(
+                 fileTable[i], &exifTable, (*opt).filter)) == EXIF_FILTERED)
+            continue;
+
+        if (exifTableItemCount < 0) {
+            fprintf(stderr, "exiftool: '%s': exiflib error %ld\n",
+                    fileTable[i], exifTableItemCount);
+            continue;
         }
 
+        spanStart = traceStart();
+
         fprintf(stream, "[%s]\n", fileTable[i]);
 
-        if ((rc = printExifInfo(stream, exifTable, exifTableItemCount, tagTable,
-                                tagTableItemCount, (*opt).verbose)) < 0) {
+        rc = printExifInfo(stream, exifTable, exifTableItemCount, tagTable,
+                           tagTableItemCount, (*opt).verbose);
+
+        traceSpan("format", fileTable[i], spanStart);
+
+        if (rc < 0) {
             fprintf(stderr, "exiftool: exifparser error %ld\n", rc);
             return rc;
         }
@@ -425,12 +739,17 @@ static long int taskCsv(FILE *stream, struct options *opt, char **fileTable,
                         long int fileTableItemCount, char **tagTable,
                         long int tagTableItemCount) {
     long int i = 0;
-    long int j = 0;
     long int rc = 0;
-    long int exifTableItemCount = 0;
-    struct exifItem *exifTable = NULL;
+    long int spanStart = 0;
 
-    static struct exifItem *exifTag = NULL;
+    struct exifSource source;
+    struct tagCollector collector = {tagTable, tagTableItemCount, NULL, 0};
+
+    /* the tags are visited in place, only the wanted ones are kept */
+
+    if ((collector.exifTable = (struct exifItem *)malloc(
+             sizeof(struct exifItem) * (tagTableItemCount + 1))) == NULL)
+        return ERR_MALLOC;
 
     /* print header */
 
@@ -441,23 +760,45 @@ static long int taskCsv(FILE *stream, struct options *opt, char **fileTable,
     /* loop file table */
 
     for (i = 0; i < fileTableItemCount; i++) {
+        collector.exifTableItemCount = 0;
+
+        if ((rc = openExifSource(&exifDefaultContext, fileTable[i], &source)) ==
+            0)
+            rc = visitExifInfoFiltered(&source, (*opt).filter, collectTagHook,
+                                       &collector);
+
+        if (rc == EXIF_FILTERED) {
+            closeExifSource(&source);
+            continue;
+        }
+
         fprintf(stream, "%s,", fileTable[i]);
 
-        if ((exifTableItemCount = extractExifInfo(fileTable[i], &exifTable)) <
-            0) {
+        if (rc < 0) {
             fprintf(stream, "\n");
+            closeExifSource(&source);
             continue;
         }
 
-        if ((rc = printExifCsv(stream, exifTable, exifTableItemCount, tagTable,
-                               tagTableItemCount, (*opt).verbose)) < 0) {
+        spanStart = traceStart();
+
+        rc = printExifCsv(stream, collector.exifTable,
+                          collector.exifTableItemCount, tagTable,
+                          tagTableItemCount, (*opt).verbose);
+
+        traceSpan("format", fileTable[i], spanStart);
+
+        closeExifSource(&source);
+
+        if (rc < 0) {
             fprintf(stderr, "exiftool: exifparser error %ld\n", rc);
+            free(collector.exifTable);
             return rc;
         }
-
-        free(exifTable);
     }
 
+    free(collector.exifTable);
+
     return 0;
 }
 
@@ -472,88 +813,1279 @@ static long int taskGps(FILE *stream, struct options *opt, char **fileTable,
     long int i = 0;
     long int rc = 0;
     long int exifTableItemCount = 0;
+    long int untimedCount = 0;
     struct exifItem *exifTable = NULL;
-    char *gps = NULL;
+    struct gpsIndex index;
+    struct gpsGazetteer gazetteer;
+    struct geocodeJob job = {&gazetteer, NULL, fileTableItemCount};
+    struct gpsTrack track;
+    struct gpsWriter writer = {stream, (*opt).format, (*opt).track, 0};
+
+    double latitude = 0;
+    double longitude = 0;
+    char dateTime[DATETIME_ISO_LENGTH];
+
+    if ((*opt).within != NULL) return taskGpsQuery(stream, opt);
+
+    if ((*opt).geocode != NULL &&
+        ((*opt).format != GPS_FORMAT_TEXT || (*opt).track)) {
+        fprintf(stderr, "exiftool: --geocode only prints text, not with "
+                        "--format or --track\n");
+        return ERR_OPT_INVALID;
+    }
+
+    memset(&index, 0, sizeof(index));
+    memset(&track, 0, sizeof(track));
+
+    /* load gazetteer once - positions are collected and resolved in batches */
+
+    if ((*opt).geocode != NULL) {
+        if ((rc = loadGpsGazetteer((*opt).geocode, &gazetteer)) < 0) {
+            fprintf(stderr, "exiftool: gazetteer error %ld\n", rc);
+            return rc;
+        }
+
+        rc = 0;
+
+        if ((job.items = (struct geocodeItem *)calloc(
+                 fileTableItemCount + 1, sizeof(struct geocodeItem))) == NULL) {
+            freeGpsGazetteer(&gazetteer);
+            return ERR_MALLOC;
+        }
+    } else
+        printGpsHeader(&writer);
 
     for (i = 0; i < fileTableItemCount; i++) {
-        if ((exifTableItemCount = extractExifInfo(fileTable[i], &exifTable)) <
-            0) {
-            fprintf(stream, "no gps\n");
+        if ((exifTableItemCount = extractExifInfoFiltered(
+                 fileTable[i], &exifTable, (*opt).filter)) == EXIF_FILTERED) {
+            if (job.items != NULL) job.items[i].filtered = 1;
             continue;
         }
 
-        if ((gps = parseSpecialGPS(exifTable, exifTableItemCount)) != NULL)
-            fprintf(stream, "%s\n", gps);
-        else
+        if (exifTableItemCount < 0) {
+            if (job.items == NULL && writer.format == GPS_FORMAT_TEXT)
+                fprintf(stream, "no gps\n");
+            continue;
+        }
+
+        if (parseGPSCoordinates(exifTable, exifTableItemCount, &latitude,
+                                &longitude) == 0) {
+            if (job.items != NULL) {
+                job.items[i].valid = 1;
+                job.items[i].latitude = latitude;
+                job.items[i].longitude = longitude;
+            } else if (writer.track) {
+                if (parseDateTimeISO(exifTable, exifTableItemCount,
+                                     dateTime) < 0)
+                    untimedCount++;
+                else
+                    rc = addGpsTrackPoint(&track, dateTime, latitude,
+                                          longitude, fileTable[i]);
+            } else
+                printGpsPoint(&writer, latitude, longitude,
+                              parseDateTimeISO(exifTable, exifTableItemCount,
+                                               dateTime) == 0
+                                  ? dateTime
+                                  : NULL,
+                              fileTable[i]);
+
+            if (rc == 0 && (*opt).index != NULL)
+                rc = addGpsIndexPoint(&index, latitude, longitude,
+                                      fileTable[i]);
+        } else if (job.items == NULL && writer.format == GPS_FORMAT_TEXT)
             fprintf(stream, "no gps\n");
 
-        free(exifTable);
+        freeExifTable(exifTable, exifTableItemCount);
+
+        if (rc < 0) break;
+    }
+
+    /* print track ordered by time */
+
+    if (rc == 0 && job.items == NULL) {
+        if (writer.track && (rc = writeGpsTrack(&track, &writer)) < 0)
+            fprintf(stderr, "exiftool: gps track error %ld\n", rc);
+        else
+            printGpsFooter(&writer);
+
+        if (writer.track && (*opt).verbose)
+            fprintf(stderr, "gps track: %ld positions without a time\n",
+                    untimedCount);
     }
 
+    /* resolve places */
+
+    if (rc == 0 && job.items != NULL &&
+        (rc = runWorkers((fileTableItemCount + GPS_GEOCODE_BATCH - 1) /
+                             GPS_GEOCODE_BATCH,
+                         (*opt).workers, runGeocodeJob, &job)) >= 0)
+        for (i = 0; i < fileTableItemCount; i++)
+            printGeocodeItem(stream, &gazetteer, &job.items[i]);
+
+    /* write index */
+
+    if (rc >= 0 && (*opt).index != NULL &&
+        (rc = writeGpsIndex((*opt).index, &index)) < 0)
+        fprintf(stderr, "exiftool: gps index error %ld\n", rc);
+
+    /* clean up, also after an error */
+
+    freeGpsTrack(&track);
+    closeGpsIndex(&index);
+
+    if (job.items != NULL) {
+        free(job.items);
+        freeGpsGazetteer(&gazetteer);
+    }
+
+    if (rc < 0) return rc;
+
     return 0;
 }
 
 /* -------------------------------------------------------------------------- */
-/* taskRename                                                                 */
-/* renames files according to a given pattern and their exif information.     */
-/* returns 0 if successful or a negative value otherwise.                     */
+/* taskGpsQuery                                                               */
+/* prints the files of the gps index that lie within the area given by the    */
+/* --within option. returns 0 if successful or a negative value otherwise.    */
 /* -------------------------------------------------------------------------- */
 
-static long int taskRename(FILE *stream, struct options *opt, char **fileTable,
-                           long int fileTableItemCount) {
+static long int taskGpsQuery(FILE *stream, struct options *opt) {
+    long int rc = 0;
+    struct gpsIndex index;
+    struct gpsQuery query;
+
+    if ((*opt).index == NULL) {
+        fprintf(stderr, "exiftool: --within needs a gps --index\n");
+        return ERR_GPS_INDEX;
+    }
+
+    if ((rc = parseGpsQuery((*opt).within, &query)) < 0) {
+        fprintf(stderr, "exiftool: invalid gps query '%s'\n", (*opt).within);
+        return rc;
+    }
+
+    if ((rc = openGpsIndex((*opt).index, &index)) < 0) {
+        fprintf(stderr, "exiftool: gps index error %ld\n", rc);
+        return rc;
+    }
+
+    rc = queryGpsIndex(&index, &query, printGpsIndexPoint, stream);
+
+    closeGpsIndex(&index);
+
+    if (rc < 0) {
+        fprintf(stderr, "exiftool: gps index error %ld\n", rc);
+        return rc;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* printGpsIndexPoint                                                         */
+/* query callback that prints a gps index point to the stream "arg".          */
+/* -------------------------------------------------------------------------- */
+
+static long int printGpsIndexPoint(struct gpsIndexPoint *point, char *name,
+                                   void *arg) {
+    fprintf((FILE *)arg, "%s,%.4f,%.4f\n", name, (*point).latitude,
+            (*point).longitude);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* runGeocodeJob                                                              */
+/* worker function that finds the nearest places for batch "itemNo" of the    */
+/* geocode job "arg". returns 0.                                              */
+/* -------------------------------------------------------------------------- */
+
+static long int runGeocodeJob(long int itemNo, int workerNo, void *arg) {
+    long int i = 0;
+    struct geocodeJob *job = (struct geocodeJob *)arg;
+    struct geocodeItem *item = NULL;
+
+    for (i = itemNo * GPS_GEOCODE_BATCH;
+         i < (itemNo + 1) * GPS_GEOCODE_BATCH && i < (*job).itemCount; i++) {
+        item = &(*job).items[i];
+
+        if ((*item).valid)
+            (*item).place =
+                findNearestGpsPlace((*job).gazetteer, (*item).latitude,
+                                    (*item).longitude, &(*item).distance);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* printGeocodeItem                                                           */
+/* prints a gps position with the name, country code and distance in km of    */
+/* the nearest place. files left out by --where are not printed.              */
+/* -------------------------------------------------------------------------- */
+
+static void printGeocodeItem(FILE *stream, struct gpsGazetteer *gazetteer,
+                             struct geocodeItem *item) {
+    if ((*item).filtered) return;
+
+    if (!(*item).valid) {
+        fprintf(stream, "no gps\n");
+        return;
+    }
+
+    fprintf(stream, "%.4f,%.4f,%s,%s,%.1f\n", (*item).latitude,
+            (*item).longitude, (*gazetteer).names + (*(*item).place).nameOffset,
+            (*(*item).place).countryCode, (*item).distance);
+}
+
+/* -------------------------------------------------------------------------- */
+/* taskAgg                                                                    */
+/* counts the files per group of the tags given by --by, optionally as a      */
+/* histogram of the tag given by --hist. every worker aggregates to its own   */
+/* table, the tables are merged at the end. returns 0 if successful or a      */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int taskAgg(FILE *stream, struct options *opt, char **fileTable,
+                        long int fileTableItemCount) {
     long int i = 0;
     long int rc = 0;
-    long int exifTableItemCount = 0;
-    struct exifItem *exifTable = NULL;
-    char *fileName = NULL;
-    char *modFileName = NULL;
+    long int entryCount = 0;
+    int tableCount = 0;
 
-    struct stat fileStat;
+    struct aggJob job;
+    struct aggEntry **sorted = NULL;
+    struct aggEntry *entry = NULL;
 
-    for (i = 0; i < fileTableItemCount; i++) {
-        if ((exifTableItemCount = extractExifInfo(fileTable[i], &exifTable)) <
-            0) {
-            fprintf(stderr, "exiftool: exiflib error %ld\n",
-                    exifTableItemCount);
-            return exifTableItemCount;
-        }
+    if ((*opt).by == NULL) {
+        fprintf(stderr, "exiftool: agg needs --by\n");
+        return ERR_OPT_INVALID;
+    }
 
-        if ((rc = fileNameFromPattern(&fileName, (*opt).pattern, fileTable[i],
-                                      exifTable, exifTableItemCount)) < 0) {
-            fprintf(stderr, "exiftool: exifparser error %ld\n", rc);
-            return rc;
-        }
+    job.opt = opt;
+    job.fileTable = fileTable;
 
-        if ((*opt).verbose)
-            fprintf(stream, "renaming '%s' to '%s'\n", fileTable[i], fileName);
+    if ((job.specTableItemCount = parseAggSpec((*opt).by, &job.specTable)) <
+        0) {
+        fprintf(stderr, "exiftool: invalid --by '%s'\n", (*opt).by);
+        return ERR_OPT_INVALID;
+    }
 
-        /* check is file exists or modify name */
+    if ((*opt).hist != NULL && findTagIDByName((*opt).hist) < 0) {
+        fprintf(stderr, "exiftool: invalid --hist '%s'\n", (*opt).hist);
+        freeAggSpec(job.specTable, job.specTableItemCount);
+        return ERR_OPT_INVALID;
+    }
 
-        while (stat(fileName, &fileStat) == 0) {
-            if ((rc = modifyFileName(&modFileName, fileName)) < 0) return rc;
-            fileName = modFileName;
-            if ((*opt).verbose)
-                fprintf(stream, "using '%s' instead\n", fileName);
-        }
+    tableCount = (*opt).workers;
+    if (tableCount > WORKER_MAX_COUNT) tableCount = WORKER_MAX_COUNT;
 
-        /* create directories */
+    if ((job.tables = (struct aggTable *)calloc(
+             tableCount, sizeof(struct aggTable))) == NULL)
+        return ERR_MALLOC;
 
-        if ((rc = createFolders(stream, fileName, opt)) < 0) {
-            fprintf(stderr, "exiftool: create folder error \n");
-            return rc;
-        }
+    /* every worker collects the grouped tags and the histogram tag in place */
 
-        /* rename file */
+    job.tagTableItemCount = job.specTableItemCount + ((*opt).hist != NULL);
 
-        if (!(*opt).simulate) {
-            if (rename(fileTable[i], fileName) < 0) {
-                fprintf(stderr, "exiftool: rename file error\n");
-                return ERR_RENAME;
-            }
+    if ((job.tagTable = (char **)malloc(sizeof(char *) *
+                                        (job.tagTableItemCount + 1))) == NULL)
+        return ERR_MALLOC;
+
+    for (i = 0; i < job.specTableItemCount; i++)
+        job.tagTable[i] = job.specTable[i].tagName;
+
+    if ((*opt).hist != NULL) job.tagTable[i] = (*opt).hist;
+
+    if ((job.collectTables = (struct exifItem *)malloc(
+             sizeof(struct exifItem) * (job.tagTableItemCount + 1) *
+             tableCount)) == NULL)
+        return ERR_MALLOC;
+
+    /* aggregate */
+
+    if ((rc = runWorkers(fileTableItemCount, (*opt).workers, runAggJob,
+                         &job)) < 0) {
+        fprintf(stderr, "exiftool: aggregation error %ld\n", rc);
+        return ERR_AGG;
+    }
+
+    /* merge worker tables */
+
+    for (i = 1; i < tableCount; i++) {
+        if ((rc = mergeAggTable(&job.tables[0], &job.tables[i])) < 0) {
+            fprintf(stderr, "exiftool: aggregation error %ld\n", rc);
+            return ERR_AGG;
         }
+
+        freeAggTable(&job.tables[i]);
+    }
+
+    if ((entryCount = sortAggTable(&job.tables[0], &sorted)) < 0)
+        return ERR_MALLOC;
+
+    /* print header and groups */
+
+    for (i = 0; i < job.specTableItemCount; i++)
+        fprintf(stream, "%s,", job.specTable[i].tagName);
+    if ((*opt).hist != NULL) fprintf(stream, "%s,", (*opt).hist);
+    fprintf(stream, "Count\n");
+
+    for (i = 0; i < entryCount; i++) {
+        entry = sorted[i];
+
+        fprintf(stream, "%s,", (*entry).key);
+
+        if ((*opt).hist == NULL)
+            ;
+        else if ((*entry).binType == AGG_BIN_VALUE)
+            fprintf(stream, "%g,", (*entry).bin);
+        else if ((*entry).binType == AGG_BIN_MISSING)
+            fprintf(stream, "n/a,");
+        else
+            fprintf(stream, "all,");
+
+        fprintf(stream, "%ld\n", (*entry).count);
+    }
+
+    /* clean up */
+
+    free(sorted);
+    freeAggTable(&job.tables[0]);
+    free(job.tables);
+    free(job.tagTable);
+    free(job.collectTables);
+
+    freeAggSpec(job.specTable, job.specTableItemCount);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* runAggJob                                                                  */
+/* worker function of taskAgg. adds file "itemNo" to the table of worker      */
+/* "workerNo". files without exif information are counted as "n/a". returns   */
+/* 0 if successful or a negative value otherwise.                             */
+/* -------------------------------------------------------------------------- */
+
+static long int runAggJob(long int itemNo, int workerNo, void *arg) {
+    long int rc = 0;
+    double number = 0;
+
+    struct aggJob *job = (struct aggJob *)arg;
+    struct options *opt = (*job).opt;
+    struct aggTable *table = &(*job).tables[workerNo];
+    struct exifItem *tag = NULL;
+    struct exifSource source;
+    struct tagCollector collector = {
+        (*job).tagTable, (*job).tagTableItemCount,
+        &(*job).collectTables[workerNo * (*job).tagTableItemCount], 0};
+    char *key = NULL;
+
+    if ((rc = openExifSource(&exifDefaultContext, (*job).fileTable[itemNo],
+                             &source)) == 0)
+        rc = visitExifInfoFiltered(&source, (*opt).filter, collectTagHook,
+                                   &collector);
+
+    if (rc == EXIF_FILTERED) {
+        closeExifSource(&source);
+        return 0;
+    }
+
+    if (rc < 0) collector.exifTableItemCount = 0;
+
+    if ((rc = makeAggKey(&key, (*job).specTable, (*job).specTableItemCount,
+                         collector.exifTable, collector.exifTableItemCount)) <
+        0) {
+        closeExifSource(&source);
+        return rc;
+    }
+
+    /* group total */
+
+    if ((*opt).hist == NULL || (*opt).count)
+        rc = addAggEntry(table, key, AGG_BIN_NONE, 0, 1);
+
+    /* histogram bin */
+
+    if (rc == 0 && (*opt).hist != NULL) {
+        if ((tag = findTagByName(collector.exifTable,
+                                 collector.exifTableItemCount,
+                                 (*opt).hist)) != NULL &&
+            parseTagNumber(tag, &number) == 0)
+            rc = addAggEntry(table, key, AGG_BIN_VALUE,
+                             floor(number / (*opt).bin) * (*opt).bin, 1);
+        else
+            rc = addAggEntry(table, key, AGG_BIN_MISSING, 0, 1);
     }
 
-    free(exifTable);
+    free(key);
+    closeExifSource(&source);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* taskDupes                                                                  */
+/* prints groups of files with the same image payload. the payload is only    */
+/* hashed for files sharing a candidate key and compared for files sharing a  */
+/* hash, see exifdupe.h. returns 0 if successful or a negative value          */
+/* otherwise.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+static long int taskDupes(FILE *stream, struct options *opt, char **fileTable,
+                          long int fileTableItemCount) {
+    long int i = 0;
+    long int j = 0;
+    long int k = 0;
+    long int rc = 0;
+    long int candidateCount = 0;
+    long int compareCount = 0;
+    long int equalCount = 0;
+    long int groupCount = 0;
+
+    struct dupeItem *items = NULL;
+    struct dupeItem **candidates = NULL;
+
+    if ((items = (struct dupeItem *)calloc(fileTableItemCount + 1,
+                                           sizeof(struct dupeItem))) == NULL)
+        return ERR_MALLOC;
+
+    if ((candidates = (struct dupeItem **)malloc(
+             sizeof(struct dupeItem *) * (fileTableItemCount + 1))) == NULL) {
+        free(items);
+        return ERR_MALLOC;
+    }
+
+    for (i = 0; i < fileTableItemCount; i++) {
+        items[i].fileName = fileTable[i];
+        items[i].itemNo = i;
+    }
+
+    /* first pass - candidate keys from the metadata */
+
+    if ((rc = runWorkers(fileTableItemCount, (*opt).workers, runFingerprintJob,
+                         items)) < 0) {
+        free(candidates);
+        free(items);
+        return rc;
+    }
+
+    if ((*opt).verbose)
+        for (i = 0; i < fileTableItemCount; i++)
+            if (items[i].rc < 0)
+                fprintf(stderr, "exiftool: skipping '%s' (%ld)\n",
+                        items[i].fileName, items[i].rc);
+
+    sortDupeItems(items, fileTableItemCount);
+
+    /* second pass - payload hashes of colliding candidates */
+
+    for (i = 0; i < fileTableItemCount && items[i].rc >= 0; i = j) {
+        for (j = i + 1; j < fileTableItemCount && items[j].rc >= 0 &&
+                        items[j].keyHash == items[i].keyHash;
+             j++)
+            ;
+
+        if (j - i < 2) continue;
+
+        for (; i < j; i++) candidates[candidateCount++] = &items[i];
+    }
+
+    if ((rc = runWorkers(candidateCount, (*opt).workers, runPayloadJob,
+                         candidates)) < 0) {
+        free(candidates);
+        free(items);
+        return rc;
+    }
+
+    sortDupeItems(items, fileTableItemCount);
+
+    /* third pass - equal hashes are confirmed by comparing the payloads */
+
+    compareCount = 0;
+
+    for (i = 0; i < fileTableItemCount && items[i].rc >= 0; i = j) {
+        for (j = i + 1; j < fileTableItemCount && items[j].rc >= 0 &&
+                        items[j].payloadHashed &&
+                        items[j].keyHash == items[i].keyHash &&
+                        items[j].payloadHash == items[i].payloadHash;
+             j++) {
+            items[j].groupHead = &items[i];
+            candidates[compareCount++] = &items[j];
+        }
+    }
+
+    if ((rc = runWorkers(compareCount, (*opt).workers, runCompareJob,
+                         candidates)) < 0) {
+        free(candidates);
+        free(items);
+        return rc;
+    }
+
+    /* print groups */
+
+    for (i = 0; i < fileTableItemCount && items[i].rc >= 0; i = j) {
+        equalCount = 0;
+
+        for (j = i + 1; j < fileTableItemCount && items[j].rc >= 0 &&
+                        items[j].groupHead == &items[i];
+             j++)
+            equalCount = equalCount + items[j].payloadEqual;
+
+        if (!items[i].payloadHashed || equalCount == 0) continue;
+
+        if (groupCount > 0) fprintf(stream, "\n");
+
+        fprintf(stream, "%s\n", items[i].fileName);
+
+        for (k = i + 1; k < j; k++)
+            if (items[k].payloadEqual)
+                fprintf(stream, "%s%s\n", items[k].fileName,
+                        items[k].metaHash == items[i].metaHash
+                            ? ""
+                            : " (metadata differs)");
+
+        groupCount++;
+    }
+
+    if ((*opt).verbose)
+        fprintf(stderr, "%ld files, %ld payloads hashed, %ld groups\n",
+                fileTableItemCount, candidateCount, groupCount);
+
+    free(candidates);
+    free(items);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* runFingerprintJob                                                          */
+/* worker function of taskDupes. fingerprints file "itemNo". files that can   */
+/* not be fingerprinted are skipped, so it always returns 0.                  */
+/* -------------------------------------------------------------------------- */
+
+static long int runFingerprintJob(long int itemNo, int workerNo, void *arg) {
+    struct dupeItem *item = &((struct dupeItem *)arg)[itemNo];
+
+    (*item).rc = fingerprintFile(item);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* runPayloadJob                                                              */
+/* worker function of taskDupes. hashes the payload of candidate "itemNo".    */
+/* files that can not be read are skipped, so it always returns 0.            */
+/* -------------------------------------------------------------------------- */
+
+static long int runPayloadJob(long int itemNo, int workerNo, void *arg) {
+    struct dupeItem *item = ((struct dupeItem **)arg)[itemNo];
+
+    (*item).rc = hashFilePayload(item);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* runCompareJob                                                              */
+/* worker function of taskDupes. compares the payload of candidate "itemNo"   */
+/* with the first file of its group. files that can not be read count as      */
+/* different, so it always returns 0.                                         */
+/* -------------------------------------------------------------------------- */
+
+static long int runCompareJob(long int itemNo, int workerNo, void *arg) {
+    struct dupeItem *item = ((struct dupeItem **)arg)[itemNo];
+
+    (*item).payloadEqual = compareFilePayloads((*item).groupHead, item) == 0;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* taskThumb                                                                  */
+/* writes the embedded thumbnail, or the largest preview of a raw file, of    */
+/* every file. without a pattern the previews go to "stream" one after the    */
+/* other, with a pattern each one goes to its own file named like rename      */
+/* does. the image data is copied by the kernel from the source file.         */
+/* returns 0 if successful or a negative value otherwise.                     */
+/* -------------------------------------------------------------------------- */
+
+static long int taskThumb(FILE *stream, struct options *opt, char **fileTable,
+                          long int fileTableItemCount) {
+    int workers = (*opt).workers;
+    struct thumbJob job = {stream, opt, fileTable, fileno(stream)};
+
+    /* previews written to the stream keep the order of the files */
+
+    if ((*opt).pattern == NULL) workers = 1;
+
+    fflush(stream);
+
+    return runWorkers(fileTableItemCount, workers, runThumbJob, &job);
+}
+
+/* -------------------------------------------------------------------------- */
+/* runThumbJob                                                                */
+/* worker function of taskThumb. finds the preview of file "itemNo" and       */
+/* writes it. files without a preview are reported and skipped. returns 0 if  */
+/* successful or a negative value if the preview could not be written.        */
+/* -------------------------------------------------------------------------- */
+
+static long int runThumbJob(long int itemNo, int workerNo, void *arg) {
+    long int rc = 0;
+    long int exifTableItemCount = 0;
+
+    struct thumbJob *job = (struct thumbJob *)arg;
+    struct options *opt = (*job).opt;
+    struct exifItem *exifTable = NULL;
+    struct exifSource source;
+    struct exifPreview preview;
+
+    char *srcFileName = (*job).fileTable[itemNo];
+    char *fileName = NULL;
+    char *modFileName = NULL;
+    int fd = -1;
+
+    /* a pattern needs the tags, a filter only a walk over them */
+
+    if ((rc = openExifSource(&exifDefaultContext, srcFileName, &source)) < 0) {
+        fprintf(stderr, "exiftool: '%s': exiflib error %ld\n", srcFileName,
+                rc);
+        return 0;
+    }
+
+    if ((*opt).pattern != NULL)
+        rc = exifTableItemCount = extractExifInfoFiltered(
+            srcFileName, &exifTable, (*opt).filter);
+    else if ((*opt).filter != NULL)
+        rc = visitExifInfoFiltered(&source, (*opt).filter, NULL, NULL);
+
+    if (rc >= 0) rc = findExifPreview(&exifDefaultContext, &source, &preview);
+
+    closeExifSource(&source);
+
+    if (rc == EXIF_FILTERED) return 0;
+
+    if (rc < 0) {
+        fprintf(stderr, "exiftool: '%s': exiflib error %ld\n", srcFileName,
+                rc);
+        freeExifTable(exifTable, exifTableItemCount);
+        return 0;
+    }
+
+    if ((*opt).pattern == NULL)
+        return writeThumb(job, srcFileName, &preview, -1);
+
+    /* name the preview file */
+
+    rc = fileNameFromPattern(&fileName, (*opt).pattern, srcFileName,
+                             exifTable, exifTableItemCount);
+
+    freeExifTable(exifTable, exifTableItemCount);
+
+    if (rc < 0) {
+        fprintf(stderr, "exiftool: '%s': exifparser error %ld\n", srcFileName,
+                rc);
+        return 0;
+    }
+
+    if ((rc = createFolders((*job).stream, fileName, opt)) < 0) {
+        fprintf(stderr, "exiftool: create folder error \n");
+        free(fileName);
+        return rc;
+    }
+
+    /* claim a free name - other workers may claim names at the same time */
+
+    while (!(*opt).simulate && (rc = claimFileName(fileName, 0666, &fd)) < 0 &&
+           errno == EEXIST) {
+        if ((rc = modifyFileName(&modFileName, fileName)) < 0) break;
+
+        free(fileName);
+        fileName = modFileName;
+        modFileName = NULL;
+    }
+
+    if (rc < 0) {
+        fprintf(stderr, "exiftool: file '%s' can not be created\n", fileName);
+        free(fileName);
+        return rc;
+    }
+
+    if ((*opt).verbose)
+        fprintf((*job).stream, "writing preview of '%s' to '%s'\n",
+                srcFileName, fileName);
+
+    if (!(*opt).simulate) rc = writeThumb(job, srcFileName, &preview, fd);
+
+    free(fileName);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeThumb                                                                 */
+/* copies "preview" of "srcFileName" to the claimed file "fd" and closes it   */
+/* or, if "fd" is -1, to the output of "job". returns 0 if successful or a    */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int writeThumb(struct thumbJob *job, char *srcFileName,
+                           struct exifPreview *preview, int fd) {
+    long int rc = 0;
+    long int spanStart = traceStart();
+    int fdIn = -1;
+    int fdOut = fd < 0 ? (*job).fdOut : fd;
+
+    if ((fdIn = open(srcFileName, O_RDONLY)) < 0) {
+        fprintf(stderr, "exiftool: can not open '%s'\n", srcFileName);
+        if (fd >= 0) close(fd);
+        return ERR_FILEOPEN;
+    }
+
+    rc = copyFileData(fdIn, (*preview).pos, fdOut, (*preview).length);
+
+    close(fdIn);
+
+    if (fd >= 0 && close(fd) < 0 && rc == 0) rc = COPY_ERR_COPY;
+
+    traceSpan("write", srcFileName, spanStart);
+
+    if (rc < 0) {
+        fprintf(stderr, "exiftool: copy error %ld for '%s'\n", rc,
+                srcFileName);
+        return ERR_COPY;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* taskSet                                                                    */
+/* applies the edits in "tagTable" to every file in place. the files are      */
+/* edited by the workers, a file that can not be edited is reported and left  */
+/* as it is. returns 0 if successful or a negative value otherwise.           */
+/* -------------------------------------------------------------------------- */
+
+static long int taskSet(FILE *stream, struct options *opt, char **fileTable,
+                        long int fileTableItemCount, char **tagTable,
+                        long int tagTableItemCount) {
+    long int i = 0;
+    long int rc = 0;
+
+    struct setJob job = {stream, opt, fileTable, NULL, 0};
+
+    if ((job.editCount = parseSetEdits(tagTable, tagTableItemCount,
+                                       &job.edits)) <= 0) {
+        fprintf(stderr, "exiftool: invalid edit (%ld)\n", job.editCount);
+        fprintf(stderr, "Try 'exiftool help' for more information.\n");
+        rc = ERR_ARG_INVALID;
+    } else
+        rc = runWorkers(fileTableItemCount, (*opt).workers, runSetJob, &job);
+
+    for (i = 0; i < tagTableItemCount && job.edits != NULL; i++)
+        free(job.edits[i].tagName);
+
+    free(job.edits);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* runSetJob                                                                  */
+/* worker function of taskSet. edits file "itemNo", errors are reported and   */
+/* the file is skipped, so it always returns 0.                               */
+/* -------------------------------------------------------------------------- */
+
+static long int runSetJob(long int itemNo, int workerNo, void *arg) {
+    long int rc = 0;
+    long int spanStart = traceStart();
+
+    struct setJob *job = (struct setJob *)arg;
+    struct options *opt = (*job).opt;
+    char *fileName = (*job).fileTable[itemNo];
+
+    rc = setFileTags(fileName, (*job).edits, (*job).editCount, (*opt).filter,
+                     (*opt).simulate);
+
+    traceSpan("write", fileName, spanStart);
+
+    if (rc == EXIF_FILTERED) return 0;
+
+    if (rc == SET_ERR_FILE_PARTIAL)
+        fprintf(stderr, "exiftool: '%s': set error %ld, partly written\n",
+                fileName, rc);
+    else if (rc < 0)
+        fprintf(stderr, "exiftool: '%s': set error %ld\n", fileName, rc);
+    else if ((*opt).verbose)
+        fprintf((*job).stream, "setting %ld tags of '%s'\n", rc, fileName);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* taskStrip                                                                  */
+/* removes the metadata segments of every jpg file. the files are rewritten   */
+/* by the workers, a file that can not be stripped is reported and left as    */
+/* it is. returns 0 if successful or a negative value otherwise.              */
+/* -------------------------------------------------------------------------- */
+
+static long int taskStrip(FILE *stream, struct options *opt, char **fileTable,
+                          long int fileTableItemCount) {
+    struct stripJob job = {stream, opt, fileTable};
+
+    return runWorkers(fileTableItemCount, (*opt).workers, runStripJob, &job);
+}
+
+/* -------------------------------------------------------------------------- */
+/* runStripJob                                                                */
+/* worker function of taskStrip. strips file "itemNo", errors are reported    */
+/* and the file is skipped, so it always returns 0.                           */
+/* -------------------------------------------------------------------------- */
+
+static long int runStripJob(long int itemNo, int workerNo, void *arg) {
+    long int rc = 0;
+    long int spanStart = traceStart();
+
+    struct stripJob *job = (struct stripJob *)arg;
+    struct options *opt = (*job).opt;
+    char *fileName = (*job).fileTable[itemNo];
+
+    rc = stripFile(fileName, (*opt).filter, (*opt).simulate);
+
+    traceSpan("write", fileName, spanStart);
+
+    if (rc == EXIF_FILTERED) return 0;
+
+    if (rc < 0)
+        fprintf(stderr, "exiftool: '%s': strip error %ld\n", fileName, rc);
+    else if ((*opt).verbose)
+        fprintf((*job).stream, "stripping '%s'\n", fileName);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* taskCarve                                                                  */
+/* prints the offset and the tags in "tagTable", or the default tags, of      */
+/* every jpg with exif found in the disk images in "fileTable" as csv. the    */
+/* images are read one after the other. returns 0 if successful or a negative */
+/* value otherwise.                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int taskCarve(FILE *stream, struct options *opt, char **fileTable,
+                          long int fileTableItemCount, char **tagTable,
+                          long int tagTableItemCount) {
+    long int i = 0;
+    long int rc = 0;
+    long int spanStart = 0;
+
+    struct tagCollector collector = {tagTable, tagTableItemCount, NULL, 0};
+    struct carveJob job = {stream, opt, NULL, &collector};
+    struct carveScan scan = {printCarveHit, &job, 0, 0, 0};
+
+    if (tagTableItemCount == 0) {
+        collector.tagTable = carveDefaultTags;
+        collector.tagTableItemCount = CARVE_DEFAULT_TAG_COUNT;
+    }
+
+    if ((collector.exifTable = (struct exifItem *)malloc(
+             sizeof(struct exifItem) * (collector.tagTableItemCount + 1))) ==
+        NULL)
+        return ERR_MALLOC;
+
+    /* print header */
+
+    fprintf(stream, "Filename,Offset,");
+    for (i = 0; i < collector.tagTableItemCount; i++)
+        fprintf(stream, "%s,", collector.tagTable[i]);
+    fprintf(stream, "\n");
+
+    /* loop file table */
+
+    for (i = 0; i < fileTableItemCount; i++) {
+        job.fileName = fileTable[i];
+        spanStart = traceStart();
+
+        if ((rc = carveFile(fileTable[i], &scan)) < 0)
+            fprintf(stderr, "exiftool: '%s': carve error %ld\n", fileTable[i],
+                    rc);
+
+        traceSpan("carve", fileTable[i], spanStart);
+    }
+
+    if ((*opt).verbose)
+        fprintf(stderr, "carved %ld jpgs, %ld rejected, %ld bytes read\n",
+                scan.hitCount, scan.rejectCount, scan.bytesRead);
+
+    free(collector.exifTable);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* printCarveHit                                                              */
+/* hook of taskCarve. visits the jpg "source" at "pos" of the disk image of   */
+/* the carveJob "arg" and prints it if it matches the filter. returns 0 if    */
+/* the jpg is printed or a negative value otherwise.                          */
+/* -------------------------------------------------------------------------- */
+
+static long int printCarveHit(struct exifSource *source, long int pos,
+                              void *arg) {
+    long int rc = 0;
+
+    struct carveJob *job = (struct carveJob *)arg;
+    struct tagCollector *collector = (*job).collector;
+
+    (*collector).exifTableItemCount = 0;
+
+    if ((rc = visitExifInfoFiltered(source, (*(*job).opt).filter,
+                                    collectTagHook, collector)) < 0)
+        return rc;
+
+    fprintf((*job).stream, "%s,%ld,", (*job).fileName, pos);
+
+    return printExifCsv((*job).stream, (*collector).exifTable,
+                        (*collector).exifTableItemCount, (*collector).tagTable,
+                        (*collector).tagTableItemCount, (*(*job).opt).verbose);
+}
+
+/* -------------------------------------------------------------------------- */
+/* taskBench                                                                  */
+/* runs "task" file by file over the file table "runs" times with the output  */
+/* going to /dev/null, and prints the throughput, the i/o and the latency     */
+/* per file of every run. with "cold", the page cache of every file is        */
+/* dropped before each run. rename is always simulated. returns 0 if          */
+/* successful or a negative value otherwise.                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int taskBench(FILE *stream, struct options *opt, int task,
+                          char **fileTable, long int fileTableItemCount,
+                          char **tagTable, long int tagTableItemCount) {
+    long int i = 0;
+    long int runNo = 0;
+    long int rc = 0;
+    double start = 0;
+
+    FILE *devNull = NULL;
+    struct benchRun run;
+
+    if (task == TASK_HELP || task == TASK_BENCH || task == TASK_DUPES) {
+        fprintf(stderr, "exiftool: task can not be benchmarked\n");
+        return ERR_ARG_INVALID;
+    }
+
+    if (task == TASK_RENAME || task == TASK_SET || task == TASK_STRIP ||
+        (task == TASK_THUMB && (*opt).pattern != NULL))
+        (*opt).simulate = 1;
+    (*opt).verbose = 0;
+
+    if ((devNull = fopen("/dev/null", "w")) == NULL) return ERR_FILEOPEN;
+
+    if ((run.latencies = (double *)malloc(
+             sizeof(double) * (fileTableItemCount + 1))) == NULL) {
+        fclose(devNull);
+        return ERR_MALLOC;
+    }
+
+    for (runNo = 1; runNo <= (*opt).runs; runNo++) {
+        if ((*opt).cold)
+            for (i = 0; i < fileTableItemCount; i++)
+                evictFileCache(fileTable[i]);
+
+        run.fileCount = fileTableItemCount;
+        run.errorCount = 0;
+
+        if ((rc = readBenchIo(&run.ioStart)) < 0) {
+            fprintf(stderr, "exiftool: can not read /proc/self/io\n");
+            break;
+        }
+
+        start = benchTime();
+
+        for (i = 0; i < fileTableItemCount; i++) {
+            run.latencies[i] = benchTime();
+
+            if (runBenchTask(devNull, opt, task, fileTable + i, tagTable,
+                             tagTableItemCount) < 0)
+                run.errorCount++;
+
+            run.latencies[i] = benchTime() - run.latencies[i];
+        }
+
+        run.elapsed = benchTime() - start;
+
+        if ((rc = readBenchIo(&run.ioEnd)) < 0) break;
+
+        printBenchRun(stream, runNo, &run);
+    }
+
+    free(run.latencies);
+    fclose(devNull);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* runBenchTask                                                               */
+/* runs "task" for the first file of "fileTable" only. returns the result of  */
+/* the task.                                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int runBenchTask(FILE *stream, struct options *opt, int task,
+                             char **fileTable, char **tagTable,
+                             long int tagTableItemCount) {
+    if (task == TASK_PRINT)
+        return taskPrint(stream, opt, fileTable, 1, tagTable,
+                         tagTableItemCount);
+
+    if (task == TASK_CSV)
+        return taskCsv(stream, opt, fileTable, 1, tagTable, tagTableItemCount);
+
+    if (task == TASK_GPS) return taskGps(stream, opt, fileTable, 1);
+
+    if (task == TASK_RENAME) return taskRename(stream, opt, fileTable, 1);
+
+    if (task == TASK_AGG) return taskAgg(stream, opt, fileTable, 1);
+
+    if (task == TASK_THUMB) return taskThumb(stream, opt, fileTable, 1);
+
+    if (task == TASK_SET)
+        return taskSet(stream, opt, fileTable, 1, tagTable, tagTableItemCount);
+
+    if (task == TASK_STRIP) return taskStrip(stream, opt, fileTable, 1);
+
+    if (task == TASK_CARVE)
+        return taskCarve(stream, opt, fileTable, 1, tagTable,
+                         tagTableItemCount);
+
+    return ERR_ARG_INVALID;
+}
+
+/* -------------------------------------------------------------------------- */
+/* taskRename                                                                 */
+/* renames files according to a given pattern and their exif information.     */
+/* returns 0 if successful or a negative value otherwise.                     */
+/* -------------------------------------------------------------------------- */
+
+static long int taskRename(FILE *stream, struct options *opt, char **fileTable,
+                           long int fileTableItemCount) {
+    long int i = 0;
+    long int rc = 0;
+    long int exifTableItemCount = 0;
+    long int copyTableItemCount = 0;
+    long int phaseStart = 0;
+    long int spanStart = 0;
+    struct exifItem *exifTable = NULL;
+    struct copyJob *copyTable = NULL;
+    char *fileName = NULL;
+    char *modFileName = NULL;
+    char *verb = NULL;
+
+    struct stat fileStat;
+
+    if ((*opt).mode == COPY_MODE_COPY)
+        verb = "copying";
+    else if ((*opt).mode == COPY_MODE_LINK)
+        verb = "linking";
+    else if ((*opt).mode == COPY_MODE_REFLINK)
+        verb = "reflinking";
+    else
+        verb = "renaming";
+
+    for (i = 0; i < fileTableItemCount; i++) {
+        if ((exifTableItemCount = extractExifInfoFiltered(
+                 fileTable[i], &exifTable, (*opt).filter)) == EXIF_FILTERED)
+            continue;
+
+        if (exifTableItemCount < 0) {
+            fprintf(stderr, "exiftool: '%s': exiflib error %ld\n",
+                    fileTable[i], exifTableItemCount);
+            continue;
+        }
+
+        phaseStart = startPhase();
+        spanStart = traceStart();
+
+        fileName = NULL;
+
+        rc = fileNameFromPattern(&fileName, (*opt).pattern, fileTable[i],
+                                 exifTable, exifTableItemCount);
+
+        freeExifTable(exifTable, exifTableItemCount);
+        exifTable = NULL;
+
+        endPhase(STATS_PHASE_FORMAT, phaseStart);
+        traceSpan("format", fileTable[i], spanStart);
+
+        if (rc < 0) {
+            fprintf(stderr, "exiftool: '%s': exifparser error %ld\n",
+                    fileTable[i], rc);
+            free(fileName);
+            continue;
+        }
+
+        if ((*opt).verbose)
+            fprintf(stream, "%s '%s' to '%s'\n", verb, fileTable[i], fileName);
+
+        /* check is file exists or modify name */
+
+        while (stat(fileName, &fileStat) == 0) {
+            if ((rc = modifyFileName(&modFileName, fileName)) < 0) break;
+            free(fileName);
+            fileName = modFileName;
+            if ((*opt).verbose)
+                fprintf(stream, "using '%s' instead\n", fileName);
+        }
+
+        if (rc < 0) {
+            fprintf(stderr, "exiftool: '%s': modify name error %ld\n",
+                    fileTable[i], rc);
+            free(fileName);
+            continue;
+        }
+
+        /* create directories */
+
+        if ((rc = createFolders(stream, fileName, opt)) < 0) {
+            fprintf(stderr, "exiftool: '%s': create folder error %ld\n",
+                    fileName, rc);
+            free(fileName);
+            continue;
+        }
+
+        if ((*opt).simulate) {
+            free(fileName);
+            continue;
+        }
+
+        /* rename file - moving to another file system needs a copy */
+
+        if ((*opt).mode == COPY_MODE_MOVE) {
+            spanStart = traceStart();
+
+            rc = rename(fileTable[i], fileName);
+
+            traceSpan("write", fileTable[i], spanStart);
+
+            if (rc == 0 || errno != EXDEV) {
+                if (rc < 0)
+                    fprintf(stderr, "exiftool: '%s': rename file error\n",
+                            fileTable[i]);
+                free(fileName);
+                continue;
+            }
+        }
+
+        /* claim the name now, the data is copied by the workers below. the  */
+        /* copy stays private until copyFile gives it the mode of the source */
+
+        if ((rc = claimFileName(fileName, 0600, NULL)) < 0) {
+            fprintf(stderr, "exiftool: file '%s' exists\n", fileName);
+            free(fileName);
+            continue;
+        }
+
+        if ((rc = addCopyJob(&copyTable, copyTableItemCount, fileTable[i],
+                             fileName, (*opt).mode)) < 0) {
+            fprintf(stderr, "exiftool: '%s': copy job error %ld\n",
+                    fileTable[i], rc);
+            unlink(fileName);
+            free(fileName);
+            continue;
+        }
+
+        copyTableItemCount++;
+    }
+
+    /* copy files - a failed copy does not stop the others */
+
+    if ((rc = runWorkers(copyTableItemCount, (*opt).workers, runCopyJob,
+                         copyTable)) < 0)
+        fprintf(stderr, "exiftool: worker error %ld\n", rc);
+
+    /* remove the names claimed for copies that failed or never ran. a move */
+    /* that could not remove its source keeps the complete copy             */
+
+    for (i = 0; i < copyTableItemCount; i++) {
+        if (copyTable[i].rc < 0 && copyTable[i].rc != COPY_ERR_UNLINK)
+            unlink(copyTable[i].dstFileName);
+
+        if (copyTable[i].rc < 0 && rc == 0) rc = ERR_COPY;
+
+        free(copyTable[i].dstFileName);
+    }
+
+    free(copyTable);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* claimFileName                                                              */
+/* creates an empty file "fileName" with "mode", less the umask, if it does   */
+/* not exist yet. the file is left open for writing in "fd", or closed if     */
+/* "fd" is NULL. returns 0 if successful or a negative value otherwise.       */
+/* -------------------------------------------------------------------------- */
+
+static long int claimFileName(char *fileName, mode_t mode, int *fd) {
+    int fdOut = 0;
+
+    if ((fdOut = open(fileName, O_WRONLY | O_CREAT | O_EXCL, mode)) < 0)
+        return ERR_FILEEXISTS;
+
+    if (fd == NULL)
+        close(fdOut);
+    else
+        *fd = fdOut;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* addCopyJob                                                                 */
+/* adds a job to copy "srcFileName" to "dstFileName" to "copyTable" which     */
+/* already contains "copyTableItemCount" items. returns 0 if successful or a  */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int addCopyJob(struct copyJob **copyTable,
+                           long int copyTableItemCount, char *srcFileName,
+                           char *dstFileName, int mode) {
+    if ((*copyTable = (struct copyJob *)realloc(
+             *copyTable, sizeof(struct copyJob) * (copyTableItemCount + 1))) ==
+        NULL)
+        return ERR_MALLOC;
+
+    (*copyTable)[copyTableItemCount].srcFileName = srcFileName;
+    (*copyTable)[copyTableItemCount].dstFileName = dstFileName;
+    (*copyTable)[copyTableItemCount].mode = mode;
+    (*copyTable)[copyTableItemCount].rc = ERR_COPY;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* runCopyJob                                                                 */
+/* worker function that executes the copy job "itemNo" of the copy table      */
+/* "arg". returns 0 if successful or a negative value otherwise.              */
+/* -------------------------------------------------------------------------- */
+
+static long int runCopyJob(long int itemNo, int workerNo, void *arg) {
+    long int rc = 0;
+    long int spanStart = traceStart();
+    struct copyJob *job = &((struct copyJob *)arg)[itemNo];
+
+    rc = copyFile((*job).srcFileName, (*job).dstFileName, (*job).mode);
+
+    traceSpan("write", (*job).srcFileName, spanStart);
+
+    (*job).rc = rc;
+
+    if (rc < 0)
+        fprintf(stderr, "exiftool: copy error %ld for '%s'\n", rc,
+                (*job).srcFileName);
 
     return 0;
 }
@@ -588,7 +2120,8 @@ static long int createFolders(FILE *stream, char *fileName,
                 fprintf(stream, "creating directory '%s'\n", dirName);
 
             if (!(*opt).simulate)
-                if (mkdir(dirName, 0755) != 0) return ERR_MAKEDIR;
+                if (mkdir(dirName, 0755) != 0 && errno != EEXIST)
+                    return ERR_MAKEDIR;
         }
 
         fileName = limiterPos + 1;
@@ -11,9 +11,21 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#include "exifagg.h"
+#include "exifbench.h"
+#include "exifcarve.h"
+#include "exifcopy.h"
+#include "exifdupe.h"
 #include "exifextras.h"
+#include "exiffilter.h"
+#include "exifgps.h"
 #include "exiflib.h"
 #include "exifparser.h"
+#include "exifprogress.h"
+#include "exifset.h"
+#include "exifstats.h"
+#include "exifworker.h"
+#include "exifwrite.h"
 
 /* -------------------------------------------------------------------------- */
 /* definitions                                                                */
@@ -24,6 +36,13 @@
 #define TASK_GPS 3
 #define TASK_CSV 4
 #define TASK_RENAME 5
+#define TASK_AGG 6
+#define TASK_DUPES 7
+#define TASK_BENCH 8
+#define TASK_THUMB 9
+#define TASK_SET 10
+#define TASK_STRIP 11
+#define TASK_CARVE 12
 
 #define ERR_NO_ARG -601
 #define ERR_ARG_INVALID -602
@@ -39,6 +58,10 @@
 #define ERR_FILEEXISTS -612
 #define ERR_MAKEDIR -613
 #define ERR_RENAME -614
+#define ERR_COPY -615
+#define ERR_GPS_INDEX -616
+#define ERR_FILTER -617
+#define ERR_AGG -618
 
 /* -------------------------------------------------------------------------- */
 /* structs                                                                    */
@@ -50,13 +73,86 @@ struct options {
     int debug;
     char *pattern;
     int simulate;
+    int mode;
+    int workers;
+    char *index;
+    char *within;
+    char *geocode;
+    int format;
+    int track;
+    char *where;
+    struct exifFilter *filter;
+    char *by;
+    int count;
+    char *hist;
+    double bin;
+    int runs;
+    int cold;
+    int stats;
+    char *trace;
+    int progress;
 };
 
-/* -------------------------------------------------------------------------- */
-/* varibles                                                                   */
-/* -------------------------------------------------------------------------- */
+struct aggJob {
+    struct options *opt;
+    char **fileTable;
+    struct aggSpec *specTable;
+    long int specTableItemCount;
+    struct aggTable *tables;
+    char **tagTable;
+    long int tagTableItemCount;
+    struct exifItem *collectTables;
+};
+
+struct geocodeItem {
+    long int valid;
+    long int filtered;
+    double latitude;
+    double longitude;
+    double distance;
+    struct gpsPlace *place;
+};
+
+struct geocodeJob {
+    struct gpsGazetteer *gazetteer;
+    struct geocodeItem *items;
+    long int itemCount;
+};
+
+struct thumbJob {
+    FILE *stream;
+    struct options *opt;
+    char **fileTable;
+    int fdOut;
+};
 
-int debug;
+struct setJob {
+    FILE *stream;
+    struct options *opt;
+    char **fileTable;
+    struct setEdit *edits;
+    long int editCount;
+};
+
+struct stripJob {
+    FILE *stream;
+    struct options *opt;
+    char **fileTable;
+};
+
+struct carveJob {
+    FILE *stream;
+    struct options *opt;
+    char *fileName;
+    struct tagCollector *collector;
+};
+
+struct copyJob {
+    char *srcFileName;
+    char *dstFileName;
+    int mode;
+    long int rc;
+};
 
 /* -------------------------------------------------------------------------- */
 /* public functions                                                           */
@@ -78,13 +174,17 @@ static long int allocateTagTable(char ***tagTable, int tagTableItemCount);
 
 static long int getTagList(int argc, char *argv[], char ***tagTable);
 
+static int usesMakerNotes(struct options *opt, char **tagTable,
+                          long int tagCount);
+
 static long int allocateFileTable(char ***fileTable, int fileTableItemCount);
 
 static long int addFileToFileTable(char *fileName, char ***fileTable,
-                                   long int fileTableItemCount, int recursive);
+                                   long int fileTableItemCount, int recursive,
+                                   int devices);
 
 static long int getFileList(int argc, char *argv[], char ***fileTable,
-                            int recursive);
+                            int recursive, int devices);
 
 static void taskHelp(FILE *stream);
 
@@ -99,9 +199,75 @@ static long int taskCsv(FILE *stream, struct options *opt, char **fileTable,
                         long int fileTableItemCount, char **tagTable,
                         long int tagTableItemCount);
 
+static long int taskGpsQuery(FILE *stream, struct options *opt);
+
+static long int printGpsIndexPoint(struct gpsIndexPoint *point, char *name,
+                                   void *arg);
+
+static long int runGeocodeJob(long int itemNo, int workerNo, void *arg);
+
+static void printGeocodeItem(FILE *stream, struct gpsGazetteer *gazetteer,
+                             struct geocodeItem *item);
+
+static long int taskAgg(FILE *stream, struct options *opt, char **fileTable,
+                        long int fileTableItemCount);
+
+static long int runAggJob(long int itemNo, int workerNo, void *arg);
+
+static long int taskDupes(FILE *stream, struct options *opt, char **fileTable,
+                          long int fileTableItemCount);
+
+static long int runFingerprintJob(long int itemNo, int workerNo, void *arg);
+
+static long int runPayloadJob(long int itemNo, int workerNo, void *arg);
+
+static long int runCompareJob(long int itemNo, int workerNo, void *arg);
+
+static long int taskThumb(FILE *stream, struct options *opt, char **fileTable,
+                          long int fileTableItemCount);
+
+static long int runThumbJob(long int itemNo, int workerNo, void *arg);
+
+static long int writeThumb(struct thumbJob *job, char *srcFileName,
+                           struct exifPreview *preview, int fd);
+
+static long int taskSet(FILE *stream, struct options *opt, char **fileTable,
+                        long int fileTableItemCount, char **tagTable,
+                        long int tagTableItemCount);
+
+static long int runSetJob(long int itemNo, int workerNo, void *arg);
+
+static long int taskStrip(FILE *stream, struct options *opt, char **fileTable,
+                          long int fileTableItemCount);
+
+static long int runStripJob(long int itemNo, int workerNo, void *arg);
+
+static long int taskCarve(FILE *stream, struct options *opt, char **fileTable,
+                          long int fileTableItemCount, char **tagTable,
+                          long int tagTableItemCount);
+
+static long int printCarveHit(struct exifSource *source, long int pos,
+                              void *arg);
+
+static long int taskBench(FILE *stream, struct options *opt, int task,
+                          char **fileTable, long int fileTableItemCount,
+                          char **tagTable, long int tagTableItemCount);
+
+static long int runBenchTask(FILE *stream, struct options *opt, int task,
+                             char **fileTable, char **tagTable,
+                             long int tagTableItemCount);
+
 static long int taskRename(FILE *stream, struct options *opt, char **fileTable,
                            long int fileTableItemCount);
 
+static long int claimFileName(char *fileName, mode_t mode, int *fd);
+
+static long int addCopyJob(struct copyJob **copyTable,
+                           long int copyTableItemCount, char *srcFileName,
+                           char *dstFileName, int mode);
+
+static long int runCopyJob(long int itemNo, int workerNo, void *arg);
+
 static long int createFolders(FILE *stream, char *fileName,
                               struct options *opt);
 
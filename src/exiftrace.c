@@ -0,0 +1,184 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exiftrace.h"
+
+/* -------------------------------------------------------------------------- */
+/* variables                                                                  */
+/* -------------------------------------------------------------------------- */
+
+int traceEnabled = 0;
+
+static __thread struct traceBuffer *threadTrace = NULL;
+
+static struct traceBuffer **traceTable = NULL;
+static long int traceTableItemCount = 0;
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+
+static char *traceFileName = NULL;
+static long int traceTimeStart = 0;
+
+/* -------------------------------------------------------------------------- */
+/* startTrace                                                                 */
+/* turns tracing on. the trace is written to "fileName" by writeTrace.        */
+/* -------------------------------------------------------------------------- */
+
+void startTrace(char *fileName) {
+    traceFileName = fileName;
+    traceTimeStart = statsClock();
+    traceEnabled = 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* addTraceEvent                                                              */
+/* adds a span "name" with the argument "arg" from "start" until now to the   */
+/* ring buffer of the calling thread. when the buffer is full, the oldest     */
+/* span is overwritten.                                                       */
+/* -------------------------------------------------------------------------- */
+
+void addTraceEvent(char *name, char *arg, long int start) {
+    struct traceEvent *event = NULL;
+
+    if (threadTrace == NULL && registerTraceBuffer() == NULL) return;
+
+    event = &(*threadTrace).events[(*threadTrace).eventCount % TRACE_RING_SIZE];
+
+    (*event).name = name;
+    (*event).arg = arg;
+    (*event).start = start;
+    (*event).duration = statsClock() - start;
+
+    (*threadTrace).eventCount++;
+}
+
+/* -------------------------------------------------------------------------- */
+/* registerTraceBuffer                                                        */
+/* allocates the ring buffer of the calling thread and adds it to the trace   */
+/* table. the buffer lives until the process exits. returns the buffer or     */
+/* NULL in case of an error.                                                  */
+/* -------------------------------------------------------------------------- */
+
+static struct traceBuffer *registerTraceBuffer(void) {
+    struct traceBuffer **table = NULL;
+    struct traceBuffer *buffer = NULL;
+
+    if ((buffer = (struct traceBuffer *)malloc(sizeof(struct traceBuffer))) ==
+        NULL)
+        return NULL;
+
+    (*buffer).tid = syscall(SYS_gettid);
+    (*buffer).eventCount = 0;
+
+    pthread_mutex_lock(&traceLock);
+
+    if ((table = (struct traceBuffer **)realloc(
+             traceTable, sizeof(struct traceBuffer *) *
+                             (traceTableItemCount + 1))) == NULL) {
+        pthread_mutex_unlock(&traceLock);
+        free(buffer);
+        return NULL;
+    }
+
+    traceTable = table;
+    traceTable[traceTableItemCount++] = buffer;
+
+    pthread_mutex_unlock(&traceLock);
+
+    threadTrace = buffer;
+
+    return buffer;
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeTrace                                                                 */
+/* writes the spans of all threads in the chrome trace event format, which    */
+/* chrome://tracing and perfetto read. times are in microseconds since        */
+/* startTrace. returns 0 if successful or a negative value otherwise.         */
+/* -------------------------------------------------------------------------- */
+
+long int writeTrace(void) {
+    long int i = 0;
+    long int j = 0;
+    long int first = 0;
+    long int count = 0;
+    long int pid = getpid();
+
+    struct traceBuffer *buffer = NULL;
+    struct traceEvent *event = NULL;
+    FILE *fp = NULL;
+
+    if (!traceEnabled) return 0;
+
+    if ((fp = fopen(traceFileName, "w")) == NULL) return TRACE_ERR_FILE_OPEN;
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,"
+                "\"args\":{\"name\":\"exiftool\"}}",
+            pid);
+
+    pthread_mutex_lock(&traceLock);
+
+    for (i = 0; i < traceTableItemCount; i++) {
+        buffer = traceTable[i];
+
+        /* a full ring starts with its oldest span */
+
+        first = 0;
+        count = (*buffer).eventCount;
+
+        if (count > TRACE_RING_SIZE) {
+            first = count % TRACE_RING_SIZE;
+            count = TRACE_RING_SIZE;
+        }
+
+        for (j = 0; j < count; j++) {
+            event = &(*buffer).events[(first + j) % TRACE_RING_SIZE];
+
+            fprintf(fp,
+                    ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%ld,"
+                    "\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f",
+                    (*event).name, pid, (*buffer).tid,
+                    ((*event).start - traceTimeStart) / 1e3,
+                    (*event).duration / 1e3);
+
+            if ((*event).arg != NULL) {
+                fprintf(fp, ",\"args\":{\"file\":");
+                writeTraceString(fp, (*event).arg);
+                fprintf(fp, "}");
+            }
+
+            fprintf(fp, "}");
+        }
+    }
+
+    pthread_mutex_unlock(&traceLock);
+
+    fprintf(fp, "\n]}\n");
+
+    if (fclose(fp) != 0) return TRACE_ERR_FILE_WRITE;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeTraceString                                                           */
+/* writes "string" to "fp" as a quoted json string.                           */
+/* -------------------------------------------------------------------------- */
+
+static void writeTraceString(FILE *fp, char *string) {
+    unsigned char *c = NULL;
+
+    fputc('"', fp);
+
+    for (c = (unsigned char *)string; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            fprintf(fp, "\\%c", *c);
+        else if (*c < 0x20)
+            fprintf(fp, "\\u%04x", *c);
+        else
+            fputc(*c, fp);
+    }
+
+    fputc('"', fp);
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,76 @@
+#ifndef EXIFTRACE_H_INCLUDED
+#define EXIFTRACE_H_INCLUDED
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "exifstats.h"
+
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define TRACE_RING_SIZE 65536
+
+#define TRACE_ERR_FILE_OPEN -871
+#define TRACE_ERR_FILE_WRITE -872
+
+/* spans cost a branch when tracing is off. "name" must be a string literal,  */
+/* "arg" must live until the trace is written.                                */
+
+#define traceStart() (traceEnabled ? statsClock() : 0)
+
+#define traceSpan(name, arg, start)                                   \
+    do {                                                              \
+        if (traceEnabled) addTraceEvent((name), (arg), (start));      \
+    } while (0)
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct traceEvent {
+    char *name;
+    char *arg;
+    long int start;
+    long int duration;
+};
+
+struct traceBuffer {
+    long int tid;
+    long int eventCount;
+    struct traceEvent events[TRACE_RING_SIZE];
+};
+
+/* -------------------------------------------------------------------------- */
+/* variables                                                                  */
+/* -------------------------------------------------------------------------- */
+
+extern int traceEnabled;
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+void startTrace(char *fileName);
+
+void addTraceEvent(char *name, char *arg, long int start);
+
+long int writeTrace(void);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static struct traceBuffer *registerTraceBuffer(void);
+
+static void writeTraceString(FILE *fp, char *string);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
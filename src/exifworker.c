@@ -0,0 +1,94 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifworker.h"
+
+/* -------------------------------------------------------------------------- */
+/* runWorkers                                                                 */
+/* calls "work" for every item number from 0 to "itemCount" - 1 using         */
+/* "workerCount" threads. items are handed out one by one, so slow items do   */
+/* not hold up the others. a negative value returned by "work" stops the      */
+/* workers from taking new items. returns 0 if successful or the first        */
+/* negative value returned by "work" otherwise.                               */
+/* -------------------------------------------------------------------------- */
+
+long int runWorkers(long int itemCount, int workerCount, workerFunction work,
+                    void *arg) {
+    long int i = 0;
+    long int started = 0;
+    long int rc = 0;
+
+    struct workerPool pool = {work, arg, itemCount, 0, 0};
+    struct workerThread *threads = NULL;
+
+    if (itemCount <= 0) return 0;
+
+    if (workerCount < 1) workerCount = 1;
+    if (workerCount > WORKER_MAX_COUNT) workerCount = WORKER_MAX_COUNT;
+    if (workerCount > itemCount) workerCount = itemCount;
+
+    /* a single worker runs in the calling thread */
+
+    if (workerCount == 1) {
+        for (i = 0; i < itemCount; i++)
+            if ((rc = work(i, 0, arg)) < 0) return rc;
+        return 0;
+    }
+
+    if ((threads = (struct workerThread *)malloc(sizeof(struct workerThread) *
+                                                 workerCount)) == NULL)
+        return WORKER_ERR_MALLOC;
+
+    /* start threads */
+
+    for (i = 0; i < workerCount; i++) {
+        threads[i].pool = &pool;
+        threads[i].workerNo = i;
+
+        if (pthread_create(&threads[i].thread, NULL, workerLoop,
+                           &threads[i]) != 0) {
+            __atomic_store_n(&pool.rc, WORKER_ERR_THREAD, __ATOMIC_RELAXED);
+            break;
+        }
+
+        started++;
+    }
+
+    /* wait for threads */
+
+    for (i = 0; i < started; i++) pthread_join(threads[i].thread, NULL);
+
+    free(threads);
+
+    return pool.rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* workerLoop                                                                 */
+/* thread function. takes items from the pool until there are no items left   */
+/* or an item failed.                                                         */
+/* -------------------------------------------------------------------------- */
+
+static void *workerLoop(void *arg) {
+    long int rc = 0;
+    long int noError = 0;
+    long int itemNo = 0;
+
+    struct workerThread *thread = (struct workerThread *)arg;
+    struct workerPool *pool = (*thread).pool;
+
+    while (__atomic_load_n(&(*pool).rc, __ATOMIC_RELAXED) == 0) {
+        itemNo = __atomic_fetch_add(&(*pool).nextItem, 1, __ATOMIC_RELAXED);
+
+        if (itemNo >= (*pool).itemCount) break;
+
+        if ((rc = (*pool).work(itemNo, (*thread).workerNo, (*pool).arg)) < 0) {
+            __atomic_compare_exchange_n(&(*pool).rc, &noError, rc, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
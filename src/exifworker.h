@@ -0,0 +1,57 @@
+#ifndef EXIFWORKER_H_INCLUDED
+#define EXIFWORKER_H_INCLUDED
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define WORKER_DEFAULT_COUNT 4
+#define WORKER_MAX_COUNT 256
+
+#define WORKER_ERR_MALLOC -801
+#define WORKER_ERR_THREAD -802
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+typedef long int (*workerFunction)(long int itemNo, int workerNo, void *arg);
+
+struct workerPool {
+    workerFunction work;
+    void *arg;
+
+    long int itemCount;
+    long int nextItem;
+    long int rc;
+};
+
+struct workerThread {
+    struct workerPool *pool;
+    int workerNo;
+    pthread_t thread;
+};
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int runWorkers(long int itemCount, int workerCount, workerFunction work,
+                    void *arg);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static void *workerLoop(void *arg);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,691 @@
+/* -------------------------------------------------------------------------- */
+
+#include "exifwrite.h"
+
+/* -------------------------------------------------------------------------- */
+/* openExifRewrite                                                            */
+/* copies the tiff block of the exif APP1 of the jpg "source" to "rewrite".   */
+/* a jpg without exif gets an empty block. "rewrite" must be closed with      */
+/* closeExifRewrite, also if this fails. returns 0 if successful or a         */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+long int openExifRewrite(struct exifRewrite *rewrite,
+                         struct exifSource *source) {
+    long int pos = 2;
+    long int end = 0;
+    long int marker = 0;
+
+    unsigned char *data = (*source).data;
+
+    memset(rewrite, 0, sizeof(struct exifRewrite));
+    (*rewrite).exifFormat = EXIF_FORMAT_INTEL;
+    (*rewrite).tiffPos = -1;
+    (*rewrite).app1Pos = -1;
+
+    if (loadExifSource(source, 0, 4) < 0 ||
+        memcmp(data, soiMarker, SOI_MARKER_LENGTH) != 0)
+        return WRITE_ERR_FORMAT;
+
+    /* find the first exif APP1 */
+
+    while ((marker = nextJpgSegment(source, &pos, &end)) >= 0 &&
+           marker != 0xDA && marker != 0xD9) {
+        if (marker == 0xE1 && end - pos >= 10 + 8 &&
+            loadExifSource(source, pos, end - pos) == 0 &&
+            memcmp(data + pos + 4, exifPrefix, EXIF_PREFIX_LENGTH) == 0)
+            break;
+
+        pos = end;
+    }
+
+    if (marker < 0) return marker;
+
+    if (marker != 0xE1) return createExifRewrite(rewrite, EXIF_FORMAT_INTEL);
+
+    /* copy its tiff block */
+
+    if (data[pos + 10] == 'I' && data[pos + 11] == 'I')
+        (*rewrite).exifFormat = EXIF_FORMAT_INTEL;
+    else if (data[pos + 10] == 'M' && data[pos + 11] == 'M')
+        (*rewrite).exifFormat = EXIF_FORMAT_MOTO;
+    else
+        return WRITE_ERR_EXIF;
+
+    (*rewrite).app1Pos = pos;
+    (*rewrite).tiffPos = pos + 10;
+    (*rewrite).tiffLength = end - (*rewrite).tiffPos;
+    (*rewrite).tiffCapacity = (*rewrite).tiffLength;
+
+    if (((*rewrite).tiff = (unsigned char *)malloc((*rewrite).tiffCapacity)) ==
+        NULL)
+        return WRITE_ERR_MALLOC;
+
+    memcpy((*rewrite).tiff, data + (*rewrite).tiffPos, (*rewrite).tiffLength);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* createExifRewrite                                                          */
+/* creates a tiff block in "exifFormat" with an empty ifd0 in "rewrite", for  */
+/* a jpg without exif. returns 0 if successful or a negative value otherwise. */
+/* -------------------------------------------------------------------------- */
+
+long int createExifRewrite(struct exifRewrite *rewrite, long int exifFormat) {
+    free((*rewrite).tiff);
+
+    memset(rewrite, 0, sizeof(struct exifRewrite));
+    (*rewrite).exifFormat = exifFormat;
+    (*rewrite).tiffPos = -1;
+    (*rewrite).app1Pos = -1;
+    (*rewrite).tiffLength = 8 + 2 + 4;
+    (*rewrite).tiffCapacity = (*rewrite).tiffLength;
+
+    if (((*rewrite).tiff = (unsigned char *)calloc((*rewrite).tiffCapacity,
+                                                   1)) == NULL)
+        return WRITE_ERR_MALLOC;
+
+    /* header and ifd0 at offset 8 */
+
+    memcpy((*rewrite).tiff, exifFormat == EXIF_FORMAT_INTEL ? "II" : "MM", 2);
+    storeExifValue((*rewrite).tiff + 2, 2, 42, exifFormat);
+    storeExifValue((*rewrite).tiff + 4, 4, 8, exifFormat);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* closeExifRewrite                                                           */
+/* releases the tiff block of "rewrite".                                      */
+/* -------------------------------------------------------------------------- */
+
+void closeExifRewrite(struct exifRewrite *rewrite) {
+    free((*rewrite).tiff);
+
+    (*rewrite).tiff = NULL;
+    (*rewrite).tiffLength = 0;
+    (*rewrite).tiffCapacity = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* findRewriteTag                                                             */
+/* returns the position of the entry of tag "tagID" in the ifd "ifdID" of     */
+/* "rewrite", WRITE_ERR_NO_TAG if the ifd or the tag does not exist or        */
+/* another negative value otherwise.                                          */
+/* -------------------------------------------------------------------------- */
+
+long int findRewriteTag(struct exifRewrite *rewrite, long int ifdID,
+                        long int tagID) {
+    long int i = 0;
+    long int ifdPos = 0;
+    long int tagCount = 0;
+    long int entryPos = 0;
+
+    long int exifFormat = (*rewrite).exifFormat;
+
+    if ((ifdPos = getRewriteIfd(rewrite, ifdID, 0)) < 0) return ifdPos;
+
+    tagCount = castUInt16((*rewrite).tiff + ifdPos, exifFormat);
+
+    for (i = 0; i < tagCount; i++) {
+        entryPos = ifdPos + 2 + i * 12;
+
+        if (castUInt16((*rewrite).tiff + entryPos, exifFormat) == tagID)
+            return entryPos;
+    }
+
+    return WRITE_ERR_NO_TAG;
+}
+
+/* -------------------------------------------------------------------------- */
+/* setRewriteTag                                                              */
+/* gives the tag "tagID" of the ifd "ifdID" of "rewrite" the "tagCount"       */
+/* values of "tagType" in "data", in the byte order of the block. a missing   */
+/* tag is added, also a missing exif ifd. a value of more than four bytes     */
+/* takes the place of the old one if it fits, or is appended. returns 0 if    */
+/* successful or a negative value otherwise.                                  */
+/* -------------------------------------------------------------------------- */
+
+long int setRewriteTag(struct exifRewrite *rewrite, long int ifdID,
+                       long int tagID, long int tagType, long int tagCount,
+                       unsigned char *data) {
+    long int size = 0;
+    long int oldSize = 0;
+    long int oldPos = 0;
+    long int entryPos = 0;
+    long int ifdPos = 0;
+    long int dataPos = 0;
+
+    long int exifFormat = (*rewrite).exifFormat;
+
+    if ((size = getTagTypeSize(tagType)) < 0) return WRITE_ERR_EXIF;
+
+    size = size * tagCount;
+
+    /* add the tag if it is missing */
+
+    if ((entryPos = findRewriteTag(rewrite, ifdID, tagID)) ==
+        WRITE_ERR_NO_TAG) {
+        if ((ifdPos = getRewriteIfd(rewrite, ifdID, 1)) < 0) return ifdPos;
+
+        entryPos = relocateRewriteIfd(rewrite, ifdID, ifdPos, tagID);
+    }
+
+    if (entryPos < 0) return entryPos;
+
+    /* the old value, an unknown type has none */
+
+    oldSize = getTagTypeSize(
+        castUInt16((*rewrite).tiff + entryPos + 2, exifFormat));
+    oldSize = oldSize * castUInt32((*rewrite).tiff + entryPos + 4, exifFormat);
+    oldPos = castUInt32((*rewrite).tiff + entryPos + 8, exifFormat);
+
+    if (oldSize <= 4 || oldPos + oldSize > (*rewrite).tiffLength) oldSize = 0;
+
+    /* the new one */
+
+    if (size <= 4) {
+        memset((*rewrite).tiff + entryPos + 8, 0, 4);
+        memcpy((*rewrite).tiff + entryPos + 8, data, size);
+    } else if (size <= oldSize)
+        memcpy((*rewrite).tiff + oldPos, data, size);
+    else {
+        if ((dataPos = appendRewriteData(rewrite, data, size)) < 0)
+            return dataPos;
+
+        storeExifValue((*rewrite).tiff + entryPos + 8, 4, dataPos, exifFormat);
+    }
+
+    storeExifValue((*rewrite).tiff + entryPos + 2, 2, tagType, exifFormat);
+    storeExifValue((*rewrite).tiff + entryPos + 4, 4, tagCount, exifFormat);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeJpgFile                                                               */
+/* writes the jpg "source" of "fileName" again with the exif block of         */
+/* "rewrite", which may be null. with "strip", the metadata segments are      */
+/* dropped. the new file is written next to "fileName", keeps its owner, mode */
+/* and timestamps, is synced and renamed over it. returns 0 if successful or  */
+/* a negative value otherwise.                                                */
+/* -------------------------------------------------------------------------- */
+
+long int writeJpgFile(char *fileName, struct exifSource *source,
+                      struct exifRewrite *rewrite, int strip) {
+    long int rc = 0;
+    int fdIn = -1;
+    int fdOut = -1;
+
+    char *path = NULL;
+    char *tempName = NULL;
+    struct stat fileStat;
+    struct timespec fileTimes[2];
+
+    if (loadExifSource(source, 0, 4) < 0 ||
+        memcmp((*source).data, soiMarker, SOI_MARKER_LENGTH) != 0)
+        return WRITE_ERR_FORMAT;
+
+    /* a link is followed, the file it points to is replaced */
+
+    if ((path = realpath(fileName, NULL)) == NULL) return WRITE_ERR_FILE_OPEN;
+
+    if ((tempName = (char *)malloc(strlen(path) + 8)) == NULL) {
+        free(path);
+        return WRITE_ERR_MALLOC;
+    }
+
+    sprintf(tempName, "%s.XXXXXX", path);
+
+    if ((fdIn = open(path, O_RDONLY)) < 0 || fstat(fdIn, &fileStat) < 0)
+        rc = WRITE_ERR_FILE_OPEN;
+    else if ((fdOut = mkstemp(tempName)) < 0)
+        rc = WRITE_ERR_FILE_OPEN;
+    else
+        rc = copyJpgSegments(source, rewrite, strip, fdIn, fdOut);
+
+    /* keep owner, mode and timestamps. only root may give the file to   */
+    /* someone else, other users keep at least the group if they can     */
+
+    if (rc == 0 && fchown(fdOut, fileStat.st_uid, fileStat.st_gid) < 0 &&
+        fchown(fdOut, -1, fileStat.st_gid) < 0 && errno != EPERM)
+        rc = WRITE_ERR_FILE_WRITE;
+
+    if (rc == 0 && fchmod(fdOut, fileStat.st_mode & 07777) < 0)
+        rc = WRITE_ERR_FILE_WRITE;
+
+    if (rc == 0) {
+        fileTimes[0] = fileStat.st_atim;
+        fileTimes[1] = fileStat.st_mtim;
+        futimens(fdOut, fileTimes);
+    }
+
+    /* the data is on disk before the rename, so a crash leaves either */
+    /* the old or the new file                                         */
+
+    if (rc == 0 && fsync(fdOut) < 0) rc = WRITE_ERR_FILE_WRITE;
+
+    if (fdIn >= 0) close(fdIn);
+
+    if (fdOut >= 0 && close(fdOut) < 0 && rc == 0) rc = WRITE_ERR_FILE_WRITE;
+
+    /* replace the old file */
+
+    if (rc == 0 && rename(tempName, path) < 0) rc = WRITE_ERR_FILE_RENAME;
+
+    if (rc < 0 && fdOut >= 0) unlink(tempName);
+
+    free(tempName);
+    free(path);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* stripFile                                                                  */
+/* drops the metadata segments of the jpg "fileName" if it matches "filter",  */
+/* which may be null. an orientation other than 1 is kept. with "simulate",   */
+/* the file is not written. returns 0 if successful, EXIF_FILTERED if the     */
+/* file does not match or another negative value otherwise.                   */
+/* -------------------------------------------------------------------------- */
+
+long int stripFile(char *fileName, struct exifFilter *filter, int simulate) {
+    long int rc = 0;
+    long int entryPos = 0;
+    long int orientation = 0;
+
+    unsigned char bytes[2];
+    struct exifSource source;
+    struct exifRewrite old;
+    struct exifRewrite stripped;
+
+    memset(&old, 0, sizeof(struct exifRewrite));
+    memset(&stripped, 0, sizeof(struct exifRewrite));
+
+    if ((rc = openExifSource(&exifDefaultContext, fileName, &source)) < 0)
+        return rc;
+
+    if (filter != NULL)
+        rc = visitExifInfoFiltered(&source, filter, NULL, NULL);
+
+    /* a broken exif block is stripped as well */
+
+    if (rc >= 0 && (rc = openExifRewrite(&old, &source)) == WRITE_ERR_EXIF)
+        rc = 0;
+
+    if (rc >= 0 &&
+        (entryPos = findRewriteTag(&old, IFD_ID_IFD, 0x0112)) >= 0 &&
+        castUInt16(old.tiff + entryPos + 2, old.exifFormat) == 3)
+        orientation = castUInt16(old.tiff + entryPos + 8, old.exifFormat);
+
+    if (rc >= 0 && orientation > 1 && orientation <= 8) {
+        storeExifValue(bytes, 2, orientation, old.exifFormat);
+
+        if ((rc = createExifRewrite(&stripped, old.exifFormat)) == 0)
+            rc = setRewriteTag(&stripped, IFD_ID_IFD, 0x0112, 3, 1, bytes);
+    }
+
+    if (rc >= 0 && !simulate)
+        rc = writeJpgFile(fileName, &source,
+                          stripped.tiff != NULL ? &stripped : NULL, 1);
+
+    closeExifRewrite(&old);
+    closeExifRewrite(&stripped);
+    closeExifSource(&source);
+
+    if (rc < 0) return rc;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* storeExifValue                                                             */
+/* writes the lowest "size" bytes of "value" to "bytes" in "exifFormat".      */
+/* -------------------------------------------------------------------------- */
+
+void storeExifValue(unsigned char *bytes, long int size, uint32_t value,
+                    long int exifFormat) {
+    long int i = 0;
+
+    for (i = 0; i < size; i++) {
+        if (exifFormat == EXIF_FORMAT_INTEL)
+            bytes[i] = (value >> (8 * i)) & 0xFF;
+        else
+            bytes[size - 1 - i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* getRewriteIfd                                                              */
+/* returns the position of the ifd "ifdID" (ifd0, exif or gps) in "rewrite".  */
+/* with "create", a missing exif or gps ifd is added empty. returns           */
+/* WRITE_ERR_NO_TAG if the ifd does not exist or another negative value in    */
+/* case of an error.                                                          */
+/* -------------------------------------------------------------------------- */
+
+static long int getRewriteIfd(struct exifRewrite *rewrite, long int ifdID,
+                              int create) {
+    long int ifdPos = 0;
+    long int entryPos = 0;
+    long int pointerTagID = 0;
+
+    long int exifFormat = (*rewrite).exifFormat;
+    unsigned char bytes[4];
+
+    if ((*rewrite).tiffLength < 8) return WRITE_ERR_EXIF;
+
+    if (ifdID == IFD_ID_IFD)
+        ifdPos = castUInt32((*rewrite).tiff + 4, exifFormat);
+    else if (ifdID == IFD_ID_EXIFOFFSET || ifdID == IFD_ID_GPSINFO) {
+        pointerTagID = ifdID == IFD_ID_EXIFOFFSET ? 0x8769 : 0x8825;
+        entryPos = findRewriteTag(rewrite, IFD_ID_IFD, pointerTagID);
+
+        /* an empty ifd is added */
+
+        if (entryPos == WRITE_ERR_NO_TAG && create) {
+            if ((ifdPos = appendRewriteData(rewrite, NULL, 2 + 4)) < 0)
+                return ifdPos;
+
+            storeExifValue(bytes, 4, ifdPos, exifFormat);
+
+            if ((entryPos = setRewriteTag(rewrite, IFD_ID_IFD, pointerTagID, 4,
+                                          1, bytes)) < 0)
+                return entryPos;
+
+            return ifdPos;
+        }
+
+        if (entryPos < 0) return entryPos;
+
+        ifdPos = castUInt32((*rewrite).tiff + entryPos + 8, exifFormat);
+    } else
+        return WRITE_ERR_IFD;
+
+    /* the entries and the link must be in the block */
+
+    if (ifdPos < 8 || ifdPos + 2 > (*rewrite).tiffLength ||
+        ifdPos + 2 +
+                castUInt16((*rewrite).tiff + ifdPos, exifFormat) * 12 + 4 >
+            (*rewrite).tiffLength)
+        return WRITE_ERR_EXIF;
+
+    return ifdPos;
+}
+
+/* -------------------------------------------------------------------------- */
+/* relocateRewriteIfd                                                         */
+/* copies the ifd "ifdID" at "ifdPos" to the end of "rewrite" with a new      */
+/* entry for "tagID" sorted in, and points the header or the ifd0 entry of    */
+/* the ifd to the copy. returns the position of the new, empty entry or a     */
+/* negative value in case of an error.                                        */
+/* -------------------------------------------------------------------------- */
+
+static long int relocateRewriteIfd(struct exifRewrite *rewrite,
+                                   long int ifdID, long int ifdPos,
+                                   long int tagID) {
+    long int i = 0;
+    long int j = 0;
+    long int rc = 0;
+    long int newPos = 0;
+    long int entryPos = -1;
+    long int tagCount = 0;
+
+    long int exifFormat = (*rewrite).exifFormat;
+    unsigned char *tiff = NULL;
+
+    if ((tagCount = castUInt16((*rewrite).tiff + ifdPos, exifFormat)) ==
+        0xFFFF)
+        return WRITE_ERR_SIZE;
+
+    if ((newPos = appendRewriteData(rewrite, NULL,
+                                    2 + (tagCount + 1) * 12 + 4)) < 0)
+        return newPos;
+
+    tiff = (*rewrite).tiff;
+
+    storeExifValue(tiff + newPos, 2, tagCount + 1, exifFormat);
+
+    for (i = 0, j = 0; i <= tagCount; i++, j++) {
+        if (entryPos < 0 &&
+            (i == tagCount ||
+             castUInt16(tiff + ifdPos + 2 + i * 12, exifFormat) > tagID)) {
+            entryPos = newPos + 2 + j * 12;
+            storeExifValue(tiff + entryPos, 2, tagID, exifFormat);
+            j++;
+        }
+
+        if (i < tagCount)
+            memcpy(tiff + newPos + 2 + j * 12, tiff + ifdPos + 2 + i * 12, 12);
+    }
+
+    /* the link to the next ifd */
+
+    memcpy(tiff + newPos + 2 + (tagCount + 1) * 12,
+           tiff + ifdPos + 2 + tagCount * 12, 4);
+
+    /* point to the copy */
+
+    if (ifdID == IFD_ID_IFD)
+        storeExifValue(tiff + 4, 4, newPos, exifFormat);
+    else {
+        if ((rc = findRewriteTag(
+                 rewrite, IFD_ID_IFD,
+                 ifdID == IFD_ID_EXIFOFFSET ? 0x8769 : 0x8825)) < 0)
+            return rc;
+
+        storeExifValue(tiff + rc + 8, 4, newPos, exifFormat);
+    }
+
+    return entryPos;
+}
+
+/* -------------------------------------------------------------------------- */
+/* appendRewriteData                                                          */
+/* appends the "length" bytes of "data", or zeros if null, to the block of    */
+/* "rewrite" at an even position. returns the position if successful or a     */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int appendRewriteData(struct exifRewrite *rewrite,
+                                  unsigned char *data, long int length) {
+    long int pos = ((*rewrite).tiffLength + 1) & ~1L;
+    long int capacity = (*rewrite).tiffCapacity;
+
+    unsigned char *tiff = NULL;
+
+    if (pos + length > WRITE_MAX_TIFF_LENGTH) return WRITE_ERR_SIZE;
+
+    if (pos + length > capacity) {
+        while (pos + length > capacity) capacity = capacity * 2 + 64;
+
+        if ((tiff = (unsigned char *)realloc((*rewrite).tiff, capacity)) ==
+            NULL)
+            return WRITE_ERR_MALLOC;
+
+        (*rewrite).tiff = tiff;
+        (*rewrite).tiffCapacity = capacity;
+    }
+
+    memset((*rewrite).tiff + (*rewrite).tiffLength, 0,
+           pos - (*rewrite).tiffLength);
+
+    if (data != NULL)
+        memcpy((*rewrite).tiff + pos, data, length);
+    else
+        memset((*rewrite).tiff + pos, 0, length);
+
+    (*rewrite).tiffLength = pos + length;
+
+    return pos;
+}
+
+/* -------------------------------------------------------------------------- */
+/* nextJpgSegment                                                             */
+/* reads the jpg segment of "source" at "pos". "pos" is moved past fill bytes */
+/* and "end" is set to the end of the segment, or to "pos" for the start of   */
+/* the image data. returns the marker if successful or a negative value       */
+/* otherwise.                                                                 */
+/* -------------------------------------------------------------------------- */
+
+static long int nextJpgSegment(struct exifSource *source, long int *pos,
+                               long int *end) {
+    long int p = *pos;
+    long int marker = 0;
+    long int length = 0;
+
+    unsigned char *data = (*source).data;
+
+    if (loadExifSource(source, p, 2) < 0 || data[p] != 0xFF)
+        return WRITE_ERR_FORMAT;
+
+    while (loadExifSource(source, p + 1, 1) == 0 && data[p + 1] == 0xFF) p++;
+
+    if (loadExifSource(source, p, 2) < 0) return WRITE_ERR_FORMAT;
+
+    marker = data[p + 1];
+    *pos = p;
+
+    /* image data and markers without a length */
+
+    if (marker == 0xDA || marker == 0xD9) {
+        *end = p;
+        return marker;
+    }
+
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+        *end = p + 2;
+        return marker;
+    }
+
+    if (loadExifSource(source, p, 4) < 0) return WRITE_ERR_FORMAT;
+
+    length = data[p + 2] * 256 + data[p + 3];
+    *end = p + 2 + length;
+
+    if (length < 2 || *end > (*source).size) return WRITE_ERR_FORMAT;
+
+    return marker;
+}
+
+/* -------------------------------------------------------------------------- */
+/* keepStripSegment                                                           */
+/* returns 1 if the segment of "marker" from "pos" to "end" of "source" is    */
+/* kept by stripping, or 0 otherwise.                                         */
+/* -------------------------------------------------------------------------- */
+
+static int keepStripSegment(struct exifSource *source, long int pos,
+                            long int marker, long int end) {
+    if (marker == 0xE0 || marker == 0xEE) return 1;
+
+    if (marker == 0xE2)
+        return end - pos >= 4 + ICC_PROFILE_HEADER_LENGTH &&
+               loadExifSource(source, pos + 4, ICC_PROFILE_HEADER_LENGTH) ==
+                   0 &&
+               memcmp((*source).data + pos + 4, iccProfileHeader,
+                      ICC_PROFILE_HEADER_LENGTH) == 0;
+
+    return marker < 0xE0 || (marker > 0xEF && marker != 0xFE);
+}
+
+/* -------------------------------------------------------------------------- */
+/* copyJpgSegments                                                            */
+/* copies the jpg "source" opened as "fdIn" to "fdOut". the exif APP1 of      */
+/* "rewrite" is replaced, or inserted after the APP0 segments, and with       */
+/* "strip" the metadata segments are dropped. runs of kept bytes and the      */
+/* image data are copied with copyFileData. returns 0 if successful or a      */
+/* negative value otherwise.                                                  */
+/* -------------------------------------------------------------------------- */
+
+static long int copyJpgSegments(struct exifSource *source,
+                                struct exifRewrite *rewrite, int strip,
+                                int fdIn, int fdOut) {
+    long int rc = 0;
+    long int pos = 2;
+    long int end = 0;
+    long int marker = 0;
+    long int copyStart = 0;
+
+    int pending = rewrite != NULL && (*rewrite).app1Pos < 0;
+    int replace = 0;
+    int drop = 0;
+    int insert = 0;
+
+    while ((marker = nextJpgSegment(source, &pos, &end)) >= 0 &&
+           marker != 0xDA && marker != 0xD9) {
+        replace = rewrite != NULL && pos == (*rewrite).app1Pos;
+        drop = replace ||
+               (strip && !keepStripSegment(source, pos, marker, end));
+        insert = pending && marker != 0xE0;
+
+        /* copy the bytes kept so far, then the new segment */
+
+        if (insert || drop) {
+            rc = copyFileData(fdIn, copyStart, fdOut, pos - copyStart);
+
+            if (rc == 0 && (insert || replace))
+                rc = writeRewriteApp1(fdOut, rewrite);
+
+            if (rc < 0) return rc;
+
+            pending = pending && !insert;
+            copyStart = drop ? end : pos;
+        }
+
+        pos = end;
+    }
+
+    if (marker < 0) return marker;
+
+    if (pending) {
+        rc = copyFileData(fdIn, copyStart, fdOut, pos - copyStart);
+
+        if (rc == 0) rc = writeRewriteApp1(fdOut, rewrite);
+
+        if (rc < 0) return rc;
+
+        copyStart = pos;
+    }
+
+    /* the image data */
+
+    return copyFileData(fdIn, copyStart, fdOut, (*source).size - copyStart);
+}
+
+/* -------------------------------------------------------------------------- */
+/* writeRewriteApp1                                                           */
+/* writes the exif APP1 segment with the block of "rewrite" to "fd". returns  */
+/* 0 if successful or a negative value otherwise.                             */
+/* -------------------------------------------------------------------------- */
+
+static long int writeRewriteApp1(int fd, struct exifRewrite *rewrite) {
+    long int i = 0;
+    long int done = 0;
+    long int length = 0;
+    ssize_t n = 0;
+
+    unsigned char header[4 + EXIF_PREFIX_LENGTH] = {0xFF, 0xE1};
+    unsigned char *parts[2] = {header, (*rewrite).tiff};
+    long int partLengths[2] = {4 + EXIF_PREFIX_LENGTH, (*rewrite).tiffLength};
+
+    if ((*rewrite).tiffLength > WRITE_MAX_TIFF_LENGTH) return WRITE_ERR_SIZE;
+
+    length = 2 + EXIF_PREFIX_LENGTH + (*rewrite).tiffLength;
+    header[2] = (length >> 8) & 0xFF;
+    header[3] = length & 0xFF;
+    memcpy(header + 4, exifPrefix, EXIF_PREFIX_LENGTH);
+
+    for (i = 0; i < 2; i++) {
+        for (done = 0; done < partLengths[i]; done = done + n) {
+            n = write(fd, parts[i] + done, partLengths[i] - done);
+
+            if (n < 0 && errno == EINTR) n = 0;
+
+            if (n < 0) return WRITE_ERR_FILE_WRITE;
+        }
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
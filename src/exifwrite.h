@@ -0,0 +1,129 @@
+#ifndef EXIFWRITE_H_INCLUDED
+#define EXIFWRITE_H_INCLUDED
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exifcopy.h"
+#include "exiffilter.h"
+#include "exiflib.h"
+
+/* -------------------------------------------------------------------------- */
+/* info box                                                                   */
+/* -------------------------------------------------------------------------- */
+/*                                                                            */
+/*    rewriting the exif segment of jpg files:                                */
+/*                                                                            */
+/*       SOI APP0 APP1(new) DQT ... SOS <image data copied in the kernel>     */
+/*                                                                            */
+/*    the tiff block of the exif APP1 is copied to memory as it is, so all    */
+/*    of its offsets stay valid, including those inside of maker notes and    */
+/*    the thumbnail. a value that grows is appended to the block and its tag  */
+/*    points to it. an ifd that gets a new tag is copied to the end with the  */
+/*    tag sorted in, and the offset pointing to the ifd is changed. the old   */
+/*    bytes are left as unused space.                                         */
+/*                                                                            */
+/*    the new file is written next to the old one: the segments before the    */
+/*    image data are copied, except for the replaced or stripped ones, and    */
+/*    the rest of the file is copied with copyFileData, which keeps the       */
+/*    image data in the kernel. the new file is then renamed over the old     */
+/*    one, so a reader sees either the old or the new file, never a part.     */
+/*                                                                            */
+/*    stripping drops every APP1 (exif and xmp), APP13 (iptc), COM and the    */
+/*    other APPn segments. APP0 (jfif), APP2 with an icc profile and APP14    */
+/*    (adobe) are kept, as they change how the image looks. the orientation   */
+/*    is kept in a new minimal exif segment.                                  */
+/*                                                                            */
+/* -------------------------------------------------------------------------- */
+/* definitions                                                                */
+/* -------------------------------------------------------------------------- */
+
+#define WRITE_MAX_TIFF_LENGTH (0xFFFF - 2 - EXIF_PREFIX_LENGTH)
+
+#define WRITE_ERR_MALLOC -901
+#define WRITE_ERR_FORMAT -902
+#define WRITE_ERR_EXIF -903
+#define WRITE_ERR_SIZE -904
+#define WRITE_ERR_NO_TAG -905
+#define WRITE_ERR_IFD -906
+#define WRITE_ERR_FILE_OPEN -907
+#define WRITE_ERR_FILE_WRITE -908
+#define WRITE_ERR_FILE_RENAME -909
+
+/* -------------------------------------------------------------------------- */
+/* structs                                                                    */
+/* -------------------------------------------------------------------------- */
+
+struct exifRewrite {
+    long int exifFormat;
+    unsigned char *tiff;
+    long int tiffLength;
+    long int tiffCapacity;
+    long int tiffPos;
+    long int app1Pos;
+};
+
+/* -------------------------------------------------------------------------- */
+/* public functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+long int openExifRewrite(struct exifRewrite *rewrite,
+                         struct exifSource *source);
+
+long int createExifRewrite(struct exifRewrite *rewrite, long int exifFormat);
+
+void closeExifRewrite(struct exifRewrite *rewrite);
+
+long int findRewriteTag(struct exifRewrite *rewrite, long int ifdID,
+                        long int tagID);
+
+long int setRewriteTag(struct exifRewrite *rewrite, long int ifdID,
+                       long int tagID, long int tagType, long int tagCount,
+                       unsigned char *data);
+
+long int writeJpgFile(char *fileName, struct exifSource *source,
+                      struct exifRewrite *rewrite, int strip);
+
+long int stripFile(char *fileName, struct exifFilter *filter, int simulate);
+
+void storeExifValue(unsigned char *bytes, long int size, uint32_t value,
+                    long int exifFormat);
+
+/* -------------------------------------------------------------------------- */
+/* static functions                                                           */
+/* -------------------------------------------------------------------------- */
+
+static long int getRewriteIfd(struct exifRewrite *rewrite, long int ifdID,
+                              int create);
+
+static long int relocateRewriteIfd(struct exifRewrite *rewrite,
+                                   long int ifdID, long int ifdPos,
+                                   long int tagID);
+
+static long int appendRewriteData(struct exifRewrite *rewrite,
+                                  unsigned char *data, long int length);
+
+static long int nextJpgSegment(struct exifSource *source, long int *pos,
+                               long int *end);
+
+static int keepStripSegment(struct exifSource *source, long int pos,
+                            long int marker, long int end);
+
+static long int copyJpgSegments(struct exifSource *source,
+                                struct exifRewrite *rewrite, int strip,
+                                int fdIn, int fdOut);
+
+static long int writeRewriteApp1(int fd, struct exifRewrite *rewrite);
+
+/* -------------------------------------------------------------------------- */
+
+#endif
+
+/* -------------------------------------------------------------------------- */